@@ -58,9 +58,12 @@
 #include "caches/image_cache.h"
 #include "imageio/imageio_module.h"
 #include "common/l10n.h"
+#include "common/times.h"
 
 #include <inttypes.h>
 #include <libintl.h>
+#include <stdio.h>
+#include <unistd.h>
 
 #ifdef __APPLE__
 #include "osx/osx.h"
@@ -103,6 +106,11 @@ static void usage(const char *progname)
   fprintf(stderr, "   --icc-file <file> specify icc filename, default to NONE\n");
   fprintf(stderr, "   --icc-intent <intent> specify icc intent, default to LAST\n");
   fprintf(stderr, "                     use --help icc-intent for list of supported intents\n");
+  fprintf(stderr, "   --serve           stay resident and export the requests read from stdin,\n");
+  fprintf(stderr, "                     one JSON object per line, answering one per line on\n");
+  fprintf(stderr, "                     stdout; takes no positional argument, the options\n");
+  fprintf(stderr, "                     above become each request's defaults\n");
+  fprintf(stderr, "   --jobs <n>        requests processed at once with --serve, default: 1\n");
   fprintf(stderr, "   --verbose\n");
   fprintf(stderr, "   --help,-h [option]\n");
   fprintf(stderr, "   --version\n");
@@ -195,6 +203,448 @@ static dt_iop_color_intent_t get_icc_intent(const char* option)
 }
 #undef ICC_INTENT_FROM_STR
 
+/* --serve: one resident process for many exports.
+ *
+ * A job system calling ansel-cli once per image pays library init, module load and OpenCL
+ * setup every time, for a few hundred milliseconds of actual processing. In server mode the
+ * process reads one JSON object per line on stdin, exports it, and answers with one JSON
+ * object per line on stdout, until stdin closes. Everything that survives between jobs -- the
+ * pixelpipe cache, module global data (lensfun database, compiled LUTs, OpenCL kernels) --
+ * is paid for once.
+ *
+ * Request members, all optional but "input" and "output", default to the command line options:
+ *   {"id": <anything, echoed back>, "input": "file.raw", "xmp": "file.raw.xmp",
+ *    "output": "dir/or/pattern", "out-ext": "jpg", "width": 0, "height": 0, "style": "name",
+ *    "export-masks": false, "icc-type": "SRGB", "icc-file": "file.icc", "icc-intent": "PERCEPTUAL"}
+ * Answer:
+ *   {"id": <echoed>, "status": "ok" | "error", "error": "why", "seconds": 1.23}
+ *
+ * Up to --jobs requests run at once. Pipelines themselves still run one at a time (see
+ * dt_pipeline_threadsafe_mutex()), so extra jobs overlap decoding, encoding and disk I/O with
+ * the pipe, not pipes with each other. Answers come in completion order: match them by "id".
+ */
+
+typedef struct _cli_job_t
+{
+  JsonNode *id;
+  gchar *input;
+  gchar *xmp;
+  gchar *output;
+  gchar *out_ext;
+  gchar *style;
+  gchar *icc_filename;
+  int width, height;
+  gboolean export_masks;
+  dt_colorspaces_color_profile_type_t icc_type;
+  dt_iop_color_intent_t icc_intent;
+} _cli_job_t;
+
+typedef struct _cli_server_t
+{
+  GMutex lock;        // guards busy, and serializes imports into the library
+  GCond idle;
+  GHashTable *busy;   // input files being processed: one job per file at a time
+  GMutex out_lock;    // one answer per line on out
+  FILE *out;          // the process' real stdout, which nothing but the answers may write to
+} _cli_server_t;
+
+static void _cli_job_free(_cli_job_t *job)
+{
+  if(job->id) json_node_unref(job->id);
+  dt_free(job->input);
+  dt_free(job->xmp);
+  dt_free(job->output);
+  dt_free(job->out_ext);
+  dt_free(job->style);
+  dt_free(job->icc_filename);
+  dt_free(job);
+}
+
+// whether a member holds a scalar of the given type: the json_object_get_*_member() getters
+// return NULL or 0 for anything else, which must not reach the export
+static gboolean _cli_json_holds(JsonObject *obj, const char *member, const GType type)
+{
+  JsonNode *node = json_object_get_member(obj, member);
+  return JSON_NODE_HOLDS_VALUE(node) && json_node_get_value_type(node) == type;
+}
+
+/* A string member, the fallback when it is missing, NULL when it is null. Anything else is an
+ * error, reported once. */
+static gchar *_cli_json_string(JsonObject *obj, const char *member, const gchar *fallback, GString *error)
+{
+  if(!json_object_has_member(obj, member)) return g_strdup(fallback);
+  if(JSON_NODE_HOLDS_NULL(json_object_get_member(obj, member))) return NULL;
+  if(!_cli_json_holds(obj, member, G_TYPE_STRING))
+  {
+    if(error->len == 0) g_string_printf(error, "\"%s\" must be a string", member);
+    return NULL;
+  }
+  return g_strdup(json_object_get_string_member(obj, member));
+}
+
+static int _cli_json_size(JsonObject *obj, const char *member, const int fallback, GString *error)
+{
+  if(!json_object_has_member(obj, member)) return fallback;
+  if(!_cli_json_holds(obj, member, G_TYPE_INT64))
+  {
+    if(error->len == 0) g_string_printf(error, "\"%s\" must be an integer", member);
+    return fallback;
+  }
+  return MAX((int)json_object_get_int_member(obj, member), 0);
+}
+
+/* Parse one request line into a job, starting from the command line options. On error, the
+ * job is still returned when its "id" could be read, so the answer can carry it. */
+static _cli_job_t *_cli_job_parse(const _cli_job_t *defaults, const gchar *line, GString *error)
+{
+  _cli_job_t *job = calloc(1, sizeof(_cli_job_t));
+  job->width = defaults->width;
+  job->height = defaults->height;
+  job->export_masks = defaults->export_masks;
+  job->icc_type = defaults->icc_type;
+  job->icc_intent = defaults->icc_intent;
+
+  JsonParser *parser = json_parser_new();
+  GError *gerror = NULL;
+  if(!json_parser_load_from_data(parser, line, -1, &gerror))
+  {
+    g_string_assign(error, gerror->message);
+    g_error_free(gerror);
+    g_object_unref(parser);
+    return job;
+  }
+
+  JsonNode *root = json_parser_get_root(parser);
+  if(IS_NULL_PTR(root) || !JSON_NODE_HOLDS_OBJECT(root))
+  {
+    g_string_assign(error, "request is not a JSON object");
+    g_object_unref(parser);
+    return job;
+  }
+
+  JsonObject *obj = json_node_get_object(root);
+  if(json_object_has_member(obj, "id")) job->id = json_node_copy(json_object_get_member(obj, "id"));
+
+  job->input = _cli_json_string(obj, "input", NULL, error);
+  job->xmp = _cli_json_string(obj, "xmp", NULL, error);
+  job->output = _cli_json_string(obj, "output", NULL, error);
+  job->out_ext = _cli_json_string(obj, "out-ext", defaults->out_ext, error);
+  job->style = _cli_json_string(obj, "style", defaults->style, error);
+  job->icc_filename = _cli_json_string(obj, "icc-file", defaults->icc_filename, error);
+  job->width = _cli_json_size(obj, "width", job->width, error);
+  job->height = _cli_json_size(obj, "height", job->height, error);
+  if(json_object_has_member(obj, "export-masks"))
+  {
+    if(_cli_json_holds(obj, "export-masks", G_TYPE_BOOLEAN))
+      job->export_masks = json_object_get_boolean_member(obj, "export-masks");
+    else if(error->len == 0)
+      g_string_assign(error, "\"export-masks\" must be a boolean");
+  }
+
+  if(json_object_has_member(obj, "icc-type"))
+  {
+    gchar *value = _cli_json_string(obj, "icc-type", NULL, error);
+    if(value)
+    {
+      gchar *str = g_ascii_strup(value, -1);
+      job->icc_type = get_icc_type(str);
+      dt_free(str);
+    }
+    dt_free(value);
+    if(error->len == 0 && job->icc_type >= DT_COLORSPACE_LAST) g_string_assign(error, "unknown icc-type");
+  }
+  if(json_object_has_member(obj, "icc-intent"))
+  {
+    gchar *value = _cli_json_string(obj, "icc-intent", NULL, error);
+    if(value)
+    {
+      gchar *str = g_ascii_strup(value, -1);
+      job->icc_intent = get_icc_intent(str);
+      dt_free(str);
+    }
+    dt_free(value);
+    if(error->len == 0 && job->icc_intent >= DT_INTENT_LAST) g_string_assign(error, "unknown icc-intent");
+  }
+
+  if(error->len == 0 && (IS_NULL_PTR(job->input) || IS_NULL_PTR(job->output)))
+    g_string_assign(error, "\"input\" and \"output\" are required");
+  else if(error->len == 0 && job->out_ext && *job->out_ext == '.')
+    memmove(job->out_ext, job->out_ext + 1, strlen(job->out_ext));
+
+  if(error->len == 0 && job->out_ext && strlen(job->out_ext) > DT_MAX_OUTPUT_EXT_LENGTH)
+    g_string_assign(error, "out-ext is too long");
+
+  g_object_unref(parser);
+  return job;
+}
+
+/* Same rules as the command line: a directory exports to $(FILE_NAME) in it, otherwise the
+ * extension comes from out-ext or from the destination itself. */
+static gboolean _cli_job_destination(const _cli_job_t *job, gchar **pattern, gchar **ext, GString *error)
+{
+  gchar *out = g_strdup(job->output);
+  gchar *out_ext = g_strdup(job->out_ext);
+
+  if(g_file_test(out, G_FILE_TEST_IS_DIR))
+  {
+    if(IS_NULL_PTR(out_ext)) out_ext = g_strdup("jpg");
+    if(g_str_has_suffix(out, "/")) out[strlen(out) - 1] = '\0';
+    gchar *dir = out;
+    out = g_strconcat(dir, "/$(FILE_NAME)", NULL);
+    dt_free(dir);
+  }
+  else
+  {
+    char *dot = strrchr(out, '.');
+    if(IS_NULL_PTR(out_ext))
+    {
+      if(IS_NULL_PTR(dot) || strlen(dot) <= 1 || strlen(dot) > DT_MAX_OUTPUT_EXT_LENGTH)
+      {
+        g_string_assign(error, "no usable output file extension");
+        dt_free(out);
+        return FALSE;
+      }
+      out_ext = g_strdup(dot + 1);
+      *dot = '\0';
+    }
+    else if(dot && !strcmp(out_ext, dot + 1))
+      *dot = '\0';
+  }
+
+  if(!strcmp(out_ext, "jpg"))
+  {
+    dt_free(out_ext);
+    out_ext = g_strdup("jpeg");
+  }
+  else if(!strcmp(out_ext, "tif"))
+  {
+    dt_free(out_ext);
+    out_ext = g_strdup("tiff");
+  }
+
+  *pattern = out;
+  *ext = out_ext;
+  return TRUE;
+}
+
+/* The export part of main(), for one image with its own storage and format parameters, so
+ * that concurrent jobs share nothing but the modules. */
+static int _cli_job_export(const _cli_job_t *job, const int32_t imgid, const gchar *pattern, const gchar *ext,
+                           GString *error)
+{
+  dt_imageio_module_storage_t *storage = dt_imageio_get_storage_by_name("disk");
+  dt_imageio_module_format_t *format = dt_imageio_get_format_by_name(ext);
+  if(IS_NULL_PTR(storage) || IS_NULL_PTR(format))
+  {
+    g_string_printf(error, IS_NULL_PTR(storage) ? "cannot find disk storage module" : "unknown extension '.%s'",
+                    ext);
+    return 1;
+  }
+
+  dt_imageio_module_data_t *sdata = storage->get_params(storage);
+  dt_imageio_module_data_t *fdata = format->get_params(format);
+  if(IS_NULL_PTR(sdata) || IS_NULL_PTR(fdata))
+  {
+    g_string_assign(error, "failed to get export parameters");
+    if(sdata) storage->free_params(storage, sdata);
+    if(fdata) format->free_params(format, fdata);
+    return 1;
+  }
+
+  // same ugly hack as main(): the disk storage parameters start with the filename
+  g_strlcpy((char *)sdata, pattern, DT_MAX_PATH_FOR_PARAMS);
+
+  uint32_t w, h, fw = 0, fh = 0, sw = 0, sh = 0;
+  storage->dimension(storage, sdata, &sw, &sh);
+  format->dimension(format, fdata, &fw, &fh);
+  w = (sw == 0 || fw == 0) ? MAX(sw, fw) : MIN(sw, fw);
+  h = (sh == 0 || fh == 0) ? MAX(sh, fh) : MIN(sh, fh);
+
+  fdata->max_width = (w != 0 && job->width > w) ? w : job->width;
+  fdata->max_height = (h != 0 && job->height > h) ? h : job->height;
+  fdata->style[0] = '\0';
+  if(job->style) g_strlcpy((char *)fdata->style, job->style, DT_MAX_STYLE_NAME_LENGTH);
+
+  GList *id_list = g_list_append(NULL, GINT_TO_POINTER(imgid));
+  if(storage->initialize_store)
+  {
+    storage->initialize_store(storage, sdata, &format, &fdata, &id_list, TRUE);
+    format->set_params(format, fdata, format->params_size(format));
+    storage->set_params(storage, sdata, storage->params_size(storage));
+  }
+
+  dt_export_metadata_t metadata;
+  metadata.flags = dt_lib_export_metadata_default_flags();
+  metadata.list = NULL;
+  const int res = storage->store(storage, sdata, imgid, format, fdata, 1, 1, TRUE, job->export_masks,
+                                 job->icc_type, job->icc_filename, job->icc_intent, &metadata);
+  if(res) g_string_assign(error, "export failed");
+
+  if(storage->finalize_store) storage->finalize_store(storage, sdata);
+  storage->free_params(storage, sdata);
+  format->free_params(format, fdata);
+  g_list_free(id_list);
+  return res != 0;
+}
+
+static void _cli_answer(_cli_server_t *server, const _cli_job_t *job, const GString *error, const double seconds)
+{
+  JsonBuilder *builder = json_builder_new();
+  json_builder_begin_object(builder);
+  json_builder_set_member_name(builder, "id");
+  if(job && job->id)
+    json_builder_add_value(builder, json_node_copy(job->id));
+  else
+    json_builder_add_null_value(builder);
+  json_builder_set_member_name(builder, "status");
+  json_builder_add_string_value(builder, error->len ? "error" : "ok");
+  if(error->len)
+  {
+    json_builder_set_member_name(builder, "error");
+    json_builder_add_string_value(builder, error->str);
+  }
+  json_builder_set_member_name(builder, "seconds");
+  json_builder_add_double_value(builder, seconds);
+  json_builder_end_object(builder);
+
+  JsonGenerator *generator = json_generator_new();
+  JsonNode *root = json_builder_get_root(builder);
+  json_generator_set_root(generator, root);
+  gchar *text = json_generator_to_data(generator, NULL);
+
+  g_mutex_lock(&server->out_lock);
+  fprintf(server->out, "%s\n", text);
+  fflush(server->out);
+  g_mutex_unlock(&server->out_lock);
+
+  dt_free(text);
+  json_node_unref(root);
+  g_object_unref(generator);
+  g_object_unref(builder);
+}
+
+static void _cli_job_import_export(_cli_server_t *server, const _cli_job_t *job, const gchar *pattern,
+                                   const gchar *ext, GString *error)
+{
+  if(!g_file_test(job->input, G_FILE_TEST_IS_REGULAR))
+  {
+    g_string_printf(error, "can't open file %s", job->input);
+    return;
+  }
+
+  // two requests for the same file would share one library entry and its history
+  gchar *key = g_canonicalize_filename(job->input, NULL);
+  g_mutex_lock(&server->lock);
+  while(g_hash_table_contains(server->busy, key)) g_cond_wait(&server->idle, &server->lock);
+  g_hash_table_add(server->busy, key);
+
+  dt_film_t film;
+  gchar *directory = g_path_get_dirname(key);
+  const int filmid = dt_film_new(&film, directory);
+  const int32_t imgid = dt_image_import(filmid, key, TRUE);
+  dt_free(directory);
+  g_mutex_unlock(&server->lock);
+
+  if(!imgid)
+    g_string_printf(error, "can't open file %s", job->input);
+  else
+  {
+    if(job->xmp)
+    {
+      dt_image_t *image = dt_image_cache_get(imgid, 'w');
+      if(dt_exif_xmp_read(image, job->xmp, 1) != 0) g_string_printf(error, "can't open xmp file %s", job->xmp);
+      dt_image_cache_write_release(image, DT_IMAGE_CACHE_RELAXED);
+    }
+    if(error->len == 0) _cli_job_export(job, imgid, pattern, ext, error);
+
+    // the next request for this file starts from its own xmp, not from this one's history
+    dt_image_remove(imgid);
+  }
+
+  g_mutex_lock(&server->lock);
+  g_hash_table_remove(server->busy, key);
+  g_cond_broadcast(&server->idle);
+  g_mutex_unlock(&server->lock);
+}
+
+static void _cli_job_run(gpointer data, gpointer user_data)
+{
+  _cli_job_t *job = (_cli_job_t *)data;
+  _cli_server_t *server = (_cli_server_t *)user_data;
+  const double start = dt_get_wtime();
+  GString *error = g_string_new(NULL);
+  gchar *pattern = NULL, *ext = NULL;
+
+  if(_cli_job_destination(job, &pattern, &ext, error))
+    _cli_job_import_export(server, job, pattern, ext, error);
+
+  _cli_answer(server, job, error, dt_get_wtime() - start);
+  g_string_free(error, TRUE);
+  dt_free(pattern);
+  dt_free(ext);
+  _cli_job_free(job);
+}
+
+/* One line of stdin, without its line break, or NULL at end of input. */
+static gchar *_cli_read_line(FILE *in)
+{
+  GString *line = g_string_new(NULL);
+  char buf[4096];
+  while(fgets(buf, sizeof(buf), in))
+  {
+    g_string_append(line, buf);
+    if(line->str[line->len - 1] == '\n') break;
+  }
+
+  if(line->len == 0)
+  {
+    g_string_free(line, TRUE);
+    return NULL;
+  }
+
+  return g_strchomp(g_string_free(line, FALSE));
+}
+
+static int _cli_serve(const _cli_job_t *defaults, const int jobs, FILE *out)
+{
+  _cli_server_t server = { 0 };
+  server.out = out;
+  g_mutex_init(&server.lock);
+  g_cond_init(&server.idle);
+  g_mutex_init(&server.out_lock);
+  server.busy = g_hash_table_new_full(g_str_hash, g_str_equal, dt_free_gpointer, NULL);
+
+  GThreadPool *pool = g_thread_pool_new(_cli_job_run, &server, jobs, FALSE, NULL);
+
+  gchar *line = NULL;
+  while((line = _cli_read_line(stdin)))
+  {
+    if(line[0] != '\0')
+    {
+      GString *error = g_string_new(NULL);
+      _cli_job_t *job = _cli_job_parse(defaults, line, error);
+      if(error->len)
+      {
+        _cli_answer(&server, job, error, 0.);
+        _cli_job_free(job);
+      }
+      else
+        g_thread_pool_push(pool, job, NULL);
+      g_string_free(error, TRUE);
+    }
+    dt_free(line);
+  }
+
+  // end of input: finish what was queued, then leave
+  g_thread_pool_free(pool, FALSE, TRUE);
+
+  g_hash_table_destroy(server.busy);
+  g_mutex_clear(&server.out_lock);
+  g_cond_clear(&server.idle);
+  g_mutex_clear(&server.lock);
+  return 0;
+}
+
 int main(int argc, char *arg[])
 {
 #ifdef __APPLE__
@@ -220,7 +670,8 @@ int main(int argc, char *arg[])
   int file_counter = 0;
   int width = 0, height = 0, bpp = 0;
   gboolean verbose = FALSE, custom_presets = TRUE, export_masks = FALSE,
-           output_to_dir = FALSE;
+           output_to_dir = FALSE, serve = FALSE;
+  int jobs = 1;
 
   GList* inputs = NULL;
   GList* imgids = NULL;
@@ -380,6 +831,15 @@ int main(int argc, char *arg[])
           exit(1);
         }
       }
+      else if(!strcmp(arg[k], "--serve"))
+      {
+        serve = TRUE;
+      }
+      else if(!strcmp(arg[k], "--jobs") && argc > k + 1)
+      {
+        k++;
+        jobs = MAX(atoi(arg[k]), 1);
+      }
       else if(!strcmp(arg[k], "-v") || !strcmp(arg[k], "--verbose"))
       {
         verbose = TRUE;
@@ -426,7 +886,46 @@ int main(int argc, char *arg[])
   for(; k < argc; k++) m_arg[m_argc++] = arg[k];
   m_arg[m_argc] = NULL;
 
-  if(imgids && (inputs || file_counter != 1))
+  if(serve)
+  {
+    if(inputs || imgids || file_counter > 0)
+    {
+      fprintf(stderr, _("error: --serve takes its inputs and outputs from stdin\n"));
+      usage(arg[0]);
+      exit(1);
+    }
+
+    // stdout carries the answers and nothing else. dt_print() and every other log writes to
+    // stdout too: keep the real one for the answers, and send the rest to stderr.
+    fflush(stdout);
+    const int answers_fd = dup(STDOUT_FILENO);
+    FILE *answers = (answers_fd >= 0) ? fdopen(answers_fd, "w") : NULL;
+    if(IS_NULL_PTR(answers) || dup2(STDERR_FILENO, STDOUT_FILENO) < 0)
+    {
+      fprintf(stderr, _("error: --serve cannot set up its output\n"));
+      dt_free(m_arg);
+      exit(1);
+    }
+
+    if(dt_init(m_argc, m_arg, FALSE, custom_presets))
+    {
+      dt_free(m_arg);
+      exit(1);
+    }
+
+    const _cli_job_t defaults = { .out_ext = output_ext, .style = style, .icc_filename = icc_filename,
+                                  .width = width, .height = height, .export_masks = export_masks,
+                                  .icc_type = icc_type, .icc_intent = icc_intent };
+    const int res = _cli_serve(&defaults, jobs, answers);
+    fclose(answers);
+
+    dt_cleanup();
+    dt_free(output_ext);
+    dt_free(icc_filename);
+    dt_free(m_arg);
+    exit(res);
+  }
+  else if(imgids && (inputs || file_counter != 1))
   {
     // --imgid takes no input file and no XMP: the only positional argument is the output
     if(inputs || file_counter > 1)
@@ -186,6 +186,8 @@ int main(int argc, char *arg[])
          cpu_err, w1, cpu[w1], expected[w1]);
 
   // ---- OpenCL: same stage, then apply the residual host-side ------------------------------
+  // on a first run the programs may still be building in the background
+  dt_opencl_wait_for_programs();
   const int devid = dt_opencl_reserve_device_for_pipe(DT_DEV_PIXELPIPE_EXPORT);
   if(devid < 0)
   {
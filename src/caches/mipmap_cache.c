@@ -115,6 +115,8 @@ typedef struct dt_mipmap_cache_t
   dt_mipmap_cache_one_t mip_thumbs;
   dt_mipmap_cache_one_t mip_f;
   dt_mipmap_cache_one_t mip_full;
+  // camera previews standing in for thumbnails being processed, see dt_mipmap_cache_get_preview()
+  dt_mipmap_cache_one_t mip_preview;
   char cachedir[PATH_MAX]; // cached sha1sum filename for faster access
 } dt_mipmap_cache_t;
 
@@ -805,6 +807,29 @@ write_error:
   entry->data = NULL;
 }
 
+// Previews never touch the disk cache: they are cheap to decode again, and their keys would
+// collide with the processed thumbnails there.
+static void _preview_allocate(void *data, dt_cache_entry_t *entry)
+{
+  dt_mipmap_cache_t *cache = (dt_mipmap_cache_t *)data;
+  const dt_mipmap_size_t mip = get_size(entry->key);
+
+  dt_free_align(entry->data);
+  entry->data = dt_alloc_align(cache->buffer_size[mip]);
+  if(IS_NULL_PTR(entry->data)) return;
+
+  struct dt_mipmap_buffer_dsc *dsc = NULL;
+  dt_mipmap_cache_update_buffer_addresses(entry, &dsc, cache->max_width[mip], cache->max_height[mip],
+                                          cache->buffer_size[mip]);
+  entry->cost = cache->buffer_size[mip];
+}
+
+static void _preview_deallocate(void *data, dt_cache_entry_t *entry)
+{
+  dt_free_align(entry->data);
+  entry->data = NULL;
+}
+
 void dt_mipmap_cache_init(const dt_mipmap_cache_settings_t *settings, const gboolean verbose)
 {
   _verbose = verbose;
@@ -872,6 +897,11 @@ void dt_mipmap_cache_init(const dt_mipmap_cache_settings_t *settings, const gboo
   dt_cache_set_cleanup_callback(&cache->mip_f.cache, dt_mipmap_cache_deallocate_dynamic, cache);
   cache->buffer_size[DT_MIPMAP_F]
       = _get_entry_size(4 * sizeof(float) * cache->max_width[DT_MIPMAP_F] * cache->max_height[DT_MIPMAP_F]);
+
+  // Previews only bridge the time a thumbnail takes to process: a fraction of the thumbnails budget
+  dt_cache_init(&cache->mip_preview.cache, 0, _settings_get().max_memory / 8);
+  dt_cache_set_allocate_callback(&cache->mip_preview.cache, _preview_allocate, cache);
+  dt_cache_set_cleanup_callback(&cache->mip_preview.cache, _preview_deallocate, cache);
 }
 
 void dt_mipmap_cache_cleanup(void)
@@ -882,6 +912,7 @@ void dt_mipmap_cache_cleanup(void)
   dt_cache_cleanup(&cache->mip_thumbs.cache);
   dt_cache_cleanup(&cache->mip_full.cache);
   dt_cache_cleanup(&cache->mip_f.cache);
+  dt_cache_cleanup(&cache->mip_preview.cache);
 
   dt_free(_mipmap_cache);
   _mipmap_cache = NULL;
@@ -981,6 +1012,7 @@ GArray *dt_mipmap_cache_get_entries_stats(void)
   _mipmap_subcache_collect(&cache->mip_thumbs.cache, out);
   _mipmap_subcache_collect(&cache->mip_f.cache, out);
   _mipmap_subcache_collect(&cache->mip_full.cache, out);
+  _mipmap_subcache_collect(&cache->mip_preview.cache, out);
   return out;
 }
 
@@ -1337,8 +1369,13 @@ void dt_mipmap_cache_remove_at_size(const int32_t imgid, const dt_mipmap_size_t
 // get rid of all ldr thumbnails:
 void dt_mipmap_cache_remove(const int32_t imgid, const gboolean flush_disk)
 {
+  dt_mipmap_cache_t *cache = _mipmap_cache;
   for(dt_mipmap_size_t k = DT_MIPMAP_0; k < DT_MIPMAP_F; k++)
+  {
     dt_mipmap_cache_remove_at_size(imgid, k, flush_disk);
+    // previews are rotated by the image orientation, which the history can change
+    dt_cache_remove(&cache->mip_preview.cache, get_key(imgid, k));
+  }
 }
 
 // write thumbnail to disc if not existing there
@@ -1346,7 +1383,10 @@ void dt_mimap_cache_evict(const int32_t imgid)
 {
   dt_mipmap_cache_t *cache = _mipmap_cache;
   for(dt_mipmap_size_t k = DT_MIPMAP_0; k < DT_MIPMAP_F; k++)
+  {
     dt_cache_remove(&_get_cache(cache, k)->cache, get_key(imgid, k));
+    dt_cache_remove(&cache->mip_preview.cache, get_key(imgid, k));
+  }
 }
 
 static void _init_f(dt_mipmap_buffer_t *mipmap_buf, float *out, uint32_t *width, uint32_t *height, float *iscale,
@@ -1521,6 +1561,71 @@ static int _find_sidecar_jpg(const char *filename, const char *ext, char *sideca
   return 0;
 }
 
+// Load the camera's own rendering of the image into a wd x ht box: the input itself when it is a JPEG,
+// else a companion JPEG, else the thumbnail embedded in the raw. Returns 0 on success.
+static int _load_embedded_8(const int32_t imgid, const char *filename, const char *ext,
+                            const gboolean is_jpg_input, uint8_t *buf, const uint32_t wd, const uint32_t ht,
+                            const dt_mipmap_size_t size, uint32_t *width, uint32_t *height,
+                            dt_colorspaces_color_profile_type_t *color_space)
+{
+  int res = 1;
+  dt_image_orientation_t orientation = ORIENTATION_NONE;
+  dt_boundingbox_t usercrop = { 0.f, 0.f, 1.f, 1.f };
+  const dt_image_t *img = dt_image_cache_get(imgid, 'r');
+  if(img)
+  {
+    orientation = (img->orientation != ORIENTATION_NULL) ? img->orientation : ORIENTATION_NONE;
+    dt_image_cache_read_release(img);
+  }
+
+  // Resolve outside the read lock: this path never decodes the raw, so the framing may still
+  // have to be read from the file, and storing the answer needs the write lock.
+  dt_image_resolve_usercrop(imgid, usercrop);
+
+  char sidecar_filename[PATH_MAX] = { 0 };
+
+  if(is_jpg_input)
+  {
+    // Input file is a JPEG
+    res = _load_jpg(filename, imgid, wd, ht, size, orientation, buf, width, height, color_space);
+  }
+  else if(_find_sidecar_jpg(filename, ext, sidecar_filename))
+  {
+    // input file is a RAW but we have a companion JPEG file in the same folder:
+    // use it in priority (it may be higher resolution/quality than embedded JPEG).
+    res = _load_jpg(sidecar_filename, imgid, wd, ht, size, orientation, buf, width, height, color_space);
+  }
+  else
+  {
+    // input file is a RAW without companion JPEG:
+    // try to load the embedded thumbnail. Might not be large enough though.
+    uint8_t *tmp = NULL;
+    int32_t thumb_width, thumb_height;
+    res = dt_imageio_large_thumbnail(filename, &tmp, &thumb_width, &thumb_height, color_space, wd, ht);
+    if(!res)
+    {
+      // We take the thumbnail no matter its size. It might be too small for the requested dimension,
+      // and end up blurry. But it's less bad than the following scenario:
+      // 1. user displays collections in grid of 5 columns (small thumbnail -> fetch embedded JPEG for performance, all good),
+      // 2. user zooms in the grid, to 2 or 3 columns,
+      // 3. suddently, embedded JPEG is too small so we ditch it for a full pipe recompute,
+      // 4. but then, color/contrast/appearance unexpectedly changes and user doesn't understand WTF just happened.
+      // Blurry is less bad than randomly inconsistent, plus user has a GUI way in lighttable to
+      // change how thumbs are processed at runtime.
+      _cache_print(DT_DEBUG_CACHE, "[mipmap_cache] generate mip size %d for image %d from embedded jpeg\n", size, imgid);
+      // The camera renders its embedded previews from the full default-crop rectangle even when
+      // it recorded a narrower framing, so trim them to what the photographer actually framed.
+      // Only here: the two branches above read a separate JPEG file, which the camera already
+      // wrote cropped. This runs before the rotation below, hence the un-oriented box.
+      dt_imageio_crop_thumbnail(usercrop, tmp, &thumb_width, &thumb_height);
+      dt_iop_flip_and_zoom_8(tmp, thumb_width, thumb_height, buf, wd, ht, orientation, width, height);
+      dt_pixelpipe_cache_free_align(tmp);
+    }
+  }
+
+  return res;
+}
+
 static void _init_8(uint8_t *buf, uint32_t *width, uint32_t *height, float *iscale,
                     dt_colorspaces_color_profile_type_t *color_space, const int32_t imgid,
                     const dt_mipmap_size_t size, dt_atomic_int *shutdown)
@@ -1570,66 +1675,8 @@ static void _init_8(uint8_t *buf, uint32_t *width, uint32_t *height, float *isca
     }
   }
 
-  // Orientation and camera framing are only needed when loading embedded JPEGs.
-  dt_image_orientation_t orientation = ORIENTATION_NONE;
-  dt_boundingbox_t usercrop = { 0.f, 0.f, 1.f, 1.f };
-  if(use_embedded_jpg)
-  {
-    const dt_image_t *img = dt_image_cache_get(imgid, 'r');
-    if(img)
-    {
-      orientation = (img->orientation != ORIENTATION_NULL) ? img->orientation : ORIENTATION_NONE;
-      dt_image_cache_read_release(img);
-    }
-
-    // Resolve outside the read lock: this path never decodes the raw, so the framing may still
-    // have to be read from the file, and storing the answer needs the write lock.
-    dt_image_resolve_usercrop(imgid, usercrop);
-  }
-
   if(res && use_embedded_jpg)
-  {
-    char sidecar_filename[PATH_MAX] = { 0 };
-
-    if(is_jpg_input)
-    {
-      // Input file is a JPEG
-      res = _load_jpg(filename, imgid, wd, ht, size, orientation, buf, width, height, color_space);
-    }
-    else if(_find_sidecar_jpg(filename, ext, sidecar_filename))
-    {
-      // input file is a RAW but we have a companion JPEG file in the same folder:
-      // use it in priority (it may be higher resolution/quality than embedded JPEG).
-      res = _load_jpg(sidecar_filename, imgid, wd, ht, size, orientation, buf, width, height, color_space);
-    }
-    else
-    {
-      // input file is a RAW without companion JPEG:
-      // try to load the embedded thumbnail. Might not be large enough though.
-      uint8_t *tmp = NULL;
-      int32_t thumb_width, thumb_height;
-      res = dt_imageio_large_thumbnail(filename, &tmp, &thumb_width, &thumb_height, color_space, *width, *height);
-      if(!res)
-      {
-        // We take the thumbnail no matter its size. It might be too small for the requested dimension,
-        // and end up blurry. But it's less bad than the following scenario:
-        // 1. user displays collections in grid of 5 columns (small thumbnail -> fetch embedded JPEG for performance, all good),
-        // 2. user zooms in the grid, to 2 or 3 columns,
-        // 3. suddently, embedded JPEG is too small so we ditch it for a full pipe recompute,
-        // 4. but then, color/contrast/appearance unexpectedly changes and user doesn't understand WTF just happened.
-        // Blurry is less bad than randomly inconsistent, plus user has a GUI way in lighttable to
-        // change how thumbs are processed at runtime.
-        _cache_print(DT_DEBUG_CACHE, "[mipmap_cache] generate mip size %d for image %d from embedded jpeg\n", size, imgid);
-        // The camera renders its embedded previews from the full default-crop rectangle even when
-        // it recorded a narrower framing, so trim them to what the photographer actually framed.
-        // Only here: the two branches above read a separate JPEG file, which the camera already
-        // wrote cropped. This runs before the rotation below, hence the un-oriented box.
-        dt_imageio_crop_thumbnail(usercrop, tmp, &thumb_width, &thumb_height);
-        dt_iop_flip_and_zoom_8(tmp, thumb_width, thumb_height, buf, wd, ht, orientation, width, height);
-        dt_pixelpipe_cache_free_align(tmp);
-      }
-    }
-  }
+    res = _load_embedded_8(imgid, filename, ext, is_jpg_input, buf, wd, ht, size, width, height, color_space);
 
   if(res)
   {
@@ -1679,6 +1726,98 @@ static void _init_8(uint8_t *buf, uint32_t *width, uint32_t *height, float *isca
   }
 }
 
+// Copy a thumbnail payload out of its cache line, so the caller doesn't hold the lock while drawing it
+static uint8_t *_copy_payload(const uint8_t *in, const uint32_t width, const uint32_t height)
+{
+  uint8_t *out = dt_alloc_align((size_t)width * height * 4 * sizeof(uint8_t));
+  if(out) memcpy(out, in, (size_t)width * height * 4 * sizeof(uint8_t));
+  return out;
+}
+
+int dt_mipmap_cache_get_preview(const int32_t imgid, const dt_mipmap_size_t mip, uint8_t **out,
+                                uint32_t *width, uint32_t *height,
+                                dt_colorspaces_color_profile_type_t *color_space)
+{
+  dt_mipmap_cache_t *cache = _mipmap_cache;
+  *out = NULL;
+  if(IS_NULL_PTR(cache) || mip < DT_MIPMAP_0 || mip >= DT_MIPMAP_F) return 1;
+
+  char filename[PATH_MAX] = { 0 };
+  char ext[6] = { 0 };
+  gboolean input_exists, is_jpg_input, use_embedded_jpg, write_to_disk;
+  _write_mipmap_to_disk(imgid, filename, ext, &input_exists, &is_jpg_input, &use_embedded_jpg, &write_to_disk);
+
+  // The thumbnail is the camera preview already, or can't be made at all
+  if(!input_exists || use_embedded_jpg) return 1;
+
+  // The thumbnail, or a larger one to downscale, is in RAM: it comes without the pipeline
+  for(dt_mipmap_size_t k = mip; k < DT_MIPMAP_F; k++)
+  {
+    dt_mipmap_buffer_t tmp;
+    dt_mipmap_cache_get(&tmp, imgid, k, DT_MIPMAP_TESTLOCK, 'r');
+    const gboolean found = !IS_NULL_PTR(tmp.buf);
+    dt_mipmap_cache_release(&tmp);
+    if(found) return 1;
+  }
+
+  // Same on the disk cache, which the allocation reads back
+  if(cache->cachedir[0] && write_to_disk)
+  {
+    char cached[PATH_MAX] = { 0 };
+    dt_mipmap_get_cache_filename(cached, mip, imgid);
+    if(g_file_test(cached, G_FILE_TEST_EXISTS)) return 1;
+  }
+
+  // A smaller processed thumbnail, upscaled when drawn, looks closer to the result than the camera preview
+  for(int k = (int)mip - 1; k >= DT_MIPMAP_0; k--)
+  {
+    dt_mipmap_buffer_t tmp;
+    dt_mipmap_cache_get(&tmp, imgid, k, DT_MIPMAP_TESTLOCK, 'r');
+    if(!IS_NULL_PTR(tmp.buf) && tmp.width > 8 && tmp.height > 8)
+    {
+      *out = _copy_payload(tmp.buf, tmp.width, tmp.height);
+      *width = tmp.width;
+      *height = tmp.height;
+      *color_space = tmp.color_space;
+    }
+    dt_mipmap_cache_release(&tmp);
+    if(*out)
+    {
+      _cache_print(DT_DEBUG_CACHE, "[mipmap_cache] preview of mip size %d for image %d from mip size %d\n", mip,
+                   imgid, k);
+      return 0;
+    }
+  }
+
+  // The camera preview, decoded once and kept apart from the processed thumbnails
+  dt_cache_entry_t *entry = dt_cache_get(&cache->mip_preview.cache, get_key(imgid, mip), 'w');
+  if(IS_NULL_PTR(entry)) return 1;
+  struct dt_mipmap_buffer_dsc *dsc = _get_dsc_from_entry(entry);
+  if(!IS_NULL_PTR(dsc))
+  {
+    ASAN_UNPOISON_MEMORY_REGION(dsc, dt_mipmap_buffer_dsc_size);
+    ASAN_UNPOISON_MEMORY_REGION(_get_buffer_from_dsc(dsc), dsc->size - dt_mipmap_buffer_dsc_size);
+    if(dsc->flags & DT_MIPMAP_BUFFER_DSC_FLAG_GENERATE)
+    {
+      // a file without preview is remembered as such, by an empty entry
+      if(_load_embedded_8(imgid, filename, ext, is_jpg_input, _get_buffer_from_dsc(dsc), dsc->width, dsc->height,
+                          mip, &dsc->width, &dsc->height, &dsc->color_space))
+        dsc->width = dsc->height = 0;
+      dsc->flags &= ~DT_MIPMAP_BUFFER_DSC_FLAG_GENERATE;
+    }
+    if(dsc->width > 8 && dsc->height > 8)
+    {
+      *out = _copy_payload(_get_buffer_from_dsc(dsc), dsc->width, dsc->height);
+      *width = dsc->width;
+      *height = dsc->height;
+      *color_space = dsc->color_space;
+    }
+  }
+  dt_cache_release(&cache->mip_preview.cache, entry);
+
+  return IS_NULL_PTR(*out);
+}
+
 void dt_mipmap_cache_copy_thumbnails(const uint32_t dst_imgid, const uint32_t src_imgid)
 {
   dt_mipmap_cache_t *cache = _mipmap_cache;
@@ -198,6 +198,22 @@ void dt_mipmap_cache_write_get_with_caller(
 void dt_mipmap_cache_release_with_caller(dt_mipmap_buffer_t *buf, const char *file,
                                          int line);
 
+/**
+ * @brief Something to show for the thumbnail of @p imgid at @p mip, right now, while it gets processed.
+ *
+ * @details Only when getting the thumbnail means running the pipeline: declines when it, or a larger
+ * one, is cached in RAM or on disk, and when the lighttable shows the camera previews anyway. The
+ * stand-in is a smaller processed thumbnail when one is in RAM, else the camera preview (JPEG input,
+ * companion JPEG or embedded thumbnail), which is decoded once and kept in a cache of its own.
+ * Never runs the pipeline.
+ *
+ * @param out a copy of the pixels, RGBA 8 bits, at most the size of @p mip. Free it with dt_free_align().
+ * @return 0 when @p out holds a stand-in, 1 otherwise.
+ */
+int dt_mipmap_cache_get_preview(const int32_t imgid, const dt_mipmap_size_t mip, uint8_t **out,
+                                uint32_t *width, uint32_t *height,
+                                dt_colorspaces_color_profile_type_t *color_space);
+
 // remove thumbnails, so they will be regenerated:
 void dt_mipmap_cache_remove(const int32_t imgid, const gboolean flush_disk);
 void dt_mipmap_cache_remove_at_size(const int32_t imgid, const dt_mipmap_size_t mip, const gboolean flush_disk);
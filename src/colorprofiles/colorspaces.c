@@ -52,6 +52,7 @@
 
 #include "colorprofiles/colorspaces.h"
 #include "colorprofiles/iop_profile.h"   // dt_colorspaces_invalidate_display_profile_memo()
+#include "colorprofiles/conversion.h"    // dt_colorspaces_flush_baked_luts()
 
 #include <stddef.h>   // offsetof(), for the startup self-test
 
@@ -1261,6 +1262,7 @@ void dt_colorprofiles_cleanup(void)
 
   // the derived matrix/LUT memo is built from these profiles; it goes first
   dt_colorspaces_flush_profile_memo();
+  dt_colorspaces_flush_baked_luts();
 
   _colorspaces_destroy(_colorprofiles);
   _colorprofiles = NULL;
@@ -23,6 +23,7 @@
 #include "common/colorspaces_inline_conversions.h"
 #include "common/hash.h"
 #include "common/logging.h"
+#include "common/times.h"
 #include "system/macros.h"
 #include "system/mem_alloc.h"
 #include "system/openmp.h"
@@ -31,6 +32,7 @@
 
 #include <lcms2.h>
 #include <math.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -55,6 +57,8 @@
 #define DT_CONVERSION_MAGIC_LIVE 0xC0117E51u
 #define DT_CONVERSION_MAGIC_DEAD 0xDEADC017u
 
+typedef struct dt_baked_lut_t dt_baked_lut_t;
+
 struct dt_colorspaces_conversion_t
 {
   uint32_t magic;
@@ -86,6 +90,11 @@ struct dt_colorspaces_conversion_t
   cmsHTRANSFORM clip_xform;     //!< clip -> target; NULL unless has_clipping
   gboolean gamutcheck;
 
+  /* lcms2 branch with DT_CONVERSION_BAKE_LUT: the transforms above sampled on a grid, applied
+   * in their place wherever the input lies inside the grid. NULL otherwise. Shared, see
+   * _baked_lut_acquire(). */
+  dt_baked_lut_t *baked;
+
   /* Handles this conversion created and must close. An endpoint resolved from the profile
    * list is BORROWED -- the list owns it -- and never lands here. The only owned handle in
    * practice is the quantised soft-proof copy. */
@@ -213,6 +222,195 @@ static void _free_curves(float *lut[3])
   }
 }
 
+/* The lcms2 chain on one run of pixels, in place or not: the transform, and when clipping, the
+ * clamp in the clip space and the second transform. Shared by the lcms2 branch and the LUT
+ * baking, so that the LUT samples exactly what the lcms2 branch renders. */
+static void _lcms2_run(const cmsHTRANSFORM xform, const cmsHTRANSFORM clip_xform, const gboolean clipping,
+                       const float *const in, float *const out, const size_t count)
+{
+  dt_colorspaces_transform_rgba_float_row(xform, in, out, count);
+  if(!clipping) return;
+
+  __OMP_SIMD__(aligned(out : 16))
+  for(size_t j = 0; j < count; j++)
+  {
+    for(int ch = 0; ch < 3; ch++) out[4 * j + ch] = CLAMP(out[4 * j + ch], 0.0f, 1.0f);
+  }
+  dt_colorspaces_transform_rgba_float_row(clip_xform, out, out, count);
+}
+
+/* --- baked LUTs -------------------------------------------------------------
+ *
+ * LUT-based display and printer profiles, soft proofing and gamut clipping all land on the
+ * lcms2 branch, where every pixel walks lcms2's float pipeline -- two of them when clipping.
+ * With DT_CONVERSION_BAKE_LUT, that chain is sampled once on a regular grid over [0,1]^3 and
+ * applied by tetrahedral interpolation. Pixels outside the grid (negative, above white, NaN)
+ * still go through lcms2, so the LUT never extrapolates.
+ *
+ * A linear source is sampled in sqrt(x) rather than x: the target encodings are display
+ * gammas, and spacing the nodes evenly in a gamma-2 shaper puts them where the output curves.
+ * 33 nodes per axis, 65 when soft proofing, whose gamut mapping has the sharpest features.
+ *
+ * Baking costs one lcms2 pass over the grid, 36k or 275k pixels. commit_params() prepares a
+ * new conversion on every pipeline resync, so the grids are memoised by the identity of the
+ * conversion they were sampled from, and shared by every conversion that has that identity.
+ */
+#define DT_BAKED_LUT_NODES 33
+#define DT_BAKED_LUT_NODES_PROOF 65
+#define DT_BAKED_LUT_MEMO_SIZE 4
+
+struct dt_baked_lut_t
+{
+  uint64_t key;     //!< identity of the conversion the grid was sampled from, before baking
+  int refs;         //!< the memo's reference, plus one per conversion using it
+  int nodes;        //!< per axis
+  gboolean shaped;  //!< nodes evenly spaced in sqrt(x) rather than x
+  float *grid;      //!< nodes^3 RGBA nodes, blue fastest
+};
+
+static GList *_baked_memo = NULL; // most recently used first
+static pthread_mutex_t _baked_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void _baked_lut_free(dt_baked_lut_t *lut)
+{
+  dt_free_align(lut->grid);
+  dt_free(lut);
+}
+
+static void _baked_lut_release(dt_baked_lut_t *lut)
+{
+  if(IS_NULL_PTR(lut)) return;
+  pthread_mutex_lock(&_baked_lock);
+  const gboolean last = (--lut->refs == 0);
+  pthread_mutex_unlock(&_baked_lock);
+  if(last) _baked_lut_free(lut);
+}
+
+void dt_colorspaces_flush_baked_luts(void)
+{
+  pthread_mutex_lock(&_baked_lock);
+  GList *memo = _baked_memo;
+  _baked_memo = NULL;
+  pthread_mutex_unlock(&_baked_lock);
+
+  for(GList *l = memo; l; l = g_list_next(l)) _baked_lut_release((dt_baked_lut_t *)l->data);
+  g_list_free(memo);
+}
+
+/* Whether every channel of the profile decodes linearly, i.e. whether the buffer handed to the
+ * conversion is scene-linear and wants the shaper. */
+static gboolean _profile_is_linear(cmsHPROFILE profile)
+{
+  if(!cmsIsMatrixShaper(profile)) return FALSE;
+  const cmsTagSignature tags[3] = { cmsSigRedTRCTag, cmsSigGreenTRCTag, cmsSigBlueTRCTag };
+  for(int c = 0; c < 3; c++)
+  {
+    const cmsToneCurve *curve = (const cmsToneCurve *)cmsReadTag(profile, tags[c]);
+    if(IS_NULL_PTR(curve) || !cmsIsToneCurveLinear(curve)) return FALSE;
+  }
+  return TRUE;
+}
+
+__DT_CLONE_TARGETS__
+static dt_baked_lut_t *_baked_lut_sample(const dt_colorspaces_conversion_t *const c, const uint64_t key,
+                                         const int nodes, const gboolean shaped)
+{
+  dt_baked_lut_t *lut = g_new0(dt_baked_lut_t, 1);
+  const size_t slab = (size_t)nodes * nodes;
+  lut->key = key;
+  lut->refs = 1;
+  lut->nodes = nodes;
+  lut->shaped = shaped;
+  lut->grid = dt_alloc_align_float(4 * slab * nodes);
+  float *const coords = dt_alloc_align_float(nodes);
+  if(IS_NULL_PTR(lut->grid) || IS_NULL_PTR(coords))
+  {
+    dt_free_align(coords);
+    _baked_lut_free(lut);
+    return NULL;
+  }
+
+  for(int i = 0; i < nodes; i++)
+  {
+    const float u = (float)i / (float)(nodes - 1);
+    coords[i] = shaped ? u * u : u;
+  }
+
+  const cmsHTRANSFORM xform = c->xform;
+  const cmsHTRANSFORM clip_xform = c->clip_xform;
+  const gboolean clipping = c->has_clipping;
+  float *const grid = lut->grid;
+
+  // one red slab per iteration, sampled in place
+  __OMP_PARALLEL_FOR__()
+  for(int r = 0; r < nodes; r++)
+  {
+    float *const out = grid + 4 * slab * r;
+    for(size_t k = 0; k < slab; k++)
+    {
+      out[4 * k + 0] = coords[r];
+      out[4 * k + 1] = coords[k / nodes];
+      out[4 * k + 2] = coords[k % nodes];
+      out[4 * k + 3] = 0.0f;
+    }
+    _lcms2_run(xform, clip_xform, clipping, out, out, slab);
+  }
+
+  dt_free_align(coords);
+  return lut;
+}
+
+/* The grid for conversion @p c, whose identity before baking is @p key: from the memo, or
+ * sampled now. The caller owns one reference. */
+static dt_baked_lut_t *_baked_lut_acquire(const dt_colorspaces_conversion_t *const c, const uint64_t key,
+                                          const int nodes, const gboolean shaped)
+{
+  pthread_mutex_lock(&_baked_lock);
+  for(GList *l = _baked_memo; l; l = g_list_next(l))
+  {
+    dt_baked_lut_t *lut = (dt_baked_lut_t *)l->data;
+    if(lut->key != key) continue;
+    lut->refs++;
+    _baked_memo = g_list_remove_link(_baked_memo, l);
+    _baked_memo = g_list_concat(l, _baked_memo);
+    pthread_mutex_unlock(&_baked_lock);
+    return lut;
+  }
+  pthread_mutex_unlock(&_baked_lock);
+
+  // sampled outside the lock: it runs lcms2 over the whole grid
+  const double start = dt_get_wtime();
+  dt_baked_lut_t *lut = _baked_lut_sample(c, key, nodes, shaped);
+  if(IS_NULL_PTR(lut)) return NULL;
+  dt_print(DT_DEBUG_COLORPROFILE, "[colorspaces] baked a %i^3 LUT in %.1f ms\n", nodes,
+           (dt_get_wtime() - start) * 1e3);
+
+  dt_baked_lut_t *evicted = NULL;
+  pthread_mutex_lock(&_baked_lock);
+  for(GList *l = _baked_memo; l; l = g_list_next(l))
+  {
+    // another pipe baked the same grid meanwhile: keep one copy
+    dt_baked_lut_t *other = (dt_baked_lut_t *)l->data;
+    if(other->key != key) continue;
+    other->refs++;
+    pthread_mutex_unlock(&_baked_lock);
+    _baked_lut_free(lut);
+    return other;
+  }
+  lut->refs++; // the memo's
+  _baked_memo = g_list_prepend(_baked_memo, lut);
+  if(g_list_length(_baked_memo) > DT_BAKED_LUT_MEMO_SIZE)
+  {
+    GList *oldest = g_list_last(_baked_memo);
+    evicted = (dt_baked_lut_t *)oldest->data;
+    _baked_memo = g_list_delete_link(_baked_memo, oldest);
+  }
+  pthread_mutex_unlock(&_baked_lock);
+
+  _baked_lut_release(evicted);
+  return lut;
+}
+
 dt_colorspaces_conversion_t *dt_colorspaces_prepare_conversion(const dt_colorspaces_endpoint_t *const from,
                                                                const dt_colorspaces_endpoint_t *const to,
                                                                const dt_colorspaces_endpoint_t *const clip,
@@ -430,7 +628,9 @@ dt_colorspaces_conversion_t *dt_colorspaces_prepare_conversion(const dt_colorspa
     identity = _hash_endpoint(identity, clip, clip_entry);
     identity = _hash_endpoint(identity, proof, proof_entry);
     identity = dt_hash(identity, (const char *)&intent, sizeof(intent));
-    identity = dt_hash(identity, (const char *)&flags, sizeof(flags));
+    /* Without the bake bit, which only counts once it took effect: see below. */
+    const dt_colorspaces_conversion_flags_t hashed_flags = flags & ~DT_CONVERSION_BAKE_LUT;
+    identity = dt_hash(identity, (const char *)&hashed_flags, sizeof(hashed_flags));
     identity = dt_hash(identity, (const char *)&settings.generation, sizeof(settings.generation));
 
     identity = dt_hash(identity, (const char *)&conversion->is_matrix, sizeof(conversion->is_matrix));
@@ -460,6 +660,24 @@ dt_colorspaces_conversion_t *dt_colorspaces_prepare_conversion(const dt_colorspa
     conversion->identity = identity;
   }
 
+  /* Baked after the identity, keyed by it: the grid is a pure function of what the identity
+   * names. The result then goes into the identity too, since the LUT and lcms2 differ by a
+   * fraction of a delta E and a cache must not serve one for the other. */
+  if(!conversion->is_matrix && (flags & DT_CONVERSION_BAKE_LUT) && !conversion->gamutcheck
+     && source_format == TYPE_RGBA_FLT)
+  {
+    const int nodes = proofing ? DT_BAKED_LUT_NODES_PROOF : DT_BAKED_LUT_NODES;
+    conversion->baked
+        = _baked_lut_acquire(conversion, conversion->identity, nodes, _profile_is_linear(from_profile));
+    if(!IS_NULL_PTR(conversion->baked))
+    {
+      conversion->identity = dt_hash(conversion->identity, (const char *)&conversion->baked->nodes,
+                                     sizeof(conversion->baked->nodes));
+      conversion->identity = dt_hash(conversion->identity, (const char *)&conversion->baked->shaped,
+                                     sizeof(conversion->baked->shaped));
+    }
+  }
+
   dt_colorspaces_unlock_profile(proof_entry);
   dt_colorspaces_unlock_profile(clip_entry);
   dt_colorspaces_unlock_profile(to_entry);
@@ -524,6 +742,7 @@ void dt_colorspaces_free_conversion(dt_colorspaces_conversion_t **conversion)
 
   if(!IS_NULL_PTR(c->xform)) cmsDeleteTransform(c->xform);
   if(!IS_NULL_PTR(c->clip_xform)) cmsDeleteTransform(c->clip_xform);
+  _baked_lut_release(c->baked);
 
   for(int k = 0; k < c->n_owned; k++) dt_colorspaces_cleanup_profile(c->owned[k]);
 
@@ -708,37 +927,154 @@ static void _apply_lcms2(const dt_colorspaces_conversion_t *const c, const float
         hook(source + 4 * j, target + 4 * j);
         target[4 * j + 3] = 0.0f;
       }
-      dt_colorspaces_transform_rgba_float_row(xform, target, target, width);
+      _lcms2_run(xform, clip_xform, clipping, target, target, width);
     }
     else
     {
-      dt_colorspaces_transform_rgba_float_row(xform, source, target, width);
+      _lcms2_run(xform, clip_xform, clipping, source, target, width);
     }
 
-    if(clipping)
+    if(gamutcheck)
     {
-      float *const restrict clipped = target;
-      __OMP_SIMD__(aligned(clipped : 64))
       for(size_t j = 0; j < width; j++)
       {
-        for(int ch = 0; ch < 3; ch++) clipped[4 * j + ch] = CLAMP(clipped[4 * j + ch], 0.0f, 1.0f);
+        if(target[4 * j + 0] < 0.0f || target[4 * j + 1] < 0.0f || target[4 * j + 2] < 0.0f)
+        {
+          target[4 * j + 0] = 0.0f;
+          target[4 * j + 1] = 1.0f;
+          target[4 * j + 2] = 1.0f;
+        }
       }
-      dt_colorspaces_transform_rgba_float_row(clip_xform, target, target, width);
     }
+  }
+}
 
-    if(gamutcheck)
+static inline gboolean _in_grid(const float *const pixel)
+{
+  // written so that NaN is outside
+  return pixel[0] >= 0.0f && pixel[0] <= 1.0f && pixel[1] >= 0.0f && pixel[1] <= 1.0f && pixel[2] >= 0.0f
+         && pixel[2] <= 1.0f;
+}
+
+/* Tetrahedral interpolation: the unit cell is split into the six tetrahedra sharing its
+ * black-white diagonal, and the pixel is weighted between the four corners of its own. Channels
+ * 0-2 are written, alpha is left alone as lcms2 leaves it. */
+static inline __attribute__((always_inline)) void _tetrahedral(const dt_baked_lut_t *const lut,
+                                                               const float *const pixel, float *const out)
+{
+  const int n = lut->nodes;
+  const float scale = (float)(n - 1);
+  int i[3];
+  float f[3];
+  for(int c = 0; c < 3; c++)
+  {
+    const float t = (lut->shaped ? sqrtf(pixel[c]) : pixel[c]) * scale;
+    i[c] = MIN((int)t, n - 2);
+    f[c] = t - (float)i[c];
+  }
+
+  const size_t sr = 4 * (size_t)n * n, sg = 4 * (size_t)n, sb = 4;
+  const float *const base = lut->grid + sr * i[0] + sg * i[1] + sb * i[2];
+
+  size_t d1, d2;
+  float w1, w2, w3;
+  if(f[0] >= f[1])
+  {
+    if(f[1] >= f[2])
+    { d1 = sr; d2 = sr + sg; w1 = f[0]; w2 = f[1]; w3 = f[2]; }
+    else if(f[0] >= f[2])
+    { d1 = sr; d2 = sr + sb; w1 = f[0]; w2 = f[2]; w3 = f[1]; }
+    else
+    { d1 = sb; d2 = sr + sb; w1 = f[2]; w2 = f[0]; w3 = f[1]; }
+  }
+  else
+  {
+    if(f[2] >= f[1])
+    { d1 = sb; d2 = sg + sb; w1 = f[2]; w2 = f[1]; w3 = f[0]; }
+    else if(f[2] >= f[0])
+    { d1 = sg; d2 = sg + sb; w1 = f[1]; w2 = f[2]; w3 = f[0]; }
+    else
+    { d1 = sg; d2 = sr + sg; w1 = f[1]; w2 = f[0]; w3 = f[2]; }
+  }
+
+  const dt_aligned_pixel_simd_t c0 = dt_load_simd_aligned(base);
+  const dt_aligned_pixel_simd_t c1 = dt_load_simd_aligned(base + d1);
+  const dt_aligned_pixel_simd_t c2 = dt_load_simd_aligned(base + d2);
+  const dt_aligned_pixel_simd_t c3 = dt_load_simd_aligned(base + sr + sg + sb);
+  const dt_aligned_pixel_simd_t v = c0 * dt_simd_set1(1.0f - w1) + c1 * dt_simd_set1(w1 - w2)
+                                    + c2 * dt_simd_set1(w2 - w3) + c3 * dt_simd_set1(w3);
+
+  out[0] = v[0];
+  out[1] = v[1];
+  out[2] = v[2];
+}
+
+__DT_CLONE_TARGETS__
+static void _apply_baked(const dt_colorspaces_conversion_t *const c, const float *const in, float *const out,
+                         const size_t width, const size_t height, const dt_colorspaces_conversion_hook_t hook)
+{
+  /* Per-thread rows for the pixels the grid does not cover, allocated before the parallel
+   * region so that no thread can fail where the others do not. */
+  const int nthreads = MAX(dt_get_num_openmp_threads(), 1);
+  float *const misses = dt_alloc_align_float((size_t)4 * width * nthreads);
+  size_t *const where = dt_alloc_align(sizeof(size_t) * width * nthreads);
+  if(IS_NULL_PTR(misses) || IS_NULL_PTR(where))
+  {
+    dt_free_align(misses);
+    dt_free_align(where);
+    _apply_lcms2(c, in, out, width, height, hook);
+    return;
+  }
+
+  const dt_baked_lut_t *const lut = c->baked;
+  const cmsHTRANSFORM xform = c->xform;
+  const cmsHTRANSFORM clip_xform = c->clip_xform;
+  const gboolean clipping = c->has_clipping;
+
+  __OMP_PARALLEL__(num_threads(nthreads))
+  {
+    float *const row_misses = misses + (size_t)4 * width * dt_get_thread_num();
+    size_t *const row_where = where + width * dt_get_thread_num();
+
+    __OMP_FOR__()
+    for(size_t row = 0; row < height; row++)
     {
+      const float *source = in + 4 * row * width;
+      float *const target = out + 4 * row * width;
+
+      if(!IS_NULL_PTR(hook))
+      {
+        // same staging as the lcms2 branch
+        for(size_t j = 0; j < width; j++)
+        {
+          hook(source + 4 * j, target + 4 * j);
+          target[4 * j + 3] = 0.0f;
+        }
+        source = target;
+      }
+
+      size_t nmisses = 0;
       for(size_t j = 0; j < width; j++)
       {
-        if(target[4 * j + 0] < 0.0f || target[4 * j + 1] < 0.0f || target[4 * j + 2] < 0.0f)
+        const float *const pixel = source + 4 * j;
+        if(_in_grid(pixel))
+          _tetrahedral(lut, pixel, target + 4 * j);
+        else
         {
-          target[4 * j + 0] = 0.0f;
-          target[4 * j + 1] = 1.0f;
-          target[4 * j + 2] = 1.0f;
+          memcpy(row_misses + 4 * nmisses, pixel, 4 * sizeof(float));
+          row_where[nmisses++] = j;
         }
       }
+
+      if(nmisses == 0) continue;
+      _lcms2_run(xform, clip_xform, clipping, row_misses, row_misses, nmisses);
+      for(size_t k = 0; k < nmisses; k++)
+        memcpy(target + 4 * row_where[k], row_misses + 4 * k, 3 * sizeof(float));
     }
   }
+
+  dt_free_align(misses);
+  dt_free_align(where);
 }
 
 void dt_colorspaces_apply_conversion_hooked(const dt_colorspaces_conversion_t *const conversion,
@@ -755,6 +1091,8 @@ void dt_colorspaces_apply_conversion_hooked(const dt_colorspaces_conversion_t *c
 
   if(conversion->is_matrix)
     _apply_matrix(conversion, in, out, width * height, hook);
+  else if(!IS_NULL_PTR(conversion->baked))
+    _apply_baked(conversion, in, out, width, height, hook);
   else
     _apply_lcms2(conversion, in, out, width, height, hook);
 }
@@ -129,6 +129,12 @@ typedef enum dt_colorspaces_conversion_flags_t
   /** @brief Mark out-of-gamut pixels rather than merely proofing them. Requires a soft-proof
    * endpoint, and forces the lcms2 fallback because there is no matrix form of it. */
   DT_CONVERSION_GAMUTCHECK = 1 << 3,
+  /** @brief On the lcms2 branch, sample the whole transform once into a 3D LUT and interpolate
+   * it, falling back to lcms2 only for pixels outside [0,1]. Much faster for LUT-based and
+   * soft-proofing profiles: about a tenth of a delta E from lcms2 on average, a couple at worst on
+   * the gamut boundary. No effect on the matrix branch, nor with ::DT_CONVERSION_GAMUTCHECK,
+   * whose marking must stay exact. Backs the `plugins/lighttable/export/bake_lcms2` conf key. */
+  DT_CONVERSION_BAKE_LUT = 1 << 4,
 } dt_colorspaces_conversion_flags_t;
 
 /**
@@ -253,6 +259,12 @@ void dt_colorspaces_apply_conversion_hooked(const dt_colorspaces_conversion_t *c
  */
 uint64_t dt_colorspaces_conversion_identity(const dt_colorspaces_conversion_t *const conversion);
 
+/**
+ * @brief Drop the memoised ::DT_CONVERSION_BAKE_LUT grids. Conversions still holding one keep
+ * it until they are freed. Called by dt_colorprofiles_cleanup().
+ */
+void dt_colorspaces_flush_baked_luts(void);
+
 /**
  * @brief Whether the conversion reduced to matrices and curves, and can therefore be run by a
  * device kernel at all.
@@ -20,6 +20,7 @@
 */
 
 #include "common/act_on.h"
+#include "common/image.h"
 #include "common/selection.h"
 #include "control/control.h"
 #include "views/view.h"
@@ -49,6 +50,24 @@ GList *dt_act_on_get_images()
   return NULL;
 }
 
+void dt_act_on_foreach_image(dt_act_on_image_func_t func, void *user_data)
+{
+  struct dt_selection_t *selection = dt_selection_get_global();
+  if(dt_selection_get_length(selection) > 0)
+  {
+    for(int32_t imgid = dt_selection_next_id(selection, UNKNOWN_IMAGE); imgid != UNKNOWN_IMAGE;
+        imgid = dt_selection_next_id(selection, imgid))
+      func(imgid, user_data);
+  }
+  else if(dt_view_active_images_get_first() > -1)
+  {
+    for(const GList *l = dt_view_active_images_get_all(); l; l = g_list_next(l))
+      func(GPOINTER_TO_INT(l->data), user_data);
+  }
+  else if(dt_control_get_keyboard_over_id() > -1)
+    func(dt_control_get_keyboard_over_id(), user_data);
+}
+
 // get only the number of images to act on
 int dt_act_on_get_images_nb(const gboolean only_visible, const gboolean force)
 {
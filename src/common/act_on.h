@@ -25,9 +25,15 @@
 #include <glib.h>
 #include <stdint.h>
 // get images to act on for globals change (via libs or accels)
-// The list needs to be freed by the caller
+// The list needs to be freed by the caller. A copy: jobs that outlive the call (export, ...) keep it
+// while the selection moves on. From the selection, it is in ascending imgid order.
 GList *dt_act_on_get_images();
 
+// call func on every image to act on, in the order of dt_act_on_get_images(), without copying the
+// selection. func must not change the selection or the active images.
+typedef void (*dt_act_on_image_func_t)(const int32_t imgid, void *user_data);
+void dt_act_on_foreach_image(dt_act_on_image_func_t func, void *user_data);
+
 // get only the number of images to act on
 int dt_act_on_get_images_nb(const gboolean only_visible, const gboolean force);
 
@@ -871,17 +871,14 @@ void dt_collection_hint_message(const dt_collection_t *collection)
   if(cs == 1)
   {
     /* determine offset of the single selected image */
-    GList *selected_imgids = dt_selection_get_list(dt_selection_get_global());
+    const int32_t imgid = dt_selection_next_id(dt_selection_get_global(), UNKNOWN_IMAGE);
     int selected = -1;
 
-    if(selected_imgids)
+    if(imgid != UNKNOWN_IMAGE)
     {
-      selected = GPOINTER_TO_INT(selected_imgids->data);
-      selected = dt_collection_image_offset_with_collection(collection, selected);
+      selected = dt_collection_image_offset_with_collection(collection, imgid);
       selected++;
     }
-    g_list_free(selected_imgids);
-    selected_imgids = NULL;
     message = g_strdup_printf(_("%d image of %d (#%d) in current collection is selected"), cs, c, selected);
   }
   else
@@ -24,6 +24,7 @@
 #include "common/conf.h"
 #include "control/control.h"
 #include "control/jobs.h"
+#include "control/jobs/image_jobs.h"
 #include "control/jobs/import_jobs.h"
 
 #include <gio/gio.h>
@@ -31,6 +32,16 @@
 #include "common/logging.h"
 
 #define DT_FOLDER_SURVEY_STATE_FILE "folder-survey-state.ini"
+#define DT_FOLDER_SURVEY_FILE_ATTRIBUTES                                                                      \
+  G_FILE_ATTRIBUTE_STANDARD_NAME "," G_FILE_ATTRIBUTE_STANDARD_TYPE "," G_FILE_ATTRIBUTE_STANDARD_SIZE       \
+  "," G_FILE_ATTRIBUTE_TIME_MODIFIED "," G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC
+
+// Watched folders: a burst of events for one shot makes one scan, this long after the first.
+#define DT_FOLDER_SURVEY_SETTLE_MS 100
+// A file that changed without being closed is imported once it has not moved for this long.
+#define DT_FOLDER_SURVEY_STABLE_MS 1000
+// With a working watcher, the periodic full scan only catches what the watcher missed.
+#define DT_FOLDER_SURVEY_FALLBACK_SECONDS 60
 
 typedef enum dt_folder_survey_file_state_t
 {
@@ -45,17 +56,23 @@ typedef struct dt_folder_survey_entry_t
   gint64 mtime;
   int stable_scans;
   dt_folder_survey_file_state_t state;
+  // Not persisted: monotonic time of the last change seen, and wall-clock time at which the
+  // file was completely written, for the shot-to-screen latency.
+  gint64 changed;
+  gint64 arrival;
 } dt_folder_survey_entry_t;
 
 typedef struct dt_folder_survey_observation_t
 {
   guint64 size;
   gint64 mtime;
+  gint64 modified; // wall-clock microseconds
 } dt_folder_survey_observation_t;
 
 typedef struct dt_folder_survey_job_t
 {
   char *folder;
+  GHashTable *paths; // the files the watcher reported, NULL to read the whole folder
   guint generation;
 } dt_folder_survey_job_t;
 
@@ -68,6 +85,19 @@ typedef struct dt_folder_survey_t
   guint generation;
   guint timer;
   guint immediate_scan;
+  // imgid -> wall-clock time its file was completely written, for imports of this session
+  GHashTable *arrivals;
+  // Event-driven scans. monitors (folder path -> GFileMonitor) is only touched from the GUI
+  // thread, the rest under the lock: touched holds the paths reported since the last scan,
+  // written the close-write time of the files not modified since.
+  GHashTable *monitors;
+  GHashTable *touched;
+  GHashTable *written;
+  guint settle;
+  gint64 settle_due;
+  gboolean watching;
+  gboolean rescan_all;   // a folder appeared: read everything on the next watched scan
+  gboolean watch_missed; // a watched scan was due while another ran
   gboolean initialized;
   gboolean active;
   gboolean baseline_initialized;
@@ -188,6 +218,24 @@ static int _folder_survey_load_locked()
   return 0;
 }
 
+/**
+ * @brief Record the stability metadata of one file in @p observed, which takes @p canonical_path.
+ */
+static void _folder_survey_observe(GHashTable *observed, char *canonical_path, GFileInfo *info)
+{
+  dt_folder_survey_observation_t *observation = malloc(sizeof(dt_folder_survey_observation_t));
+  if(IS_NULL_PTR(observation))
+  {
+    dt_free(canonical_path);
+    return;
+  }
+  observation->size = g_file_info_get_size(info);
+  observation->mtime = g_file_info_get_attribute_uint64(info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+  observation->modified = observation->mtime * G_USEC_PER_SEC
+                          + g_file_info_get_attribute_uint32(info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+  g_hash_table_replace(observed, canonical_path, observation);
+}
+
 /**
  * @brief Recursively collect supported images and their stability metadata.
  *
@@ -205,11 +253,8 @@ static int _folder_survey_collect(const char *folder, GHashTable *observed)
   {
     GFile *current = g_queue_pop_head(&folders);
     GError *enumeration_error = NULL;
-    GFileEnumerator *enumerator = g_file_enumerate_children(
-        current,
-        G_FILE_ATTRIBUTE_STANDARD_NAME "," G_FILE_ATTRIBUTE_STANDARD_TYPE "," G_FILE_ATTRIBUTE_STANDARD_SIZE
-                                       "," G_FILE_ATTRIBUTE_TIME_MODIFIED,
-        G_FILE_QUERY_INFO_NONE, NULL, &enumeration_error);
+    GFileEnumerator *enumerator = g_file_enumerate_children(current, DT_FOLDER_SURVEY_FILE_ATTRIBUTES,
+                                                            G_FILE_QUERY_INFO_NONE, NULL, &enumeration_error);
     g_object_unref(current);
 
     if(IS_NULL_PTR(enumerator))
@@ -243,16 +288,7 @@ static int _folder_survey_collect(const char *folder, GHashTable *observed)
         continue;
       }
 
-      char *canonical_path = g_canonicalize_filename(path, NULL);
-      dt_folder_survey_observation_t *observation = malloc(sizeof(dt_folder_survey_observation_t));
-      if(!IS_NULL_PTR(observation))
-      {
-        observation->size = g_file_info_get_size(info);
-        observation->mtime = g_file_info_get_attribute_uint64(info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
-        g_hash_table_replace(observed, canonical_path, observation);
-        canonical_path = NULL;
-      }
-      dt_free(canonical_path);
+      _folder_survey_observe(observed, g_canonicalize_filename(path, NULL), info);
       dt_free(path);
     }
 
@@ -270,6 +306,27 @@ static int _folder_survey_collect(const char *folder, GHashTable *observed)
   return error;
 }
 
+/**
+ * @brief Collect the supported images among @p paths, which the watcher reported.
+ *
+ * Paths that no longer exist are simply not observed, which is how the caller learns they are gone.
+ */
+static void _folder_survey_collect_paths(GHashTable *paths, GHashTable *observed)
+{
+  GHashTableIter iter;
+  gpointer path = NULL;
+  g_hash_table_iter_init(&iter, paths);
+  while(g_hash_table_iter_next(&iter, &path, NULL))
+  {
+    GFile *file = g_file_new_for_path((const char *)path);
+    GFileInfo *info = g_file_query_info(file, DT_FOLDER_SURVEY_FILE_ATTRIBUTES, G_FILE_QUERY_INFO_NONE, NULL, NULL);
+    if(!IS_NULL_PTR(info) && g_file_info_get_file_type(info) == G_FILE_TYPE_REGULAR)
+      _folder_survey_observe(observed, g_strdup((const char *)path), info);
+    if(!IS_NULL_PTR(info)) g_object_unref(info);
+    g_object_unref(file);
+  }
+}
+
 /**
  * @brief Read the ordered auto-apply style list from conf.
  *
@@ -302,9 +359,10 @@ static GList *_folder_survey_styles_for_import()
 /**
  * @brief Update one persisted entry when its asynchronous import completes.
  */
-static void _folder_survey_imported(const char *source, const gboolean success, gpointer user_data)
+static void _folder_survey_imported(const char *source, const int32_t imgid, gpointer user_data)
 {
   const guint generation = GPOINTER_TO_UINT(user_data);
+  const gboolean success = imgid > UNKNOWN_IMAGE;
   char *path = g_canonicalize_filename(source, NULL);
 
   dt_pthread_mutex_lock(&_folder_survey.lock);
@@ -315,26 +373,43 @@ static void _folder_survey_imported(const char *source, const gboolean success,
     {
       entry->state = success ? DT_FOLDER_SURVEY_FILE_DONE : DT_FOLDER_SURVEY_FILE_PENDING;
       entry->stable_scans = success ? entry->stable_scans : 0;
+      if(success && entry->arrival > 0)
+      {
+        gint64 *arrival = g_new(gint64, 1);
+        *arrival = entry->arrival;
+        g_hash_table_replace(_folder_survey.arrivals, GINT_TO_POINTER(imgid), arrival);
+      }
       _folder_survey_save_locked();
     }
   }
   dt_pthread_mutex_unlock(&_folder_survey.lock);
 
+  // Studio Capture shows every new shot, and then opens it in its pipe: start the raw decode
+  // now, while the embedded preview makes the thumbnail, rather than when the pipe asks.
+  if(success) dt_image_prefetch_full(&imgid, 1);
+
   dt_free(path);
 }
 
+static void _folder_survey_schedule_locked(const guint delay_ms);
+
 /**
  * @brief Compare the current directory contents with the prior survey loop.
  *
- * New files are first recorded as pending. An unchanged size and modification
- * time on the following loop proves that the producer has stopped writing
- * before the import job receives the file.
+ * New files are first recorded as pending. A file is handed to the import
+ * job once its producer is known to be done with it: either the watcher saw
+ * it closed after writing, or its size and modification time have not moved
+ * between two scans at least DT_FOLDER_SURVEY_STABLE_MS apart.
+ *
+ * Scans triggered by the watcher only look at the paths it reported.
  */
 static int32_t _folder_survey_job_run(dt_job_t *job)
 {
   dt_folder_survey_job_t *params = dt_control_job_get_params(job);
   GHashTable *observed = g_hash_table_new_full(g_str_hash, g_str_equal, dt_free_gpointer, dt_free_gpointer);
-  if(_folder_survey_collect(params->folder, observed))
+  if(!IS_NULL_PTR(params->paths))
+    _folder_survey_collect_paths(params->paths, observed);
+  else if(_folder_survey_collect(params->folder, observed))
   {
     g_hash_table_destroy(observed);
     return 1;
@@ -349,16 +424,30 @@ static int32_t _folder_survey_job_run(dt_job_t *job)
     return 0;
   }
 
-  GHashTableIter previous_iter;
-  gpointer previous_path = NULL;
-  gpointer previous_entry = NULL;
-  g_hash_table_iter_init(&previous_iter, _folder_survey.files);
   // Forget paths removed since the preceding scan so they can be detected if they reappear.
-  while(g_hash_table_iter_next(&previous_iter, &previous_path, &previous_entry))
+  // A watched scan only knows about the paths it looked at.
+  if(!IS_NULL_PTR(params->paths))
   {
-    if(!g_hash_table_contains(observed, previous_path)) g_hash_table_iter_remove(&previous_iter);
+    GHashTableIter paths_iter;
+    gpointer path = NULL;
+    g_hash_table_iter_init(&paths_iter, params->paths);
+    while(g_hash_table_iter_next(&paths_iter, &path, NULL))
+      if(!g_hash_table_contains(observed, path)) g_hash_table_remove(_folder_survey.files, path);
+  }
+  else
+  {
+    GHashTableIter previous_iter;
+    gpointer previous_path = NULL;
+    gpointer previous_entry = NULL;
+    g_hash_table_iter_init(&previous_iter, _folder_survey.files);
+    while(g_hash_table_iter_next(&previous_iter, &previous_path, &previous_entry))
+    {
+      if(!g_hash_table_contains(observed, previous_path)) g_hash_table_iter_remove(&previous_iter);
+    }
   }
 
+  const gint64 now = g_get_monotonic_time();
+  gboolean recheck = FALSE;
   GHashTableIter observed_iter;
   gpointer observed_path = NULL;
   gpointer observed_value = NULL;
@@ -386,43 +475,46 @@ static int32_t _folder_survey_job_run(dt_job_t *job)
       if(IS_NULL_PTR(entry)) continue;
       entry->size = observation->size;
       entry->mtime = observation->mtime;
+      entry->changed = now;
       entry->state = DT_FOLDER_SURVEY_FILE_PENDING;
       g_hash_table_replace(_folder_survey.files, g_strdup(observed_path), entry);
-      continue;
     }
-
-    if(entry->state == DT_FOLDER_SURVEY_FILE_DONE)
+    else if(entry->state == DT_FOLDER_SURVEY_FILE_QUEUED)
+      continue;
+    else if(entry->size != observation->size || entry->mtime != observation->mtime)
     {
       // A producer may reuse a filename after the previous image was handled.
       // Treat changed metadata at the same path as a new pending file.
-      if(entry->size != observation->size || entry->mtime != observation->mtime)
-      {
-        entry->size = observation->size;
-        entry->mtime = observation->mtime;
-        entry->stable_scans = 0;
-        entry->state = DT_FOLDER_SURVEY_FILE_PENDING;
-      }
-      continue;
-    }
-
-    if(entry->state == DT_FOLDER_SURVEY_FILE_QUEUED) continue;
-
-    if(entry->size != observation->size || entry->mtime != observation->mtime)
-    {
       entry->size = observation->size;
       entry->mtime = observation->mtime;
+      entry->changed = now;
       entry->stable_scans = 0;
-      continue;
+      entry->state = DT_FOLDER_SURVEY_FILE_PENDING;
     }
+    else if(entry->state == DT_FOLDER_SURVEY_FILE_DONE)
+      continue;
+    else if(now - entry->changed >= DT_FOLDER_SURVEY_STABLE_MS * 1000)
+      entry->stable_scans++;
 
-    entry->stable_scans++;
-    if(entry->stable_scans >= 1)
+    const gint64 *closed = g_hash_table_lookup(_folder_survey.written, observed_path);
+    if(IS_NULL_PTR(closed) && entry->stable_scans < 1)
     {
-      entry->state = DT_FOLDER_SURVEY_FILE_QUEUED;
-      imports = g_list_prepend(imports, g_strdup(observed_path));
+      // Still being written, as far as we know: have the watcher look again shortly.
+      if(_folder_survey.watching)
+      {
+        g_hash_table_add(_folder_survey.touched, g_strdup(observed_path));
+        recheck = TRUE;
+      }
+      continue;
     }
+
+    entry->state = DT_FOLDER_SURVEY_FILE_QUEUED;
+    entry->arrival = closed ? *closed : observation->modified;
+    g_hash_table_remove(_folder_survey.written, observed_path);
+    imports = g_list_prepend(imports, g_strdup(observed_path));
   }
 
+  if(recheck) _folder_survey_schedule_locked(DT_FOLDER_SURVEY_STABLE_MS);
   _folder_survey.baseline_initialized = TRUE;
   _folder_survey_save_locked();
   dt_pthread_mutex_unlock(&_folder_survey.lock);
@@ -472,68 +564,97 @@ static int32_t _folder_survey_job_run(dt_job_t *job)
 }
 
 /**
- * @brief Release one scan job and allow the next periodic scan to start.
+ * @brief Release one scan job and allow the next scan to start.
  */
 static void _folder_survey_job_cleanup(void *data)
 {
   dt_folder_survey_job_t *params = (dt_folder_survey_job_t *)data;
   dt_free(params->folder);
+  if(!IS_NULL_PTR(params->paths)) g_hash_table_destroy(params->paths);
   dt_free(params);
 
   if(!_folder_survey.initialized) return;
   dt_pthread_mutex_lock(&_folder_survey.lock);
   _folder_survey.scan_running = FALSE;
+  // the watcher reported files while this scan ran: look at them now
+  if(_folder_survey.watch_missed && _folder_survey.active && !_folder_survey.shutting_down)
+    _folder_survey_schedule_locked(DT_FOLDER_SURVEY_SETTLE_MS);
+  _folder_survey.watch_missed = FALSE;
   dt_pthread_mutex_unlock(&_folder_survey.lock);
 }
 
 /**
  * @brief Queue one background scan without overlapping the previous scan.
+ *
+ * @param watched TRUE to look only at the files the watcher reported since the
+ * last scan, FALSE to read the whole folder.
  */
-static gboolean _folder_survey_scan(gpointer user_data)
+static void _folder_survey_queue_scan(const gboolean watched)
 {
-  dt_pthread_mutex_lock(&_folder_survey.lock);
-  if(_folder_survey.shutting_down || !_folder_survey.active || _folder_survey.scan_running)
-  {
-    dt_pthread_mutex_unlock(&_folder_survey.lock);
-    return G_SOURCE_CONTINUE;
-  }
-  dt_pthread_mutex_unlock(&_folder_survey.lock);
-
   char *folder = dt_conf_get_string("studio_capture/folder");
   if(IS_NULL_PTR(folder) || folder[0] == '\0' || !g_file_test(folder, G_FILE_TEST_IS_DIR))
   {
     dt_free(folder);
-    return G_SOURCE_CONTINUE;
+    return;
   }
 
   dt_pthread_mutex_lock(&_folder_survey.lock);
   if(_folder_survey.shutting_down || !_folder_survey.active || _folder_survey.scan_running)
   {
+    if(watched && _folder_survey.scan_running) _folder_survey.watch_missed = TRUE;
     dt_pthread_mutex_unlock(&_folder_survey.lock);
     dt_free(folder);
-    return G_SOURCE_CONTINUE;
+    return;
   }
-  _folder_survey.scan_running = TRUE;
-  dt_folder_survey_job_t *params = malloc(sizeof(dt_folder_survey_job_t));
+
+  // Without a baseline, or after a new folder appeared, the watched paths are not enough.
+  const gboolean partial = watched && _folder_survey.baseline_initialized && !_folder_survey.rescan_all;
+  if(partial && g_hash_table_size(_folder_survey.touched) == 0)
+  {
+    dt_pthread_mutex_unlock(&_folder_survey.lock);
+    dt_free(folder);
+    return;
+  }
+
+  dt_folder_survey_job_t *params = calloc(1, sizeof(dt_folder_survey_job_t));
   if(IS_NULL_PTR(params))
   {
-    _folder_survey.scan_running = FALSE;
     dt_pthread_mutex_unlock(&_folder_survey.lock);
     dt_free(folder);
-    return G_SOURCE_CONTINUE;
+    return;
   }
+  _folder_survey.scan_running = TRUE;
   params->folder = folder;
   params->generation = _folder_survey.generation;
+  if(partial)
+  {
+    params->paths = _folder_survey.touched;
+    _folder_survey.touched = g_hash_table_new_full(g_str_hash, g_str_equal, dt_free_gpointer, NULL);
+  }
+  else
+  {
+    // a full scan sees everything the watcher reported too
+    g_hash_table_remove_all(_folder_survey.touched);
+    _folder_survey.rescan_all = FALSE;
+  }
   dt_pthread_mutex_unlock(&_folder_survey.lock);
 
   dt_job_t *job = dt_control_job_create(_folder_survey_job_run, "folder survey");
   if(IS_NULL_PTR(job))
   {
     _folder_survey_job_cleanup(params);
-    return G_SOURCE_CONTINUE;
+    return;
   }
   dt_control_job_set_params(job, params, _folder_survey_job_cleanup);
   dt_control_add_job(dt_control_get_global(), DT_JOB_QUEUE_SYSTEM_BG, job);
+}
+
+/**
+ * @brief Periodic full scan.
+ */
+static gboolean _folder_survey_scan(gpointer user_data)
+{
+  _folder_survey_queue_scan(FALSE);
   return G_SOURCE_CONTINUE;
 }
 
@@ -548,7 +669,212 @@ static gboolean _folder_survey_scan_once(gpointer user_data)
 }
 
 /**
- * @brief Recreate the periodic source after a frequency or state change.
+ * @brief Scan the files the watcher reported.
+ */
+static gboolean _folder_survey_settled(gpointer user_data)
+{
+  dt_pthread_mutex_lock(&_folder_survey.lock);
+  // a shorter delay may have replaced this source after it was dispatched
+  if(_folder_survey.settle == g_source_get_id(g_main_current_source())) _folder_survey.settle = 0;
+  dt_pthread_mutex_unlock(&_folder_survey.lock);
+
+  _folder_survey_queue_scan(TRUE);
+  return G_SOURCE_REMOVE;
+}
+
+/**
+ * @brief Have the watched files scanned in @p delay_ms at most.
+ *
+ * Called from the GUI thread by the watcher and from the scan job.
+ */
+static void _folder_survey_schedule_locked(const guint delay_ms)
+{
+  const gint64 due = g_get_monotonic_time() + (gint64)delay_ms * 1000;
+  if(_folder_survey.settle > 0)
+  {
+    if(_folder_survey.settle_due <= due) return;
+    g_source_remove(_folder_survey.settle);
+  }
+  _folder_survey.settle_due = due;
+  _folder_survey.settle = g_timeout_add(delay_ms, _folder_survey_settled, NULL);
+}
+
+/**
+ * @brief Record what the watcher saw happen to one image file.
+ *
+ * @param complete TRUE when the file was closed after writing or moved in
+ * whole, so it can be imported without waiting for it to settle.
+ */
+static void _folder_survey_touch_locked(const char *path, const gboolean complete)
+{
+  if(complete)
+  {
+    gint64 *closed = g_new(gint64, 1);
+    *closed = g_get_real_time();
+    g_hash_table_replace(_folder_survey.written, g_strdup(path), closed);
+  }
+  else
+    g_hash_table_remove(_folder_survey.written, path);
+
+  g_hash_table_add(_folder_survey.touched, g_strdup(path));
+  _folder_survey_schedule_locked(complete ? DT_FOLDER_SURVEY_SETTLE_MS : DT_FOLDER_SURVEY_STABLE_MS);
+}
+
+static void _folder_survey_watch(const char *folder);
+
+static void _folder_survey_monitor_changed(GFileMonitor *monitor, GFile *file, GFile *other_file,
+                                           GFileMonitorEvent event, gpointer user_data)
+{
+  // A rename inside one watched folder reports the old name in file and the new one in other_file.
+  GFile *target = event == G_FILE_MONITOR_EVENT_RENAMED ? other_file : file;
+  char *raw_path = IS_NULL_PTR(target) ? NULL : g_file_get_path(target);
+  char *old_raw_path = event == G_FILE_MONITOR_EVENT_RENAMED ? g_file_get_path(file) : NULL;
+  char *path = IS_NULL_PTR(raw_path) ? NULL : g_canonicalize_filename(raw_path, NULL);
+  char *old_path = IS_NULL_PTR(old_raw_path) ? NULL : g_canonicalize_filename(old_raw_path, NULL);
+  dt_free(raw_path);
+  dt_free(old_raw_path);
+
+  const gboolean arrived = event == G_FILE_MONITOR_EVENT_CREATED || event == G_FILE_MONITOR_EVENT_MOVED_IN
+                           || event == G_FILE_MONITOR_EVENT_RENAMED;
+  const gboolean left = event == G_FILE_MONITOR_EVENT_DELETED || event == G_FILE_MONITOR_EVENT_MOVED_OUT;
+
+  // A watched folder that went away takes its watch with it.
+  if(left && !IS_NULL_PTR(path)) g_hash_table_remove(_folder_survey.monitors, path);
+  if(!IS_NULL_PTR(old_path)) g_hash_table_remove(_folder_survey.monitors, old_path);
+
+  if(arrived && !IS_NULL_PTR(path)
+     && g_file_query_file_type(target, G_FILE_QUERY_INFO_NONE, NULL) == G_FILE_TYPE_DIRECTORY)
+  {
+    // Files may have landed in a new folder before its watch was set: read everything once.
+    _folder_survey_watch(path);
+    dt_pthread_mutex_lock(&_folder_survey.lock);
+    _folder_survey.rescan_all = TRUE;
+    _folder_survey_schedule_locked(DT_FOLDER_SURVEY_SETTLE_MS);
+    dt_pthread_mutex_unlock(&_folder_survey.lock);
+    dt_free(path);
+    dt_free(old_path);
+    return;
+  }
+
+  dt_pthread_mutex_lock(&_folder_survey.lock);
+  if(_folder_survey.active && !_folder_survey.shutting_down)
+  {
+    if(!IS_NULL_PTR(old_path) && dt_supported_image(old_path)) _folder_survey_touch_locked(old_path, FALSE);
+
+    if(!IS_NULL_PTR(path) && dt_supported_image(path))
+    {
+      switch(event)
+      {
+        // Tethering tools either write the file in place and close it, or write a
+        // temporary file and rename it: both mean the shot is complete.
+        case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+        case G_FILE_MONITOR_EVENT_MOVED_IN:
+        case G_FILE_MONITOR_EVENT_RENAMED:
+          _folder_survey_touch_locked(path, TRUE);
+          break;
+        case G_FILE_MONITOR_EVENT_CREATED:
+        case G_FILE_MONITOR_EVENT_CHANGED:
+        case G_FILE_MONITOR_EVENT_DELETED:
+        case G_FILE_MONITOR_EVENT_MOVED_OUT:
+          _folder_survey_touch_locked(path, FALSE);
+          break;
+        default:
+          break;
+      }
+    }
+  }
+  dt_pthread_mutex_unlock(&_folder_survey.lock);
+
+  dt_free(path);
+  dt_free(old_path);
+}
+
+static void _folder_survey_monitor_free(gpointer data)
+{
+  GFileMonitor *monitor = G_FILE_MONITOR(data);
+  g_signal_handlers_disconnect_by_func(monitor, G_CALLBACK(_folder_survey_monitor_changed), NULL);
+  g_file_monitor_cancel(monitor);
+  g_object_unref(monitor);
+}
+
+/**
+ * @brief Watch @p folder and every folder below it, on the GUI thread.
+ *
+ * GFileMonitor watches one folder, not a tree, so each subfolder gets its own
+ * monitor (one inotify watch each on Linux). Folders already watched are skipped.
+ */
+static void _folder_survey_watch(const char *folder)
+{
+  GQueue folders = G_QUEUE_INIT;
+  g_queue_push_tail(&folders, g_strdup(folder));
+
+  while(!g_queue_is_empty(&folders))
+  {
+    char *path = g_queue_pop_head(&folders);
+    if(g_hash_table_contains(_folder_survey.monitors, path))
+    {
+      dt_free(path);
+      continue;
+    }
+
+    GFile *directory = g_file_new_for_path(path);
+    GError *error = NULL;
+    GFileMonitor *monitor = g_file_monitor_directory(directory, G_FILE_MONITOR_WATCH_MOVES, NULL, &error);
+    if(IS_NULL_PTR(monitor))
+    {
+      dt_print(DT_DEBUG_CONTROL, "[folder_survey] can't watch `%s`: %s\n", path,
+               error ? error->message : "unknown error");
+      g_clear_error(&error);
+    }
+    else
+    {
+      g_signal_connect(monitor, "changed", G_CALLBACK(_folder_survey_monitor_changed), NULL);
+      g_hash_table_replace(_folder_survey.monitors, g_strdup(path), monitor);
+    }
+
+    // symbolic links are not followed: a link back up the tree would never end
+    GFileEnumerator *enumerator
+        = g_file_enumerate_children(directory, G_FILE_ATTRIBUTE_STANDARD_NAME "," G_FILE_ATTRIBUTE_STANDARD_TYPE,
+                                    G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, NULL, NULL);
+    GFileInfo *info = NULL;
+    GFile *child = NULL;
+    while(enumerator && g_file_enumerator_iterate(enumerator, &info, &child, NULL, NULL))
+    {
+      if(IS_NULL_PTR(info) || IS_NULL_PTR(child)) break;
+      if(g_file_info_get_file_type(info) != G_FILE_TYPE_DIRECTORY) continue;
+      char *child_path = g_file_get_path(child);
+      if(!IS_NULL_PTR(child_path)) g_queue_push_tail(&folders, g_canonicalize_filename(child_path, NULL));
+      dt_free(child_path);
+    }
+    if(enumerator) g_object_unref(enumerator);
+    g_object_unref(directory);
+    dt_free(path);
+  }
+}
+
+/**
+ * @brief Drop every watch and whatever the watcher reported.
+ */
+static void _folder_survey_unwatch()
+{
+  g_hash_table_remove_all(_folder_survey.monitors);
+
+  dt_pthread_mutex_lock(&_folder_survey.lock);
+  if(_folder_survey.settle > 0)
+  {
+    g_source_remove(_folder_survey.settle);
+    _folder_survey.settle = 0;
+  }
+  g_hash_table_remove_all(_folder_survey.touched);
+  g_hash_table_remove_all(_folder_survey.written);
+  _folder_survey.watching = FALSE;
+  _folder_survey.rescan_all = FALSE;
+  _folder_survey.watch_missed = FALSE;
+  dt_pthread_mutex_unlock(&_folder_survey.lock);
+}
+
+/**
+ * @brief Recreate the watches and the periodic source after a frequency or state change.
  */
 static void _folder_survey_reschedule()
 {
@@ -562,18 +888,31 @@ static void _folder_survey_reschedule()
     g_source_remove(_folder_survey.immediate_scan);
     _folder_survey.immediate_scan = 0;
   }
+  _folder_survey_unwatch();
   dt_pthread_mutex_lock(&_folder_survey.lock);
   const gboolean active = _folder_survey.active && !_folder_survey.shutting_down;
   dt_pthread_mutex_unlock(&_folder_survey.lock);
   if(!active) return;
 
+  char *folder = dt_conf_get_string("studio_capture/folder");
+  if(!IS_NULL_PTR(folder) && folder[0]) _folder_survey_watch(folder);
+  dt_free(folder);
+
+  dt_pthread_mutex_lock(&_folder_survey.lock);
+  _folder_survey.watching = g_hash_table_size(_folder_survey.monitors) > 0;
+  const gboolean watching = _folder_survey.watching;
+  dt_pthread_mutex_unlock(&_folder_survey.lock);
+
+  // Without a watcher (unsupported file system), polling is all there is.
   const int interval = CLAMP(dt_conf_get_int("studio_capture/interval"), 2, 3600);
-  _folder_survey.timer = g_timeout_add_seconds(interval, _folder_survey_scan, NULL);
+  _folder_survey.timer
+      = g_timeout_add_seconds(watching ? MAX(interval, DT_FOLDER_SURVEY_FALLBACK_SECONDS) : interval,
+                              _folder_survey_scan, NULL);
   _folder_survey.immediate_scan = g_idle_add(_folder_survey_scan_once, NULL);
 }
 
 /**
- * @brief Stop periodic scans without discarding the persisted comparison state.
+ * @brief Stop scans and watches without discarding the persisted comparison state.
  *
  * Imports already queued are allowed to finish. Starting again in the same
  * session resumes comparison from the last saved file list.
@@ -590,6 +929,7 @@ static void _folder_survey_deactivate()
     g_source_remove(_folder_survey.immediate_scan);
     _folder_survey.immediate_scan = 0;
   }
+  _folder_survey_unwatch();
 
   dt_pthread_mutex_lock(&_folder_survey.lock);
   _folder_survey.active = FALSE;
@@ -772,6 +1112,10 @@ void dt_folder_survey_init()
 
   dt_pthread_mutex_init(&_folder_survey.lock, NULL);
   _folder_survey.files = g_hash_table_new_full(g_str_hash, g_str_equal, dt_free_gpointer, dt_free_gpointer);
+  _folder_survey.arrivals = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, dt_free_gpointer);
+  _folder_survey.monitors = g_hash_table_new_full(g_str_hash, g_str_equal, dt_free_gpointer, _folder_survey_monitor_free);
+  _folder_survey.touched = g_hash_table_new_full(g_str_hash, g_str_equal, dt_free_gpointer, NULL);
+  _folder_survey.written = g_hash_table_new_full(g_str_hash, g_str_equal, dt_free_gpointer, dt_free_gpointer);
   char config_dir[PATH_MAX] = { 0 };
   dt_loc_get_user_config_dir(config_dir, sizeof(config_dir));
   _folder_survey.state_path = g_build_filename(config_dir, DT_FOLDER_SURVEY_STATE_FILE, NULL);
@@ -932,6 +1276,17 @@ gboolean dt_folder_survey_is_active()
   return active;
 }
 
+gint64 dt_folder_survey_get_arrival(const int32_t imgid)
+{
+  if(!_folder_survey.initialized) return 0;
+
+  dt_pthread_mutex_lock(&_folder_survey.lock);
+  const gint64 *arrival = g_hash_table_lookup(_folder_survey.arrivals, GINT_TO_POINTER(imgid));
+  const gint64 result = arrival ? *arrival : 0;
+  dt_pthread_mutex_unlock(&_folder_survey.lock);
+  return result;
+}
+
 gboolean dt_folder_survey_session_was_active()
 {
   return _folder_survey.initialized && _folder_survey.was_active_last_session;
@@ -1050,6 +1405,14 @@ void dt_folder_survey_cleanup()
 
   g_hash_table_destroy(_folder_survey.files);
   _folder_survey.files = NULL;
+  g_hash_table_destroy(_folder_survey.arrivals);
+  _folder_survey.arrivals = NULL;
+  g_hash_table_destroy(_folder_survey.monitors);
+  _folder_survey.monitors = NULL;
+  g_hash_table_destroy(_folder_survey.touched);
+  _folder_survey.touched = NULL;
+  g_hash_table_destroy(_folder_survey.written);
+  _folder_survey.written = NULL;
   dt_free(_folder_survey.folder);
   dt_free(_folder_survey.state_path);
   dt_pthread_mutex_destroy(&_folder_survey.lock);
@@ -1070,6 +1433,7 @@ void dt_folder_survey_stop()
     g_source_remove(_folder_survey.immediate_scan);
     _folder_survey.immediate_scan = 0;
   }
+  _folder_survey_unwatch();
 
   dt_pthread_mutex_lock(&_folder_survey.lock);
   // Application shutdown, NOT a user stop: persist the active flag as-is so an
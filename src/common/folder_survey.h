@@ -12,6 +12,7 @@
 #define DT_COMMON_FOLDER_SURVEY_H
 
 #include <glib.h>
+#include <stdint.h>
 
 /** Conf key holding the ordered list of style names auto-applied to studio
  * captures, separated by DT_FOLDER_SURVEY_STYLES_SEPARATOR. Style names may
@@ -45,7 +46,7 @@ int dt_folder_survey_start();
 void dt_folder_survey_halt();
 
 /**
- * @brief TRUE while the periodic folder scan is running.
+ * @brief TRUE while the folder is watched and scanned.
  */
 gboolean dt_folder_survey_is_active();
 
@@ -60,6 +61,15 @@ gboolean dt_folder_survey_is_active();
  */
 gboolean dt_folder_survey_can_start(const char **message);
 
+/**
+ * @brief Wall-clock time, in microseconds, at which the file of @p imgid was
+ * completely written to the surveyed folder: when the watcher saw it closed,
+ * or its modification time otherwise.
+ *
+ * @return 0 when the image was not imported by the survey in this session.
+ */
+gint64 dt_folder_survey_get_arrival(const int32_t imgid);
+
 /**
  * @brief TRUE when the previous application session quit while monitoring.
  */
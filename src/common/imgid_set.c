@@ -0,0 +1,215 @@
+/*
+    This file is part of Ansel,
+    Copyright (C) 2026 Aurélien PIERRE.
+
+    Ansel is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ansel is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ansel.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "common/imgid_set.h"
+#include "system/macros.h"
+#include "system/mem_alloc.h"
+
+#include <string.h>
+
+#define BLOCK_BITS 16
+#define BLOCK_WORDS ((1 << BLOCK_BITS) / 64)
+
+struct dt_imgid_set_t
+{
+  uint64_t **blocks; // BLOCK_WORDS words each, or NULL when nothing of its range was ever added
+  uint32_t n_blocks;
+  uint32_t count;
+};
+
+static inline uint32_t _block_popcount(const uint64_t *block)
+{
+  uint32_t count = 0;
+  for(int w = 0; w < BLOCK_WORDS; w++) count += __builtin_popcountll(block[w]);
+  return count;
+}
+
+static uint64_t *_block(dt_imgid_set_t *set, const uint32_t b)
+{
+  if(b >= set->n_blocks)
+  {
+    set->blocks = g_renew(uint64_t *, set->blocks, b + 1);
+    memset(set->blocks + set->n_blocks, 0, sizeof(uint64_t *) * (b + 1 - set->n_blocks));
+    set->n_blocks = b + 1;
+  }
+  if(IS_NULL_PTR(set->blocks[b])) set->blocks[b] = g_new0(uint64_t, BLOCK_WORDS);
+  return set->blocks[b];
+}
+
+dt_imgid_set_t *dt_imgid_set_new(void)
+{
+  return g_new0(dt_imgid_set_t, 1);
+}
+
+void dt_imgid_set_free(dt_imgid_set_t *set)
+{
+  if(IS_NULL_PTR(set)) return;
+  for(uint32_t b = 0; b < set->n_blocks; b++) dt_free(set->blocks[b]);
+  dt_free(set->blocks);
+  dt_free(set);
+}
+
+dt_imgid_set_t *dt_imgid_set_copy(const dt_imgid_set_t *set)
+{
+  dt_imgid_set_t *copy = dt_imgid_set_new();
+  dt_imgid_set_union(copy, set);
+  return copy;
+}
+
+void dt_imgid_set_clear(dt_imgid_set_t *set)
+{
+  for(uint32_t b = 0; b < set->n_blocks; b++)
+    if(set->blocks[b]) memset(set->blocks[b], 0, sizeof(uint64_t) * BLOCK_WORDS);
+  set->count = 0;
+}
+
+gboolean dt_imgid_set_add(dt_imgid_set_t *set, const int32_t imgid)
+{
+  if(imgid < 0) return FALSE;
+  uint64_t *word = _block(set, (uint32_t)imgid >> BLOCK_BITS) + ((imgid & ((1 << BLOCK_BITS) - 1)) >> 6);
+  const uint64_t bit = (uint64_t)1 << (imgid & 63);
+  if(*word & bit) return FALSE;
+  *word |= bit;
+  set->count++;
+  return TRUE;
+}
+
+gboolean dt_imgid_set_remove(dt_imgid_set_t *set, const int32_t imgid)
+{
+  if(!dt_imgid_set_contains(set, imgid)) return FALSE;
+  uint64_t *word = set->blocks[(uint32_t)imgid >> BLOCK_BITS] + ((imgid & ((1 << BLOCK_BITS) - 1)) >> 6);
+  *word &= ~((uint64_t)1 << (imgid & 63));
+  set->count--;
+  return TRUE;
+}
+
+gboolean dt_imgid_set_contains(const dt_imgid_set_t *set, const int32_t imgid)
+{
+  if(IS_NULL_PTR(set) || imgid < 0) return FALSE;
+  const uint32_t b = (uint32_t)imgid >> BLOCK_BITS;
+  if(b >= set->n_blocks || IS_NULL_PTR(set->blocks[b])) return FALSE;
+  const uint64_t word = set->blocks[b][(imgid & ((1 << BLOCK_BITS) - 1)) >> 6];
+  return (word >> (imgid & 63)) & 1;
+}
+
+uint32_t dt_imgid_set_count(const dt_imgid_set_t *set)
+{
+  return set ? set->count : 0;
+}
+
+int32_t dt_imgid_set_next(const dt_imgid_set_t *set, const int32_t after)
+{
+  if(IS_NULL_PTR(set) || set->count == 0 || after == INT32_MAX) return -1;
+
+  const uint32_t first = (uint32_t)MAX(after + 1, 0);
+  uint32_t w = (first & ((1 << BLOCK_BITS) - 1)) >> 6;
+  // the bits of the first word below `first` are masked out, the later words are whole
+  uint64_t mask = ~(uint64_t)0 << (first & 63);
+  for(uint32_t b = first >> BLOCK_BITS; b < set->n_blocks; b++, w = 0, mask = ~(uint64_t)0)
+  {
+    const uint64_t *block = set->blocks[b];
+    if(IS_NULL_PTR(block)) continue;
+    for(; w < BLOCK_WORDS; w++, mask = ~(uint64_t)0)
+    {
+      const uint64_t word = block[w] & mask;
+      if(word) return (int32_t)((b << BLOCK_BITS) + (w << 6) + __builtin_ctzll(word));
+    }
+  }
+  return -1;
+}
+
+int32_t dt_imgid_set_last(const dt_imgid_set_t *set)
+{
+  if(IS_NULL_PTR(set) || set->count == 0) return -1;
+  for(uint32_t b = set->n_blocks; b-- > 0;)
+  {
+    const uint64_t *block = set->blocks[b];
+    if(IS_NULL_PTR(block)) continue;
+    for(int w = BLOCK_WORDS; w-- > 0;)
+      if(block[w]) return (int32_t)((b << BLOCK_BITS) + (w << 6) + 63 - __builtin_clzll(block[w]));
+  }
+  return -1;
+}
+
+void dt_imgid_set_union(dt_imgid_set_t *dst, const dt_imgid_set_t *src)
+{
+  if(IS_NULL_PTR(src)) return;
+  for(uint32_t b = 0; b < src->n_blocks; b++)
+  {
+    const uint64_t *from = src->blocks[b];
+    if(IS_NULL_PTR(from) || _block_popcount(from) == 0) continue;
+    uint64_t *to = _block(dst, b);
+    dst->count -= _block_popcount(to);
+    for(int w = 0; w < BLOCK_WORDS; w++) to[w] |= from[w];
+    dst->count += _block_popcount(to);
+  }
+}
+
+void dt_imgid_set_subtract(dt_imgid_set_t *dst, const dt_imgid_set_t *src)
+{
+  if(IS_NULL_PTR(src)) return;
+  for(uint32_t b = 0; b < MIN(src->n_blocks, dst->n_blocks); b++)
+  {
+    const uint64_t *from = src->blocks[b];
+    uint64_t *to = dst->blocks[b];
+    if(IS_NULL_PTR(from) || IS_NULL_PTR(to)) continue;
+    dst->count -= _block_popcount(to);
+    for(int w = 0; w < BLOCK_WORDS; w++) to[w] &= ~from[w];
+    dst->count += _block_popcount(to);
+  }
+}
+
+void dt_imgid_set_intersect(dt_imgid_set_t *dst, const dt_imgid_set_t *src)
+{
+  for(uint32_t b = 0; b < dst->n_blocks; b++)
+  {
+    uint64_t *to = dst->blocks[b];
+    if(IS_NULL_PTR(to)) continue;
+    const uint64_t *from = (src && b < src->n_blocks) ? src->blocks[b] : NULL;
+    dst->count -= _block_popcount(to);
+    if(IS_NULL_PTR(from))
+      memset(to, 0, sizeof(uint64_t) * BLOCK_WORDS);
+    else
+    {
+      for(int w = 0; w < BLOCK_WORDS; w++) to[w] &= from[w];
+      dst->count += _block_popcount(to);
+    }
+  }
+}
+
+GList *dt_imgid_set_to_list(const dt_imgid_set_t *set)
+{
+  // prepended from the top down, so it comes out ascending without a reverse
+  GList *list = NULL;
+  if(IS_NULL_PTR(set) || set->count == 0) return list;
+  for(uint32_t b = set->n_blocks; b-- > 0;)
+  {
+    const uint64_t *block = set->blocks[b];
+    if(IS_NULL_PTR(block)) continue;
+    for(int w = BLOCK_WORDS; w-- > 0;)
+      for(uint64_t word = block[w]; word; word &= ~((uint64_t)1 << (63 - __builtin_clzll(word))))
+        list = g_list_prepend(list, GINT_TO_POINTER((b << BLOCK_BITS) + (w << 6) + 63 - __builtin_clzll(word)));
+  }
+  return list;
+}
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
@@ -0,0 +1,77 @@
+/*
+    This file is part of Ansel,
+    Copyright (C) 2026 Aurélien PIERRE.
+
+    Ansel is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ansel is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ansel.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DT_COMMON_IMGID_SET_H
+#define DT_COMMON_IMGID_SET_H
+
+#include <glib.h>
+#include <stdint.h>
+
+/**
+ * @file imgid_set.h
+ *
+ * A set of image ids, as bits. Image ids are the INTEGER PRIMARY KEY of main.images, so they
+ * are dense from 1 up: the bits come in blocks of 65536 ids, allocated when the first id of
+ * their range is added, which keeps a library of 300k images under 40 kB whatever is in the set.
+ *
+ * Membership, insertion and removal are O(1), set operations run a word at a time, and the
+ * iteration is in ascending id order. Not thread-safe: the owner locks, if it has to.
+ */
+
+typedef struct dt_imgid_set_t dt_imgid_set_t;
+
+dt_imgid_set_t *dt_imgid_set_new(void);
+void dt_imgid_set_free(dt_imgid_set_t *set);
+dt_imgid_set_t *dt_imgid_set_copy(const dt_imgid_set_t *set);
+
+/** empty the set, keeping its blocks for the next fill */
+void dt_imgid_set_clear(dt_imgid_set_t *set);
+
+/** add @p imgid, return TRUE if it was not in the set. Negative ids are never in it. */
+gboolean dt_imgid_set_add(dt_imgid_set_t *set, const int32_t imgid);
+/** remove @p imgid, return TRUE if it was in the set */
+gboolean dt_imgid_set_remove(dt_imgid_set_t *set, const int32_t imgid);
+gboolean dt_imgid_set_contains(const dt_imgid_set_t *set, const int32_t imgid);
+uint32_t dt_imgid_set_count(const dt_imgid_set_t *set);
+
+/**
+ * The lowest id of the set above @p after, or -1 past the last one. Walk the set with
+ *
+ *   for(int32_t id = dt_imgid_set_next(set, -1); id != -1; id = dt_imgid_set_next(set, id))
+ */
+int32_t dt_imgid_set_next(const dt_imgid_set_t *set, const int32_t after);
+/** the highest id of the set, or -1 when it is empty */
+int32_t dt_imgid_set_last(const dt_imgid_set_t *set);
+
+/** @p dst becomes @p dst ∪ @p src */
+void dt_imgid_set_union(dt_imgid_set_t *dst, const dt_imgid_set_t *src);
+/** @p dst becomes @p dst ∖ @p src */
+void dt_imgid_set_subtract(dt_imgid_set_t *dst, const dt_imgid_set_t *src);
+/** @p dst becomes @p dst ∩ @p src */
+void dt_imgid_set_intersect(dt_imgid_set_t *dst, const dt_imgid_set_t *src);
+
+/** the ids as a GList of GINT_TO_POINTER(), ascending. Free with g_list_free(). */
+GList *dt_imgid_set_to_list(const dt_imgid_set_t *set);
+
+#endif // DT_COMMON_IMGID_SET_H
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
@@ -74,6 +74,9 @@
 
 #include <assert.h>
 #include <locale.h>
+#ifdef __APPLE__
+#include <xlocale.h> // uselocale()
+#endif
 #include <stdio.h>
 #include <string.h>
 #include <strings.h>
@@ -117,6 +120,15 @@ typedef struct dt_opencl_t
   // a freshly-created object -- some drivers fault on that under vRAM pressure.
   GHashTable *mem_sizes;
   dt_pthread_mutex_t mem_sizes_lock;
+
+  // Programs without a cached binary, built after startup: see _opencl_compile_start().
+  GPtrArray *compile_jobs;   // _opencl_compile_job_t *, queued by dt_opencl_device_init()
+  GThreadPool *compile_pool;
+  int compile_pending;       // jobs not finished yet, atomic
+  int compile_cancel;        // set on cleanup: the jobs not started yet skip their build, atomic
+  double compile_start;
+  int compile_started;       // under lock: kernels created from now on are no shared helpers
+  int program_shared[DT_OPENCL_MAX_PROGRAMS]; // the helpers' programs: no pipe gets a device without them
 } dt_opencl_t;
 
 /* The OpenCL module's state, owned HERE. It used to hang off the application god-struct as
@@ -130,6 +142,9 @@ static dt_opencl_t *_opencl = NULL;
 /* Internal: neither is called from outside this file. */
 static void dt_opencl_cleanup_device(dt_opencl_t *cl, int i);
 
+/* Where dt_opencl_create_kernel() notes the programs it is asked for, on this thread. */
+static __thread dt_opencl_programs_t *_program_record = NULL;
+
 static inline void _opencl_splash_update_compile(const char *programname)
 {
   if(IS_NULL_PTR(programname)) return;
@@ -139,6 +154,163 @@ static inline void _opencl_splash_update_compile(const char *programname)
   dt_startup_progress_report(_("Building OpenCL kernels: %s"), programname);
 }
 
+/* Background compilation.
+ *
+ * Building from source is what makes a first start, or the first start after a driver update,
+ * take tens of seconds: every program of programs.conf, one after the other, before the window
+ * or the export even begins. Only programs without a valid cached binary are concerned, so they
+ * are queued by dt_opencl_device_init() and built by a thread pool once OpenCL is up. Each
+ * program is PENDING until then; the kernels asked for meanwhile get their slot now and are
+ * created when the build lands. A pipe does not wait for it: a module whose programs are not
+ * built runs on the CPU (dt_opencl_programs_ready()), and a device whose shared helpers are not
+ * built is not handed out at all. */
+typedef struct _opencl_compile_job_t
+{
+  int dev;
+  int prog;
+  char *programname;
+  char *binname;
+  char *cachedir;
+  char md5sum[33];
+} _opencl_compile_job_t;
+
+static _opencl_compile_job_t *_opencl_compile_job_new(const int dev, const int prog, const char *programname,
+                                                      const char *binname, const char *cachedir,
+                                                      const char *md5sum)
+{
+  _opencl_compile_job_t *job = g_new0(_opencl_compile_job_t, 1);
+  job->dev = dev;
+  job->prog = prog;
+  job->programname = g_strdup(programname);
+  job->binname = g_strdup(binname);
+  job->cachedir = g_strdup(cachedir);
+  g_strlcpy(job->md5sum, md5sum, sizeof(job->md5sum));
+  return job;
+}
+
+static void _opencl_compile_job_free(_opencl_compile_job_t *job)
+{
+  dt_free(job->programname);
+  dt_free(job->binname);
+  dt_free(job->cachedir);
+  dt_free(job);
+}
+
+// the shared helpers' programs first: no pipe gets the device before they are built
+static gint _opencl_compile_job_cmp(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  const dt_opencl_t *cl = (const dt_opencl_t *)user_data;
+  const _opencl_compile_job_t *x = *(const _opencl_compile_job_t **)a;
+  const _opencl_compile_job_t *y = *(const _opencl_compile_job_t **)b;
+  return cl->program_shared[y->prog] - cl->program_shared[x->prog];
+}
+
+// create the kernels reserved while prog was being built on dev. Under cl->lock.
+static void _opencl_create_pending_kernels(dt_opencl_t *cl, const int dev, const int prog)
+{
+  for(int k = 0; k < DT_OPENCL_MAX_KERNELS; k++)
+  {
+    if(!cl->dev[dev].kernel_used[k] || cl->dev[dev].kernel_program[k] != prog
+       || IS_NULL_PTR(cl->dev[dev].kernel_name[k]))
+      continue;
+
+    cl_int err = CL_SUCCESS;
+    cl->dev[dev].kernel[k]
+        = (cl->dlocl->symbols->dt_clCreateKernel)(cl->dev[dev].program[prog], cl->dev[dev].kernel_name[k], &err);
+    if(err != CL_SUCCESS)
+    {
+      dt_print(DT_DEBUG_OPENCL, "[opencl_create_kernel] could not create kernel `%s'! (%i)\n",
+               cl->dev[dev].kernel_name[k], err);
+      cl->dev[dev].kernel[k] = NULL;
+    }
+  }
+}
+
+static void _opencl_compile_job_run(gpointer data, gpointer user_data)
+{
+  _opencl_compile_job_t *job = (_opencl_compile_job_t *)data;
+  dt_opencl_t *cl = (dt_opencl_t *)user_data;
+  int state = DT_OPENCL_PROGRAM_FAILED;
+
+  if(!g_atomic_int_get(&cl->compile_cancel))
+  {
+    // some AMD compilers misparse numerical constants outside the "C" locale, see dt_opencl_init().
+    // The process locale is back to the user's by now: switch this thread only.
+#ifdef _WIN32
+    _configthreadlocale(_ENABLE_PER_THREAD_LOCALE);
+    char *locale = g_strdup(setlocale(LC_ALL, NULL));
+    setlocale(LC_ALL, "C");
+#else
+    locale_t c_locale = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+    locale_t locale = c_locale ? uselocale(c_locale) : (locale_t)0;
+#endif
+
+    const double start = dt_get_wtime();
+    const int err = dt_opencl_build_program(job->dev, job->prog, job->binname, job->cachedir, job->md5sum, 0);
+    if(err == CL_SUCCESS) state = DT_OPENCL_PROGRAM_READY;
+    dt_print(DT_DEBUG_OPENCL | DT_DEBUG_PERF, "[opencl_compile] device %i: `%s' %s in %.3f s\n", job->dev,
+             job->programname, (err == CL_SUCCESS) ? "built" : "FAILED", dt_get_wtime() - start);
+
+#ifdef _WIN32
+    setlocale(LC_ALL, locale);
+    dt_free(locale);
+#else
+    if(c_locale)
+    {
+      uselocale(locale);
+      freelocale(c_locale);
+    }
+#endif
+  }
+
+  dt_pthread_mutex_lock(&cl->lock);
+  if(state == DT_OPENCL_PROGRAM_READY) _opencl_create_pending_kernels(cl, job->dev, job->prog);
+  // after the kernels: READY is what lets a pipe use them
+  g_atomic_int_set(&cl->dev[job->dev].program_state[job->prog], state);
+  dt_pthread_mutex_unlock(&cl->lock);
+
+  if(g_atomic_int_dec_and_test(&cl->compile_pending))
+    dt_print(DT_DEBUG_OPENCL | DT_DEBUG_PERF, "[opencl_compile] all programs done in %.3f s\n",
+             dt_get_wtime() - cl->compile_start);
+
+  _opencl_compile_job_free(job);
+}
+
+// Start building the queued programs. After the shared helpers created their kernels, so that
+// their programs are known and go first.
+static void _opencl_compile_start(dt_opencl_t *cl)
+{
+  dt_pthread_mutex_lock(&cl->lock);
+  cl->compile_started = 1;
+  dt_pthread_mutex_unlock(&cl->lock);
+
+  if(cl->compile_jobs->len == 0) return;
+
+  g_ptr_array_sort_with_data(cl->compile_jobs, _opencl_compile_job_cmp, cl);
+
+  // half the cores: startup goes on, and the first pipes run on the CPU meanwhile
+  const int threads = MAX(1, g_get_num_processors() / 2);
+  dt_print(DT_DEBUG_OPENCL, "[opencl_compile] building %u programs on %i threads\n", cl->compile_jobs->len,
+           threads);
+
+  cl->compile_pending = cl->compile_jobs->len;
+  cl->compile_start = dt_get_wtime();
+  cl->compile_pool = g_thread_pool_new(_opencl_compile_job_run, cl, threads, FALSE, NULL);
+  for(guint n = 0; n < cl->compile_jobs->len; n++)
+    g_thread_pool_push(cl->compile_pool, g_ptr_array_index(cl->compile_jobs, n), NULL);
+  g_ptr_array_set_size(cl->compile_jobs, 0);
+}
+
+// every shared helper program is built on devid
+static gboolean _opencl_shared_programs_ready(dt_opencl_t *cl, const int devid)
+{
+  for(int prog = 0; prog < DT_OPENCL_MAX_PROGRAMS; prog++)
+    if(cl->program_shared[prog]
+       && g_atomic_int_get(&cl->dev[devid].program_state[prog]) != DT_OPENCL_PROGRAM_READY)
+      return FALSE;
+  return TRUE;
+}
+
 static const char *dt_opencl_get_vendor_by_id(unsigned int id);
 static char *_ascii_str_canonical(const char *in, char *out, int maxlen);
 /** parse a single token of priority string and store priorities in priority_list */
@@ -485,11 +657,15 @@ static int dt_opencl_device_init(dt_opencl_t *cl, const int dev, cl_device_id *d
   int res;
   cl_int err;
   gboolean lock_initialized = FALSE;
+  GPtrArray *jobs = g_ptr_array_new();
 
   memset(cl->dev[dev].program, 0x0, sizeof(cl_program) * DT_OPENCL_MAX_PROGRAMS);
   memset(cl->dev[dev].program_used, 0x0, sizeof(int) * DT_OPENCL_MAX_PROGRAMS);
   memset(cl->dev[dev].kernel, 0x0, sizeof(cl_kernel) * DT_OPENCL_MAX_KERNELS);
   memset(cl->dev[dev].kernel_used, 0x0, sizeof(int) * DT_OPENCL_MAX_KERNELS);
+  memset(cl->dev[dev].program_state, 0x0, sizeof(int) * DT_OPENCL_MAX_PROGRAMS);
+  memset(cl->dev[dev].kernel_program, 0x0, sizeof(int) * DT_OPENCL_MAX_KERNELS);
+  memset(cl->dev[dev].kernel_name, 0x0, sizeof(char *) * DT_OPENCL_MAX_KERNELS);
   cl->dev[dev].context = NULL;
   cl->dev[dev].cmd_queue = NULL;
   cl->dev[dev].eventlist = NULL;
@@ -924,8 +1100,9 @@ static int dt_opencl_device_init(dt_opencl_t *cl, const int dev, cl_device_id *d
     dt_conf_save(darktable.conf);
   }
 
-  // now load all darktable cl kernels.
-  // TODO: compile as a job?
+  // now load all darktable cl kernels. The ones we have a binary for are built right away,
+  // the others are queued for _opencl_compile_start(), unless the user wants them built here.
+  const gboolean background = dt_conf_get_bool("opencl_background_compile");
   tstart = dt_get_wtime();
   FILE *f = g_fopen(filename, "rb");
   if(f)
@@ -980,6 +1157,14 @@ static int dt_opencl_device_init(dt_opencl_t *cl, const int dev, cl_device_id *d
       char md5sum[33];
       if(dt_opencl_load_program(dev, prog, filename, binname, cachedir, md5sum, includemd5, &loaded_cached))
       {
+        if(!loaded_cached && background)
+        {
+          cl->dev[dev].program_state[prog] = DT_OPENCL_PROGRAM_PENDING;
+          g_ptr_array_add(jobs, _opencl_compile_job_new(dev, prog, programname, binname, cachedir, md5sum));
+          g_strfreev(tokens);
+          continue;
+        }
+
         if(!loaded_cached)
           _opencl_splash_update_compile(programname);
 
@@ -991,6 +1176,7 @@ static int dt_opencl_device_init(dt_opencl_t *cl, const int dev, cl_device_id *d
           res = -1;
           goto end;
         }
+        cl->dev[dev].program_state[prog] = DT_OPENCL_PROGRAM_READY;
       }
 
       g_strfreev(tokens);
@@ -1000,6 +1186,8 @@ static int dt_opencl_device_init(dt_opencl_t *cl, const int dev, cl_device_id *d
     tend = dt_get_wtime();
     tdiff = tend - tstart;
     dt_print_nts(DT_DEBUG_OPENCL, "   KERNEL LOADING TIME:       %2.4lf sec\n", tdiff);
+    if(jobs->len > 0)
+      dt_print_nts(DT_DEBUG_OPENCL, "   PROGRAMS TO BUILD:         %u, in the background\n", jobs->len);
   }
   else
   {
@@ -1014,12 +1202,23 @@ end:
   // we always write the device config to keep track of disabled devices
   dt_opencl_write_device_config(dev);
 
+  // the device slot is reused when this one is dropped: only keep the jobs of a device we keep
+  for(guint n = 0; n < jobs->len; n++)
+  {
+    if(res == 0)
+      g_ptr_array_add(cl->compile_jobs, g_ptr_array_index(jobs, n));
+    else
+      _opencl_compile_job_free(g_ptr_array_index(jobs, n));
+  }
+  g_ptr_array_free(jobs, TRUE);
+
   if(res != 0)
   {
     if(lock_initialized)
     {
       for(int n = 0; n < DT_OPENCL_MAX_KERNELS; n++)
-        if(cl->dev[dev].kernel_used[n]) (cl->dlocl->symbols->dt_clReleaseKernel)(cl->dev[dev].kernel[n]);
+        if(cl->dev[dev].kernel_used[n] && cl->dev[dev].kernel[n])
+          (cl->dlocl->symbols->dt_clReleaseKernel)(cl->dev[dev].kernel[n]);
       for(int n = 0; n < DT_OPENCL_MAX_PROGRAMS; n++)
         if(cl->dev[dev].program_used[n]) (cl->dlocl->symbols->dt_clReleaseProgram)(cl->dev[dev].program[n]);
       if(!IS_NULL_PTR(cl->dev[dev].cmd_queue))
@@ -1065,6 +1264,7 @@ void dt_opencl_init(const gboolean exclude_opencl, const gboolean print_statisti
   dt_pthread_mutex_init(&cl->lock, NULL);
   dt_pthread_mutex_init(&cl->mem_sizes_lock, NULL);
   cl->mem_sizes = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+  cl->compile_jobs = g_ptr_array_new();
   cl->inited = 0;
   cl->enabled = 0;
   cl->stopped = 0;
@@ -1277,6 +1477,7 @@ finally:
     dt_heal_init_cl_global();
     dt_colorspaces_init_cl_global();
     dt_guided_filter_init_cl_global();
+    _opencl_compile_start(cl);
   }
 
   dt_opencl_apply_scheduling_profile();
@@ -1304,7 +1505,11 @@ static void dt_opencl_cleanup_device(dt_opencl_t *cl, int i)
 {
   dt_pthread_mutex_destroy(&cl->dev[i].lock);
   for(int k = 0; k < DT_OPENCL_MAX_KERNELS; k++)
-    if(cl->dev[i].kernel_used[k]) (cl->dlocl->symbols->dt_clReleaseKernel)(cl->dev[i].kernel[k]);
+  {
+    if(cl->dev[i].kernel_used[k] && cl->dev[i].kernel[k])
+      (cl->dlocl->symbols->dt_clReleaseKernel)(cl->dev[i].kernel[k]);
+    dt_free(cl->dev[i].kernel_name[k]);
+  }
   for(int k = 0; k < DT_OPENCL_MAX_PROGRAMS; k++)
     if(cl->dev[i].program_used[k]) (cl->dlocl->symbols->dt_clReleaseProgram)(cl->dev[i].program[k]);
   if(!IS_NULL_PTR(cl->dev[i].cmd_queue))
@@ -1353,6 +1558,18 @@ void dt_opencl_cleanup(void)
 {
   dt_opencl_t *cl = _opencl;
   if(IS_NULL_PTR(cl)) return;
+
+  // a build already running cannot be interrupted: let it land, skip the others
+  if(cl->compile_pool)
+  {
+    g_atomic_int_set(&cl->compile_cancel, 1);
+    g_thread_pool_free(cl->compile_pool, FALSE, TRUE);
+    cl->compile_pool = NULL;
+  }
+  for(guint n = 0; cl->compile_jobs && n < cl->compile_jobs->len; n++)
+    _opencl_compile_job_free(g_ptr_array_index(cl->compile_jobs, n));
+  if(cl->compile_jobs) g_ptr_array_free(cl->compile_jobs, TRUE);
+
   if(cl->inited)
   {
     dt_develop_blend_free_cl_global();
@@ -1681,9 +1898,16 @@ int dt_opencl_reserve_device_for_pipe(const int pipetype)
     for(int n = 0; n < nloop; n++)
     {
       const int *prio = priority;
+      gboolean building = TRUE; // every listed device is still building its shared programs
 
       while(*prio != -1)
       {
+        if(!_opencl_shared_programs_ready(cl, *prio))
+        {
+          prio++;
+          continue;
+        }
+        building = FALSE;
         if(!dt_pthread_mutex_BAD_trylock(&cl->dev[*prio].lock))
         {
           int devid = *prio;
@@ -1693,7 +1917,8 @@ int dt_opencl_reserve_device_for_pipe(const int pipetype)
         prio++;
       }
 
-      if(!mandatory)
+      // a build takes longer than any timeout worth waiting: use the CPU this time
+      if(!mandatory || building)
       {
         dt_free(priority);
         return -1;
@@ -1709,7 +1934,8 @@ int dt_opencl_reserve_device_for_pipe(const int pipetype)
     for(int try_dev = 0; try_dev < cl->num_devs; try_dev++)
     {
       // get first currently unused processor
-      if(!dt_pthread_mutex_BAD_trylock(&cl->dev[try_dev].lock)) return try_dev;
+      if(_opencl_shared_programs_ready(cl, try_dev) && !dt_pthread_mutex_BAD_trylock(&cl->dev[try_dev].lock))
+        return try_dev;
     }
   }
 
@@ -2142,23 +2368,21 @@ int dt_opencl_build_program(const int dev, const int prog, const char *binname,
           if(bytes_written != binary_sizes[i]) goto ret;
           fclose(f);
 
-          // create link (e.g. basic.cl.bin -> f1430102c53867c162bb60af6c163328)
-          char cwd[PATH_MAX] = { 0 };
-          if(!getcwd(cwd, sizeof(cwd))) goto ret;
-          if(chdir(cachedir) != 0) goto ret;
-          char dup[PATH_MAX] = { 0 };
-          g_strlcpy(dup, binname, sizeof(dup));
-          char *bname = basename(dup);
+          // create link (e.g. basic.cl.bin -> f1430102c53867c162bb60af6c163328). No chdir():
+          // programs are built from several threads at once, see _opencl_compile_job_run().
 #if defined(_WIN32)
           //CreateSymbolicLink in Windows requires admin privileges, which we don't want/need
           //store has using a simple filerename
+          char dup[PATH_MAX] = { 0 };
+          g_strlcpy(dup, binname, sizeof(dup));
+          char *bname = basename(dup);
           char finalfilename[PATH_MAX] = { 0 };
           snprintf(finalfilename, sizeof(finalfilename), "%s" G_DIR_SEPARATOR_S "%s.%s", cachedir, bname, md5sum);
           rename(link_dest, finalfilename);
 #else
-          if(symlink(md5sum, bname) != 0) goto ret;
+          // a relative target resolves against the link's own directory, i.e. cachedir
+          if(symlink(md5sum, binname) != 0) goto ret;
 #endif //!defined(_WIN32)
-          if(chdir(cwd) != 0) goto ret;
         }
 
     ret:
@@ -2185,6 +2409,17 @@ int dt_opencl_create_kernel(const int prog, const char *name)
       if(!cl->dev[dev].kernel_used[k])
       {
         cl->dev[dev].kernel_used[k] = 1;
+        cl->dev[dev].kernel_program[k] = prog;
+        const int state = g_atomic_int_get(&cl->dev[dev].program_state[prog]);
+        if(state == DT_OPENCL_PROGRAM_PENDING || state == DT_OPENCL_PROGRAM_FAILED)
+        {
+          // keep the slot, so the kernel has the same number on every device. A pending one is
+          // created by _opencl_create_pending_kernels(); until then the program is not READY and
+          // no pipe runs it on this device.
+          cl->dev[dev].kernel[k] = NULL;
+          cl->dev[dev].kernel_name[k] = g_strdup(name);
+          break;
+        }
         cl->dev[dev].kernel[k]
             = (cl->dlocl->symbols->dt_clCreateKernel)(cl->dev[dev].program[prog], name, &err);
         if(err != CL_SUCCESS)
@@ -2207,6 +2442,10 @@ int dt_opencl_create_kernel(const int prog, const char *name)
       goto error;
     }
   }
+  if(_program_record)
+    _program_record->bits[prog / 64] |= (uint64_t)1 << (prog % 64);
+  else if(!cl->compile_started)
+    cl->program_shared[prog] = 1;
   dt_pthread_mutex_unlock(&cl->lock);
   return k;
 error:
@@ -2223,11 +2462,43 @@ void dt_opencl_free_kernel(const int kernel)
   for(int dev = 0; dev < cl->num_devs; dev++)
   {
     cl->dev[dev].kernel_used[kernel] = 0;
-    (cl->dlocl->symbols->dt_clReleaseKernel)(cl->dev[dev].kernel[kernel]);
+    if(cl->dev[dev].kernel[kernel]) (cl->dlocl->symbols->dt_clReleaseKernel)(cl->dev[dev].kernel[kernel]);
+    cl->dev[dev].kernel[kernel] = NULL;
+    dt_free(cl->dev[dev].kernel_name[kernel]);
   }
   dt_pthread_mutex_unlock(&cl->lock);
 }
 
+dt_opencl_programs_t *dt_opencl_set_program_record(dt_opencl_programs_t *record)
+{
+  dt_opencl_programs_t *previous = _program_record;
+  _program_record = record;
+  return previous;
+}
+
+gboolean dt_opencl_programs_ready(const int devid, const dt_opencl_programs_t *programs)
+{
+  dt_opencl_t *cl = _opencl;
+  if(IS_NULL_PTR(cl) || !cl->inited || devid < 0 || devid >= cl->num_devs) return FALSE;
+  if(IS_NULL_PTR(programs)) return TRUE;
+
+  for(int prog = 0; prog < DT_OPENCL_MAX_PROGRAMS; prog++)
+    if(((programs->bits[prog / 64] >> (prog % 64)) & 1)
+       && g_atomic_int_get(&cl->dev[devid].program_state[prog]) != DT_OPENCL_PROGRAM_READY)
+      return FALSE;
+  return TRUE;
+}
+
+void dt_opencl_wait_for_programs(void)
+{
+  dt_opencl_t *cl = _opencl;
+  if(IS_NULL_PTR(cl) || IS_NULL_PTR(cl->compile_pool)) return;
+
+  // runs what is still queued, then joins the threads
+  g_thread_pool_free(cl->compile_pool, FALSE, TRUE);
+  cl->compile_pool = NULL;
+}
+
 int dt_opencl_get_max_work_item_sizes(const int dev, size_t *sizes)
 {
   dt_opencl_t *cl = _opencl;
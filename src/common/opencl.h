@@ -62,6 +62,12 @@
 
 #include <stdint.h>
 
+/** A set of OpenCL program numbers, as listed in programs.conf. */
+typedef struct dt_opencl_programs_t
+{
+  uint64_t bits[DT_OPENCL_MAX_PROGRAMS / 64];
+} dt_opencl_programs_t;
+
 #ifdef HAVE_OPENCL
 
 #include "common/dlopencl.h"
@@ -171,6 +177,16 @@ typedef enum dt_opencl_fit_reason_t
   DT_OPENCL_FIT_UNINITED      // OpenCL unavailable / invalid device
 } dt_opencl_fit_reason_t;
 
+// Where a program stands on a device. Programs with a cached binary are READY once the device
+// is up; the others are PENDING until the background compilation gets to them.
+typedef enum dt_opencl_program_state_t
+{
+  DT_OPENCL_PROGRAM_NONE = 0, // not in programs.conf, or not loaded
+  DT_OPENCL_PROGRAM_PENDING,  // waiting to be built, its kernels are reserved but not created
+  DT_OPENCL_PROGRAM_READY,    // built, its kernels exist
+  DT_OPENCL_PROGRAM_FAILED    // did not build: its kernels never will
+} dt_opencl_program_state_t;
+
 /**
  * to support multi-gpu and mixed systems with cpu support,
  * we encapsulate devices and use separate command queues.
@@ -190,6 +206,9 @@ typedef struct dt_opencl_device_t
   cl_kernel kernel[DT_OPENCL_MAX_KERNELS];
   int program_used[DT_OPENCL_MAX_PROGRAMS];
   int kernel_used[DT_OPENCL_MAX_KERNELS];
+  int program_state[DT_OPENCL_MAX_PROGRAMS]; // dt_opencl_program_state_t, read with g_atomic_int_get()
+  int kernel_program[DT_OPENCL_MAX_KERNELS]; // the program a kernel comes from
+  char *kernel_name[DT_OPENCL_MAX_KERNELS];  // to create it once its program is built
   cl_event *eventlist;
   dt_opencl_eventtag_t *eventtags;
   int numevents;
@@ -432,6 +451,29 @@ int dt_opencl_create_kernel(const int program, const char *name);
 /** releases kernel resources again. */
 void dt_opencl_free_kernel(const int kernel);
 
+/**
+ * @brief Note, on the calling thread, the programs dt_opencl_create_kernel() is asked for.
+ *
+ * Set around a module's init_global() so the pipe knows which programs the module's kernels
+ * need. Kernels created with no record set come from the shared helpers (blend, gaussian, ...):
+ * a device is not handed to any pipe before those are built.
+ *
+ * @param record where to add the programs, or NULL to stop recording.
+ * @return the record that was set before, to restore afterwards.
+ */
+dt_opencl_programs_t *dt_opencl_set_program_record(dt_opencl_programs_t *record);
+
+/**
+ * @brief Whether every program in the set is built on the device.
+ *
+ * Programs without a cached binary are built in the background after startup. Until they are,
+ * the pipe runs the modules that need them on the CPU rather than waiting.
+ */
+gboolean dt_opencl_programs_ready(const int devid, const dt_opencl_programs_t *programs);
+
+/** Block until the background compilation has built every program. Main thread only. */
+void dt_opencl_wait_for_programs(void);
+
 /** return max size in sizes[3]. */
 int dt_opencl_get_max_work_item_sizes(const int dev, size_t *sizes);
 
@@ -743,6 +785,17 @@ static inline int dt_opencl_create_kernel(const int program, const char *name)
 static inline void dt_opencl_free_kernel(const int kernel)
 {
 }
+static inline dt_opencl_programs_t *dt_opencl_set_program_record(dt_opencl_programs_t *record)
+{
+  return NULL;
+}
+static inline gboolean dt_opencl_programs_ready(const int devid, const dt_opencl_programs_t *programs)
+{
+  return FALSE;
+}
+static inline void dt_opencl_wait_for_programs(void)
+{
+}
 static inline int dt_opencl_get_max_work_item_sizes(const int dev, size_t *sizes)
 {
   return -1;
@@ -38,6 +38,7 @@
 #include "common/utility.h"
 #include "database/selection_repository.h"
 #include "common/collection.h"
+#include "common/imgid_set.h"
 #include "common/selection.h"
 #include "system/macros.h"
 #include "system/mem_alloc.h"
@@ -47,15 +48,13 @@
 
 typedef struct dt_selection_t
 {
-  /* length of selection. 0 means no selection, -1 means it needs to be updated */
-  uint32_t length;
-
   /* this stores the last single clicked image id indicating
      the start of a selection range */
   int32_t last_single_id;
 
-  /* GList of ids of all images in selection */
-  GList *ids;
+  /* ids of all images in selection, the source of truth: main.selected_images is written
+     from it, and only read back into it when SQL changed the table */
+  dt_imgid_set_t *ids;
 
   /* TRUE while a selection is parked in memory.selected_backup by dt_selection_push(),
      waiting for the matching dt_selection_pop(). This lived on dt_gui_gtk_t, which is why a
@@ -65,7 +64,7 @@ typedef struct dt_selection_t
 } dt_selection_t;
 
 
-// Signal the GUI that selection got changed and trigger a selected images counter update
+// Signal the GUI that selection got changed and trigger a selected images counter update
 static void _update_gui()
 {
   dt_collection_hint_message(dt_collection_get_global());
@@ -79,23 +78,12 @@ int32_t dt_selection_get_first_id(struct dt_selection_t *selection)
 }
 
 
-static void _reset_ids_list(dt_selection_t *selection)
+static void _reset_ids(dt_selection_t *selection)
 {
-  g_list_free(g_steal_pointer(&selection->ids));
-  selection->ids = NULL;
-  selection->length = 0;
+  dt_imgid_set_clear(selection->ids);
   selection->last_single_id = -1;
 }
 
-static void _update_last_ids(dt_selection_t *selection)
-{
-  GList *last = g_list_last(selection->ids);
-  if(last)
-    selection->last_single_id = GPOINTER_TO_INT(last->data);
-  else
-    selection->last_single_id = -1;
-}
-
 // Drop selected imgids that are not in the current collection
 // WARNING: that doesn't take care of visible/unvisible image group members in GUI
 static void _clean_missing_ids(dt_selection_t *selection)
@@ -103,20 +91,14 @@ static void _clean_missing_ids(dt_selection_t *selection)
   dt_selection_repository_drop_uncollected();
 }
 
-// Unroll DB imgids to GList
-static GList *_selection_database_to_glist(dt_selection_t *selection)
-{
-  // Don't reverse the GList: the query orders SQL rows descending and the repository
-  // prepends, so what comes back is already ascending.
-  return dt_selection_repository_get_all();
-}
-
  void dt_selection_reload_from_database_real(dt_selection_t *selection)
 {
-  _reset_ids_list(selection);
-  selection->ids = _selection_database_to_glist(selection);
-  selection->length = g_list_length(selection->ids);
-  _update_last_ids(selection);
+  _reset_ids(selection);
+  GList *ids = dt_selection_repository_get_all();
+  for(GList *id = ids; id; id = g_list_next(id))
+    dt_imgid_set_add(selection->ids, GPOINTER_TO_INT(id->data));
+  g_list_free(ids);
+  selection->last_single_id = dt_imgid_set_last(selection->ids);
 }
 
 /* On collection change events, ensure the selection is only a subset of the current collection,
@@ -132,53 +114,38 @@ static void _selection_update_collection(gpointer instance, dt_collection_change
 }
 
 
-static void _remove_id_link(dt_selection_t *selection, int32_t imgid)
+static gboolean _remove_id(dt_selection_t *selection, int32_t imgid)
 {
-  GList *link = g_list_find(selection->ids, GINT_TO_POINTER(imgid));
-  if(link)
-  {
-    selection->ids = g_list_delete_link(selection->ids, link);
-    --selection->length;
-  }
-  _update_last_ids(selection);
+  const gboolean removed = dt_imgid_set_remove(selection->ids, imgid);
+  // the range anchor went: fall back on the highest id left, as after a reload
+  if(imgid == selection->last_single_id)
+    selection->last_single_id = dt_imgid_set_last(selection->ids);
+  return removed;
 }
 
-static void _add_id_link(dt_selection_t *selection, int32_t imgid)
+static gboolean _add_id(dt_selection_t *selection, int32_t imgid)
 {
-  if(!g_list_find(selection->ids, GINT_TO_POINTER(imgid)))
-  {
-    selection->ids = g_list_append(selection->ids, GINT_TO_POINTER(imgid));
-    ++selection->length;
-  }
   selection->last_single_id = imgid;
+  return dt_imgid_set_add(selection->ids, imgid);
 }
 
 GList *dt_selection_get_list(struct dt_selection_t *selection)
 {
-  if(IS_NULL_PTR(selection->ids)) return NULL;
-
-  return g_list_copy(selection->ids);
+  return dt_imgid_set_to_list(selection->ids);
 }
 
 int dt_selection_get_length(struct dt_selection_t *selection)
 {
-  if(IS_NULL_PTR(selection) || !selection->ids) return 0;
-
-  return selection->length;
-}
-
-static void _selection_select(dt_selection_t *selection, int32_t imgid)
-{
-  if(imgid < 0) return;
+  if(IS_NULL_PTR(selection)) return 0;
 
-  dt_selection_repository_select(imgid);
+  return dt_imgid_set_count(selection->ids);
 }
 
-static void _selection_deselect(dt_selection_t *selection, int32_t imgid)
+int32_t dt_selection_next_id(struct dt_selection_t *selection, const int32_t after)
 {
-  if(imgid < 0) return;
+  if(IS_NULL_PTR(selection)) return UNKNOWN_IMAGE;
 
-  dt_selection_repository_deselect(imgid);
+  return dt_imgid_set_next(selection->ids, after);
 }
 
 void dt_selection_push(dt_selection_t *selection)
@@ -189,7 +156,7 @@ void dt_selection_push(dt_selection_t *selection)
     dt_selection_repository_push();
     selection->stacked = TRUE;
 
-    // Commit from DB to GList of imgids
+    // Commit from DB to the set of imgids
     dt_selection_reload_from_database(selection);
   }
 
@@ -204,7 +171,7 @@ void dt_selection_pop(dt_selection_t *selection)
     dt_selection_repository_pop();
     selection->stacked = FALSE;
 
-    // Commit from DB to GList of imgids
+    // Commit from DB to the set of imgids
     dt_selection_reload_from_database(selection);
   }
 
@@ -214,6 +181,7 @@ void dt_selection_pop(dt_selection_t *selection)
 dt_selection_t *dt_selection_new()
 {
   dt_selection_t *selection = g_malloc0(sizeof(dt_selection_t));
+  selection->ids = dt_imgid_set_new();
 
   /* populate our local cache */
   dt_selection_reload_from_database(selection);
@@ -229,7 +197,7 @@ void dt_selection_free(dt_selection_t *selection)
 {
   DT_DEBUG_CONTROL_SIGNAL_DISCONNECT(dt_control_signal_get_global(), G_CALLBACK(_selection_update_collection),
                                      (gpointer)selection);
-  g_list_free(selection->ids);
+  dt_imgid_set_free(selection->ids);
   selection->ids = NULL;
   dt_selection_repository_cleanup();
   dt_free(selection);
@@ -238,23 +206,21 @@ void dt_selection_free(dt_selection_t *selection)
 void dt_selection_clear(dt_selection_t *selection)
 {
   dt_selection_repository_clear();
-  _reset_ids_list(selection);
+  _reset_ids(selection);
   _update_gui();
 }
 
 void dt_selection_select(dt_selection_t *selection, int32_t imgid)
 {
   if(imgid == UNKNOWN_IMAGE) return;
-  _selection_select(selection, imgid);
-  _add_id_link(selection, imgid);
+  if(_add_id(selection, imgid)) dt_selection_repository_select(imgid);
   _update_gui();
 }
 
 void dt_selection_deselect(dt_selection_t *selection, int32_t imgid)
 {
   if(imgid == UNKNOWN_IMAGE) return;
-  _selection_deselect(selection, imgid);
-  _remove_id_link(selection, imgid);
+  if(_remove_id(selection, imgid)) dt_selection_repository_deselect(imgid);
   _update_gui();
 }
 
@@ -269,45 +235,26 @@ void dt_selection_toggle(dt_selection_t *selection, int32_t imgid)
 {
   if(imgid == UNKNOWN_IMAGE) return;
 
-  if(g_list_find(selection->ids, GINT_TO_POINTER(imgid)))
+  if(dt_imgid_set_contains(selection->ids, imgid))
     dt_selection_deselect(selection, imgid);
   else
     dt_selection_select(selection, imgid);
 }
 
-static int32_t _list_iterate(struct dt_selection_t *selection, GList **list, int *count, const gboolean add)
-{
-  *count += 1;
-  int32_t imgid = GPOINTER_TO_INT((*list)->data);
-
-  if(add)
-    _add_id_link(selection, imgid);
-  else
-    _remove_id_link(selection, imgid);
-
-  *list = g_list_next(*list);
-  return imgid;
-}
-
+// Only what actually changes state goes to the database, in one transaction: selecting all
+// of an already half-selected library writes the other half, and nothing when it is all in.
 void dt_selection_select_list(struct dt_selection_t *selection, const GList *const l)
 {
   if(IS_NULL_PTR(l)) return;
-  GList *list = (GList *)l;
 
-  // Send SQL queries by batches of 400 imgids for performance
-  while(list)
+  GArray *changed = g_array_new(FALSE, FALSE, sizeof(int32_t));
+  for(const GList *id = l; id; id = g_list_next(id))
   {
-    int count = 0;
-    gchar *ids = g_strdup("");
-    while(list && count < 400)
-    {
-      int32_t imgid = _list_iterate(selection, &list, &count, TRUE);
-      ids = dt_util_dstrcat(ids, (ids[0] != '\0') ? ", (%i)" : "(%i)", imgid);
-    }
-    dt_selection_repository_select_list(ids);
-    // its sibling below has always freed this; this one never did
-    dt_free(ids);
+    const int32_t imgid = GPOINTER_TO_INT(id->data);
+    if(imgid >= 0 && _add_id(selection, imgid)) g_array_append_val(changed, imgid);
   }
+  dt_selection_repository_select_ids((const int32_t *)changed->data, changed->len);
+  g_array_free(changed, TRUE);
 
   _update_gui();
 }
@@ -315,55 +262,64 @@ void dt_selection_select_list(struct dt_selection_t *selection, const GList *con
 void dt_selection_deselect_list(struct dt_selection_t *selection, const GList *const l)
 {
   if(IS_NULL_PTR(l)) return;
-  GList *list = (GList *)l;
 
-  // Send SQL queries by batches of 400 imgids for performance
-  while(list)
+  GArray *changed = g_array_new(FALSE, FALSE, sizeof(int32_t));
+  for(const GList *id = l; id; id = g_list_next(id))
   {
-    int count = 0;
-    gchar *ids = g_strdup("");
-    while(list && count < 400)
-    {
-      int32_t imgid = _list_iterate(selection, &list, &count, FALSE);
-      ids = dt_util_dstrcat(ids, (ids[0] != '\0') ? ", %i" : "%i", imgid);
-    }
-    dt_selection_repository_deselect_list(ids);
-    dt_free(ids);
+    const int32_t imgid = GPOINTER_TO_INT(id->data);
+    if(_remove_id(selection, imgid)) g_array_append_val(changed, imgid);
   }
+  dt_selection_repository_deselect_ids((const int32_t *)changed->data, changed->len);
+  g_array_free(changed, TRUE);
 
   _update_gui();
 }
 
-gchar *dt_selection_ids_to_string(struct dt_selection_t *selection)
+void dt_selection_invert(struct dt_selection_t *selection, const GList *const l)
 {
-  // There is no selection even after init, abort
-  if(IS_NULL_PTR(selection->ids)) return NULL;
-
-  gchar **ids = g_malloc0_n(selection->length + 1, 9 * sizeof(char *));
-  uint32_t i = 0;
+  if(IS_NULL_PTR(l)) return;
 
-  // Build the array of uint32_tegers as charaters
-  for(GList *id = g_list_first(selection->ids); id; id = g_list_next(id))
+  dt_imgid_set_t *inverted = dt_imgid_set_new();
+  GArray *selected = g_array_new(FALSE, FALSE, sizeof(int32_t));
+  for(const GList *id = l; id; id = g_list_next(id))
   {
-    ids[i] = g_strdup_printf("%i", GPOINTER_TO_INT(id->data));
-    i++;
+    const int32_t imgid = GPOINTER_TO_INT(id->data);
+    if(!dt_imgid_set_contains(selection->ids, imgid) && dt_imgid_set_add(inverted, imgid))
+      g_array_append_val(selected, imgid);
   }
 
-  // ids needs to be null-terminated for strjoinv
-  ids[i] = NULL;
+  // keep the range anchor of shift-click if it survives the inversion, else fall back on the
+  // highest id selected, as _remove_id() does
+  const int32_t anchor = selection->last_single_id;
+  _reset_ids(selection);
+  dt_imgid_set_union(selection->ids, inverted);
+  dt_imgid_set_free(inverted);
+  selection->last_single_id
+      = dt_imgid_set_contains(selection->ids, anchor) ? anchor : dt_imgid_set_last(selection->ids);
+
+  dt_selection_repository_clear();
+  dt_selection_repository_select_ids((const int32_t *)selected->data, selected->len);
+  g_array_free(selected, TRUE);
 
-  // Concatenate with blank comas within
-  gchar *result = g_strjoinv(",", ids);
+  _update_gui();
+}
+
+gchar *dt_selection_ids_to_string(struct dt_selection_t *selection)
+{
+  // There is no selection even after init, abort
+  if(dt_imgid_set_count(selection->ids) == 0) return NULL;
 
-  g_strfreev(ids);
+  GString *ids = g_string_sized_new(8 * dt_imgid_set_count(selection->ids));
+  for(int32_t id = dt_imgid_set_next(selection->ids, -1); id != -1; id = dt_imgid_set_next(selection->ids, id))
+    g_string_append_printf(ids, ids->len ? ",%i" : "%i", id);
 
-  return result;
+  return g_string_free(ids, FALSE);
 }
 
 gboolean dt_selection_is_id_selected(struct dt_selection_t *selection, int32_t imgid)
 {
-  if(IS_NULL_PTR(selection) || !selection->ids) return FALSE;
-  return (g_list_find(selection->ids, GINT_TO_POINTER(imgid)) != NULL);
+  if(IS_NULL_PTR(selection)) return FALSE;
+  return dt_imgid_set_contains(selection->ids, imgid);
 }
 
 // clang-format off
@@ -53,8 +53,10 @@
  * coming from the thumbtable is a valid image ID with regard to the current collection, without additional checks.
  *
  * We synchronize here 2 representations of the selections:
- *  - a memory DB table: memory.selected_images, that is saved to be restored between reboots,
- *  - a GList of imgid, selection->ids, cached, that allows us direct access from C loops.
+ *  - a set of imgids in memory, selection->ids (see common/imgid_set.h), the source of truth: membership
+ *    is O(1) and selecting or inverting a whole collection never goes through SQL to decide anything,
+ *  - the DB table main.selected_images, written from it with only what changed, for SQL JOINs and to be
+ *    restored between reboots. It is read back only when SQL changed it (push, pop, collection change).
  *
  * Selections subscribe to the COLLECTION_CHANGED signal to ensure the selected imgids are a subset of the current collection
  * at all time. But that doesn't deal with images that might be hidden from GUI, for example image group members.
@@ -65,7 +67,8 @@
  * Interactions with selections should use the public API here.
  *
  * `SELECT imgid FROM main.seleted_images` should be reserved to SQL JOIN, when fetching metadata from DB for the list of IDs.
- * All other cases should iterate over the GList of imgids returned by `dt_selection_get_list()`
+ * All other cases should walk the selection with `dt_selection_next_id()`, or take the GList copy
+ * returned by `dt_selection_get_list()` when they need to keep it.
  *
  */
 
@@ -93,8 +96,16 @@ void dt_selection_toggle(struct dt_selection_t *selection, int32_t imgid);
 void dt_selection_select_list(struct dt_selection_t *selection, const GList *list);
 /** deselects a set of images from a list in a fast, optimized fashion. the list is unaltered */
 void dt_selection_deselect_list(struct dt_selection_t *selection, const GList *list);
-/** get the list of selected images. Warning: returns a copy, the caller owns it and needs to free it. */
+/** replaces the selection by the images of the list that are not in it: inverts it within the list, and deselects
+ * whatever selected image the list does not hold */
+void dt_selection_invert(struct dt_selection_t *selection, const GList *list);
+/** get the list of selected images, in ascending imgid order: not the collection order, nor the order they were
+ *  selected in. Callers that show or number images in collection order sort the list themselves.
+ *  Warning: returns a copy, the caller owns it and needs to free it. */
 GList *dt_selection_get_list(struct dt_selection_t *selection);
+/** the lowest selected imgid above `after`, or UNKNOWN_IMAGE past the last one. Walks the selection without copying it:
+ *  for(int32_t id = dt_selection_next_id(s, UNKNOWN_IMAGE); id != UNKNOWN_IMAGE; id = dt_selection_next_id(s, id)) */
+int32_t dt_selection_next_id(struct dt_selection_t *selection, const int32_t after);
 
 /** backup the current selection to a temp memory database table */
 void dt_selection_push(struct dt_selection_t *selection);
@@ -110,7 +121,7 @@ gchar *dt_selection_ids_to_string(struct dt_selection_t *selection);
 /** see if the imgid is known from the selection */
 gboolean dt_selection_is_id_selected(struct dt_selection_t *selection, int32_t imgid);
 
-/** call this right after the selection got changed directly in memory database, to resync the GList representation of the selection */
+/** call this right after the selection got changed directly in the database, to resync the in-memory set of the selection */
 void dt_selection_reload_from_database_real(struct dt_selection_t *selection);
 
 #define dt_selection_reload_from_database(selection) DT_DEBUG_TRACE_WRAPPER(DT_DEBUG_SQL, dt_selection_reload_from_database_real, (selection))
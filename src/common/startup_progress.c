@@ -22,6 +22,8 @@
 
 
 #include "common/startup_progress.h"
+#include "common/logging.h"
+#include "common/times.h"
 
 #include <glib.h>
 #include <stdarg.h>
@@ -29,6 +31,10 @@
 // Set once at GUI startup, never cleared. NULL in every headless run.
 static dt_startup_progress_handler_t _handler = NULL;
 
+// Only ever touched by dt_init(), on the main thread.
+static const char *_phase = NULL;
+static double _phase_start = 0.;
+
 void dt_startup_progress_set_handler(dt_startup_progress_handler_t handler)
 {
   _handler = handler;
@@ -50,6 +56,19 @@ void dt_startup_progress_report(const char *format, ...)
   }
 }
 
+void dt_startup_trace_phase(const char *phase)
+{
+  const double now = dt_get_wtime();
+  if(_phase != NULL)
+    dt_print(DT_DEBUG_PERF, "[startup] %s took %.3f secs\n", _phase, now - _phase_start);
+
+  if(phase == NULL)
+    dt_print(DT_DEBUG_PERF, "[startup] ready after %.3f secs\n", now - dt_get_start_wtime());
+
+  _phase = phase;
+  _phase_start = now;
+}
+
 // clang-format off
 // modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
 // vim: shiftwidth=2 expandtab tabstop=2 cindent
@@ -41,4 +41,13 @@ void dt_startup_progress_set_handler(dt_startup_progress_handler_t handler);
 /** Report progress. printf-style; safe to call with no handler registered. */
 void dt_startup_progress_report(const char *format, ...) __attribute__((format(printf, 1, 2)));
 
+/* Startup trace: where the time before the first window goes, under -d perf.
+ *
+ * dt_init() names each phase as it begins; that closes the previous one and logs its wall time.
+ * NULL closes the last phase and logs the total since process start. Work moved out of startup
+ * (modules' init_global(), see dt_iop_module_global_data()) logs under the same "[startup]" tag
+ * when it finally runs, so the deferred cost stays visible.
+ */
+void dt_startup_trace_phase(const char *phase);
+
 #endif // DT_COMMON_STARTUP_PROGRESS_H
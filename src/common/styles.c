@@ -64,6 +64,7 @@
 
 #include "develop/develop.h"
 #include "develop/dev_history.h"
+#include "develop/history_merge_rows.h"
 
 #include <libxml/encoding.h>
 #include <libxml/xmlwriter.h>
@@ -348,16 +349,11 @@ void dt_multiple_styles_apply_to_list(GList *styles, const GList *list, gboolean
     return;
   }
 
-  /* for each selected image apply style */
+  /* apply each style to every selected image: styles in the same order on each image, and one
+     merge batch per style, so its first image settles what the others can reuse */
   dt_undo_start_group(dt_undo_get_global(), DT_UNDO_LT_HISTORY);
-  for(const GList *l = list; l; l = g_list_next(l))
-  {
-    const int32_t imgid = GPOINTER_TO_INT(l->data);
-    for(GList *style = styles; style; style = g_list_next(style))
-    {
-      dt_history_style_on_image(imgid, (char *)style->data, duplicate);
-    }
-  }
+  for(GList *style = styles; style; style = g_list_next(style))
+    dt_history_style_on_list(list, (char *)style->data, duplicate);
   dt_undo_end_group(dt_undo_get_global());
 
   const guint styles_cnt = g_list_length(styles);
@@ -685,11 +681,55 @@ static int _styles_prepare_source_dev(dt_develop_t *dev_src, const char *name, c
   return 0;
 }
 
+/* The rows the rest of the batch takes: what the merge just appended to this image. A legacy item
+ * of a module with image-dependent defaults was upgraded against this image only, so such a style
+ * gets no rows and every image goes through the merge. */
+static dt_hm_rows_t *_styles_rows_new(const GList *mod_list, const GList *si_list, const int32_t imgid)
+{
+  dt_hm_rows_t *rows = dt_hm_rows_new();
+  for(const GList *l = si_list; l; l = g_list_next(l))
+  {
+    const dt_style_item_t *style_item = (const dt_style_item_t *)l->data;
+    for(const GList *m = mod_list; m; m = g_list_next(m))
+    {
+      const dt_iop_module_t *module = (const dt_iop_module_t *)m->data;
+      if(strcmp(module->op, style_item->operation)) continue;
+      if(style_item->module_version != module->version() && module->reload_defaults) return rows;
+      break;
+    }
+  }
+
+  for(const GList *m = mod_list; m; m = g_list_next(m))
+  {
+    const dt_iop_module_t *module = (const dt_iop_module_t *)m->data;
+    dt_hm_rows_add(rows, module->op, module->multi_name, module->multi_priority,
+                   (module->flags() & IOP_FLAGS_ONE_INSTANCE) == IOP_FLAGS_ONE_INSTANCE);
+  }
+  dt_hm_rows_capture(rows, imgid);
+  return rows;
+}
+
 int dt_styles_apply_to_image_merge(const char *name, const int style_id, const int32_t newimgid,
                                    const dt_history_merge_strategy_t mode, dt_hm_batch_state_t *batch)
 {
   int ret_val = 1;
 
+  // Studio capture and import stack several styles through one batch state: what was settled for
+  // one style says nothing about the next.
+  if(!IS_NULL_PTR(batch) && batch->source_id != style_id)
+  {
+    dt_free(batch->order_text);
+    dt_hm_rows_free(batch->rows);
+    batch->rows = NULL;
+    batch->source_id = style_id;
+  }
+
+  // Once the first image of a batch settled the order, the images that already have it take the
+  // style as plain history rows, without a develop on either side.
+  if(mode == DT_HISTORY_MERGE_APPEND && !IS_NULL_PTR(batch) && !IS_NULL_PTR(batch->order_text)
+     && dt_hm_rows_append_to_image(batch->rows, newimgid, batch) == 0)
+    return 0;
+
   // Init source history + pipeline (style content)
   dt_develop_t dev_src = { 0 };
 
@@ -714,6 +754,11 @@ int dt_styles_apply_to_image_merge(const char *name, const int style_id, const i
     ret_val = dt_dev_merge_history_into_image(&dev_src, newimgid, mod_list,
                                               dt_conf_get_bool("history/style/copy_iop_order"), mode,
                                               dt_conf_get_bool("history/paste_instances"), name, batch);
+
+    // The merge that settled the batch order hands what it wrote to the images after it.
+    if(ret_val == 0 && mode == DT_HISTORY_MERGE_APPEND && !IS_NULL_PTR(batch) && !IS_NULL_PTR(batch->order_text)
+       && IS_NULL_PTR(batch->rows))
+      batch->rows = _styles_rows_new(mod_list, si_list, newimgid);
   }
 
   g_list_free(mod_list);
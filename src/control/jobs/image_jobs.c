@@ -28,9 +28,15 @@
 
 #include "control/jobs/image_jobs.h"
 #include "control/control.h"
+#include "common/logging.h"
+#include "imageio/imageio_readahead.h"
+#include "system/atomic.h"
 #include "system/macros.h"
 #include "system/mem_alloc.h"
 
+#include <limits.h>
+#include <string.h>
+
 typedef struct dt_image_load_t
 {
   int32_t imgid;
@@ -86,6 +92,84 @@ dt_job_t *dt_image_import_job_create(uint32_t filmid, const char *filename)
   return job;
 }
 
+#define DT_IMAGE_PREFETCH_MAX 4
+
+typedef struct dt_image_prefetch_t
+{
+  int32_t imgids[DT_IMAGE_PREFETCH_MAX];
+  int count;
+  int generation;
+} dt_image_prefetch_t;
+
+// bumped by every new request and every cancel: a job only works while it holds the latest
+static dt_atomic_int _prefetch_generation;
+
+static gboolean _image_prefetch_stale(const dt_image_prefetch_t *params)
+{
+  return dt_atomic_get_int(&_prefetch_generation) != params->generation;
+}
+
+static int32_t dt_image_prefetch_job_run(dt_job_t *job)
+{
+  dt_image_prefetch_t *params = dt_control_job_get_params(job);
+  gboolean pending[DT_IMAGE_PREFETCH_MAX] = { FALSE };
+
+  for(int k = 0; k < params->count; k++)
+  {
+    // already decoded: nothing to do, and don't bump it in the LRU either
+    dt_mipmap_buffer_t buf;
+    dt_mipmap_cache_get(&buf, params->imgids[k], DT_MIPMAP_FULL, DT_MIPMAP_TESTLOCK, 'r');
+    pending[k] = IS_NULL_PTR(buf.buf);
+    dt_mipmap_cache_release(&buf);
+    if(!pending[k]) continue;
+
+    // the disk reads the next files while the first ones decode. Same path choice as the loader.
+    char filename[PATH_MAX] = { 0 };
+    gboolean from_cache = FALSE;
+    dt_image_full_path(params->imgids[k], filename, sizeof(filename), &from_cache, __FUNCTION__);
+    if(filename[0]) dt_imageio_readahead(filename);
+  }
+
+  for(int k = 0; k < params->count && !_image_prefetch_stale(params); k++)
+  {
+    if(!pending[k]) continue;
+
+    dt_mipmap_buffer_t buf;
+    dt_print(DT_DEBUG_CACHE, "[image_prefetch] decoding image %i ahead of use\n", params->imgids[k]);
+    dt_mipmap_cache_get(&buf, params->imgids[k], DT_MIPMAP_FULL, DT_MIPMAP_BLOCKING, 'r');
+    dt_mipmap_cache_release(&buf);
+  }
+  return 0;
+}
+
+void dt_image_prefetch_full(const int32_t *imgids, const int count)
+{
+  const int generation = dt_atomic_add_int(&_prefetch_generation, 1) + 1;
+  if(count <= 0) return;
+
+  dt_job_t *job = dt_control_job_create(&dt_image_prefetch_job_run, "prefetch full images");
+  if(IS_NULL_PTR(job)) return;
+  dt_image_prefetch_t *params = (dt_image_prefetch_t *)calloc(1, sizeof(dt_image_prefetch_t));
+  if(IS_NULL_PTR(params))
+  {
+    dt_control_job_dispose(job);
+    return;
+  }
+
+  params->count = MIN(count, DT_IMAGE_PREFETCH_MAX);
+  memcpy(params->imgids, imgids, sizeof(int32_t) * params->count);
+  params->generation = generation;
+  dt_control_job_set_params(job, params, dt_free_gpointer);
+
+  // SYSTEM_BG is a FIFO at priority 0: never ahead of thumbnails or the darkroom pipes
+  dt_control_add_job(dt_control_get_global(), DT_JOB_QUEUE_SYSTEM_BG, job);
+}
+
+void dt_image_prefetch_cancel(void)
+{
+  dt_atomic_add_int(&_prefetch_generation, 1);
+}
+
 // clang-format off
 // modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
 // vim: shiftwidth=2 expandtab tabstop=2 cindent
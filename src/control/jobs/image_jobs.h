@@ -32,6 +32,19 @@
 
 dt_job_t *dt_image_import_job_create(uint32_t filmid, const char *filename);
 
+/**
+ * @brief Decode the full-size input of @p imgids into the mipmap cache, in that order, on a
+ * background worker at the lowest priority.
+ *
+ * @details Meant for the images the user is likely to open next: when they do, the darkroom's
+ * blocking DT_MIPMAP_FULL request finds the buffer in cache, or waits on the decode already
+ * under way instead of starting it. Each call supersedes the previous one, and so does
+ * dt_image_prefetch_cancel(): images not started yet are dropped. A raw decode in progress
+ * can't be interrupted and runs to completion.
+ */
+void dt_image_prefetch_full(const int32_t *imgids, const int count);
+void dt_image_prefetch_cancel(void);
+
 #endif // DT_CONTROL_JOBS_IMAGE_JOBS_H
 
 // clang-format off
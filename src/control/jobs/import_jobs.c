@@ -540,7 +540,7 @@ static int32_t _control_import_job_run(dt_job_t *job)
     _refresh_progress_counter(job, data->elements, index, data->folder_survey);
     imgid = _import_image(img, data, index, &data->discarded, &xmps);
     if(!IS_NULL_PTR(data->file_imported))
-      data->file_imported((const char *)img->data, imgid > UNKNOWN_IMAGE, data->callback_data);
+      data->file_imported((const char *)img->data, imgid, data->callback_data);
 
     if(imgid > UNKNOWN_IMAGE)
     {
@@ -699,7 +699,7 @@ int dt_control_import(dt_control_import_t data)
     // Report every source as failed so asynchronous clients can release their queued state.
     for(GList *img = g_list_first(data.imgs); img; img = g_list_next(img))
       if(!IS_NULL_PTR(data.file_imported))
-        data.file_imported((const char *)img->data, FALSE, data.callback_data);
+        data.file_imported((const char *)img->data, UNKNOWN_IMAGE, data.callback_data);
 
     dt_control_import_data_free(&data);
     return 1;
@@ -81,10 +81,11 @@ typedef struct dt_control_import_t
    * @brief Optional per-file completion method.
    *
    * The import worker calls this method after each source file has either been
-   * imported successfully or rejected. The callback data belongs to this
+   * imported successfully or rejected, with its new image id, or UNKNOWN_IMAGE
+   * when it was rejected. The callback data belongs to this
    * structure and is released with callback_data_free after the complete job.
    */
-  void (*file_imported)(const char *source, gboolean success, gpointer user_data);
+  void (*file_imported)(const char *source, int32_t imgid, gpointer user_data);
   gpointer callback_data;
   GDestroyNotify callback_data_free;
 
@@ -149,6 +149,7 @@
 #include "metadata/notify.h"
 #include "caches/mipmap_cache.h"
 #include "common/noiseprofiles.h"
+#include "common/startup_progress.h"
 #include "common/opencl.h"
 #include "common/points.h"
 #include "system/resource_limits.h"
@@ -617,11 +618,6 @@ dt_pthread_mutex_t *dt_exiv2_threadsafe_mutex(void)
   return &darktable.exiv2_threadsafe;
 }
 
-dt_pthread_mutex_t *dt_readfile_mutex(void)
-{
-  return &darktable.readFile_mutex;
-}
-
 
 
 struct dt_selection_t *dt_selection_get_global(void)
@@ -889,6 +885,7 @@ int dt_init(int argc, char *argv[], const gboolean init_gui, const gboolean load
   memset(&darktable, 0, sizeof(darktable_t));
 
   darktable.start_wtime = start_wtime;
+  dt_startup_trace_phase("configuration and library");
 
   darktable.progname = argv[0];
 
@@ -905,7 +902,6 @@ int dt_init(int argc, char *argv[], const gboolean init_gui, const gboolean load
   // hold it across its whole critical section while inner helpers (read_metadata_threadsafe) or
   // re-entrant calls (e.g. variable expansion that reads metadata) re-lock it without deadlocking.
   dt_pthread_mutex_init(&(darktable.exiv2_threadsafe), &recursive_locking);
-  dt_pthread_mutex_init(&(darktable.readFile_mutex), NULL);
   dt_pthread_mutex_init(&(darktable.pipeline_threadsafe), NULL);
 
   darktable.control = (dt_control_t *)calloc(1, sizeof(dt_control_t));
@@ -1604,6 +1600,7 @@ int dt_init(int argc, char *argv[], const gboolean init_gui, const gboolean load
   // TODO : Make a single call to unified GUI API initializing everything graphical at once.
   // The current tangled mess is a nightmare to maintain.
 
+  dt_startup_trace_phase("GUI toolkit");
   if(init_gui)
   {
     if(dt_gui_gtk_init(darktable.gui))
@@ -1622,6 +1619,7 @@ int dt_init(int argc, char *argv[], const gboolean init_gui, const gboolean load
   // because we init its size here
   dt_configure_runtime_performance(&darktable.dtresources, init_gui);
 
+  dt_startup_trace_phase("views");
   darktable.view_manager = (dt_view_manager_t *)calloc(1, sizeof(dt_view_manager_t));
   dt_view_manager_init(darktable.view_manager);
 
@@ -1637,6 +1635,7 @@ int dt_init(int argc, char *argv[], const gboolean init_gui, const gboolean load
   // use), so init only fails on exhausted address space or a pathological requested
   // size. Rather than aborting outright, retry smaller: a shrunken cache degrades
   // performance, an abort loses the session.
+  dt_startup_trace_phase("caches");
   size_t pipecache_size = darktable.dtresources.pixelpipe_memory;
   dt_dev_pixelpipe_cache_init(pipecache_size,
                               (dt_get_debug_flags() & DT_DEBUG_PIPECACHE) != 0,
@@ -1689,6 +1688,7 @@ int dt_init(int argc, char *argv[], const gboolean init_gui, const gboolean load
   dt_control_signal_connect(darktable.signals, DT_SIGNAL_PREFERENCES_CHANGE,
                             G_CALLBACK(_xmp_mode_preferences_changed), NULL);
 
+  dt_startup_trace_phase("OpenCL");
 #ifdef HAVE_OPENCL
   dt_opencl_init(exclude_opencl, print_statistics);
   // Show the splash only while compiling OpenCL kernels (triggered from opencl.c),
@@ -1696,6 +1696,7 @@ int dt_init(int argc, char *argv[], const gboolean init_gui, const gboolean load
   dt_gui_splash_close();
 #endif
 
+  dt_startup_trace_phase("image I/O and processing modules");
   darktable.imageio = (dt_imageio_t *)calloc(1, sizeof(dt_imageio_t));
   dt_imageio_init(darktable.imageio);
 
@@ -1724,6 +1725,7 @@ int dt_init(int argc, char *argv[], const gboolean init_gui, const gboolean load
 
   if(init_gui)
   {
+    dt_startup_trace_phase("utility modules and view GUIs");
     darktable.lib = (dt_lib_t *)calloc(1, sizeof(dt_lib_t));
     dt_lib_init(darktable.lib);
 
@@ -1752,6 +1754,7 @@ int dt_init(int argc, char *argv[], const gboolean init_gui, const gboolean load
 
   if(init_gui)
   {
+    dt_startup_trace_phase("lighttable");
     // we have to call dt_ctl_switch_mode_to() here already to not run into a lua deadlock.
     // having another call later is ok
     dt_ctl_switch_mode_to("lighttable");
@@ -1811,6 +1814,7 @@ int dt_init(int argc, char *argv[], const gboolean init_gui, const gboolean load
   // Opt-in usage analytics (PostHog) - separate toggle from crash reporting.
   dt_telemetry_init(init_gui);
 
+  dt_startup_trace_phase(NULL);
   dt_print(DT_DEBUG_CONTROL, "[init] startup took %f seconds\n", dt_get_wtime() - start_wtime);
 
   return 0;
@@ -2018,7 +2022,6 @@ void dt_cleanup()
   dt_pthread_mutex_destroy(&(darktable.plugin_threadsafe));
   dt_pthread_mutex_destroy(&(darktable.capabilities_threadsafe));
   dt_pthread_mutex_destroy(&(darktable.exiv2_threadsafe));
-  dt_pthread_mutex_destroy(&(darktable.readFile_mutex));
   dt_pthread_mutex_destroy(&(darktable.pipeline_threadsafe));
 
   dt_exif_cleanup();
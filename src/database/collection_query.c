@@ -25,6 +25,7 @@
 #include "database/collection_query.h"
 #include "database/database.h"
 #include "database/sql_debug.h"
+#include "database/tag_repository.h"
 #include "metadata/colorlabels.h"
 #include "common/datetime.h"
 #include "metadata/map_locations.h"
@@ -41,6 +42,9 @@
 // dt_collection_query_set_rules() and read results back as ids and counts.
 static dt_collection_params_t _params;
 static gchar **_where_ext = NULL;   // composed from the rules below, never handed in
+static dt_collection_rule_t *_rules = NULL; // our copy, to compose _where_ext again
+static int _n_rules = 0;
+static guint64 _tag_names_generation = 0; // of the tag index _where_ext was resolved against
 static uint32_t _tagid = 0;
 static gchar *_query = NULL;
 static uint32_t _count = 0;
@@ -49,6 +53,8 @@ static dt_collection_query_order_resolver_t _order_resolver = NULL;
 static const char *const *_order_names = NULL;
 static int _order_names_count = 0;
 
+static gchar **_compose_where_ext(const dt_collection_rule_t *rules, const int n_rules);
+
 
 #define LIMIT_QUERY "LIMIT ?1, ?2"
 
@@ -114,6 +120,23 @@ static int _store(gchar *query)
   return 1;
 }
 
+/* Images carrying any of @p tagids, which this consumes. */
+static gchar *_tagged_with(GArray *tagids)
+{
+  if(tagids->len == 0)
+  {
+    g_array_unref(tagids);
+    return g_strdup("(1=0)");
+  }
+
+  GString *query = g_string_new("(id IN (SELECT imgid FROM main.tagged_images WHERE tagid IN (");
+  for(guint k = 0; k < tagids->len; k++)
+    g_string_append_printf(query, k ? ",%u" : "%u", g_array_index(tagids, guint, k));
+  g_string_append(query, ")))");
+  g_array_unref(tagids);
+  return g_string_free(query, FALSE);
+}
+
 /** The WHERE built from the rules the caller handed in, as "(1=1<rule><rule>...)".
  *
  *  The original took an `exclude` index and, for exclude >= 0, read
@@ -307,38 +330,31 @@ static gchar *get_query_string(const dt_collection_properties_t property, const
       }
       else
       {
-        if ((escaped_length > 0) && (escaped_text[escaped_length-1] == '*'))
+        /* The names are matched in memory by the tag index, ignoring case like LOWER()
+         * did; SQLite is left with walking tagged_images by tagid. */
+        const size_t length = strlen(text);
+        gchar *name = g_strdup(text);
+        GArray *tagids = NULL;
+        if(length > 0 && text[length - 1] == '*')
         {
           // shift-click adds an asterix * to include items in and under this hierarchy
           // without using a wildcard % which also would include similar named items
-          escaped_text[escaped_length-1] = '\0';
-          // clang-format off
-          query = g_strdup_printf("(id IN (SELECT imgid FROM main.tagged_images WHERE tagid IN "
-                                         "(SELECT id FROM data.tags "
-                                         "WHERE LOWER(name) = LOWER('%s')"
-                                         "  OR SUBSTR(LOWER(name), 1, LENGTH('%s') + 1) = LOWER('%s|'))))",
-                                  escaped_text, escaped_text, escaped_text);
-          // clang-format on
+          name[length - 1] = '\0';
+          tagids = dt_tag_repository_find_path(name, TRUE);
         }
-        else if ((escaped_length > 0) && (escaped_text[escaped_length-1] == '%'))
+        else if(length > 0 && text[length - 1] == '%')
         {
           // ends with % or |%
-          escaped_text[escaped_length-1] = '\0';
-          // clang-format off
-          query = g_strdup_printf("(id IN (SELECT imgid FROM main.tagged_images WHERE tagid IN "
-                                         "(SELECT id FROM data.tags WHERE SUBSTR(LOWER(name), 1, LENGTH('%s')) = LOWER('%s'))))",
-                                  escaped_text, escaped_text);
-          // clang-format on
+          name[length - 1] = '\0';
+          tagids = dt_tag_repository_find_prefix(name);
         }
         else
         {
           // default
-          // clang-format off
-          query = g_strdup_printf("(id IN (SELECT imgid FROM main.tagged_images WHERE tagid IN "
-                                       "(SELECT id FROM data.tags WHERE LOWER(name) = LOWER('%s'))))",
-                                  escaped_text);
-          // clang-format on
+          tagids = dt_tag_repository_find_path(name, FALSE);
         }
+        query = _tagged_with(tagids);
+        dt_free(name);
       }
     }
     break;
@@ -800,6 +816,16 @@ static int _recompose(void){
   gchar *wq, *sq, *selq_pre, *selq_post, *query;
   wq = sq = selq_pre = selq_post = query = NULL;
 
+  /* Tag rules are composed from the tag ids their names resolved to, so a tag created or
+   * renamed since is only picked up by resolving them again. */
+  const guint64 tag_names = dt_tag_repository_index_generation();
+  if(tag_names != _tag_names_generation && _n_rules > 0)
+  {
+    g_strfreev(_where_ext);
+    _where_ext = _compose_where_ext(_rules, _n_rules);
+    _tag_names_generation = dt_tag_repository_index_generation();
+  }
+
   /* build where part */
   gchar *where_ext = _extended_where();
   if(_params.query_flags & COLLECTION_QUERY_USE_ONLY_WHERE_EXT)
@@ -1106,6 +1132,13 @@ static gchar **_compose_where_ext(const dt_collection_rule_t *rules, const int n
   return parts;
 }
 
+static void _rules_free(void)
+{
+  for(int i = 0; i < _n_rules; i++) g_free((gchar *)_rules[i].text);
+  dt_free(_rules);
+  _n_rules = 0;
+}
+
 int dt_collection_query_set_rules(const dt_collection_params_t *params,
                                   const dt_collection_rule_t *rules, const int n_rules,
                                   const uint32_t tagid)
@@ -1117,8 +1150,21 @@ int dt_collection_query_set_rules(const dt_collection_params_t *params,
   _params = *params;
   _params.text_filter = params->text_filter ? g_strdup(params->text_filter) : NULL;
 
+  _rules_free();
+  if(rules && n_rules > 0)
+  {
+    _rules = g_new0(dt_collection_rule_t, n_rules);
+    _n_rules = n_rules;
+    for(int i = 0; i < n_rules; i++)
+    {
+      _rules[i] = rules[i];
+      _rules[i].text = g_strdup(rules[i].text);
+    }
+  }
+
   g_strfreev(_where_ext);
-  _where_ext = (rules && n_rules > 0) ? _compose_where_ext(rules, n_rules) : NULL;
+  _where_ext = _n_rules > 0 ? _compose_where_ext(_rules, _n_rules) : NULL;
+  _tag_names_generation = dt_tag_repository_index_generation();
   _tagid = tagid;
 
   return _recompose();
@@ -1602,6 +1648,7 @@ void dt_collection_query_cleanup(void)
   _params.text_filter = NULL;
   g_strfreev(_where_ext);
   _where_ext = NULL;
+  _rules_free();
 }
 
 void dt_collection_query_refresh_memory_table(void){
@@ -904,6 +904,48 @@ dt_image_geo_point_t *dt_image_repository_get_collected_geo_points(const double
   return (dt_image_geo_point_t *)g_array_free(points, FALSE);  // hand over the buffer
 }
 
+dt_image_geo_point_t *dt_image_repository_get_collected_geo_points_of(const GList *imgs, int *count)
+{
+  if(IS_NULL_PTR(count)) return NULL;
+  *count = 0;
+  if(IS_NULL_PTR(imgs)) return NULL;
+
+  sqlite3_stmt *stmt = NULL;
+  // clang-format off
+  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get_sqlite3_global(),
+                              "SELECT i.longitude, i.latitude"
+                              " FROM main.images i INNER JOIN memory.collected_images c ON i.id = c.imgid"
+                              " WHERE i.id = ?1 AND i.longitude NOT NULL AND i.latitude NOT NULL",
+                              -1, &stmt, NULL);
+  // clang-format on
+  if(IS_NULL_PTR(stmt)) return NULL;
+
+  GArray *points = g_array_new(FALSE, FALSE, sizeof(dt_image_geo_point_t));
+  for(const GList *iter = imgs; iter; iter = g_list_next(iter))
+  {
+    const int32_t imgid = GPOINTER_TO_INT(iter->data);
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgid);
+    if(sqlite3_step(stmt) != SQLITE_ROW) continue;
+
+    dt_image_geo_point_t p = { .imgid = imgid,
+                               .longitude = sqlite3_column_double(stmt, 0),
+                               .latitude = sqlite3_column_double(stmt, 1) };
+    g_array_append_val(points, p);
+  }
+  sqlite3_finalize(stmt);
+
+  *count = (int)points->len;
+  if(points->len == 0)
+  {
+    g_array_free(points, TRUE);
+    return NULL;
+  }
+
+  return (dt_image_geo_point_t *)g_array_free(points, FALSE);
+}
+
 int64_t dt_image_repository_get_write_timestamp(const int32_t imgid)
 {
   if(imgid <= 0) return 0;
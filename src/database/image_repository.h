@@ -324,8 +324,9 @@ typedef struct dt_image_geo_point_t
 /**
  * @brief Collected images inside the box, **ordered by longitude ascending**.
  *
- * @details The order is not cosmetic: the caller's DBSCAN clustering sweeps the array in
- * longitude order and would cluster differently without it.
+ * @details The order is not cosmetic: the caller's DBSCAN clustering numbers its clusters in
+ * longitude order and would show other thumbnails without it. The map view asks for the whole
+ * globe once per collection and keeps the result.
  *
  * @param count out: how many points the array holds. Never NULL.
  * @return a newly allocated array of @p count points, or NULL when there are none.
@@ -335,6 +336,19 @@ dt_image_geo_point_t *dt_image_repository_get_collected_geo_points(const double
                                                                    const double lat1, const double lat2,
                                                                    int *count);
 
+/**
+ * @brief Those of @p imgs that are collected and carry coordinates, in the order of @p imgs.
+ *
+ * @details Keeps a copy of the collected points current when a few images are geotagged,
+ * without reading the whole collection again. One prepared statement, stepped once per image.
+ *
+ * @param imgs image ids as GINT_TO_POINTER().
+ * @param count out: how many points the array holds. Never NULL.
+ * @return a newly allocated array of @p count points, or NULL when there are none.
+ *         Free with dt_free().
+ */
+dt_image_geo_point_t *dt_image_repository_get_collected_geo_points_of(const GList *imgs, int *count);
+
 /* ---------------------------------------------------------------------------------------
  *  Do these images agree?
  * ------------------------------------------------------------------------------------- */
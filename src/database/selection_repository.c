@@ -26,9 +26,9 @@
 
 #include <sqlite3.h>
 
-/* The read is on the hot path -- every selection change re-reads the whole table to
- * rebuild the in-memory mirror -- so its statement is cached. The writes are one per user
- * action and are not. */
+/* The table is only read back when the selection reloads -- at startup, and after a push,
+ * a pop or a collection change rewrote it here in SQL. Every other change is made in memory
+ * first and written through one of the functions below. */
 
 void dt_selection_repository_select(const int32_t imgid)
 {
@@ -48,22 +48,35 @@ void dt_selection_repository_deselect(const int32_t imgid)
   dt_free(query);
 }
 
-void dt_selection_repository_select_list(const char *ids)
+/* One statement stepped per id inside one transaction: selecting a whole 300k-image
+ * library is then one journal write, not 750 INSERTs of 400 VALUES each. */
+static void _run_for_ids(const char *query, const int32_t *imgids, const int count)
 {
-  if(IS_NULL_PTR(ids)) return;
+  if(IS_NULL_PTR(imgids) || count <= 0) return;
 
-  gchar *query = g_strdup_printf("INSERT OR IGNORE INTO main.selected_images VALUES %s", ids);
-  DT_DEBUG_SQLITE3_EXEC(dt_database_get_sqlite3_global(), query, NULL, NULL, NULL);
-  dt_free(query);
+  sqlite3_stmt *stmt = NULL;
+  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get_sqlite3_global(), query, -1, &stmt, NULL);
+  if(IS_NULL_PTR(stmt)) return;
+
+  dt_database_start_transaction();
+  for(int k = 0; k < count; k++)
+  {
+    DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, imgids[k]);
+    sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+  }
+  dt_database_release_transaction();
+  sqlite3_finalize(stmt);
 }
 
-void dt_selection_repository_deselect_list(const char *ids)
+void dt_selection_repository_select_ids(const int32_t *imgids, const int count)
 {
-  if(IS_NULL_PTR(ids)) return;
+  _run_for_ids("INSERT OR IGNORE INTO main.selected_images VALUES (?1)", imgids, count);
+}
 
-  gchar *query = g_strdup_printf("DELETE FROM main.selected_images WHERE imgid IN (%s)", ids);
-  DT_DEBUG_SQLITE3_EXEC(dt_database_get_sqlite3_global(), query, NULL, NULL, NULL);
-  dt_free(query);
+void dt_selection_repository_deselect_ids(const int32_t *imgids, const int count)
+{
+  _run_for_ids("DELETE FROM main.selected_images WHERE imgid = ?1", imgids, count);
 }
 
 void dt_selection_repository_clear(void)
@@ -20,9 +20,10 @@
  *
  * @brief `main.selected_images`, and the `memory.selected_backup` it is pushed onto.
  *
- * @details The selection is in the database rather than in memory because the collection
- * query joins against it. `common/selection.c` keeps the in-memory mirror, the signals and
- * the range/toggle semantics; the two tables live here.
+ * @details `common/selection.c` holds the selection in memory, as a set of ids, and answers
+ * every question about it from there. The table is its copy for the SQL that joins against
+ * the selection -- the collection query, the tag and metadata repositories -- and for the
+ * next session; the selection writes only what changed. The two tables live here.
  */
 
 #ifndef DT_DATABASE_SELECTION_REPOSITORY_H
@@ -39,24 +40,11 @@ void dt_selection_repository_select(const int32_t imgid);
 /** @brief Remove @p imgid from the selection. */
 void dt_selection_repository_deselect(const int32_t imgid);
 
-/**
- * @brief Add every id in @p ids to the selection.
- *
- * @param ids a comma-separated list of parenthesised single-column tuples, `"(1),(2),(3)"`
- *        -- the VALUES clause of the insert. Built by the caller because it is the caller
- *        that knows how to walk its own list.
- */
-void dt_selection_repository_select_list(const char *ids);
+/** @brief Add the @p count ids of @p imgids to the selection, in one transaction. */
+void dt_selection_repository_select_ids(const int32_t *imgids, const int count);
 
-/**
- * @brief Remove every id in @p ids from the selection.
- *
- * @param ids a comma-separated list of bare ids, `"1,2,3"`. Note this is NOT the same
- *        spelling as dt_selection_repository_select_list() takes -- one lands in a VALUES
- *        clause, the other in an `IN (...)`. That asymmetry is inherited; both callers are
- *        in `common/selection.c`, a dozen lines apart.
- */
-void dt_selection_repository_deselect_list(const char *ids);
+/** @brief Remove the @p count ids of @p imgids from the selection, in one transaction. */
+void dt_selection_repository_deselect_ids(const int32_t *imgids, const int count);
 
 /** @brief Empty the selection. */
 void dt_selection_repository_clear(void);
@@ -20,10 +20,12 @@
 
 #include "database/database.h"
 #include "database/sql_debug.h"
+#include "system/dtpthread.h"
 #include "system/macros.h"
 #include "system/mem_alloc.h"
 
 #include <sqlite3.h>
+#include <string.h>
 
 GList *dt_tag_repository_get_attached_names(const int32_t imgid)
 {
@@ -106,6 +108,265 @@ GList *dt_tag_repository_get_by_path_with_counts(const char *path, const char *p
 }
 
 
+/* ---------------------------------------------------------------------------------------
+ *  The name index
+ *
+ *  Every tag name and its synonyms, folded once, held in memory. Typing in the tagging
+ *  entry or a tag rule of the collection matches against these instead of LOWER()-ing and
+ *  LIKE-ing the whole of data.tags again for every keystroke. Loaded on first use; every
+ *  write to data.tags below patches it, so it is never reloaded until the connection goes.
+ * ------------------------------------------------------------------------------------- */
+
+typedef struct _tag_index_entry_t
+{
+  guint tagid;
+  gchar *key;      // the name, normalized and casefolded
+  gchar *haystack; // the name then its synonyms, folded the same way
+} _tag_index_entry_t;
+
+static dt_pthread_mutex_t _index_mutex;
+static gsize _index_mutex_inited = 0;
+static GPtrArray *_index = NULL;        // _tag_index_entry_t, sorted by key then tagid
+static GHashTable *_index_by_id = NULL; // tagid -> _tag_index_entry_t, same entries
+static guint64 _index_generation = 0;
+
+static inline void _index_lock(void)
+{
+  if(g_once_init_enter(&_index_mutex_inited))
+  {
+    dt_pthread_mutex_init(&_index_mutex, NULL);
+    g_once_init_leave(&_index_mutex_inited, 1);
+  }
+  dt_pthread_mutex_lock(&_index_mutex);
+}
+
+static inline void _index_unlock(void)
+{
+  dt_pthread_mutex_unlock(&_index_mutex);
+}
+
+static gchar *_fold(const char *text)
+{
+  gchar *normalized = g_utf8_normalize(text ? text : "", -1, G_NORMALIZE_ALL);
+  // not UTF-8: match it as it is rather than not at all
+  if(IS_NULL_PTR(normalized)) return g_ascii_strdown(text ? text : "", -1);
+  gchar *folded = g_utf8_casefold(normalized, -1);
+  dt_free(normalized);
+  return folded;
+}
+
+static void _index_entry_fill(_tag_index_entry_t *entry, const char *name, const char *synonyms)
+{
+  dt_free(entry->key);
+  dt_free(entry->haystack);
+  entry->key = _fold(name);
+  if(synonyms && synonyms[0])
+  {
+    gchar *text = g_strconcat(name ? name : "", ", ", synonyms, NULL);
+    entry->haystack = _fold(text);
+    dt_free(text);
+  }
+  else
+    entry->haystack = g_strdup(entry->key);
+}
+
+static void _index_entry_free(gpointer data)
+{
+  _tag_index_entry_t *entry = (_tag_index_entry_t *)data;
+  dt_free(entry->key);
+  dt_free(entry->haystack);
+  dt_free(entry);
+}
+
+static int _index_entry_cmp(gconstpointer a, gconstpointer b)
+{
+  // g_ptr_array_sort() hands over pointers to the elements
+  const _tag_index_entry_t *x = *(const _tag_index_entry_t *const *)a;
+  const _tag_index_entry_t *y = *(const _tag_index_entry_t *const *)b;
+  const int c = strcmp(x->key, y->key);
+  return c ? c : (x->tagid > y->tagid) - (x->tagid < y->tagid);
+}
+
+/* First position whose (key, tagid) is not below the given ones. */
+static guint _index_lower_bound(const char *key, const guint tagid)
+{
+  guint lo = 0, hi = _index->len;
+  while(lo < hi)
+  {
+    const guint mid = lo + (hi - lo) / 2;
+    const _tag_index_entry_t *entry = g_ptr_array_index(_index, mid);
+    const int c = strcmp(entry->key, key);
+    if(c < 0 || (c == 0 && entry->tagid < tagid))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/* With the lock held. */
+static void _index_ensure_loaded(void)
+{
+  if(_index) return;
+
+  _index = g_ptr_array_new_with_free_func(_index_entry_free);
+  _index_by_id = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+  sqlite3_stmt *stmt = NULL;
+  DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get_sqlite3_global(),
+                              "SELECT id, name, synonyms FROM data.tags", -1, &stmt, NULL);
+  while(sqlite3_step(stmt) == SQLITE_ROW)
+  {
+    _tag_index_entry_t *entry = g_new0(_tag_index_entry_t, 1);
+    entry->tagid = sqlite3_column_int(stmt, 0);
+    _index_entry_fill(entry, (const char *)sqlite3_column_text(stmt, 1),
+                      (const char *)sqlite3_column_text(stmt, 2));
+    g_ptr_array_add(_index, entry);
+    g_hash_table_insert(_index_by_id, GUINT_TO_POINTER(entry->tagid), entry);
+  }
+  sqlite3_finalize(stmt);
+
+  g_ptr_array_sort(_index, _index_entry_cmp);
+  _index_generation++;
+}
+
+/* With the lock held. Takes @p entry out of the sorted array without freeing it. */
+static void _index_unlink(_tag_index_entry_t *entry)
+{
+  const guint pos = _index_lower_bound(entry->key, entry->tagid);
+  if(pos < _index->len && g_ptr_array_index(_index, pos) == entry)
+    g_ptr_array_steal_index(_index, pos);
+}
+
+/* With the lock held. */
+static void _index_link(_tag_index_entry_t *entry)
+{
+  g_ptr_array_insert(_index, _index_lower_bound(entry->key, entry->tagid), entry);
+}
+
+/* A tag was created, renamed or got new synonyms: re-read its row. Does nothing while the
+ * index is not loaded, since loading will read the row anyway. */
+static void _index_update(const guint tagid)
+{
+  _index_lock();
+  if(_index)
+  {
+    _tag_index_entry_t *entry = g_hash_table_lookup(_index_by_id, GUINT_TO_POINTER(tagid));
+    if(entry) _index_unlink(entry);
+
+    sqlite3_stmt *stmt = NULL;
+    DT_DEBUG_SQLITE3_PREPARE_V2(dt_database_get_sqlite3_global(),
+                                "SELECT name, synonyms FROM data.tags WHERE id = ?1", -1, &stmt, NULL);
+    DT_DEBUG_SQLITE3_BIND_INT(stmt, 1, tagid);
+    if(sqlite3_step(stmt) == SQLITE_ROW)
+    {
+      if(IS_NULL_PTR(entry))
+      {
+        entry = g_new0(_tag_index_entry_t, 1);
+        entry->tagid = tagid;
+        g_hash_table_insert(_index_by_id, GUINT_TO_POINTER(tagid), entry);
+      }
+      _index_entry_fill(entry, (const char *)sqlite3_column_text(stmt, 0),
+                        (const char *)sqlite3_column_text(stmt, 1));
+      _index_link(entry);
+    }
+    else if(entry)
+    {
+      g_hash_table_remove(_index_by_id, GUINT_TO_POINTER(tagid));
+      _index_entry_free(entry);
+    }
+    sqlite3_finalize(stmt);
+    _index_generation++;
+  }
+  _index_unlock();
+}
+
+/* With the lock held. */
+static void _index_remove_locked(const guint tagid)
+{
+  _tag_index_entry_t *entry = g_hash_table_lookup(_index_by_id, GUINT_TO_POINTER(tagid));
+  if(IS_NULL_PTR(entry)) return;
+  _index_unlink(entry);
+  g_hash_table_remove(_index_by_id, GUINT_TO_POINTER(tagid));
+  _index_entry_free(entry);
+}
+
+GArray *dt_tag_repository_find_path(const char *path, const gboolean subtree)
+{
+  GArray *tagids = g_array_new(FALSE, FALSE, sizeof(guint));
+  gchar *key = _fold(path);
+  gchar *below = g_strconcat(key, "|", NULL);
+
+  _index_lock();
+  _index_ensure_loaded();
+  // the tag itself: "a|b" sorts before "a|b|c"
+  for(guint k = _index_lower_bound(key, 0); k < _index->len; k++)
+  {
+    const _tag_index_entry_t *entry = g_ptr_array_index(_index, k);
+    if(strcmp(entry->key, key)) break;
+    g_array_append_val(tagids, entry->tagid);
+  }
+  // and its descendants, one contiguous run from "a|b|"
+  for(guint k = subtree ? _index_lower_bound(below, 0) : _index->len; k < _index->len; k++)
+  {
+    const _tag_index_entry_t *entry = g_ptr_array_index(_index, k);
+    if(!g_str_has_prefix(entry->key, below)) break;
+    g_array_append_val(tagids, entry->tagid);
+  }
+  _index_unlock();
+
+  dt_free(below);
+  dt_free(key);
+  return tagids;
+}
+
+GArray *dt_tag_repository_find_prefix(const char *prefix)
+{
+  GArray *tagids = g_array_new(FALSE, FALSE, sizeof(guint));
+  gchar *key = _fold(prefix);
+
+  _index_lock();
+  _index_ensure_loaded();
+  for(guint k = _index_lower_bound(key, 0); k < _index->len; k++)
+  {
+    const _tag_index_entry_t *entry = g_ptr_array_index(_index, k);
+    if(!g_str_has_prefix(entry->key, key)) break;
+    g_array_append_val(tagids, entry->tagid);
+  }
+  _index_unlock();
+
+  dt_free(key);
+  return tagids;
+}
+
+GHashTable *dt_tag_repository_match(const char *needle, const gboolean synonyms)
+{
+  GHashTable *tagids = g_hash_table_new(g_direct_hash, g_direct_equal);
+  gchar *key = _fold(needle);
+
+  _index_lock();
+  _index_ensure_loaded();
+  for(guint k = 0; k < _index->len; k++)
+  {
+    const _tag_index_entry_t *entry = g_ptr_array_index(_index, k);
+    if(strstr(synonyms ? entry->haystack : entry->key, key))
+      g_hash_table_add(tagids, GUINT_TO_POINTER(entry->tagid));
+  }
+  _index_unlock();
+
+  dt_free(key);
+  return tagids;
+}
+
+guint64 dt_tag_repository_index_generation(void)
+{
+  _index_lock();
+  const guint64 generation = _index_generation;
+  _index_unlock();
+  return generation;
+}
+
+
 /* ---------------------------------------------------------------------------------------
  *  Identity and lifecycle
  * ------------------------------------------------------------------------------------- */
@@ -164,7 +425,9 @@ guint dt_tag_repository_insert(const char *name)
   /* Read the id back rather than taking sqlite3_last_insert_rowid(): that is what this
    * always did, and the two differ if anything else on this connection inserts in
    * between. */
-  return dt_tag_repository_find_by_name(name);
+  const guint tagid = dt_tag_repository_find_by_name(name);
+  if(tagid) _index_update(tagid);
+  return tagid;
 }
 
 gchar *dt_tag_repository_get_name(const guint tagid)
@@ -193,6 +456,7 @@ void dt_tag_repository_rename(const guint tagid, const char *new_name)
   DT_DEBUG_SQLITE3_BIND_TEXT(stmt, 2, new_name, -1, SQLITE_TRANSIENT);
   sqlite3_step(stmt);
   sqlite3_finalize(stmt);
+  _index_update(tagid);
 }
 
 int dt_tag_repository_count_attachments(const guint tagid)
@@ -215,6 +479,14 @@ void dt_tag_repository_delete(const guint tagid)
   _run_for_id("DELETE FROM data.tags WHERE id=?1", tagid);
   _run_for_id("DELETE FROM main.tagged_images WHERE tagid=?1", tagid);
   _run_for_id("DELETE FROM memory.darktable_tags WHERE tagid=?1", tagid);
+
+  _index_lock();
+  if(_index)
+  {
+    _index_remove_locked(tagid);
+    _index_generation++;
+  }
+  _index_unlock();
 }
 
 void dt_tag_repository_delete_batch(const char *id_list)
@@ -233,6 +505,16 @@ void dt_tag_repository_delete_batch(const char *id_list)
   sqlite3_step(stmt);
   sqlite3_finalize(stmt);
   dt_free(query);
+
+  _index_lock();
+  if(_index)
+  {
+    gchar **ids = g_strsplit(id_list, ",", -1);
+    for(int k = 0; ids[k]; k++) _index_remove_locked((guint)g_ascii_strtoull(ids[k], NULL, 10));
+    g_strfreev(ids);
+    _index_generation++;
+  }
+  _index_unlock();
 }
 
 void dt_tag_repository_mark_internal(const guint tagid)
@@ -326,6 +608,7 @@ void dt_tag_repository_set_synonyms(const guint tagid, const char *synonyms)
   DT_DEBUG_SQLITE3_BIND_TEXT(stmt, 2, synonyms, -1, SQLITE_TRANSIENT);
   sqlite3_step(stmt);
   sqlite3_finalize(stmt);
+  _index_update(tagid);
 }
 
 /* ---------------------------------------------------------------------------------------
@@ -962,8 +1245,15 @@ void dt_tag_repository_get_agreement(GList *imgids, gboolean *same_tags, gboolea
 
 void dt_tag_repository_cleanup(void)
 {
-  /* Nothing cached any more: every statement in this file is prepared and finalised per
-   * call. Kept because the connection's close order calls every repository's cleanup. */
+  /* Every statement in this file is prepared and finalised per call; what is left is the
+   * name index, which belongs to the connection being closed. */
+  _index_lock();
+  if(_index) g_ptr_array_free(_index, TRUE);
+  if(_index_by_id) g_hash_table_destroy(_index_by_id);
+  _index = NULL;
+  _index_by_id = NULL;
+  _index_generation++;
+  _index_unlock();
 }
 
 // clang-format off
@@ -86,6 +86,37 @@ void dt_tag_repository_delete(const guint tagid);
  *  @param id_list a comma-separated list of decimal tag ids, composed by the caller. */
 void dt_tag_repository_delete_batch(const char *id_list);
 
+/* ---------------------------------------------------------------------------------------
+ *  Lookups by name -- answered from an in-memory index of `data.tags`
+ *
+ *  Names and synonyms are compared normalized and casefolded, so "Été" finds "été". The
+ *  index is loaded on first use and kept up to date by the writes above; it is only
+ *  correct as long as `data.tags` is written through this file.
+ * ------------------------------------------------------------------------------------- */
+
+/**
+ * @brief The tag named @p path, and with @p subtree every tag below it, ignoring case.
+ * @return a `GArray` of `guint` tag ids, possibly empty. Free with `g_array_unref()`.
+ */
+GArray *dt_tag_repository_find_path(const char *path, const gboolean subtree);
+
+/**
+ * @brief The tags whose name starts with @p prefix, ignoring case.
+ * @return a `GArray` of `guint` tag ids, possibly empty. Free with `g_array_unref()`.
+ */
+GArray *dt_tag_repository_find_prefix(const char *prefix);
+
+/**
+ * @brief The tags whose name, or with @p synonyms whose synonyms, contain @p needle,
+ * ignoring case.
+ * @return a set of tag ids as `GUINT_TO_POINTER()` keys. Free with `g_hash_table_destroy()`.
+ */
+GHashTable *dt_tag_repository_match(const char *needle, const gboolean synonyms);
+
+/** @brief Bumped on every change of a tag name or synonym. Whatever was resolved from
+ *  the lookups above is stale once this moves. */
+guint64 dt_tag_repository_index_generation(void);
+
 /* ---------------------------------------------------------------------------------------
  *  `memory.darktable_tags` -- the cache of which tags are internal
  * ------------------------------------------------------------------------------------- */
@@ -283,8 +314,7 @@ GList *dt_tag_repository_get_suggestions(const uint32_t nb_selected, const int c
 void dt_tag_repository_get_agreement(GList *imgids, gboolean *same_tags,
                                      gboolean *same_categories);
 
-/** @brief Finalise whatever this repository still caches -- today, nothing. See
- *  dt_colorlabel_repository_cleanup() for why the hook stays. */
+/** @brief Drop the name index. It is loaded again from the next connection on first use. */
 void dt_tag_repository_cleanup(void);
 
 /** One row of dt_tag_repository_get_by_path_with_counts(). */
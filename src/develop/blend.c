@@ -113,7 +113,8 @@ static dt_develop_blend_params_t _default_blendop_params
         0.0f,
         0.0f,
         0.0f, // detail mask threshold
-        { 0, 0, 0 },
+        DEVELOP_MASK_FEATHERING_FULL,
+        { 0, 0 },
         { 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f,
           0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f,
           0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f,
@@ -602,7 +603,8 @@ static void _develop_blend_combine_masks(float *const restrict mask,
 
 static int _develop_blend_process_feather(const float *const guide, float *const mask, const size_t width,
                                           const size_t height, const int ch, const float guide_weight,
-                                          const float feathering_radius, const float scale)
+                                          const float feathering_radius, const uint32_t resolution,
+                                          const float scale)
 {
   const float sqrt_eps = 1.f;
   int w = (int)(2 * feathering_radius * scale + 0.5f);
@@ -612,8 +614,15 @@ static int _develop_blend_process_feather(const float *const guide, float *const
     dt_pixelpipe_cache_alloc_align_float_cache( width * height, 0);
   if(IS_NULL_PTR(mask_bak)) return 1;
 
+  // Wide feathering windows cost 13 full-resolution box filters whose result is smooth anyway:
+  // when the edit asks for it, solve them on a coarser grid once the window spans several coarse
+  // pixels. Below that, keep the exact filter so small feathers stay pixel-accurate. Edits made
+  // before the choice existed read DEVELOP_MASK_FEATHERING_FULL and keep their masks.
+  const int subsample = (resolution == DEVELOP_MASK_FEATHERING_FAST) ? CLAMP(w / 16, 1, 4) : 1;
+
   memcpy(mask_bak, mask, sizeof(float) * width * height);
-  if(guided_filter(guide, mask_bak, mask, width, height, ch, w, sqrt_eps, guide_weight, 0.f, 1.f) != 0)
+  if(guided_filter_subsampled(guide, mask_bak, mask, width, height, ch, w, sqrt_eps, guide_weight, 0.f, 1.f,
+                              subsample) != 0)
   {
     dt_pixelpipe_cache_free_align(mask_bak);
     return 1;
@@ -828,7 +837,8 @@ int dt_develop_blend_process(struct dt_iop_module_t *self, dt_dev_pixelpipe_t *p
           return 1;
         }
         if(_develop_blend_process_feather(guide, mask, owidth, oheight, ch, guide_weight,
-                                          d->feathering_radius, roi_out->scale) != 0)
+                                          d->feathering_radius, d->feathering_resolution,
+                                          roi_out->scale) != 0)
         {
           if(!rois_equal)
             _develop_blend_process_free_region(guide);
@@ -842,7 +852,8 @@ int dt_develop_blend_process(struct dt_iop_module_t *self, dt_dev_pixelpipe_t *p
       {
         const float guide_weight = dt_iop_colorspace_is_rgb(cst) ? 100.0f : 1.0f;
         if(_develop_blend_process_feather((const float *const restrict)ovoid, mask, owidth, oheight, ch,
-                                          guide_weight, d->feathering_radius, roi_out->scale) != 0)
+                                          guide_weight, d->feathering_radius, d->feathering_resolution,
+                                          roi_out->scale) != 0)
         {
           dt_pixelpipe_cache_free_align(_mask);
           return 1;
@@ -1379,6 +1390,8 @@ int dt_develop_blend_process_cl(struct dt_iop_module_t *self, dt_dev_pixelpipe_t
           err = dt_opencl_enqueue_copy_image(devid, dev_in, guide, origin_2, origin_1, region);
           if(err != CL_SUCCESS) goto error;
         }
+        // there is no coarse solve on the device: whatever d->feathering_resolution says, the GPU
+        // feathers at full resolution, and only the CPU path takes the fast one
         if(guided_filter_cl(devid, guide, dev_mask_1, dev_mask_2, owidth, oheight, ch, w, sqrt_eps, guide_weight,
                             0.0f, 1.0f) != 0)
           goto error;
@@ -2324,6 +2337,11 @@ const dt_develop_name_value_t dt_develop_feathering_guide_names[]
         { N_("input after blur"), DEVELOP_MASK_GUIDE_IN_AFTER_BLUR },
         { "", 0 } };
 
+const dt_develop_name_value_t dt_develop_feathering_resolution_names[]
+    = { { N_("full"), DEVELOP_MASK_FEATHERING_FULL },
+        { N_("fast"), DEVELOP_MASK_FEATHERING_FAST },
+        { "", 0 } };
+
 const dt_develop_name_value_t dt_develop_invert_mask_names[]
     = { { N_("off"), DEVELOP_COMBINE_NORM },
         { N_("on"), DEVELOP_COMBINE_INV },
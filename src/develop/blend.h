@@ -138,6 +138,14 @@ typedef enum dt_develop_mask_feathering_guide_t
   DEVELOP_MASK_GUIDE_OUT_AFTER_BLUR = 0x06,
 } dt_develop_mask_feathering_guide_t;
 
+/** resolution the feathering guided filter is solved at. 0 is what every edit made before the
+ *  choice existed reads from its reserved field, so it must stay the exact filter. */
+typedef enum dt_develop_mask_feathering_resolution_t
+{
+  DEVELOP_MASK_FEATHERING_FULL = 0,
+  DEVELOP_MASK_FEATHERING_FAST = 1,
+} dt_develop_mask_feathering_resolution_t;
+
 typedef enum dt_develop_blendif_channels_t
 {
   DEVELOP_BLENDIF_L_in = 0,
@@ -225,8 +233,10 @@ typedef struct dt_develop_blend_params_t
   float brightness;
   /** details threshold */
   float details;
+  /** feathering resolution, see dt_develop_mask_feathering_resolution_t */
+  uint32_t feathering_resolution;
   /** some reserved fields for future use */
-  uint32_t reserved[3];
+  uint32_t reserved[2];
   /** blendif parameters */
   float blendif_parameters[4 * DEVELOP_BLENDIF_SIZE];
   float blendif_boost_factors[DEVELOP_BLENDIF_SIZE];
@@ -274,6 +284,7 @@ extern const dt_develop_name_value_t dt_develop_blend_mode_flag_names[];
 extern const dt_develop_name_value_t dt_develop_mask_mode_names[];
 extern const dt_develop_name_value_t dt_develop_combine_masks_names[];
 extern const dt_develop_name_value_t dt_develop_feathering_guide_names[];
+extern const dt_develop_name_value_t dt_develop_feathering_resolution_names[];
 extern const dt_develop_name_value_t dt_develop_invert_mask_names[];
 
 /* The blending GUI state (dt_iop_gui_blend_data_t and its channel/colorstop/filter
@@ -3708,6 +3708,7 @@ void dt_iop_gui_init_contours(GtkBox *blendw, dt_iop_module_t *module)
   gtk_box_pack_start(blendw, bd->blur_radius_slider, FALSE, FALSE, 0);
   gtk_box_pack_start(blendw, bd->masks_feathering_guide_combo, FALSE, FALSE, 0);
   gtk_box_pack_start(blendw, bd->feathering_radius_slider, FALSE, FALSE, 0);
+  gtk_box_pack_start(blendw, bd->masks_feathering_resolution_combo, FALSE, FALSE, 0);
   gtk_box_pack_start(blendw, bd->brightness_slider, FALSE, FALSE, 0);
   gtk_box_pack_start(blendw, bd->contrast_slider, FALSE, FALSE, 0);
 }
@@ -4473,6 +4474,8 @@ void dt_iop_gui_update_blending(dt_iop_module_t *module)
   dt_bauhaus_combobox_set_from_value(bd->masks_feathering_guide_combo,
                                      module->blend_params->feathering_guide);
   dt_bauhaus_slider_set(bd->feathering_radius_slider, module->blend_params->feathering_radius);
+  dt_bauhaus_combobox_set_from_value(bd->masks_feathering_resolution_combo,
+                                     module->blend_params->feathering_resolution);
   dt_bauhaus_slider_set(bd->blur_radius_slider, module->blend_params->blur_radius);
   dt_bauhaus_slider_set(bd->brightness_slider, module->blend_params->brightness);
   dt_bauhaus_slider_set(bd->contrast_slider, module->blend_params->contrast);
@@ -4553,6 +4556,8 @@ void dt_iop_gui_update_blending(dt_iop_module_t *module)
     gtk_widget_hide(bd->masks_feathering_guide_combo);
     gtk_widget_set_sensitive(bd->feathering_radius_slider, FALSE);
     gtk_widget_hide(bd->feathering_radius_slider);
+    gtk_widget_set_sensitive(bd->masks_feathering_resolution_combo, FALSE);
+    gtk_widget_hide(bd->masks_feathering_resolution_combo);
     gtk_widget_set_sensitive(bd->brightness_slider, FALSE);
     gtk_widget_hide(bd->brightness_slider);
     gtk_widget_set_sensitive(bd->contrast_slider, FALSE);
@@ -4567,6 +4572,8 @@ void dt_iop_gui_update_blending(dt_iop_module_t *module)
     gtk_widget_show(bd->masks_feathering_guide_combo);
     gtk_widget_set_sensitive(bd->feathering_radius_slider, TRUE);
     gtk_widget_show(bd->feathering_radius_slider);
+    gtk_widget_set_sensitive(bd->masks_feathering_resolution_combo, TRUE);
+    gtk_widget_show(bd->masks_feathering_resolution_combo);
     gtk_widget_set_sensitive(bd->brightness_slider, TRUE);
     gtk_widget_show(bd->brightness_slider);
     gtk_widget_set_sensitive(bd->contrast_slider, TRUE);
@@ -4729,6 +4736,7 @@ void dt_iop_gui_cleanup_blending_body(dt_iop_module_t *module)
   bd->opacity_slider = NULL;
   bd->masks_feathering_guide_combo = NULL;
   bd->feathering_radius_slider = NULL;
+  bd->masks_feathering_resolution_combo = NULL;
   bd->blur_radius_slider = NULL;
   bd->contrast_slider = NULL;
   bd->brightness_slider = NULL;
@@ -4921,6 +4929,15 @@ void dt_iop_gui_init_blending_body(GtkWidget *container, dt_iop_module_t *module
   gtk_widget_set_tooltip_text(bd->feathering_radius_slider, _("spatial radius of feathering"));
   g_object_set_data(G_OBJECT(bd->feathering_radius_slider), "dt-blendop-header-update", GINT_TO_POINTER(TRUE));
 
+  bd->masks_feathering_resolution_combo
+      = _combobox_new_from_list(module, _("feathering resolution"), dt_develop_feathering_resolution_names,
+                                &module->blend_params->feathering_resolution,
+                                _("full solves the feathering at the resolution of the image.\n"
+                                  "fast solves wide feathering on a coarser grid, several times faster,\n"
+                                  "with slightly softer mask edges. it only applies on CPU."));
+  g_object_set_data(G_OBJECT(bd->masks_feathering_resolution_combo), "dt-blendop-header-update",
+                    GINT_TO_POINTER(TRUE));
+
   bd->brightness_slider = dt_bauhaus_slider_new_with_range(dt_bauhaus_get_global(), DT_GUI_MODULE(module), -1.0, 1.0, 0, 0.0, 2);
   dt_bauhaus_disable_module_list(bd->brightness_slider);
   dt_bauhaus_set_use_default_callback(bd->brightness_slider);
@@ -116,6 +116,7 @@ typedef struct dt_iop_gui_blend_data_t
   GtkWidget *opacity_slider;
   GtkWidget *masks_feathering_guide_combo;
   GtkWidget *feathering_radius_slider;
+  GtkWidget *masks_feathering_resolution_combo;
   GtkWidget *blur_radius_slider;
   GtkWidget *contrast_slider;
   GtkWidget *brightness_slider;
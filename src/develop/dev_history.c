@@ -69,6 +69,7 @@
 #include "common/undo.h"
 #include "caches/image_cache.h"
 #include "develop/history_merge.h"
+#include "develop/history_merge_rows.h"
 #include "develop/iop_order.h"
 #include "develop/dev_history.h"
 #include "develop/blend.h"
@@ -408,6 +409,11 @@ int dt_dev_merge_history_into_image(dt_develop_t *dev_src, int32_t dest_imgid, c
   {
     dt_dev_pop_history_items_ext(&dev_dest);
     dt_dev_write_history(&dev_dest, FALSE);
+
+    // Read back what was just stored, so later images compare against the same serialization.
+    if(mode == DT_HISTORY_MERGE_APPEND && !IS_NULL_PTR(batch) && IS_NULL_PTR(batch->order_text)
+       && dt_hm_batch_is_silent(batch))
+      batch->order_text = dt_hm_rows_order_text(dest_imgid);
   }
 
   dt_dev_cleanup(&dev_dest);
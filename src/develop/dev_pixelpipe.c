@@ -31,6 +31,7 @@
 #include "develop/geometry/geometry.h"
 #include "develop/imageop.h"
 #include "develop/pixelpipe.h"
+#include "develop/pixelpipe_fuse.h"
 #include "caches/pixelpipe_cache.h"
 #include "develop/supervisor.h"
 #include "develop/blend.h"
@@ -1408,6 +1409,10 @@ void dt_pixelpipe_get_global_hash(dt_dev_pixelpipe_t *pipe)
     // Combine with the previous modules hashes
     uint64_t local_hash = piece->hash;
 
+    // Whether the runtime resamples this piece alone or as the end of a fused run, see
+    // dt_dev_pixelpipe_process_rec(). Decided here, once, so the hash and the pixels agree.
+    if(IS_NULL_PTR(dt_dev_pixelpipe_fuse_run(pipe, node, &piece->fused_span))) piece->fused_span = 0;
+
     // Some GUI previews author their final display inside the active module,
     // then runtime forwards that exact buffer through later pass-through stages.
     // Keep the planned hash contract aligned with the published cacheline so the
@@ -1514,6 +1519,9 @@ void dt_pixelpipe_get_global_hash(dt_dev_pixelpipe_t *pipe)
     // we need to track that. It somewhat overlaps module->request_mask_display, but...
     local_hash = dt_hash(local_hash, (const char *)&piece->bypass_cache, sizeof(gboolean));
 
+    // A fused run interpolates once instead of once per module: different pixels.
+    local_hash = dt_hash(local_hash, (const char *)&piece->fused_span, sizeof(int));
+
     // Update global hash for this stage
     hash = dt_hash(hash, (const char *)&local_hash, sizeof(uint64_t));
 
@@ -79,6 +79,7 @@
  */
 
 #include "develop/history_merge.h"
+#include "develop/history_merge_rows.h"
 #include "history/notify.h"
 
 #include "develop/iop_order.h"
@@ -1612,6 +1613,16 @@ void dt_hm_batch_state_cleanup(dt_hm_batch_state_t *batch)
     g_list_free_full(batch->order_ids, dt_free_gpointer);
     batch->order_ids = NULL;
   }
+  dt_free(batch->order_text);
+  dt_hm_rows_free(batch->rows);
+  batch->rows = NULL;
+}
+
+gboolean dt_hm_batch_is_silent(const dt_hm_batch_state_t *batch)
+{
+  if(IS_NULL_PTR(batch)) return FALSE;
+  return batch->decision == DT_HM_BATCH_ACCEPT
+         || (batch->decision == DT_HM_BATCH_UNDECIDED && IS_NULL_PTR(_merge_report_handler));
 }
 
 static dt_iop_module_t *_hm_dest_module_from_id(dt_develop_t *dev, const char *id)
@@ -51,6 +51,15 @@ extern "C"
     // accepted image of a batch. When non-NULL, later images replay this order instead of re-solving it,
     // so a single high-level decision (and any manual reorder done in the report) applies to the whole batch.
     GList *order_ids;
+    // The destination's stored module order after the first merge of a batch that later images go through
+    // silently (see dt_hm_batch_is_silent()), serialized. Images that already have this exact order can
+    // take the source as plain history rows (develop/history_merge_rows.h).
+    char *order_text;
+    // The rows the merge appended to the first image, read back once by the caller. Owned by the batch state.
+    struct dt_hm_rows_t *rows;
+    // Caller's id of the source order_text and rows were settled for (a style id). A caller that runs
+    // several sources through one batch state drops both when it changes.
+    int source_id;
   } dt_hm_batch_state_t;
 
   /**
@@ -58,6 +67,12 @@ extern "C"
    */
   void dt_hm_batch_state_cleanup(dt_hm_batch_state_t *batch);
 
+  /**
+   * @brief Whether the next merges of this batch will apply without asking anyone: the user accepted
+   * for the whole batch, or there is no merge report to show (headless).
+   */
+  gboolean dt_hm_batch_is_silent(const dt_hm_batch_state_t *batch);
+
   /**
    * @brief Merge a list of modules into a destination image, solving pipeline topologies
    * for proper insertion of source modules.
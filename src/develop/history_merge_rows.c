@@ -0,0 +1,366 @@
+/*
+    This file is part of Ansel,
+    Copyright (C) 2026 Aurélien PIERRE.
+
+    Ansel is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ansel is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ansel.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "develop/history_merge_rows.h"
+
+#include "caches/image_cache.h"
+#include "common/image.h"
+#include "common/logging.h"
+#include "database/database.h"
+#include "database/history_repository.h"
+#include "develop/blend.h"
+#include "develop/iop_order.h"
+#include "system/macros.h"
+#include "system/mem_alloc.h"
+
+#include <string.h>
+
+/* One module of the merge: the source instance it came from, and the row the merge wrote for it. */
+typedef struct _hm_row_t
+{
+  // source identity, what the destination instance is resolved from
+  dt_dev_operation_t op;
+  char multi_name[128];
+  int multi_priority;
+  gboolean one_instance;
+  // the row written on the first image of the batch
+  int module_version;
+  gboolean enabled;
+  void *params;
+  int params_size;
+  void *blend_params;
+  int blend_params_size;
+  int blendop_version;
+} _hm_row_t;
+
+struct dt_hm_rows_t
+{
+  GList *rows;       // _hm_row_t, in the order the merge appended them
+  gboolean captured; // dt_hm_rows_capture() filled every row
+  gboolean usable;
+};
+
+static void _hm_row_free(gpointer data)
+{
+  _hm_row_t *row = (_hm_row_t *)data;
+  if(IS_NULL_PTR(row)) return;
+  dt_free(row->params);
+  dt_free(row->blend_params);
+  dt_free(row);
+}
+
+dt_hm_rows_t *dt_hm_rows_new(void)
+{
+  dt_hm_rows_t *rows = (dt_hm_rows_t *)calloc(1, sizeof(dt_hm_rows_t));
+  if(rows) rows->usable = TRUE;
+  return rows;
+}
+
+void dt_hm_rows_free(dt_hm_rows_t *rows)
+{
+  if(IS_NULL_PTR(rows)) return;
+  g_list_free_full(rows->rows, _hm_row_free);
+  rows->rows = NULL;
+  dt_free(rows);
+}
+
+gboolean dt_hm_rows_usable(const dt_hm_rows_t *rows)
+{
+  return !IS_NULL_PTR(rows) && rows->usable && rows->captured && !IS_NULL_PTR(rows->rows);
+}
+
+void dt_hm_rows_add(dt_hm_rows_t *rows, const char *operation, const char *multi_name, const int multi_priority,
+                    const gboolean one_instance)
+{
+  if(IS_NULL_PTR(rows) || !rows->usable || IS_NULL_PTR(operation)) return;
+
+  _hm_row_t *row = (_hm_row_t *)calloc(1, sizeof(_hm_row_t));
+  if(IS_NULL_PTR(row))
+  {
+    rows->usable = FALSE;
+    return;
+  }
+
+  g_strlcpy(row->op, operation, sizeof(row->op));
+  const gboolean has_name = multi_name && *multi_name && strcmp(multi_name, "0");
+  g_strlcpy(row->multi_name, has_name ? multi_name : "", sizeof(row->multi_name));
+  row->multi_priority = multi_priority;
+  row->one_instance = one_instance;
+  rows->rows = g_list_append(rows->rows, row);
+  rows->captured = FALSE;
+}
+
+typedef struct _hm_capture_t
+{
+  _hm_row_t **rows; // by position in the appended tail
+  int first_num;
+  int count;
+  int found;
+  gboolean ok;
+} _hm_capture_t;
+
+static void _hm_rows_capture_row(void *user_data, const int32_t imgid, const int num, const int module_version,
+                                 const char *operation, const void *op_params, const int op_params_len,
+                                 const gboolean enabled, const void *blendop_params,
+                                 const int blendop_params_len, const int blendop_version,
+                                 const int multi_priority, const char *multi_name, const char *preset_name)
+{
+  _hm_capture_t *capture = (_hm_capture_t *)user_data;
+  if(num < capture->first_num) return;
+  const int k = num - capture->first_num;
+  if(!capture->ok || k >= capture->count || strcmp(capture->rows[k]->op, operation))
+  {
+    capture->ok = FALSE;
+    return;
+  }
+
+  _hm_row_t *row = capture->rows[k];
+  row->module_version = module_version;
+  row->enabled = enabled;
+  row->params_size = MAX(op_params_len, 0);
+  row->params = row->params_size ? malloc(row->params_size) : NULL;
+  row->blend_params_size = MAX(blendop_params_len, 0);
+  row->blend_params = row->blend_params_size ? malloc(row->blend_params_size) : NULL;
+  if((row->params_size && IS_NULL_PTR(row->params)) || (row->blend_params_size && IS_NULL_PTR(row->blend_params)))
+  {
+    capture->ok = FALSE;
+    return;
+  }
+  if(row->params_size) memcpy(row->params, op_params, row->params_size);
+  if(row->blend_params_size) memcpy(row->blend_params, blendop_params, row->blend_params_size);
+  row->blendop_version = blendop_version;
+  capture->found++;
+}
+
+// Drawn forms live in masks_history at the item's num, and raster masks bind to a provider
+// instance of the destination: both are the full merge's business.
+static gboolean _hm_row_has_masks(const _hm_row_t *row)
+{
+  if(IS_NULL_PTR(row->blend_params)) return FALSE;
+  if(row->blendop_version != dt_develop_blend_version() || row->blend_params_size != sizeof(dt_develop_blend_params_t))
+    return TRUE; // can't tell, so don't guess
+  const dt_develop_blend_params_t *const bp = (const dt_develop_blend_params_t *)row->blend_params;
+  return (bp->mask_mode & (DEVELOP_MASK_SHAPE | DEVELOP_MASK_RASTER)) || bp->mask_id != 0
+         || bp->raster_mask_source[0];
+}
+
+gboolean dt_hm_rows_capture(dt_hm_rows_t *rows, const int32_t imgid)
+{
+  if(IS_NULL_PTR(rows) || !rows->usable || IS_NULL_PTR(rows->rows)) return FALSE;
+
+  const int count = g_list_length(rows->rows);
+  const int history_end = dt_history_repository_get_end(imgid);
+  _hm_capture_t capture = { .rows = (_hm_row_t **)calloc(count, sizeof(_hm_row_t *)),
+                            .first_num = history_end - count,
+                            .count = count,
+                            .found = 0,
+                            .ok = TRUE };
+  if(IS_NULL_PTR(capture.rows) || capture.first_num < 0)
+  {
+    dt_free(capture.rows);
+    rows->usable = FALSE;
+    return FALSE;
+  }
+
+  int k = 0;
+  for(GList *l = rows->rows; l; l = g_list_next(l), k++)
+  {
+    _hm_row_t *row = (_hm_row_t *)l->data;
+    dt_free(row->params);
+    dt_free(row->blend_params);
+    capture.rows[k] = row;
+  }
+
+  dt_history_repository_foreach_row(imgid, _hm_rows_capture_row, &capture);
+  gboolean ok = capture.ok && capture.found == count;
+  for(k = 0; k < count && ok; k++) ok = !_hm_row_has_masks(capture.rows[k]);
+  dt_free(capture.rows);
+
+  if(!ok)
+  {
+    dt_print(DT_DEBUG_HISTORY, "[dt_hm_rows_capture] image %i history doesn't end with the %i merged items\n",
+             imgid, count);
+    rows->usable = FALSE;
+    return FALSE;
+  }
+
+  rows->captured = TRUE;
+  return TRUE;
+}
+
+char *dt_hm_rows_order_text(const int32_t imgid)
+{
+  GList *iop_order_list = dt_ioppr_get_iop_order_list(imgid, TRUE);
+  char *text = dt_ioppr_serialize_text_iop_order_list(iop_order_list);
+  g_list_free_full(iop_order_list, dt_free_gpointer);
+  return text;
+}
+
+typedef struct _hm_dest_t
+{
+  GHashTable *names;   // "op|multi_priority" -> multi_name of the latest history row
+  int rows;
+  int max_num;
+} _hm_dest_t;
+
+static void _hm_rows_collect_dest(void *user_data, const int32_t imgid, const int num, const int module_version,
+                                  const char *operation, const void *op_params, const int op_params_len,
+                                  const gboolean enabled, const void *blendop_params,
+                                  const int blendop_params_len, const int blendop_version,
+                                  const int multi_priority, const char *multi_name, const char *preset_name)
+{
+  _hm_dest_t *dest = (_hm_dest_t *)user_data;
+  const gboolean has_name = multi_name && *multi_name && strcmp(multi_name, "0");
+  g_hash_table_insert(dest->names, g_strdup_printf("%s|%d", operation, multi_priority),
+                      g_strdup(has_name ? multi_name : ""));
+  dest->rows++;
+  dest->max_num = MAX(dest->max_num, num);
+}
+
+/* The destination instance dt_history_merge() would bind @p row to, when it would not have to
+ * create one. The instances of the develop are the order list entries the history uses, plus the
+ * base instance, in pipeline order; dt_dev_get_module_instance() picks the first of the right
+ * operation, by name when the source item has one. */
+static const dt_iop_order_entry_t *_hm_rows_resolve(const _hm_row_t *row, GList *iop_order_list,
+                                                    GHashTable *names, const char **dest_name)
+{
+  for(GList *l = iop_order_list; l; l = g_list_next(l))
+  {
+    const dt_iop_order_entry_t *entry = (const dt_iop_order_entry_t *)l->data;
+    if(strcmp(entry->operation, row->op)) continue;
+
+    char *key = g_strdup_printf("%s|%d", entry->operation, entry->instance);
+    const char *name = (const char *)g_hash_table_lookup(names, key);
+    dt_free(key);
+    if(IS_NULL_PTR(name) && entry->instance != 0) continue;  // no such instance in the develop
+    if(IS_NULL_PTR(name)) name = "";
+
+    if(row->one_instance || !row->multi_name[0])
+    {
+      // An unnamed item lands on the first instance, whichever name that one has. The merge
+      // binds it consistently only when that first instance is unnamed as well.
+      if(!row->one_instance && name[0]) return NULL;
+      *dest_name = name;
+      return entry;
+    }
+
+    if(!strcmp(name, row->multi_name))
+    {
+      *dest_name = name;
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+int dt_hm_rows_write_history(const dt_hm_rows_t *rows, const int32_t imgid, const dt_hm_batch_state_t *batch)
+{
+  if(imgid <= 0 || !dt_hm_rows_usable(rows)) return 1;
+  if(IS_NULL_PTR(batch) || IS_NULL_PTR(batch->order_text) || batch->decision == DT_HM_BATCH_REVERT) return 1;
+
+  // A fresh image gets its default history first, and a redo tail gets truncated: full merge.
+  const int history_end = dt_history_repository_get_end(imgid);
+  if(history_end <= 0) return 1;
+
+  // The order settled on the batch representative must already be this image's order. Then the
+  // replay of that order in dt_history_merge() is a no-op, and so is its module order write.
+  GList *iop_order_list = dt_ioppr_get_iop_order_list(imgid, TRUE);
+  char *order_text = dt_ioppr_serialize_text_iop_order_list(iop_order_list);
+  const gboolean same_order = order_text && !strcmp(order_text, batch->order_text);
+  dt_free(order_text);
+  if(!same_order)
+  {
+    g_list_free_full(iop_order_list, dt_free_gpointer);
+    return 1;
+  }
+
+  _hm_dest_t dest = { .names = g_hash_table_new_full(g_str_hash, g_str_equal, dt_free_gpointer, dt_free_gpointer),
+                      .rows = 0,
+                      .max_num = -1 };
+  dt_history_repository_foreach_row(imgid, _hm_rows_collect_dest, &dest);
+
+  const int n = g_list_length(rows->rows);
+  const dt_iop_order_entry_t **targets = (const dt_iop_order_entry_t **)calloc(n, sizeof(*targets));
+  const char **target_names = (const char **)calloc(n, sizeof(*target_names));
+
+  // nums must be 0..history_end-1 for the rows to go at the end
+  gboolean ok = targets && target_names && dest.rows == history_end && dest.max_num == history_end - 1;
+  int k = 0;
+  for(GList *l = rows->rows; l && ok; l = g_list_next(l), k++)
+  {
+    targets[k] = _hm_rows_resolve((const _hm_row_t *)l->data, iop_order_list, dest.names, &target_names[k]);
+    ok = !IS_NULL_PTR(targets[k]);
+  }
+
+  if(ok)
+  {
+    dt_database_start_transaction();
+
+    k = 0;
+    for(GList *l = rows->rows; l && ok; l = g_list_next(l), k++)
+    {
+      const _hm_row_t *row = (const _hm_row_t *)l->data;
+      ok = dt_history_repository_write_item(imgid, history_end + k, row->op, row->params, row->params_size,
+                                            row->module_version, row->enabled, row->blend_params,
+                                            row->blend_params_size, row->blendop_version, targets[k]->instance,
+                                            target_names[k]);
+    }
+    ok = ok && dt_history_repository_set_end(imgid, history_end + n);
+
+    if(ok)
+      dt_database_release_transaction();
+    else
+    {
+      dt_database_rollback_transaction();
+      fprintf(stderr, "[dt_hm_rows_write_history] failed to append history for image %i\n", imgid);
+    }
+  }
+
+  dt_free(targets);
+  dt_free(target_names);
+  g_list_free_full(iop_order_list, dt_free_gpointer);
+  g_hash_table_destroy(dest.names);
+
+  if(!ok) return 1;
+
+  dt_print(DT_DEBUG_HISTORY, "[dt_hm_rows_write_history] appended %i items to image %i, history end %i\n", n,
+           imgid, history_end + n);
+  return 0;
+}
+
+int dt_hm_rows_append_to_image(const dt_hm_rows_t *rows, const int32_t imgid, const dt_hm_batch_state_t *batch)
+{
+  if(dt_hm_rows_write_history(rows, imgid, batch)) return 1;
+
+  // No develop computed the item hashes: invalidate, like an undo restore does.
+  dt_image_t *image = dt_image_cache_get(imgid, 'w');
+  if(image)
+  {
+    image->history_hash = UINT64_MAX;
+    dt_image_cache_write_release(image, DT_IMAGE_CACHE_SAFE);
+  }
+  dt_image_history_changed(imgid, FALSE);
+
+  return 0;
+}
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
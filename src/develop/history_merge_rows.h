@@ -0,0 +1,125 @@
+/*
+    This file is part of Ansel,
+    Copyright (C) 2026 Aurélien PIERRE.
+
+    Ansel is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ansel is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ansel.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DT_DEVELOP_HISTORY_MERGE_ROWS_H
+#define DT_DEVELOP_HISTORY_MERGE_ROWS_H
+
+#include <glib.h>
+#include <inttypes.h>
+
+#include "develop/history_merge.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  /* Row-level history append.
+   *
+   * dt_history_merge() works on two full develop stacks: every module of the destination image is
+   * loaded, its history read and popped, the merge solved, and the whole history rewritten. That is
+   * the right tool for the first image of a batch, where the user may have to settle an order. For
+   * the thousands that follow, most images already have the exact pipeline the first one ended with,
+   * and appending the same items amounts to adding a few rows to main.history.
+   *
+   * This is that shortcut. The rows are not rebuilt from the source: they are read back from the
+   * history dt_history_merge() wrote on the first image of the batch, so both paths write the same
+   * items, in the same order, with the same params. Each image is then checked against the settled
+   * order and appended to through the history repository, without a develop. Anything the shortcut
+   * cannot prove equivalent to what dt_history_merge() would write -- a new instance to create, a
+   * different module order, a redo tail, drawn or raster masks -- is left to dt_history_merge().
+   *
+   * Like dt_history_merge(), the append never folds an item into the last one of the destination,
+   * even when both target the same instance: that reuse is dt_dev_add_history_item_ext()'s, for
+   * edits made in the darkroom.
+   */
+
+  typedef struct dt_hm_rows_t dt_hm_rows_t;
+
+  /**
+   * @brief Start an empty set of source rows.
+   */
+  dt_hm_rows_t *dt_hm_rows_new(void);
+
+  /**
+   * @brief Add one module of the merge, as the source identifies it.
+   *
+   * @details In the order dt_history_merge() appends them, i.e. its module list. The destination
+   * instance is resolved from this identity on every image, the way dt_dev_get_module_instance() does.
+   */
+  void dt_hm_rows_add(dt_hm_rows_t *rows, const char *operation, const char *multi_name, const int multi_priority,
+                      const gboolean one_instance);
+
+  /**
+   * @brief Read what dt_history_merge() just appended to @p imgid: its last rows, one per module added.
+   *
+   * @details To call right after the merge wrote the first image of the batch. Rows carrying masks, or
+   * a history that does not end with one item per added module, make the whole set unusable.
+   *
+   * @return TRUE when every row was read.
+   */
+  gboolean dt_hm_rows_capture(dt_hm_rows_t *rows, const int32_t imgid);
+
+  /**
+   * @brief Whether any image could take the rows at all.
+   */
+  gboolean dt_hm_rows_usable(const dt_hm_rows_t *rows);
+
+  void dt_hm_rows_free(dt_hm_rows_t *rows);
+
+  /**
+   * @brief @p imgid stored module order, serialized, in pipeline order.
+   *
+   * @details What dt_hm_batch_state_t::order_text holds, and what an image must match to take the
+   * rows. Caller owns the string.
+   */
+  char *dt_hm_rows_order_text(const int32_t imgid);
+
+  /**
+   * @brief Append @p rows at the end of @p imgid history, straight into the database.
+   *
+   * @details Only for DT_HISTORY_MERGE_APPEND, and only once @p batch holds the order settled on a
+   * previous image (dt_hm_batch_state_t::order_text): the image must already have exactly that order
+   * and every instance the rows target. Writes history, history_end and the XMP sidecar, and flags
+   * the image history as changed, in one transaction.
+   *
+   * @return 0 when the rows were appended, 1 when nothing was written and the image needs
+   * dt_history_merge().
+   */
+  int dt_hm_rows_append_to_image(const dt_hm_rows_t *rows, const int32_t imgid, const dt_hm_batch_state_t *batch);
+
+  /**
+   * @brief The database half of dt_hm_rows_append_to_image(): history rows and history_end only.
+   *
+   * @details No image cache, no sidecar, no change notification.
+   *
+   * @return 0 when the rows were appended, 1 when nothing was written.
+   */
+  int dt_hm_rows_write_history(const dt_hm_rows_t *rows, const int32_t imgid, const dt_hm_batch_state_t *batch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DT_DEVELOP_HISTORY_MERGE_ROWS_H
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
@@ -80,6 +80,7 @@
 #include "metadata/exif.h"
 #include "history/history.h"
 #include "common/imagebuf.h"
+#include "common/times.h"
 #include "imageio/imageio_rawspeed.h"
 #include "pixel/interpolation.h"
 #include "common/module.h"
@@ -500,10 +501,30 @@ static int _iop_load_module_static(dt_iop_module_so_t *module,
       fprintf(stderr, "[iop_load_module] failed to initialize introspection for operation `%s'\n", module_name);
   }
 
-  if(module->init_global) module->init_global(module);
+  // init_global() is deferred to first use, see dt_iop_module_global_data()
   return 0;
 }
 
+static gpointer _iop_init_global(gpointer data)
+{
+  dt_iop_module_so_t *so = (dt_iop_module_so_t *)data;
+  if(IS_NULL_PTR(so->init_global)) return NULL;
+
+  const double start = dt_get_wtime();
+  dt_opencl_programs_t *const previous = dt_opencl_set_program_record(&so->cl_programs);
+  so->init_global(so);
+  dt_opencl_set_program_record(previous);
+  dt_print(DT_DEBUG_PERF, "[startup] deferred init_global of `%s' took %.3f secs\n", so->op,
+           dt_get_wtime() - start);
+  return so->data;
+}
+
+dt_iop_global_data_t *dt_iop_module_global_data(dt_iop_module_t *module)
+{
+  module->global_data = g_once(&module->so->global_once, _iop_init_global, module->so);
+  return module->global_data;
+}
+
 /* The old inline widget members were zeroed here at load; the gui struct is calloc'd by
  * dt_iop_gui_init() when (and only when) a GUI attaches, so a headless load must not
  * touch module->gui at all -- it is NULL by design. */
@@ -548,6 +569,7 @@ int dt_iop_load_module_by_so(dt_iop_module_t *module, dt_iop_module_so_t *so, dt
   module->have_introspection = so->have_introspection;
 
 
+  // NULL until the first dt_iop_module_global_data() on any instance of this so
   module->global_data = so->data;
 
   // now init the instance:
@@ -1063,7 +1085,9 @@ void dt_iop_unload_modules_so()
   while(darktable.iop)
   {
     dt_iop_module_so_t *module = (dt_iop_module_so_t *)darktable.iop->data;
-    if(module->cleanup_global) module->cleanup_global(module);
+    // only the modules that were used ever got their global data
+    if(module->cleanup_global && module->global_once.status == G_ONCE_STATUS_READY)
+      module->cleanup_global(module);
     dt_free(darktable.iop->data);
     darktable.iop = g_list_delete_link(darktable.iop, darktable.iop);
   }
@@ -1478,6 +1502,9 @@ void dt_iop_commit_params(dt_iop_module_t *module, dt_iop_params_t *params,
     return;
   }
 
+  // first use of this module anywhere: build its kernels and tables now, on the pipe thread
+  dt_iop_module_global_data(module);
+
   // We need to commit also modules that are disabled because some of them
   // may self-enabled at commit time, depending on image input.
   // 1. commit params
@@ -234,8 +234,13 @@ typedef struct dt_iop_module_so_t
   /** string identifying this operation. */
   dt_dev_operation_t op;
   /** other stuff that may be needed by the module, not only in gui mode. inited only once, has to be
-   * read-only then. */
+   * read-only then. Built on first use, not at load: see dt_iop_module_global_data(). */
   dt_iop_global_data_t *data;
+  /** guards the one init_global() call. Zeroed by calloc, which is G_ONCE_INIT. */
+  GOnce global_once;
+  /** the OpenCL programs init_global() created kernels from: the pipe runs the module on the
+   * CPU until they are built, see dt_opencl_programs_ready(). */
+  dt_opencl_programs_t cl_programs;
   /** gui is also only inited once at startup. */
 //  dt_iop_gui_data_t *gui_data;
   /** which results in this widget here, too. */
@@ -398,6 +403,16 @@ extern const int dt_iop_static_modules_count;
 void dt_iop_load_modules_so(void);
 /** tears down the module descriptors built by dt_iop_load_modules_so(). */
 void dt_iop_unload_modules_so(void);
+/**
+ * @brief The module's global data, running its init_global() if nobody has yet.
+ *
+ * @details init_global() used to run for every module in dt_iop_load_modules_so(), OpenCL kernel
+ * creation included, before the first window. It now runs once, on whichever thread first needs
+ * it: dt_iop_commit_params() (hence every process*()), or the module itself when it reads its
+ * global data from reload_defaults(), force_enable() or the GUI. Thread-safe; also points
+ * @p module->global_data at the result, which is NULL until then.
+ */
+dt_iop_global_data_t *dt_iop_module_global_data(dt_iop_module_t *module);
 /** load a module for a given .so */
 int dt_iop_load_module_by_so(dt_iop_module_t *module, dt_iop_module_so_t *so, struct dt_develop_t *dev);
 int dt_iop_load_module(dt_iop_module_t *module, dt_iop_module_so_t *module_so, struct dt_develop_t *dev);
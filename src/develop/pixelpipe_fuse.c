@@ -0,0 +1,256 @@
+/*
+    Private geometry fusion backend.
+
+    lens, ashift, flip, clipping, crop, rotatepixels and scalepixels each resample their whole
+    input with dt_interpolation_compute_pixel4c() when they run on their own: one full buffer
+    pass, one cacheline and one more round of interpolation blur per module. When several of
+    them follow each other, nothing in between looks at the pixels, so the pipe composes where
+    each output pixel comes from across the whole run and interpolates once.
+
+    Each module supplies its half through distort_process_points(): process()'s own sampling
+    positions, not distort_backtransform(), whose frames are not the buffer frames process()
+    reads. See doc/pixelpipe-geometry-fusion.md.
+*/
+
+#include "system/macros.h"
+#include "system/openmp.h"
+#include "system/simd.h"
+#include "common/logging.h"
+#include "caches/pixelpipe_cache.h"
+#include "caches/pixelpipe_cache_alloc.h"
+#include "develop/blend.h"
+#include "develop/dev_pixelpipe.h"
+#include "develop/imageop.h"
+#include "develop/pixelpipe_fuse.h"
+#include "pixel/format.h"
+#include "pixel/interpolation.h"
+
+#include <math.h>
+
+static inline gboolean _fuse_same_cst(const int a, const int b)
+{
+  return a == b || (dt_iop_colorspace_is_rgb(a) && dt_iop_colorspace_is_rgb(b));
+}
+
+static inline gboolean _fuse_is_rgba_float(const dt_iop_buffer_dsc_t *const dsc)
+{
+  return dsc->channels == 4 && dsc->datatype == TYPE_FLOAT;
+}
+
+/* Can this piece's pixels be produced by someone else's interpolation right now? Beyond the
+ * module's own answer, everything that needs THIS piece's output buffer to exist rules it out:
+ * blending (reads its input and output), histograms and color pickers (sample them), and the
+ * focused module, whose edit mode the GUI draws from its own cachelines. */
+static gboolean _fuse_piece_ok(const dt_dev_pixelpipe_t *pipe, const dt_dev_pixelpipe_iop_t *piece)
+{
+  dt_iop_module_t *module = piece->module;
+  if(IS_NULL_PTR(module->distort_process_points)) return FALSE;
+
+  if(module->dev->gui_attached && module == module->dev->gui_module) return FALSE;
+  if(dt_dev_pixelpipe_activemodule_disables_currentmodule(module->dev, module)) return FALSE;
+  if(module->request_color_pick != DT_REQUEST_COLORPICK_OFF) return FALSE;
+  if(piece->request_histogram & DT_REQUEST_ON) return FALSE;
+  if(piece->blendop_data
+     && ((dt_develop_blend_params_t *)piece->blendop_data)->mask_mode != DEVELOP_MASK_DISABLED)
+    return FALSE;
+
+  if(!_fuse_is_rgba_float(&piece->dsc_in) || !_fuse_is_rgba_float(&piece->dsc_out)) return FALSE;
+  if(!_fuse_same_cst(piece->dsc_in.cst, piece->dsc_out.cst)) return FALSE;
+
+  return module->distort_process_points(module, pipe, piece, NULL, 0);
+}
+
+GList *dt_dev_pixelpipe_fuse_run(const dt_dev_pixelpipe_t *pipe, GList *last, int *span)
+{
+  *span = 0;
+  if(pipe->mask_display != DT_DEV_PIXELPIPE_DISPLAY_NONE) return NULL;
+
+  const dt_dev_pixelpipe_iop_t *const tail = (dt_dev_pixelpipe_iop_t *)last->data;
+  if(!tail->enabled || !_fuse_piece_ok(pipe, tail)) return NULL;
+
+  GList *first = last;
+  int fused = 1;
+  int steps = 0;
+  const dt_dev_pixelpipe_iop_t *upstream = NULL;
+  for(GList *iter = g_list_previous(last); iter; iter = g_list_previous(iter))
+  {
+    steps++;
+    const dt_dev_pixelpipe_iop_t *piece = (dt_dev_pixelpipe_iop_t *)iter->data;
+    if(!piece->enabled) continue;
+    if(!_fuse_piece_ok(pipe, piece))
+    {
+      upstream = piece;
+      break;
+    }
+    first = iter;
+    *span = steps;
+    fused++;
+  }
+
+  // the run starts on the output of another module, with no colour conversion in between
+  const dt_dev_pixelpipe_iop_t *const head = (dt_dev_pixelpipe_iop_t *)first->data;
+  if(fused < 2 || IS_NULL_PTR(upstream) || !_fuse_same_cst(upstream->dsc_out.cst, head->dsc_in.cst)
+     || !_fuse_is_rgba_float(&upstream->dsc_out))
+  {
+    *span = 0;
+    return NULL;
+  }
+
+  // one input, one output and the coordinate map at once: leave runs that need tiling alone
+  if(!dt_tiling_piece_fits_host_memory(MAX(head->roi_in.width, tail->roi_out.width),
+                                       MAX(head->roi_in.height, tail->roi_out.height),
+                                       4 * sizeof(float), 2.5f, 0))
+  {
+    *span = 0;
+    return NULL;
+  }
+
+  return first;
+}
+
+GList *dt_dev_pixelpipe_fuse_mask_run(const dt_dev_pixelpipe_t *pipe, GList *first,
+                                      const struct dt_iop_module_t *stop)
+{
+  GList *last = NULL;
+  int fused = 0;
+  for(GList *iter = first; iter; iter = g_list_next(iter))
+  {
+    const dt_dev_pixelpipe_iop_t *piece = (dt_dev_pixelpipe_iop_t *)iter->data;
+    dt_iop_module_t *module = piece->module;
+    if(piece->enabled && !dt_dev_pixelpipe_activemodule_disables_currentmodule(module->dev, module))
+    {
+      if(IS_NULL_PTR(module->distort_mask) || IS_NULL_PTR(module->distort_process_points)
+         || !module->distort_process_points(module, pipe, piece, NULL, 0))
+        break;
+      last = iter;
+      fused++;
+    }
+    if(module == stop) break;
+  }
+
+  return (fused < 2) ? NULL : last;
+}
+
+/* Where, in the roi_in buffer of @p first, each pixel of the roi_out buffer of @p last comes
+ * from. Positions that leave an intermediate buffer are NaN: the module that owned that buffer
+ * would have sampled nothing there, whatever the modules upstream could have provided. */
+__DT_CLONE_TARGETS__
+static float *_fuse_map(dt_dev_pixelpipe_t *pipe, GList *first, GList *last, const gboolean masks)
+{
+  const dt_iop_roi_t *const roi_out = &((dt_dev_pixelpipe_iop_t *)last->data)->roi_out;
+  const size_t width = roi_out->width;
+  const size_t npoints = (size_t)roi_out->width * roi_out->height;
+  float *const points = dt_pixelpipe_cache_alloc_align_float(2 * npoints, pipe);
+  if(IS_NULL_PTR(points)) return NULL;
+
+  __OMP_PARALLEL_FOR__()
+  for(size_t k = 0; k < npoints; k++)
+  {
+    points[2 * k] = (float)(k % width);
+    points[2 * k + 1] = (float)(k / width);
+  }
+
+  for(GList *iter = last; iter; iter = g_list_previous(iter))
+  {
+    const dt_dev_pixelpipe_iop_t *piece = (dt_dev_pixelpipe_iop_t *)iter->data;
+    dt_iop_module_t *module = piece->module;
+    const gboolean skipped
+        = !piece->enabled
+          || (masks && dt_dev_pixelpipe_activemodule_disables_currentmodule(module->dev, module));
+    if(!skipped)
+    {
+      module->distort_process_points(module, pipe, piece, points, npoints);
+
+      if(iter != first)
+      {
+        const float w = piece->roi_in.width;
+        const float h = piece->roi_in.height;
+        __OMP_PARALLEL_FOR__()
+        for(size_t k = 0; k < npoints; k++)
+        {
+          // same bounds as the interpolators: (int)x must land in [0, w)
+          const float x = points[2 * k];
+          const float y = points[2 * k + 1];
+          if(!(x > -1.f && x < w && y > -1.f && y < h)) points[2 * k] = points[2 * k + 1] = NAN;
+        }
+      }
+    }
+    if(iter == first) break;
+  }
+
+  return points;
+}
+
+__DT_CLONE_TARGETS__
+int dt_dev_pixelpipe_fuse_process(dt_dev_pixelpipe_t *pipe, GList *first, GList *last,
+                                  dt_pixel_cache_entry_t *input_entry, dt_pixel_cache_entry_t *output_entry)
+{
+  const dt_iop_roi_t *const roi_in = &((dt_dev_pixelpipe_iop_t *)first->data)->roi_in;
+  const dt_iop_roi_t *const roi_out = &((dt_dev_pixelpipe_iop_t *)last->data)->roi_out;
+
+  // the upstream module may have left its output on the GPU only
+  void *input = dt_pixel_cache_entry_get_data(input_entry);
+  if(IS_NULL_PTR(input) && !dt_dev_pixelpipe_cache_restore_host_payload(input_entry, pipe->devid, &input))
+    return 1;
+
+  float *output = dt_pixel_cache_entry_get_data(output_entry);
+  if(IS_NULL_PTR(output)) output = dt_pixel_cache_alloc(output_entry);
+  if(IS_NULL_PTR(output)) return 1;
+
+  float *const points = _fuse_map(pipe, first, last, FALSE);
+  if(IS_NULL_PTR(points)) return 1;
+
+  const struct dt_interpolation *const interpolation = dt_interpolation_new(DT_INTERPOLATION_USERPREF_WARP);
+  const size_t npoints = (size_t)roi_out->width * roi_out->height;
+  const float *const in = (const float *)input;
+  const int ch_width = 4 * roi_in->width;
+
+  dt_dev_pixelpipe_cache_rdlock_entry(TRUE, input_entry);
+  __OMP_PARALLEL_FOR__()
+  for(size_t k = 0; k < npoints; k++)
+  {
+    const float x = points[2 * k];
+    const float y = points[2 * k + 1];
+    if(isnan(x))
+      dt_store_simd_aligned(output + 4 * k, dt_simd_set1(0.f));
+    else
+      dt_interpolation_compute_pixel4c(interpolation, in, output + 4 * k, x, y, roi_in->width, roi_in->height,
+                                       ch_width);
+  }
+  dt_dev_pixelpipe_cache_rdlock_entry(FALSE, input_entry);
+
+  dt_pixelpipe_cache_free_align(points);
+  return 0;
+}
+
+__DT_CLONE_TARGETS__
+float *dt_dev_pixelpipe_fuse_mask(dt_dev_pixelpipe_t *pipe, GList *first, GList *last, const float *const in)
+{
+  const dt_iop_roi_t *const roi_in = &((dt_dev_pixelpipe_iop_t *)first->data)->roi_in;
+  const dt_iop_roi_t *const roi_out = &((dt_dev_pixelpipe_iop_t *)last->data)->roi_out;
+  const size_t npoints = (size_t)roi_out->width * roi_out->height;
+
+  float *const out = dt_pixelpipe_cache_alloc_align_float_cache(npoints, 0);
+  if(IS_NULL_PTR(out)) return NULL;
+
+  float *const points = _fuse_map(pipe, first, last, TRUE);
+  if(IS_NULL_PTR(points))
+  {
+    dt_pixelpipe_cache_free_align(out);
+    return NULL;
+  }
+
+  const struct dt_interpolation *const interpolation = dt_interpolation_new(DT_INTERPOLATION_USERPREF_WARP);
+  __OMP_PARALLEL_FOR__()
+  for(size_t k = 0; k < npoints; k++)
+  {
+    const float x = points[2 * k];
+    const float y = points[2 * k + 1];
+    out[k] = isnan(x) ? 0.f
+                      : dt_interpolation_compute_sample(interpolation, in, x, y, roi_in->width, roi_in->height,
+                                                        1, roi_in->width);
+  }
+
+  dt_pixelpipe_cache_free_align(points);
+  return out;
+}
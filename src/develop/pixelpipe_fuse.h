@@ -0,0 +1,56 @@
+/*
+    Private geometry fusion backend: runs of consecutive resampling modules folded into one
+    interpolation. See doc/pixelpipe-geometry-fusion.md.
+*/
+
+#ifndef DT_DEVELOP_PIXELPIPE_FUSE_H
+#define DT_DEVELOP_PIXELPIPE_FUSE_H
+
+#include "develop/pixelpipe_process.h"
+
+/**
+ * @brief Find the run of fusable pieces that ends at @p last, walking upstream.
+ *
+ * @details Disabled pieces inside the run are pass-through and do not break it. The run stops
+ * at the first enabled piece that is not a pure resample right now (see
+ * dt_iop_module_t::distort_process_points), and it must hold at least two enabled pieces to be
+ * worth anything.
+ *
+ * @param span[out] number of list nodes between @p last and the returned node.
+ * @return the list node of the most upstream piece of the run, or NULL when @p last is not
+ * fused and must be processed on its own.
+ */
+GList *dt_dev_pixelpipe_fuse_run(const dt_dev_pixelpipe_t *pipe, GList *last, int *span);
+
+/**
+ * @brief Find the run of pieces whose masks can be distorted in one go, walking downstream.
+ *
+ * @details Mirror of ::dt_dev_pixelpipe_fuse_run for the raster-mask transport, which walks
+ * from the mask provider to its consumer: the run never goes past @p stop.
+ *
+ * @return the list node of the most downstream piece of the run, or NULL if @p first is not
+ * fused.
+ */
+GList *dt_dev_pixelpipe_fuse_mask_run(const dt_dev_pixelpipe_t *pipe, GList *first,
+                                      const struct dt_iop_module_t *stop);
+
+/**
+ * @brief Resample @p input_entry through every piece from @p first to @p last at once.
+ *
+ * @details The input is the roi_in buffer of @p first, the output the roi_out buffer of
+ * @p last. Stands in for pixelpipe_process_on_CPU()/GPU() for the whole run.
+ *
+ * @return 0 on success, 1 on error.
+ */
+int dt_dev_pixelpipe_fuse_process(dt_dev_pixelpipe_t *pipe, GList *first, GList *last,
+                                  dt_pixel_cache_entry_t *input_entry, dt_pixel_cache_entry_t *output_entry);
+
+/**
+ * @brief Distort a 1-channel mask through every piece from @p first to @p last at once.
+ *
+ * @return the mask in the roi_out of @p last, to be freed with dt_pixelpipe_cache_free_align(),
+ * or NULL on allocation failure.
+ */
+float *dt_dev_pixelpipe_fuse_mask(dt_dev_pixelpipe_t *pipe, GList *first, GList *last, const float *const in);
+
+#endif // DT_DEVELOP_PIXELPIPE_FUSE_H
@@ -42,7 +42,9 @@ void dt_dev_pixelpipe_gpu_flush_host_pinned_images(dt_dev_pixelpipe_t *pipe, voi
 
 static int _is_opencl_supported(dt_dev_pixelpipe_t *pipe, const dt_dev_pixelpipe_iop_t *piece, dt_iop_module_t *module)
 {
-  return dt_opencl_is_inited() && piece->process_cl_ready && module->process_cl;
+  // a program still being built in the background is no reason to wait: this run goes to the CPU
+  return dt_opencl_is_inited() && piece->process_cl_ready && module->process_cl
+         && dt_opencl_programs_ready(pipe->devid, &module->so->cl_programs);
 }
 
 static int _gpu_init_input(dt_dev_pixelpipe_t *pipe,
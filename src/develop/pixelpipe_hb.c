@@ -73,6 +73,7 @@
 #include "caches/pixelpipe_cache.h"
 #include "develop/supervisor.h"
 #include "develop/pixelpipe_cpu.h"
+#include "develop/pixelpipe_fuse.h"
 #include "develop/pixelpipe_gpu.h"
 #include "develop/pixelpipe_process.h"
 #include "develop/tiling.h"
@@ -945,10 +946,18 @@ static int dt_dev_pixelpipe_process_rec(dt_dev_pixelpipe_t *pipe,
     dt_dev_pixelpipe_cache_ref_count_entry(FALSE, existing_cache);
   }
 
+  // 2) Consecutive pure resamplers ending here (lens, clipping, rotatepixels...) are folded into
+  // one interpolation: recurse past the whole run, and resample its input once through the composed
+  // coordinates of its modules instead of once per module. See doc/pixelpipe-geometry-fusion.md.
+  // The run was decided with the global hash (dt_pixelpipe_get_global_hash()), which accounts for it.
+  const int fused_span = piece->fused_span;
+  GList *fused_first = fused_span ? g_list_nth_prev(pieces, fused_span) : NULL;
+  GList *upstream = fused_first ? g_list_previous(fused_first) : g_list_previous(pieces);
+
   // 3) now recurse through the pipeline.
   uint64_t input_hash = DT_PIXELPIPE_CACHE_HASH_INVALID;
   const dt_dev_pixelpipe_iop_t *previous_piece = NULL;
-  if(dt_dev_pixelpipe_process_rec(pipe, &input_hash, &previous_piece, g_list_previous(pieces), pos - 1))
+  if(dt_dev_pixelpipe_process_rec(pipe, &input_hash, &previous_piece, upstream, pos - 1 - fused_span))
   {
     /* Child recursion failed before this module acquired any output cache entry.
      * Dropping `hash` here underflows cached exact-hit outputs during shutdown. */
@@ -1155,6 +1164,15 @@ static int dt_dev_pixelpipe_process_rec(dt_dev_pixelpipe_t *pipe,
 
   const char *prev_module = dt_pixelpipe_cache_set_current_module(module ? module->op : NULL);
 
+  if(fused_first)
+  {
+    error = dt_dev_pixelpipe_fuse_process(pipe, fused_first, pieces, input_entry, output_entry);
+    pixelpipe_flow |= PIXELPIPE_FLOW_PROCESSED_ON_CPU;
+    pixelpipe_flow &= ~(PIXELPIPE_FLOW_PROCESSED_ON_GPU | PIXELPIPE_FLOW_PROCESSED_WITH_TILING);
+    dt_print(DT_DEBUG_PERF, "[pixelpipe] fused %s..%s into one resample [%s]\n",
+             ((dt_dev_pixelpipe_iop_t *)fused_first->data)->module->op, module->op, type);
+  }
+  else
 #ifdef HAVE_OPENCL
   error = pixelpipe_process_on_GPU(pipe, piece, previous_piece, &tiling, &pixelpipe_flow,
                                    &cache_ram_output,
@@ -133,6 +133,11 @@ typedef struct dt_dev_pixelpipe_iop_t
   // Same as global hash but for raster masks
   uint64_t global_mask_hash;
 
+  // When this piece ends a run of fused resamplers (see dt_dev_pixelpipe_fuse_run()), the number
+  // of list nodes back to the head of the run, 0 otherwise. Decided with global_hash, which
+  // accounts for it: a fused output is not the same pixels as the unfused one.
+  int fused_span;
+
   int bpc;             // bits per channel, 32 means float
   dt_iop_roi_t buf_in, buf_out; // theoretical full buffer regions of interest, as passed through modify_roi_out
   dt_iop_roi_t roi_in, roi_out; // planned runtime regions of interest after backward ROI propagation
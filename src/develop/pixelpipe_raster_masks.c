@@ -228,7 +228,30 @@ float *dt_dev_get_raster_mask(dt_dev_pixelpipe_t *pipe, const dt_iop_module_t *r
       if(module->enabled
          && !dt_dev_pixelpipe_activemodule_disables_currentmodule(module->module->dev, module->module))
       {
-        if(module->module->distort_mask
+        GList *fused_last = dt_dev_pixelpipe_fuse_mask_run(pipe, iter, target_module);
+        if(fused_last)
+        {
+          // consecutive pure resamplers: one interpolation for all of them, as for the pixels
+          float *transformed_mask = dt_dev_pixelpipe_fuse_mask(pipe, iter, fused_last, raster_mask);
+          if(IS_NULL_PTR(transformed_mask))
+          {
+            dt_print(DT_DEBUG_MASKS, "[raster masks] could not allocate memory for transformed mask\n");
+            if(!IS_NULL_PTR(error)) *error = 1;
+            dt_pixelpipe_cache_free_align(raster_mask);
+            dt_free(clean_source_name);
+            dt_free(source_name);
+            dt_free(clean_target_name);
+            dt_free(target_name);
+            return NULL;
+          }
+
+          dt_pixelpipe_cache_free_align(raster_mask);
+          raster_mask = transformed_mask;
+          iter = fused_last;
+          module = (dt_dev_pixelpipe_iop_t *)iter->data;
+          dt_print(DT_DEBUG_MASKS, "[raster masks] doing fused transform up to %s\n", module->module->op);
+        }
+        else if(module->module->distort_mask
            && !(!strcmp(module->module->op, "finalscale")
                 && module->roi_in.width == 0
                 && module->roi_in.height == 0))
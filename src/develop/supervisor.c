@@ -770,6 +770,8 @@ static JsonArray *_blendop_json(const dt_develop_blend_params_t *bp)
                bp->mask_combine & (DEVELOP_COMBINE_INV | DEVELOP_COMBINE_INCL));
   _arr_addf(out, "feathering radius = %.4f", bp->feathering_radius);
   _arr_add_enum(out, "feathering guide", dt_develop_feathering_guide_names, bp->feathering_guide);
+  _arr_add_enum(out, "feathering resolution", dt_develop_feathering_resolution_names,
+                bp->feathering_resolution);
   _arr_addf(out, "mask blur = %.4f", bp->blur_radius);
   _arr_addf(out, "mask contrast = %.4f", bp->contrast);
   _arr_addf(out, "brightness = %.4f", bp->brightness);
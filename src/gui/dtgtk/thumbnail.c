@@ -49,6 +49,7 @@
 #include "database/image_repository.h"
 #include "gui/dtgtk/focus.h"
 #include "widgets/focus_peaking.h"
+#include "common/conf.h"
 #include "common/grouping.h"
 #include "metadata/ratings.h"
 #include "common/selection.h"
@@ -467,6 +468,89 @@ static int _finish_buffer_thread(dt_thumbnail_t *thumb, dt_job_t *job, gboolean
 }
 
 
+// Release the widget from a job that gives up without rendering, without asking for a redraw:
+// the next draw of the widget, when it comes back into view, requests a new render.
+static void _drop_buffer_thread(dt_thumbnail_t *thumb, dt_job_t *job)
+{
+  dt_pthread_mutex_lock(&thumb->lock);
+  if(thumb->job == job)
+  {
+    thumb->image_inited = FALSE;
+    thumb->job = NULL;
+  }
+  dt_pthread_mutex_unlock(&thumb->lock);
+}
+
+int32_t _get_image_buffer(dt_job_t *job);
+
+// Progressive thumbnails: commit a stand-in for the widget to draw right away, and hand the widget
+// over to a new job processing the real thumbnail from the background queue, behind the stand-ins
+// of the other thumbnails. Returns TRUE when the stand-in was committed.
+static gboolean _show_preview(dt_thumbnail_t *thumb, dt_job_t *job, const int32_t imgid, const int img_w,
+                              const int img_h)
+{
+  cairo_surface_t *surface = NULL;
+  if(dt_view_image_get_preview_surface(imgid, img_w, img_h, &surface) != DT_VIEW_SURFACE_OK) return FALSE;
+
+  dt_job_t *refine = dt_control_job_create(&_get_image_buffer, "get image %i", imgid);
+  if(IS_NULL_PTR(refine))
+  {
+    cairo_surface_destroy(surface);
+    return FALSE;
+  }
+  dt_control_job_set_state_callback(refine, _thumb_job_state_changed);
+
+  double sx = 1.0, sy = 1.0;
+  cairo_surface_get_device_scale(surface, &sx, &sy);
+
+  // Same commit rules as the final render, see _get_image_buffer()
+  GtkWidget *redraw_widget = NULL;
+  dt_pthread_mutex_lock(&thumb->lock);
+  const gboolean still_valid = (thumb->job == job
+                                && !dt_atomic_get_int(&thumb->destroying)
+                                && thumb->w_image != NULL);
+  if(still_valid)
+  {
+    _free_image_surface(thumb);
+    thumb->img_width = roundf(cairo_image_surface_get_width(surface) / sx);
+    thumb->img_height = roundf(cairo_image_surface_get_height(surface) / sy);
+    thumb->zoomx = thumb->zoomy = 0.;
+    thumb->img_surf = surface;
+    surface = NULL;
+    // image_inited stays FALSE: the widget now waits on the refinement
+    thumb->job = refine;
+    dt_atomic_add_int(&thumb->ref_count, 1);
+    redraw_widget = g_object_ref(thumb->w_image);
+  }
+  dt_pthread_mutex_unlock(&thumb->lock);
+
+  if(surface)
+  {
+    cairo_surface_destroy(surface);
+    dt_control_job_dispose(refine);
+    return FALSE;
+  }
+
+  dt_control_job_set_params(refine, thumb, _thumbnail_release);
+  if(dt_control_add_job(dt_control_get_global(), DT_JOB_QUEUE_SYSTEM_BG, refine) != 0)
+  {
+    dt_pthread_mutex_lock(&thumb->lock);
+    if(thumb->job == refine) thumb->job = NULL;
+    dt_pthread_mutex_unlock(&thumb->lock);
+    _thumbnail_release(thumb);
+  }
+  else if(thumb->table)
+    dt_atomic_add_int(&thumb->table->renders_requested, 1);
+
+  GMainContext *context = g_main_context_default();
+  g_main_context_invoke_full(context, G_PRIORITY_DEFAULT,
+                             (GSourceFunc)_main_context_queue_draw,
+                             redraw_widget,
+                             (GDestroyNotify)g_object_unref);
+  g_main_context_wakeup(context);
+  return TRUE;
+}
+
 int32_t _get_image_buffer(dt_job_t *job)
 {  
   // WARNING: the target thumbnail GUI widget can be destroyed at any time during this
@@ -478,6 +562,14 @@ int32_t _get_image_buffer(dt_job_t *job)
   // The job was cancelled on the queue. Good chances of having thumb destroyed anytime soon.
   if(IS_NULL_PTR(thumb->job) || thumb->job != job || dt_control_job_get_state(job) == DT_JOB_STATE_CANCELLED) return 1;
 
+  // Scrolled off while the job was queued: the workers have better things to do.
+  if(thumb->table && !dt_thumbtable_rowid_wanted(thumb->table, thumb->rowid))
+  {
+    dt_atomic_add_int(&thumb->table->renders_skipped, 1);
+    _drop_buffer_thread(thumb, job);
+    return 0;
+  }
+
   // Read and cache the thumb data now, while we have it. And lock it.
   dt_pthread_mutex_lock(&thumb->lock);
 
@@ -488,11 +580,18 @@ int32_t _get_image_buffer(dt_job_t *job)
   const int zoom = (thumb->table) ? thumb->table->zoom : DT_THUMBTABLE_ZOOM_FIT;
   const gboolean show_focus_peaking = (thumb->table && thumb->table->focus_peaking);
   const gboolean show_focus_clusters = (thumb->table && thumb->table->focus_regions);
+  dt_scratch_pool_t *scratch = thumb->table ? thumb->table->scratch : NULL;
   const gboolean zoom_in = (thumb->table && thumb->table->zoom > DT_THUMBTABLE_ZOOM_FIT);
   const int32_t imgid = thumb->info.id;
+  // a refresh keeps showing the previous surface until the new one is ready
+  const gboolean has_surface = (thumb->img_surf != NULL);
 
   dt_pthread_mutex_unlock(&thumb->lock);
 
+  if(zoom == DT_THUMBTABLE_ZOOM_FIT && !has_surface && dt_conf_get_bool("lighttable/progressive_thumbnails")
+     && _show_preview(thumb, job, imgid, img_w, img_h))
+    return 0;
+
   // These are the sizes of the actual image. Can be larger than the widget bounding box.
   int img_width = 0;
   int img_height = 0;
@@ -535,7 +634,8 @@ int32_t _get_image_buffer(dt_job_t *job)
     unsigned char *rgbbuf = cairo_image_surface_get_data(surface);
     if(rgbbuf)
     {
-      if(dt_focuspeaking(cri, rgbbuf, img_width, img_height, show_focus_peaking, &x_center, &y_center) != 0)
+      if(dt_focuspeaking(cri, rgbbuf, img_width, img_height, show_focus_peaking, scratch, &x_center,
+                         &y_center) != 0)
       {
         cairo_destroy(cri);
         cairo_surface_destroy(surface);
@@ -591,6 +691,10 @@ int32_t _get_image_buffer(dt_job_t *job)
                                 && thumb->w_image != NULL);
   if(still_valid)
   {
+    // Still committed: the surface is valid if the user scrolls back.
+    if(thumb->table && !dt_thumbtable_rowid_wanted(thumb->table, thumb->rowid))
+      dt_atomic_add_int(&thumb->table->renders_wasted, 1);
+
     _free_image_surface(thumb);
     thumb->img_width = roundf(img_width / sx);
     thumb->img_height = roundf(img_height / sy);
@@ -682,6 +786,7 @@ int dt_thumbnail_get_image_buffer(dt_thumbnail_t *thumb)
     return 1;
   }
 
+  if(thumb->table) dt_atomic_add_int(&thumb->table->renders_requested, 1);
   return 0;
 }
 
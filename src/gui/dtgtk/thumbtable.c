@@ -478,6 +478,44 @@ gboolean _is_rowid_visible(dt_thumbtable_t *table, int rowid)
   return table->ops->is_rowid_visible(table, rowid);
 }
 
+// How far ahead of the scrolling we prefetch, in seconds of scrolling at the current speed.
+// A pause longer than DT_THUMBTABLE_SCROLL_STOP between row changes means scrolling stopped.
+#define DT_THUMBTABLE_PREFETCH_HORIZON 0.3
+#define DT_THUMBTABLE_SCROLL_STOP 0.5
+
+// Number of rowids to prefetch beyond the visible rows in the scrolling direction, whole rows,
+// at most one page. Positive forward, negative backward.
+static int _prefetch_rowids(const dt_thumbtable_t *table)
+{
+  const int per_row = MAX(table->thumbs_per_row, 1);
+  const int page = MAX(table->max_row_id - table->min_row_id, per_row);
+  const int ahead = (int)ceilf(fabsf(table->scroll_velocity) * DT_THUMBTABLE_PREFETCH_HORIZON / per_row) * per_row;
+  const int rowids = MIN(ahead, page);
+  return (table->scroll_velocity < 0.f) ? -rowids : rowids;
+}
+
+// Track the scrolling speed from the visible rows changes, and publish the range of rowids that
+// render jobs still serve: jobs queued for thumbnails that scrolled out of it drop themselves.
+static void _update_scroll_velocity(dt_thumbtable_t *table, const int rowid_min)
+{
+  const double now = dt_get_wtime();
+  const double dt = now - table->scroll_time;
+  if(table->scroll_time == 0. || dt >= DT_THUMBTABLE_SCROLL_STOP)
+    table->scroll_velocity = 0.f;
+  else if(dt > 1e-3)
+    table->scroll_velocity = 0.5f * table->scroll_velocity
+                             + 0.5f * (float)((rowid_min - table->min_row_id) / dt);
+  table->scroll_time = now;
+}
+
+static void _update_wanted_rows(dt_thumbtable_t *table)
+{
+  const int per_row = MAX(table->thumbs_per_row, 1);
+  const int prefetch = _prefetch_rowids(table);
+  dt_atomic_set_int(&table->wanted_min_row_id, table->min_row_id - per_row + MIN(prefetch, 0));
+  dt_atomic_set_int(&table->wanted_max_row_id, table->max_row_id + per_row + MAX(prefetch, 0));
+}
+
 // Returns TRUE if visible row ids have changed since last check
 gboolean _update_row_ids(dt_thumbtable_t *table)
 {
@@ -486,14 +524,33 @@ gboolean _update_row_ids(dt_thumbtable_t *table)
   if(!_get_row_ids(table, &rowid_min, &rowid_max)) return FALSE;
   if(rowid_min != table->min_row_id || rowid_max != table->max_row_id)
   {
+    _update_scroll_velocity(table, rowid_min);
     table->min_row_id = rowid_min;
     table->max_row_id = rowid_max;
     table->thumbs_inited = FALSE;
+    _update_wanted_rows(table);
     return TRUE;
   }
   return FALSE;
 }
 
+gboolean dt_thumbtable_rowid_wanted(dt_thumbtable_t *table, const int rowid)
+{
+  if(IS_NULL_PTR(table)) return TRUE;
+  const int wanted_min = dt_atomic_get_int(&table->wanted_min_row_id);
+  const int wanted_max = dt_atomic_get_int(&table->wanted_max_row_id);
+  // nothing published yet: the table was never scrolled into place
+  if(wanted_min == wanted_max) return TRUE;
+  return rowid >= wanted_min && rowid < wanted_max;
+}
+
+void dt_thumbtable_get_render_stats(dt_thumbtable_t *table, int *requested, int *skipped, int *wasted)
+{
+  if(requested) *requested = table ? dt_atomic_get_int(&table->renders_requested) : 0;
+  if(skipped) *skipped = table ? dt_atomic_get_int(&table->renders_skipped) : 0;
+  if(wasted) *wasted = table ? dt_atomic_get_int(&table->renders_wasted) : 0;
+}
+
 void _update_grid_area(dt_thumbtable_t *table)
 {
   if(!table->configured || !table->collection_inited) return;
@@ -505,6 +562,18 @@ void _update_grid_area(dt_thumbtable_t *table)
 // configure already applies the cell-decoration budget when computing them, so re-deriving here
 // (e.g. floor(width/cols), ignoring deco) would disagree by a pixel and make thumbs_changed forever
 // true - an infinite configure/redraw loop.
+// Focus peaking borrows three planes of the rendered surface per thumbnail, the luma, its
+// downsampled copy and the RGBA8 overlay, all 4 bytes a pixel, and every render worker can have
+// one in flight: keep that much idle, for the thumbnail size in use.
+static void _scratch_configure(dt_thumbtable_t *table)
+{
+  const float ppd = dt_gui_get_global()->ppd;
+  const size_t plane = (size_t)ceilf(table->thumb_width * ppd) * (size_t)ceilf(table->thumb_height * ppd);
+  const dt_control_t *control = dt_control_get_global();
+  const size_t workers = control ? MAX(control->num_threads, 1) : 1;
+  dt_scratch_pool_set_max_idle_bytes(table->scratch, 3 * plane * sizeof(float) * workers);
+}
+
 void _grid_configure(dt_thumbtable_t *table, int width, int height, int per_row, int thumb_width, int thumb_height)
 {
   if(width < 32 || height < 32) return;
@@ -514,6 +583,7 @@ void _grid_configure(dt_thumbtable_t *table, int width, int height, int per_row,
   table->view_height = height;
   table->thumb_width = thumb_width;
   table->thumb_height = thumb_height;
+  _scratch_configure(table);
 
   table->configured = TRUE;
 
@@ -749,6 +819,17 @@ void _populate_thumbnails(dt_thumbtable_t *table)
   // for(size_t rowid = 0; rowid < table->collection_count; rowid++)
   for(size_t rowid = MAX(table->min_row_id, 0); rowid < MIN(table->max_row_id, table->collection_count); rowid++)
     _add_thumbnail_at_rowid(table, rowid, mouse_over);
+
+  // While scrolling, start rendering the rows about to come into view. GTK only draws, hence only
+  // requests, the thumbnails inside the viewport: these need the request made for them.
+  const int prefetch = _prefetch_rowids(table);
+  const int first = (prefetch > 0) ? table->max_row_id : table->min_row_id + prefetch;
+  const int last = (prefetch > 0) ? table->max_row_id + prefetch : table->min_row_id;
+  for(int rowid = MAX(first, 0); rowid < MIN(last, table->collection_count); rowid++)
+  {
+    _add_thumbnail_at_rowid(table, rowid, mouse_over);
+    if(table->lut[rowid].thumb) dt_thumbnail_get_image_buffer(table->lut[rowid].thumb);
+  }
 }
 
 // Resize the thumbnails that are still existing but outside of visible viewport at current scroll level
@@ -815,9 +896,11 @@ void dt_thumbtable_update(dt_thumbtable_t *table)
   dt_pthread_mutex_unlock(&table->lock);
 
   const char *const name = gtk_widget_get_name(table->grid);
-  dt_print(DT_DEBUG_LIGHTTABLE, "[%s] Populated %d thumbs between %i and %i in %0.04f sec \n",
+  dt_print(DT_DEBUG_LIGHTTABLE, "[%s] Populated %d thumbs between %i and %i in %0.04f sec, scrolling at %.1f images/s, "
+           "renders: %d requested, %d skipped, %d wasted\n",
            name ? name : "thumbtable", table->thumb_nb, table->min_row_id, table->max_row_id,
-           dt_get_wtime() - start);
+           dt_get_wtime() - start, table->scroll_velocity, dt_atomic_get_int(&table->renders_requested),
+           dt_atomic_get_int(&table->renders_skipped), dt_atomic_get_int(&table->renders_wasted));
 }
 
 
@@ -907,6 +990,7 @@ gboolean dt_thumbtable_get_focus_regions(dt_thumbtable_t *table)
 void dt_thumbtable_set_focus_peaking(dt_thumbtable_t *table, gboolean enable)
 {
   table->focus_peaking = enable;
+  if(!enable) dt_scratch_pool_flush(table->scratch);
   dt_thumbtable_refresh_thumbnail(table, UNKNOWN_IMAGE, TRUE);
 }
 
@@ -1912,6 +1996,8 @@ dt_thumbtable_t *dt_thumbtable_new(dt_thumbtable_mode_t mode)
   // content is a GtkFixed (grid) or a GtkLayout (filmstrip).
   table->mode = mode;
   table->ops = _ops_for_mode(mode);
+  // keeps nothing until the thumbnail size is known, see _scratch_configure()
+  table->scratch = dt_scratch_pool_new(0);
 
   table->scroll_window = gtk_scrolled_window_new(NULL, NULL);
   // Named so the theme can zero its "scrollbar-spacing" style property (see dt_thumbtable_configure).
@@ -2200,6 +2286,7 @@ void dt_thumbtable_cleanup(dt_thumbtable_t *table)
   {
     dt_free(table->lut);
   }
+  dt_scratch_pool_free(table->scratch);
 
   dt_free(table);
 }
@@ -2241,6 +2328,9 @@ void dt_thumbtable_stop(dt_thumbtable_t *table)
 
   table->thumb_nb = 0;
   table->thumbs_inited = FALSE;
+
+  // the view is left: don't keep focus peaking buffers around for when it comes back
+  dt_scratch_pool_flush(table->scratch);
 }
 
 void dt_thumbtable_update_parent(dt_thumbtable_t *table)
@@ -2261,10 +2351,9 @@ void dt_thumbtable_set_parent(dt_thumbtable_t *table, dt_thumbtable_mode_t mode)
   table->ops->setup_parent(table);
 }
 
-void dt_thumbtable_select_all(dt_thumbtable_t *table)
+// Every imgid of the collection, warning first that collapsed groups only give their visible members
+static GList *_select_all_imgids(dt_thumbtable_t *table)
 {
-  if(!table->collection_inited || table->collection_count == 0) return;
-
   if(table->collapse_groups)
     dt_control_log(_("Image groups are collapsed in view.\n"
                      "Selecting all images will only target visible members of image groups.\n"
@@ -2277,6 +2366,14 @@ void dt_thumbtable_select_all(dt_thumbtable_t *table)
     img = g_list_prepend(img, GINT_TO_POINTER(table->lut[i].imgid));
   dt_pthread_mutex_unlock(&table->lock);
 
+  return img;
+}
+
+void dt_thumbtable_select_all(dt_thumbtable_t *table)
+{
+  if(!table->collection_inited || table->collection_count == 0) return;
+
+  GList *img = _select_all_imgids(table);
   if(img)
   {
     dt_selection_select_list(dt_selection_get_global(), img);
@@ -2297,23 +2394,19 @@ void dt_thumbtable_select_range(dt_thumbtable_t *table, const int rowid)
 
   dt_pthread_mutex_lock(&table->lock);
 
-  // Find the bounds of the current selection
+  // Find the bounds of the current selection: one pass over the rows, membership is O(1)
   size_t rowid_end = 0;
   size_t rowid_start = table->collection_count - 1;
-  GList *selected = dt_selection_get_list(dt_selection_get_global());
+  struct dt_selection_t *selection = dt_selection_get_global();
 
-  if(selected)
+  if(dt_selection_get_length(selection) > 0)
   {
-    for(GList *s = g_list_first(selected); s; s = g_list_next(s))
+    for(size_t row = 0; row < table->collection_count; row++)
     {
-      int32_t imgid = GPOINTER_TO_INT(s->data);
-      int row = dt_thumbtable_find_rowid_from_imgid(table, imgid);
-      if(row < 0) continue; // not found - should not happen
+      if(!dt_selection_is_id_selected(selection, table->lut[row].imgid)) continue;
       if(row < rowid_start) rowid_start = row;
       if(row > rowid_end) rowid_end = row;
     }
-    g_list_free(selected);
-    selected = NULL;
   }
   else
   {
@@ -2359,15 +2452,13 @@ void dt_thumbtable_invert_selection(dt_thumbtable_t *table)
 {
   if(!table->collection_inited || table->collection_count == 0) return;
 
-  // Record initial selection, select all, then deselect initial selection
-  GList *to_deselect = dt_selection_get_list(dt_selection_get_global());
-  if(to_deselect)
-  {
-    dt_thumbtable_select_all(table);
-    dt_selection_deselect_list(dt_selection_get_global(), to_deselect);
-    g_list_free(to_deselect);
-    to_deselect = NULL;
-  }
+  // Nothing selected, nothing to invert. Otherwise what was selected goes and the rest of the
+  // collection comes in, in one pass over the selection set
+  if(dt_selection_get_length(dt_selection_get_global()) == 0) return;
+
+  GList *img = _select_all_imgids(table);
+  dt_selection_invert(dt_selection_get_global(), img);
+  g_list_free(img);
 }
 
 static gint64 next_over_time = 0;
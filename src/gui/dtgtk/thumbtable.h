@@ -46,6 +46,7 @@
 #include "gui/dtgtk/thumbnail.h"
 #include "common/debug.h"
 #include "common/logging.h"
+#include "system/scratch_pool.h"
 
 #include <gtk/gtk.h>
 #include <gdk/gdk.h>
@@ -148,6 +149,21 @@ typedef struct dt_thumbtable_t
   int min_row_id;
   int max_row_id;
 
+  // Scroll speed, in rowids per second, signed in the scrolling direction (smoothed over the last
+  // row changes), and when the visible rows last changed.
+  float scroll_velocity;
+  double scroll_time;
+
+  // Rowids a thumbnail render job is still useful for: the visible rows, one row behind and the
+  // prefetched rows ahead. Written by the GUI thread, read by the render jobs.
+  dt_atomic_int wanted_min_row_id;
+  dt_atomic_int wanted_max_row_id;
+
+  // Render jobs counters, see dt_thumbtable_get_render_stats()
+  dt_atomic_int renders_requested; // queued
+  dt_atomic_int renders_skipped;   // dropped before rendering: scrolled off while queued
+  dt_atomic_int renders_wasted;    // rendered, but scrolled off before they were done
+
   // Our LUT of collection, mapping rowid (index) to imgid (content)
   dt_thumbtable_cache_t *lut;
 
@@ -188,6 +204,9 @@ typedef struct dt_thumbtable_t
   gboolean focus_regions;
   gboolean focus_peaking;
 
+  // Frame-sized work buffers of the focus peaking, kept across renders
+  dt_scratch_pool_t *scratch;
+
   gboolean draw_group_borders;
 
   // Coalesce layout/scroll updates outside of draw handlers.
@@ -223,6 +242,20 @@ void dt_thumbtable_set_parent(dt_thumbtable_t *table, dt_thumbtable_mode_t mode)
 void dt_thumbtable_update_parent(dt_thumbtable_t *table);
 void dt_thumbtable_queue_update(dt_thumbtable_t *table);
 
+/**
+ * @brief Whether a thumbnail render for @p rowid is still worth doing.
+ *
+ * @details TRUE inside the visible rows, the row behind them and the rows prefetched in the scroll
+ * direction. Safe to call from the render jobs.
+ */
+gboolean dt_thumbtable_rowid_wanted(dt_thumbtable_t *table, const int rowid);
+
+/**
+ * @brief Thumbnail render jobs queued, dropped before rendering and rendered for nothing since
+ * the table was created. Any output pointer can be NULL.
+ */
+void dt_thumbtable_get_render_stats(dt_thumbtable_t *table, int *requested, int *skipped, int *wasted);
+
 /**
  * @brief Apply grid configuration changes with proper event synchronization
  * @param table The thumbnail table
@@ -0,0 +1,363 @@
+/*
+    This file is part of Ansel,
+    Copyright (C) 2026 Aurélien PIERRE.
+
+    Ansel is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ansel is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ansel.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "imageio/imageio_dng_region.h"
+#include "caches/pixelpipe_cache.h"
+#include "common/hash.h"
+#include "common/logging.h"
+#include "system/macros.h"
+#include "system/mem_alloc.h"
+
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+#include <tiffio.h>
+
+// stripped files are cut into tiles of this size, so one row band does not cost a whole strip
+#define DNG_REGION_TILE 256
+// above that, a native tile is no cheaper to read than the whole raw
+#define DNG_REGION_MAX_TILE_PIXELS (2048 * 2048)
+// bytes before the photosites of a cached tile, keeps them aligned
+#define DNG_REGION_TILE_HEADER 64
+
+// DNG tags libtiff may not know by name: their presence alone disqualifies the file
+#define DNG_TAG_LINEARIZATION_TABLE 50712
+#define DNG_TAG_OPCODE_LIST_1 51008
+#define DNG_TAG_OPCODE_LIST_2 51009
+
+typedef struct _dng_layout_t
+{
+  uint32_t width;
+  uint32_t height;
+  gboolean tiled;
+  uint32_t tile_w; // native tiles, or the DNG_REGION_TILE ones we cut uncompressed strips into
+  uint32_t tile_h;
+  uint32_t tiles_across;
+  uint32_t rows_per_strip;
+  const uint64_t *strip_offsets; // owned by libtiff, valid while the raw IFD is current
+} _dng_layout_t;
+
+typedef struct _dng_tile_t
+{
+  gboolean valid; // FALSE if the read failed: the entry is left for the cache to reap
+  // followed, at DNG_REGION_TILE_HEADER, by tile_w x tile_h photosites
+} _dng_tile_t;
+
+static inline uint16_t *_tile_pixels(const _dng_tile_t *tile)
+{
+  return (uint16_t *)((char *)tile + DNG_REGION_TILE_HEADER);
+}
+
+static TIFF *_open(const char *filename)
+{
+#ifdef _WIN32
+  wchar_t *wfilename = g_utf8_to_utf16(filename, -1, NULL, NULL, NULL);
+  TIFF *tiff = TIFFOpenW(wfilename, "rb");
+  dt_free(wfilename);
+  return tiff;
+#else
+  return TIFFOpen(filename, "rb");
+#endif
+}
+
+/**
+ * @brief Whether the current IFD carries @p tag, whatever libtiff thinks its type is.
+ *
+ * @details Tags libtiff does not register are read as anonymous, counted fields. The ones we
+ * ask about are all arrays, so a pointer receives the value in every case.
+ */
+static gboolean _has_tag(TIFF *tiff, const uint32_t tag)
+{
+  const TIFFField *field = TIFFFindField(tiff, tag, TIFF_ANY);
+  if(IS_NULL_PTR(field)) return FALSE; // not seen anywhere in the file
+
+  void *data = NULL;
+  if(!TIFFFieldPassCount(field)) return TIFFGetField(tiff, tag, &data) == 1;
+
+  if(TIFFFieldReadCount(field) == TIFF_VARIABLE2)
+  {
+    uint32_t count = 0;
+    return TIFFGetField(tiff, tag, &count, &data) == 1 && count > 0;
+  }
+
+  uint16_t count = 0;
+  return TIFFGetField(tiff, tag, &count, &data) == 1 && count > 0;
+}
+
+static gboolean _is_raw_ifd(TIFF *tiff)
+{
+  uint32_t subfiletype = 0;
+  uint16_t photometric = 0;
+  TIFFGetFieldDefaulted(tiff, TIFFTAG_SUBFILETYPE, &subfiletype);
+  if(!TIFFGetField(tiff, TIFFTAG_PHOTOMETRIC, &photometric)) return FALSE;
+  return subfiletype == 0 && photometric == PHOTOMETRIC_CFA;
+}
+
+// The raw is the first full-resolution CFA IFD: IFD0 in some files, a sub-IFD in most.
+static gboolean _select_raw_ifd(TIFF *tiff)
+{
+  if(_is_raw_ifd(tiff)) return TRUE;
+
+  uint16_t count = 0;
+  uint64_t *offsets = NULL;
+  if(!TIFFGetField(tiff, TIFFTAG_SUBIFD, &count, &offsets) || IS_NULL_PTR(offsets)) return FALSE;
+
+  // TIFFSetSubDirectory() frees the parent IFD, and its sub-IFD array with it
+  uint64_t subifds[16];
+  count = MIN(count, (uint16_t)G_N_ELEMENTS(subifds));
+  memcpy(subifds, offsets, count * sizeof(uint64_t));
+
+  for(uint16_t k = 0; k < count; k++)
+    if(TIFFSetSubDirectory(tiff, subifds[k]) && _is_raw_ifd(tiff)) return TRUE;
+
+  return FALSE;
+}
+
+/**
+ * @brief Check the raw IFD is stored the way we can read by region, and describe its tiles.
+ *
+ * @return NULL if it is, else the reason, for the debug log.
+ */
+static const char *_layout(TIFF *tiff, const dt_image_t *img, _dng_layout_t *layout)
+{
+  uint16_t bps = 0, spp = 1, compression = COMPRESSION_NONE, predictor = PREDICTOR_NONE;
+  uint16_t sampleformat = SAMPLEFORMAT_UINT;
+  memset(layout, 0, sizeof(*layout));
+
+  TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &layout->width);
+  TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &layout->height);
+  TIFFGetField(tiff, TIFFTAG_BITSPERSAMPLE, &bps);
+  TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLESPERPIXEL, &spp);
+  TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLEFORMAT, &sampleformat);
+  TIFFGetFieldDefaulted(tiff, TIFFTAG_COMPRESSION, &compression);
+
+  // rawspeed keeps the whole IFD as the uncropped plane: anything else means we read another image
+  if(layout->width != (uint32_t)img->width || layout->height != (uint32_t)img->height)
+    return "raw IFD size differs from the decoded one";
+  if(bps != 16 || spp != 1 || sampleformat != SAMPLEFORMAT_UINT) return "not 16-bit unsigned CFA";
+  if(_has_tag(tiff, DNG_TAG_LINEARIZATION_TABLE)) return "linearization table";
+  if(_has_tag(tiff, DNG_TAG_OPCODE_LIST_1) || _has_tag(tiff, DNG_TAG_OPCODE_LIST_2)) return "raw opcode lists";
+
+  layout->tiled = TIFFIsTiled(tiff);
+  if(layout->tiled)
+  {
+    if(compression != COMPRESSION_NONE && compression != COMPRESSION_ADOBE_DEFLATE
+       && compression != COMPRESSION_DEFLATE)
+      return "compressed tiles other than deflate";
+    // only the deflate codec knows the predictor tag
+    if(compression != COMPRESSION_NONE) TIFFGetFieldDefaulted(tiff, TIFFTAG_PREDICTOR, &predictor);
+    if(predictor != PREDICTOR_NONE && predictor != PREDICTOR_HORIZONTAL) return "floating-point predictor";
+    TIFFGetField(tiff, TIFFTAG_TILEWIDTH, &layout->tile_w);
+    TIFFGetField(tiff, TIFFTAG_TILELENGTH, &layout->tile_h);
+    if(layout->tile_w == 0 || layout->tile_h == 0
+       || (uint64_t)layout->tile_w * layout->tile_h > DNG_REGION_MAX_TILE_PIXELS)
+      return "tile size";
+  }
+  else
+  {
+    // strips only allow random access when we can compute where each row starts
+    if(compression != COMPRESSION_NONE) return "compressed strips";
+
+    uint64_t *offsets = NULL;
+    uint64_t *bytecounts = NULL;
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_ROWSPERSTRIP, &layout->rows_per_strip);
+    if(!TIFFGetField(tiff, TIFFTAG_STRIPOFFSETS, &offsets) || !TIFFGetField(tiff, TIFFTAG_STRIPBYTECOUNTS, &bytecounts)
+       || IS_NULL_PTR(offsets) || IS_NULL_PTR(bytecounts) || layout->rows_per_strip == 0)
+      return "no strip offsets";
+
+    layout->rows_per_strip = MIN(layout->rows_per_strip, layout->height);
+    const uint32_t strips = TIFFNumberOfStrips(tiff);
+    if(strips != (layout->height + layout->rows_per_strip - 1) / layout->rows_per_strip) return "strip count";
+    for(uint32_t s = 0; s < strips; s++)
+    {
+      const uint64_t rows = MIN(layout->rows_per_strip, layout->height - s * layout->rows_per_strip);
+      if(bytecounts[s] < rows * layout->width * sizeof(uint16_t)) return "short strip";
+    }
+
+    layout->strip_offsets = offsets;
+    layout->tile_w = DNG_REGION_TILE;
+    layout->tile_h = DNG_REGION_TILE;
+  }
+
+  layout->tiles_across = (layout->width + layout->tile_w - 1) / layout->tile_w;
+  return NULL;
+}
+
+static gboolean _read_tile(TIFF *tiff, const _dng_layout_t *const layout, const uint32_t tile, uint16_t *pixels)
+{
+  const size_t tile_bytes = (size_t)layout->tile_w * layout->tile_h * sizeof(uint16_t);
+
+  // libtiff inflates, undoes the predictor and swaps bytes. Edge tiles are padded to full size.
+  if(layout->tiled) return TIFFReadEncodedTile(tiff, tile, pixels, (tmsize_t)tile_bytes) == (tmsize_t)tile_bytes;
+
+  // uncompressed strips: read each row's span straight from its file offset
+  TIFFReadWriteProc read_proc = TIFFGetReadProc(tiff);
+  TIFFSeekProc seek_proc = TIFFGetSeekProc(tiff);
+  thandle_t handle = TIFFClientdata(tiff);
+
+  const uint32_t x0 = (tile % layout->tiles_across) * layout->tile_w;
+  const uint32_t y0 = (tile / layout->tiles_across) * layout->tile_h;
+  const uint32_t cols = MIN(layout->tile_w, layout->width - x0);
+  const uint32_t rows = MIN(layout->tile_h, layout->height - y0);
+  const tmsize_t row_bytes = (tmsize_t)cols * sizeof(uint16_t);
+
+  for(uint32_t j = 0; j < rows; j++)
+  {
+    const uint32_t row = y0 + j;
+    const uint32_t strip = row / layout->rows_per_strip;
+    const uint64_t offset = layout->strip_offsets[strip]
+                            + ((uint64_t)(row - strip * layout->rows_per_strip) * layout->width + x0)
+                                  * sizeof(uint16_t);
+    uint16_t *dst = pixels + (size_t)j * layout->tile_w;
+
+    if(seek_proc(handle, offset, SEEK_SET) != offset) return FALSE;
+    if(read_proc(handle, dst, row_bytes) != row_bytes) return FALSE;
+    if(TIFFIsByteSwapped(tiff)) TIFFSwabArrayOfShort(dst, cols);
+  }
+  return TRUE;
+}
+
+/**
+ * @brief Find @p tile in the pixelpipe cache, reading it from the file if it is not there.
+ *
+ * @details Same protocol as the lens distortion maps: the thread that creates the entry fills
+ * it under the write lock the cache hands it, everyone reads it under a read lock. Release
+ * with _tile_release().
+ */
+static const _dng_tile_t *_tile_acquire(TIFF *tiff, const _dng_layout_t *const layout, const uint64_t file_hash,
+                                        const uint32_t tile, const int id, dt_pixel_cache_entry_t **entry)
+{
+  *entry = NULL;
+  const uint64_t hash = dt_hash(file_hash, (const char *)&tile, sizeof(tile));
+  const size_t size = DNG_REGION_TILE_HEADER + (size_t)layout->tile_w * layout->tile_h * sizeof(uint16_t);
+
+  void *data = NULL;
+  const int created = dt_dev_pixelpipe_cache_get(hash, size, "dng raw tile", id, TRUE, &data, entry);
+  if(IS_NULL_PTR(data) || IS_NULL_PTR(*entry))
+  {
+    if(*entry)
+    {
+      if(created) dt_dev_pixelpipe_cache_wrlock_entry(FALSE, *entry);
+      dt_dev_pixelpipe_cache_ref_count_entry(FALSE, *entry);
+    }
+    *entry = NULL;
+    return NULL;
+  }
+
+  _dng_tile_t *cached = (_dng_tile_t *)data;
+  if(created)
+  {
+    cached->valid = _read_tile(tiff, layout, tile, _tile_pixels(cached));
+    if(!cached->valid) dt_dev_pixelpipe_cache_flag_auto_destroy(*entry);
+    dt_dev_pixelpipe_cache_wrlock_entry(FALSE, *entry);
+  }
+
+  dt_dev_pixelpipe_cache_rdlock_entry(TRUE, *entry);
+  if(cached->valid) return cached;
+
+  dt_dev_pixelpipe_cache_rdlock_entry(FALSE, *entry);
+  dt_dev_pixelpipe_cache_ref_count_entry(FALSE, *entry);
+  if(created) dt_dev_pixelpipe_cache_auto_destroy_apply(*entry);
+  *entry = NULL;
+  return NULL;
+}
+
+static void _tile_release(dt_pixel_cache_entry_t *entry)
+{
+  if(IS_NULL_PTR(entry)) return;
+  dt_dev_pixelpipe_cache_rdlock_entry(FALSE, entry);
+  dt_dev_pixelpipe_cache_ref_count_entry(FALSE, entry);
+}
+
+static gboolean _is_dng(const char *filename)
+{
+  const char *ext = strrchr(filename, '.');
+  return ext && !g_ascii_strcasecmp(ext, ".dng");
+}
+
+gboolean dt_imageio_dng_region_read(const dt_image_t *img, const char *filename, const int x, const int y,
+                                    const int width, const int height, uint16_t *out, const size_t out_stride,
+                                    const int id)
+{
+  // the mipmap layout we reproduce is rawspeed's, and only known once it decoded the file
+  if(IS_NULL_PTR(img) || IS_NULL_PTR(filename) || IS_NULL_PTR(out) || !_is_dng(filename)) return FALSE;
+  if(img->loader != LOADER_RAWSPEED || img->dsc.channels != 1 || img->dsc.datatype != TYPE_UINT16
+     || img->dsc.filters == 0u)
+    return FALSE;
+  if(x < 0 || y < 0 || width <= 0 || height <= 0 || x + width > img->width || y + height > img->height)
+    return FALSE;
+
+  // a rewritten file must not hit the tiles of the previous one
+  GStatBuf st;
+  if(g_stat(filename, &st) != 0) return FALSE;
+
+  TIFF *tiff = _open(filename);
+  if(IS_NULL_PTR(tiff)) return FALSE;
+
+  _dng_layout_t layout;
+  const char *reason = _select_raw_ifd(tiff) ? _layout(tiff, img, &layout) : "no raw CFA IFD";
+  if(reason)
+  {
+    dt_print(DT_DEBUG_IMAGEIO, "[dng_region] %s: %s, the raw will be decoded whole\n", filename, reason);
+    TIFFClose(tiff);
+    return FALSE;
+  }
+
+  // no struct: padding bytes would make the key random
+  const int64_t stamp[5] = { img->id, layout.tile_w, layout.tile_h, (int64_t)st.st_mtime, (int64_t)st.st_size };
+  const uint64_t file_hash = dt_hash(5381, (const char *)stamp, sizeof(stamp));
+
+  const uint32_t tx0 = x / layout.tile_w, tx1 = (x + width - 1) / layout.tile_w;
+  const uint32_t ty0 = y / layout.tile_h, ty1 = (y + height - 1) / layout.tile_h;
+  gboolean ok = TRUE;
+
+  // libtiff handles are not reentrant: tiles are read one after the other
+  for(uint32_t ty = ty0; ty <= ty1 && ok; ty++)
+    for(uint32_t tx = tx0; tx <= tx1 && ok; tx++)
+    {
+      dt_pixel_cache_entry_t *entry = NULL;
+      const _dng_tile_t *tile = _tile_acquire(tiff, &layout, file_hash, ty * layout.tiles_across + tx, id, &entry);
+      if(IS_NULL_PTR(tile))
+      {
+        ok = FALSE;
+        break;
+      }
+
+      const int x0 = tx * layout.tile_w, y0 = ty * layout.tile_h;
+      const int cx0 = MAX(x, x0), cx1 = MIN(x + width, x0 + (int)layout.tile_w);
+      const int cy0 = MAX(y, y0), cy1 = MIN(y + height, y0 + (int)layout.tile_h);
+      const uint16_t *const pixels = _tile_pixels(tile);
+
+      for(int j = cy0; j < cy1; j++)
+        memcpy((char *)out + (size_t)(j - y) * out_stride + (size_t)(cx0 - x) * sizeof(uint16_t),
+               pixels + (size_t)(j - y0) * layout.tile_w + (cx0 - x0), (size_t)(cx1 - cx0) * sizeof(uint16_t));
+
+      _tile_release(entry);
+    }
+
+  TIFFClose(tiff);
+
+  if(!ok) dt_print(DT_DEBUG_IMAGEIO, "[dng_region] %s: tile read failed, the raw will be decoded whole\n", filename);
+  return ok;
+}
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
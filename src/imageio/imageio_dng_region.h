@@ -0,0 +1,65 @@
+/*
+    This file is part of Ansel,
+    Copyright (C) 2026 Aurélien PIERRE.
+
+    Ansel is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ansel is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ansel.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DT_IMAGEIO_IMAGEIO_DNG_REGION_H
+#define DT_IMAGEIO_IMAGEIO_DNG_REGION_H
+
+#include "common/image.h"
+
+#include <glib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Read one rectangle of a DNG's raw CFA plane, without decoding the rest of it.
+ *
+ * @details
+ * Produces exactly the pixels rawspeed would have put at those coordinates of the
+ * `DT_MIPMAP_FULL` buffer: the uncropped sensor plane, 16 bits per photosite. Only the layouts
+ * that allow random access qualify: tiled DNGs, uncompressed or deflated, and uncompressed
+ * stripped ones. Anything the full decoder transforms on the way in -- a linearization table,
+ * opcode lists, lossless JPEG, float or non-16-bit samples -- makes this return FALSE, and the
+ * caller decodes the whole file as before.
+ *
+ * The tiles read are kept in the pixelpipe cache, keyed by image, file stamp and tile index, so
+ * panning over the same area reads the file once.
+ *
+ * @param img Image the rectangle belongs to. It must already have been decoded once by
+ *            rawspeed in this session, which is what fills in its size and buffer description.
+ * @param filename File to read, as chosen by dt_image_choose_input_path().
+ * @param x Left of the rectangle, in uncropped sensor pixels.
+ * @param y Top of the rectangle, in uncropped sensor pixels.
+ * @param width Width of the rectangle. The rectangle must lie inside the image.
+ * @param height Height of the rectangle.
+ * @param out Receives the rectangle, row after row. Untouched if FALSE is returned before the
+ *            first tile, partially written otherwise.
+ * @param out_stride Distance between two rows of @p out, in bytes.
+ * @param id Pipe type owning the cached tiles, see dt_dev_pixelpipe_cache_get().
+ * @return TRUE if the whole rectangle was written.
+ */
+gboolean dt_imageio_dng_region_read(const dt_image_t *img, const char *filename, const int x, const int y,
+                                    const int width, const int height, uint16_t *out, const size_t out_stride,
+                                    const int id);
+
+#endif // DT_IMAGEIO_IMAGEIO_DNG_REGION_H
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
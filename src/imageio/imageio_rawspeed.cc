@@ -56,11 +56,16 @@
 #define TYPE_FLOAT32 RawImageType::F32
 #define TYPE_USHORT16 RawImageType::UINT16
 
+#include <limits>
 #include <memory>
 
 #define __STDC_LIMIT_MACROS
 
 #include "glib.h"
+#include <gio/gio.h>
+#ifndef _WIN32
+#include <gio/gunixmounts.h>
+#endif
 
 #include "metadata/exif.h"
 #include "common/file_location.h"
@@ -71,10 +76,14 @@
 #include <stdint.h>
 
 // define this function, it is only declared in rawspeed:
+// rawspeed sizes its slice- and tile-parallel decompressors with it. Answer with the calling
+// thread's OpenMP budget, not the machine's: control workers are limited to `-t N` and the
+// "CPU cores" preference, and a caller decoding several files side by side (ansel-bench-decode)
+// splits them between its decoders.
 int rawspeed_get_number_of_processor_cores()
 {
 #ifdef _OPENMP
-  return omp_get_num_procs();
+  return omp_get_max_threads();
 #else
   return 1;
 #endif
@@ -166,6 +175,31 @@ static gboolean _ignore_image(const gchar *filename)
   return FALSE;
 }
 
+// A mapped file that shrinks or goes away during the decode (a network share dropping, a card
+// pulled out) faults with SIGBUS on the next page instead of failing a read(), and that kills the
+// process. Only map files on local, fixed filesystems: everything else, or anything we can't
+// tell, is read into a heap copy, where an I/O error is just an I/O error.
+static gboolean _file_is_mappable(const char *filename)
+{
+  GFile *file = g_file_new_for_path(filename);
+  GFileInfo *info = g_file_query_filesystem_info(file, G_FILE_ATTRIBUTE_FILESYSTEM_REMOTE, NULL, NULL);
+  g_object_unref(file);
+  if(IS_NULL_PTR(info)) return FALSE;
+  const gboolean remote = g_file_info_get_attribute_boolean(info, G_FILE_ATTRIBUTE_FILESYSTEM_REMOTE);
+  g_object_unref(info);
+  if(remote) return FALSE;
+
+#ifndef _WIN32
+  GUnixMountEntry *mount = g_unix_mount_for(filename, NULL);
+  if(IS_NULL_PTR(mount)) return FALSE;
+  const gboolean removable = g_unix_mount_guess_can_eject(mount);
+  g_unix_mount_free(mount);
+  if(removable) return FALSE;
+#endif
+
+  return TRUE;
+}
+
 dt_imageio_retval_t dt_imageio_open_rawspeed(dt_image_t *img,
                                              const char *filename,
                                              dt_mipmap_buffer_t *mbuf)
@@ -183,18 +217,52 @@ dt_imageio_retval_t dt_imageio_open_rawspeed(dt_image_t *img,
   if(!img->exif_inited)
     (void)dt_exif_read(img, filename);
 
-  char filen[PATH_MAX] = { 0 };
-  snprintf(filen, sizeof(filen), "%s", filename);
-  FileReader f(filen);
+  // Map the file instead of reading it into a heap copy: the decoder reads it once, straight from
+  // the page cache, and a decode no longer holds the whole file in RAM next to the decoded sensor.
+  // Files on network shares and removable media are still read: see _file_is_mappable().
+  GError *error = NULL;
+  std::unique_ptr<GMappedFile, decltype(&g_mapped_file_unref)> mapping(nullptr, &g_mapped_file_unref);
+  std::unique_ptr<gchar, decltype(&g_free)> contents(nullptr, &g_free);
+  const uint8_t *data = NULL;
+  size_t length = 0;
+  if(_file_is_mappable(filename))
+  {
+    mapping.reset(g_mapped_file_new(filename, FALSE, &error));
+    if(mapping)
+    {
+      data = reinterpret_cast<const uint8_t *>(g_mapped_file_get_contents(mapping.get()));
+      length = g_mapped_file_get_length(mapping.get());
+    }
+  }
+  else
+  {
+    gchar *bytes = NULL;
+    gsize size = 0;
+    if(g_file_get_contents(filename, &bytes, &size, &error))
+    {
+      contents.reset(bytes);
+      data = reinterpret_cast<const uint8_t *>(bytes);
+      length = size;
+    }
+  }
+  if(!mapping && !contents)
+  {
+    dt_print(DT_DEBUG_ALWAYS, "[rawspeed] (%s) I/O error: %s", img->filename, error ? error->message : "");
+    g_clear_error(&error);
+    return DT_IMAGEIO_IOERROR;
+  }
+
+  if(length == 0 || length > std::numeric_limits<Buffer::size_type>::max())
+  {
+    dt_print(DT_DEBUG_ALWAYS, "[rawspeed] (%s) I/O error: unsupported file size %zu", img->filename, length);
+    return DT_IMAGEIO_IOERROR;
+  }
 
   try
   {
     dt_rawspeed_load_meta();
 
-    dt_pthread_mutex_lock(dt_readfile_mutex());
-    auto [storage, storageBuf] = f.readFile();
-    dt_pthread_mutex_unlock(dt_readfile_mutex());
-
+    const Buffer storageBuf(data, static_cast<Buffer::size_type>(length));
     RawParser t(storageBuf);
     std::unique_ptr<RawDecoder> d = t.getDecoder(meta);
 
@@ -293,7 +361,8 @@ dt_imageio_retval_t dt_imageio_open_rawspeed(dt_image_t *img,
 
     /* free auto pointers on spot */
     d.reset();
-    storage.reset();
+    mapping.reset();
+    contents.reset();
 
     // Grab the WB
     if(r->metadata.wbCoeffs) 
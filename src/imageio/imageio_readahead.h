@@ -0,0 +1,36 @@
+/*
+    This file is part of Ansel,
+    Copyright (C) 2026 Aurélien PIERRE.
+
+    Ansel is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ansel is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ansel.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DT_IMAGEIO_IMAGEIO_READAHEAD_H
+#define DT_IMAGEIO_IMAGEIO_READAHEAD_H
+
+/**
+ * @brief Tell the kernel we are about to read the whole of @p filename.
+ *
+ * @details Returns at once: the read happens in the background and lands in the page cache, where
+ * the decoder then finds it. A hint only, and a no-op where the platform has no such hint.
+ */
+void dt_imageio_readahead(const char *filename);
+
+#endif // DT_IMAGEIO_IMAGEIO_READAHEAD_H
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
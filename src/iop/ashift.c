@@ -3175,6 +3175,78 @@ static void do_fit(dt_iop_module_t *module, dt_iop_ashift_params_t *p, dt_iop_as
   dt_gui_freeze_end();
 }
 
+/* Only the darkroom preview feeds the structure detection, from process()'s own input buffer */
+static inline gboolean _ashift_collects_preview(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe,
+                                                const dt_dev_pixelpipe_iop_t *piece)
+{
+  return !IS_NULL_PTR(dt_iop_gui_data(self)) && self->dev->gui_attached && pipe == self->dev->preview_pipe
+         && dt_dev_pixelpipe_has_preview_output(self->dev, pipe, &piece->roi_out);
+}
+
+/* process()'s sampling, shared with distort_process_points(): the inverted homography and the
+ * clipping offset at the scale of this run, then one roi_out buffer position -> one roi_in
+ * buffer position. */
+typedef struct dt_iop_ashift_sampler_t
+{
+  float ihomograph[3][3];
+  float cx, cy;
+} dt_iop_ashift_sampler_t;
+
+static void _ashift_sampler_init(const dt_iop_ashift_data_t *const data, const dt_dev_pixelpipe_iop_t *const piece,
+                                 dt_iop_ashift_sampler_t *s)
+{
+  homography((float *)s->ihomograph, data->rotation, data->lensshift_v, data->lensshift_h, data->shear,
+             data->f_length_kb, data->orthocorr, data->aspect, piece->buf_in.width, piece->buf_in.height,
+             ASHIFT_HOMOGRAPH_INVERTED);
+
+  // clipping offset
+  const float fullwidth = (float)piece->buf_out.width / (data->cr - data->cl);
+  const float fullheight = (float)piece->buf_out.height / (data->cb - data->ct);
+  s->cx = piece->roi_out.scale * fullwidth * data->cl;
+  s->cy = piece->roi_out.scale * fullheight * data->ct;
+}
+
+static inline void _ashift_process_point(const dt_iop_ashift_sampler_t *const s, const dt_iop_roi_t *const roi_in,
+                                         const dt_iop_roi_t *const roi_out, float *p)
+{
+  float pin[3], pout[3];
+
+  // convert output pixel coordinates to original image coordinates
+  pout[0] = roi_out->x + p[0] + s->cx;
+  pout[1] = roi_out->y + p[1] + s->cy;
+  pout[0] /= roi_out->scale;
+  pout[1] /= roi_out->scale;
+  pout[2] = 1.0f;
+
+  // apply homograph
+  mat3mulv(pin, (float *)s->ihomograph, pout);
+
+  // convert to input pixel coordinates
+  pin[0] /= pin[2];
+  pin[1] /= pin[2];
+  pin[0] *= roi_in->scale;
+  pin[1] *= roi_in->scale;
+  p[0] = pin[0] - roi_in->x;
+  p[1] = pin[1] - roi_in->y;
+}
+
+gboolean distort_process_points(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe,
+                                const dt_dev_pixelpipe_iop_t *piece, float *points, size_t points_count)
+{
+  if(_ashift_collects_preview(self, pipe, piece)) return FALSE;
+
+  const dt_iop_ashift_data_t *const data = (dt_iop_ashift_data_t *)piece->data;
+  if(points_count == 0 || isneutral(data)) return TRUE;
+
+  const dt_iop_roi_t *const roi_in = &piece->roi_in;
+  const dt_iop_roi_t *const roi_out = &piece->roi_out;
+  dt_iop_ashift_sampler_t s;
+  _ashift_sampler_init(data, piece, &s);
+  __OMP_PARALLEL_FOR__()
+  for(size_t k = 0; k < points_count; k++) _ashift_process_point(&s, roi_in, roi_out, points + 2 * k);
+  return TRUE;
+}
+
 __DT_CLONE_TARGETS__
 int process(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_pixelpipe_iop_t *piece, const void *const ivoid,
              void *const ovoid)
@@ -3188,9 +3260,7 @@ int process(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const
   const int ch_width = ch * roi_in->width;
 
   // only for preview pipe: collect input buffer data and do some other evaluations
-  if(!IS_NULL_PTR(g) && self->dev->gui_attached
-     && pipe == self->dev->preview_pipe
-     && dt_dev_pixelpipe_has_preview_output(self->dev, pipe, roi_out))
+  if(_ashift_collects_preview(self, pipe, piece))
   {
     // we want to find out if the final output image is flipped in relation to this iop
     // so we can adjust the gui labels accordingly
@@ -3281,15 +3351,8 @@ int process(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const
 
   const struct dt_interpolation *interpolation = dt_interpolation_new(DT_INTERPOLATION_USERPREF_WARP);
 
-  float ihomograph[3][3];
-  homography((float *)ihomograph, data->rotation, data->lensshift_v, data->lensshift_h, data->shear, data->f_length_kb,
-             data->orthocorr, data->aspect, piece->buf_in.width, piece->buf_in.height, ASHIFT_HOMOGRAPH_INVERTED);
-
-  // clipping offset
-  const float fullwidth = (float)piece->buf_out.width / (data->cr - data->cl);
-  const float fullheight = (float)piece->buf_out.height / (data->cb - data->ct);
-  const float cx = roi_out->scale * fullwidth * data->cl;
-  const float cy = roi_out->scale * fullheight * data->ct;
+  dt_iop_ashift_sampler_t s;
+  _ashift_sampler_init(data, piece, &s);
   __OMP_PARALLEL_FOR__()
   // go over all pixels of output image
   for(int j = 0; j < roi_out->height; j++)
@@ -3297,25 +3360,8 @@ int process(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const
     float *const restrict out = ((float *)ovoid) + (size_t)ch * j * roi_out->width;
     for(int i = 0; i < roi_out->width; i++)
     {
-      float pin[3], pout[3];
-
-      // convert output pixel coordinates to original image coordinates
-      pout[0] = roi_out->x + i + cx;
-      pout[1] = roi_out->y + j + cy;
-      pout[0] /= roi_out->scale;
-      pout[1] /= roi_out->scale;
-      pout[2] = 1.0f;
-
-      // apply homograph
-      mat3mulv(pin, (float *)ihomograph, pout);
-
-      // convert to input pixel coordinates
-      pin[0] /= pin[2];
-      pin[1] /= pin[2];
-      pin[0] *= roi_in->scale;
-      pin[1] *= roi_in->scale;
-      pin[0] -= roi_in->x;
-      pin[1] -= roi_in->y;
+      float pin[2] = { i, j };
+      _ashift_process_point(&s, roi_in, roi_out, pin);
 
       // get output values by interpolation from input image
       dt_interpolation_compute_pixel4c(interpolation, (float *)ivoid, out + ch*i, pin[0], pin[1], roi_in->width,
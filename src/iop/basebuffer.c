@@ -29,6 +29,7 @@
 #include "develop/develop.h"
 #include "develop/geometry/geometry.h"
 #include "develop/imageop.h"
+#include "imageio/imageio_dng_region.h"
 #include "iop/iop_api.h"
 
 #include <string.h>
@@ -115,6 +116,33 @@ void input_format(dt_iop_module_t *self, dt_dev_pixelpipe_t *pipe, dt_dev_pixelp
 }
 
 
+/* When the full raw is no longer in the mipmap cache -- evicted since the image was opened --
+ * read only the requested region from the file instead of decoding the whole sensor again. Only DNGs stored in a way that allows random
+ * access qualify, see dt_imageio_dng_region_read() ; FALSE sends the caller to the full decode.
+ * `out' is a roi_out-sized buffer. */
+static gboolean _read_region(const dt_dev_pixelpipe_t *pipe, const dt_dev_pixelpipe_iop_t *piece, void *const out)
+{
+  const dt_image_t *const img = &pipe->dev->image_storage;
+  const dt_iop_roi_t *const roi_out = &piece->roi_out;
+
+  // the region reader produces the uncropped 16-bit CFA plane of the full-size mipmap, nothing else
+  if(pipe->size != DT_MIPMAP_FULL || piece->dsc_in.datatype != TYPE_UINT16 || piece->dsc_in.channels != 1
+     || img->id != pipe->imgid || img->width != pipe->iwidth || img->height != pipe->iheight)
+    return FALSE;
+
+  const int x = MAX(roi_out->x, 0);
+  const int y = MAX(roi_out->y, 0);
+  const int width = MIN(roi_out->width, pipe->iwidth - x);
+  const int height = MIN(roi_out->height, pipe->iheight - y);
+  if(width <= 0 || height <= 0) return FALSE;
+
+  char filename[PATH_MAX] = { 0 };
+  if(dt_image_choose_input_path(img, filename, sizeof(filename), FALSE) == DT_IMAGE_PATH_NONE) return FALSE;
+
+  return dt_imageio_dng_region_read(img, filename, x, y, width, height, (uint16_t *)out,
+                                    (size_t)roi_out->width * piece->dsc_out.bpp, pipe->type);
+}
+
 __DT_CLONE_TARGETS__
 int process(dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_pixelpipe_iop_t *piece,
             const void *const ivoid, void *const ovoid)
@@ -122,7 +150,13 @@ int process(dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_
   const dt_iop_roi_t *const roi_out = &piece->roi_out;
   dt_mipmap_buffer_t buf;
 
-  dt_mipmap_cache_get(&buf, pipe->imgid, pipe->size, DT_MIPMAP_BLOCKING, 'r');
+  dt_mipmap_cache_get(&buf, pipe->imgid, pipe->size, DT_MIPMAP_TESTLOCK, 'r');
+  if(IS_NULL_PTR(buf.buf))
+  {
+    dt_mipmap_cache_release(&buf);
+    if(_read_region(pipe, piece, ovoid)) return 0;
+    dt_mipmap_cache_get(&buf, pipe->imgid, pipe->size, DT_MIPMAP_BLOCKING, 'r');
+  }
 
   // Catch out-of-bounds here because roi_in -> roi_out conversions
   // use float scaling that may not always respect initial size.
@@ -164,7 +198,28 @@ int process_cl(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, con
   const dt_iop_roi_t *const roi_out = &piece->roi_out;
   dt_mipmap_buffer_t buf;
 
-  dt_mipmap_cache_get(&buf, pipe->imgid, pipe->size, DT_MIPMAP_BLOCKING, 'r');
+  dt_mipmap_cache_get(&buf, pipe->imgid, pipe->size, DT_MIPMAP_TESTLOCK, 'r');
+  if(IS_NULL_PTR(buf.buf))
+  {
+    dt_mipmap_cache_release(&buf);
+
+    // stage the region on the host, then upload it like the mipmap crop below
+    const size_t out_stride = (size_t)roi_out->width * piece->dsc_out.bpp;
+    void *region_buf = dt_alloc_align(out_stride * roi_out->height);
+    if(region_buf && _read_region(pipe, piece, region_buf))
+    {
+      size_t origin[] = { 0, 0, 0 };
+      size_t region[] = { MIN((size_t)roi_out->width, pipe->iwidth - MAX(roi_out->x, 0)),
+                          MIN((size_t)roi_out->height, pipe->iheight - MAX(roi_out->y, 0)), 1 };
+      const int err = dt_opencl_write_host_to_device_raw(pipe->devid, region_buf, dev_out, origin, region,
+                                                         out_stride, CL_TRUE);
+      dt_free_align(region_buf);
+      return err == CL_SUCCESS;
+    }
+    dt_free_align(region_buf);
+
+    dt_mipmap_cache_get(&buf, pipe->imgid, pipe->size, DT_MIPMAP_BLOCKING, 'r');
+  }
 
   // Catch out-of-bounds here because roi_in -> roi_out conversions
   // use float scaling that may not always respect initial size.
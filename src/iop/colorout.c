@@ -397,6 +397,7 @@ void commit_params(struct dt_iop_module_t *self, dt_iop_params_t *p1, dt_dev_pix
   d->type = p->type;
 
   const int force_lcms2 = dt_conf_get_bool("plugins/lighttable/export/force_lcms2");
+  const int bake_lcms2 = dt_conf_get_bool("plugins/lighttable/export/bake_lcms2");
 
   dt_colorspaces_color_profile_type_t out_type = DT_COLORSPACE_SRGB;
   gchar *out_filename = NULL;
@@ -560,6 +561,7 @@ void commit_params(struct dt_iop_module_t *self, dt_iop_params_t *p1, dt_dev_pix
    * form of a condition the module had to remember to write. */
   dt_colorspaces_conversion_flags_t flags = DT_CONVERSION_TARGET_CURVES;
   if(force_lcms2) flags |= DT_CONVERSION_FORCE_LCMS2;
+  if(bake_lcms2) flags |= DT_CONVERSION_BAKE_LUT;
   if(d->mode == DT_PROFILE_GAMUTCHECK) flags |= DT_CONVERSION_GAMUTCHECK;
 
   dt_colorspaces_conversion_t *conversion
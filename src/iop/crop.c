@@ -424,6 +424,17 @@ int process(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const
   return 0;
 }
 
+gboolean distort_process_points(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe,
+                                const dt_dev_pixelpipe_iop_t *piece, float *points, size_t points_count)
+{
+  (void)self;
+  (void)pipe;
+  (void)points;
+  (void)points_count;
+  // process() only ever copies the buffer as a whole: the crop itself is in the ROI offsets
+  return piece->roi_in.width == piece->roi_out.width && piece->roi_in.height == piece->roi_out.height;
+}
+
 #ifdef HAVE_OPENCL
 int process_cl(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_pixelpipe_iop_t *piece, cl_mem dev_in, cl_mem dev_out)
 {
@@ -39,12 +39,18 @@
 #include "system/macros.h"
 #include "system/mem_alloc.h"
 #include "common/module_versioning.h"
+#include "common/conf.h"
+#include "common/imagebuf.h"
 #include "common/logging.h"
 #include "system/openmp.h"
 #include "system/simd.h"
 #include "system/target_clones.h"
 #include "caches/pixelpipe_cache_alloc.h"
 #include "pixel/dwt.h"
+#include "pixel/wavelet_pyramid.h"
+#include "caches/pixelpipe_cache.h"
+#include "common/hash.h"
+#include "develop/dev_pixelpipe.h"
 #include "develop/iop_profile.h"
 #include "common/opencl.h"
 #include "develop/develop.h"
@@ -128,16 +134,36 @@ typedef struct dt_iop_diffuse_global_data_t
 } dt_iop_diffuse_global_data_t;
 
 
-// only copy params struct to avoid a commit_params()
-typedef struct dt_iop_diffuse_params_t dt_iop_diffuse_data_t;
+typedef struct dt_iop_diffuse_data_t
+{
+  dt_iop_diffuse_params_t params;
+  // Stop iterating once an iteration changes the image by less than this fraction of its L1 norm.
+  // 0 runs every iteration the user asked for. Read from the preferences, so it is not history,
+  // but it changes pixels: it lives here to be part of the cache key (see runtime_data_hash()).
+  float convergence;
+} dt_iop_diffuse_data_t;
 
 void commit_params(struct dt_iop_module_t *self, dt_iop_params_t *params,
                   dt_dev_pixelpipe_t *pipe, dt_dev_pixelpipe_iop_t *piece)
 {
-  memcpy(piece->data, params, self->params_size);
+  dt_iop_diffuse_data_t *d = (dt_iop_diffuse_data_t *)piece->data;
+  memcpy(&d->params, params, sizeof(dt_iop_diffuse_params_t));
+  d->convergence = fmaxf(dt_conf_get_float("plugins/darkroom/diffuse/convergence"), 0.f);
   piece->cache_output_on_ram = TRUE;
 }
 
+void init_pipe(struct dt_iop_module_t *self, dt_dev_pixelpipe_t *pipe, dt_dev_pixelpipe_iop_t *piece)
+{
+  piece->data = dt_calloc_align(sizeof(dt_iop_diffuse_data_t));
+  piece->data_size = sizeof(dt_iop_diffuse_data_t);
+}
+
+gboolean runtime_data_hash(struct dt_iop_module_t *self, dt_dev_pixelpipe_t *pipe,
+                           const dt_dev_pixelpipe_iop_t *piece)
+{
+  return TRUE;
+}
+
 
 typedef enum dt_isotropy_t
 {
@@ -585,7 +611,7 @@ void init_presets(dt_iop_module_so_t *self)
 void tiling_callback(struct dt_iop_module_t *self, const struct dt_dev_pixelpipe_t *pipe, const struct dt_dev_pixelpipe_iop_t *piece, struct dt_develop_tiling_t *tiling)
 {
   const dt_iop_roi_t *const roi_in = &piece->roi_in;
-  dt_iop_diffuse_data_t *data = (dt_iop_diffuse_data_t *)piece->data;
+  const dt_iop_diffuse_params_t *data = &((dt_iop_diffuse_data_t *)piece->data)->params;
 
   const float zoom = dt_dev_get_module_scale(pipe, roi_in);
   const float final_radius = (data->radius + data->radius_center) * 2.f / zoom;
@@ -977,9 +1003,10 @@ static void dump_PFM(const char *filename, const float* out, const uint32_t w, c
 __DT_CLONE_TARGETS__
 static inline int wavelets_process(const float *const restrict in, float *const restrict reconstructed,
                                    const uint8_t *const restrict mask, const size_t width,
-                                   const size_t height, const dt_iop_diffuse_data_t *const data,
+                                   const size_t height, const dt_iop_diffuse_params_t *const data,
                                    const float zoom, const int scales,
                                    const int has_mask,
+                                   const dt_wavelet_pyramid_t *const pyramid,
                                    float *const restrict HF[MAX_NUM_SCALES],
                                    float *const restrict LF_odd,
                                    float *const restrict LF_even)
@@ -999,55 +1026,78 @@ static inline int wavelets_process(const float *const restrict in, float *const
   const float regularization = powf(10.f, data->regularization) - 1.f;
   const float variance_threshold = powf(10.f, data->variance_threshold);
 
-  // À trous decimated wavelet decompose
-  // there is a paper from a guy we know that explains it : https://jo.dreggn.org/home/2010_atrous.pdf
-  // the wavelets decomposition here is the same as the equalizer/atrous module,
-  float *restrict residual; // will store the temp buffer containing the last step of blur
-  // allocate a one-row temporary buffer for the decomposition
-  size_t padded_size;
-  float *const tempbuf = dt_pixelpipe_cache_alloc_perthread_float(4 * width, &padded_size); //TODO: alloc in caller
-  if(IS_NULL_PTR(tempbuf)) return 1;
+  // the bands read by the synthesis, and its three low-frequency buffers: the first input, read
+  // once, and two it ping-pongs between. The first input is only ever read, so it can be a shared
+  // cached residual; the ping-pong pair must be ours.
+  const float *restrict bands[MAX_NUM_SCALES] = { NULL };
+  const float *restrict residual; // the last step of blur
+  float *restrict ping;
+  float *restrict pong;
 
-  for(int s = 0; s < scales; ++s)
+  if(pyramid)
   {
-    const int mult = 1 << s;
+    // the decomposition of this very input was handed to us, possibly straight out of the cache
+    for(int s = 0; s < scales; ++s) bands[s] = pyramid->HF[s];
+    residual = pyramid->residual;
+    ping = LF_odd;
+    pong = LF_even;
+  }
+  else
+  {
+    // À trous decimated wavelet decompose
+    // there is a paper from a guy we know that explains it : https://jo.dreggn.org/home/2010_atrous.pdf
+    // the wavelets decomposition here is the same as the equalizer/atrous module,
+    float *restrict last_blur = NULL;
+    // allocate a one-row temporary buffer for the decomposition
+    size_t padded_size;
+    float *const tempbuf = dt_pixelpipe_cache_alloc_perthread_float(4 * width, &padded_size); //TODO: alloc in caller
+    if(IS_NULL_PTR(tempbuf)) return 1;
+
+    for(int s = 0; s < scales; ++s)
+    {
+      const int mult = 1 << s;
 
-    const float *restrict buffer_in;
-    float *restrict buffer_out;
+      const float *restrict buffer_in;
+      float *restrict buffer_out;
 
-    if(s == 0)
-    {
-      buffer_in = in;
-      buffer_out = LF_odd;
-    }
-    else if(s % 2 != 0)
-    {
-      buffer_in = LF_odd;
-      buffer_out = LF_even;
-    }
-    else
-    {
-      buffer_in = LF_even;
-      buffer_out = LF_odd;
-    }
+      if(s == 0)
+      {
+        buffer_in = in;
+        buffer_out = LF_odd;
+      }
+      else if(s % 2 != 0)
+      {
+        buffer_in = LF_odd;
+        buffer_out = LF_even;
+      }
+      else
+      {
+        buffer_in = LF_even;
+        buffer_out = LF_odd;
+      }
 
-    decompose_2D_Bspline(buffer_in, HF[s], buffer_out, width, height, mult, tempbuf, padded_size);
+      decompose_2D_Bspline(buffer_in, HF[s], buffer_out, width, height, mult, tempbuf, padded_size);
+      bands[s] = HF[s];
 
-    residual = buffer_out;
+      last_blur = buffer_out;
 
 #if DEBUG_DUMP_PFM
-    char name[64];
-    sprintf(name, "/tmp/scale-input-%i.pfm", s);
-    dump_PFM(name, buffer_in, width, height);
+      char name[64];
+      sprintf(name, "/tmp/scale-input-%i.pfm", s);
+      dump_PFM(name, buffer_in, width, height);
 
-    sprintf(name, "/tmp/scale-blur-%i.pfm", s);
-    dump_PFM(name, buffer_out, width, height);
+      sprintf(name, "/tmp/scale-blur-%i.pfm", s);
+      dump_PFM(name, buffer_out, width, height);
 #endif
+    }
+    dt_pixelpipe_cache_free_align(tempbuf);
+
+    residual = last_blur;
+    // the buffer NOT containing the last step of blur first, then the residual's own, once read
+    ping = (last_blur == LF_even) ? LF_odd : LF_even;
+    pong = last_blur;
   }
-  dt_pixelpipe_cache_free_align(tempbuf);
 
-  // will store the temp buffer NOT containing the last step of blur
-  float *restrict temp = (residual == LF_even) ? LF_odd : LF_even;
   int count = 0;
 
   for(int s = scales - 1; s > -1; --s)
@@ -1079,22 +1129,22 @@ static inline int wavelets_process(const float *const restrict in, float *const
     if(count == 0)
     {
       buffer_in = residual;
-      buffer_out = temp;
+      buffer_out = ping;
     }
     else if(count % 2 != 0)
     {
-      buffer_in = temp;
-      buffer_out = residual;
+      buffer_in = ping;
+      buffer_out = pong;
     }
     else
     {
-      buffer_in = residual;
-      buffer_out = temp;
+      buffer_in = pong;
+      buffer_out = ping;
     }
 
     if(s == 0) buffer_out = reconstructed;
 
-    heat_PDE_diffusion(HF[s], buffer_in, mask, has_mask, buffer_out, width, height,
+    heat_PDE_diffusion(bands[s], buffer_in, mask, has_mask, buffer_out, width, height,
                        anisotropy, isotropy_type, variance_threshold, mult,
                        normalized_regularization, ABCD, strength, (s == 0));
 
@@ -1105,6 +1155,25 @@ static inline int wavelets_process(const float *const restrict in, float *const
 }
 
 
+// L1 norm of the change made by one iteration, relative to the L1 norm of its input, over RGB
+__DT_CLONE_TARGETS__
+static inline float relative_update_norm(const float *const restrict before, const float *const restrict after,
+                                         const size_t width, const size_t height)
+{
+  double diff = 0.;
+  double norm = 0.;
+  __OMP_PARALLEL_FOR__(reduction(+ : diff, norm))
+  for(size_t k = 0; k < height * width * 4; k += 4)
+  {
+    for(size_t c = 0; c < 3; c++)
+    {
+      diff += fabsf(after[k + c] - before[k + c]);
+      norm += fabsf(before[k + c]);
+    }
+  }
+  return (norm > 0.) ? (float)(diff / norm) : 0.f;
+}
+
 __DT_CLONE_TARGETS__
 static inline void build_mask(const float *const restrict input, uint8_t *const restrict mask,
                               const float threshold, const size_t width, const size_t height)
@@ -1157,7 +1226,8 @@ int process(dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_
 {
   const dt_iop_roi_t *const roi_in = &piece->roi_in;
   const dt_iop_roi_t *const roi_out = &piece->roi_out;
-  const dt_iop_diffuse_data_t *const data = (dt_iop_diffuse_data_t *)piece->data;
+  const dt_iop_diffuse_data_t *const d = (dt_iop_diffuse_data_t *)piece->data;
+  const dt_iop_diffuse_params_t *const data = &d->params;
 
   float *restrict in = DT_IS_ALIGNED((float *const restrict)ivoid);
   float *const restrict out = DT_IS_ALIGNED((float *const restrict)ovoid);
@@ -1217,6 +1287,20 @@ int process(dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_
     in = temp1;
   }
 
+  // The first iteration decomposes the module input, which does not change while the user tweaks
+  // this module: in darkroom, keep that pyramid in the pipeline cache and reuse it on the next run.
+  // Export and thumbnail pipes run once, and a tile's buffer is not identified by the upstream
+  // hash, so they build it privately.
+  uint64_t input_hash = DT_PIXELPIPE_CACHE_HASH_INVALID;
+  const dt_dev_pixelpipe_iop_t *const prev_piece = dt_dev_pixelpipe_get_prev_enabled_piece(pipe, piece);
+  if(self->dev->gui_attached && !pipe->tiling && prev_piece
+     && prev_piece->global_hash != DT_PIXELPIPE_CACHE_HASH_INVALID)
+  {
+    input_hash = dt_hash(prev_piece->global_hash, (const char *)roi_in, sizeof(dt_iop_roi_t));
+    // the inpainted input depends on the threshold too
+    if(has_mask) input_hash = dt_hash(input_hash, (const char *)&data->threshold, sizeof(data->threshold));
+  }
+
   for(int it = 0; it < iterations; it++)
   {
     if(it == 0)
@@ -1238,12 +1322,34 @@ int process(dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_
     if(it == (int)iterations - 1)
       temp_out = out;
 
-    if(wavelets_process(temp_in, temp_out, mask, roi_out->width, roi_out->height,
-                        data, zoom, scales, has_mask, HF, LF_odd, LF_even))
+    dt_wavelet_pyramid_t pyramid = { 0 };
+    const gboolean use_pyramid = (it == 0 && input_hash != DT_PIXELPIPE_CACHE_HASH_INVALID);
+    if(use_pyramid
+       && dt_wavelet_pyramid_acquire(&pyramid, temp_in, roi_out->width, roi_out->height, scales,
+                                     DT_WAVELET_FILTER_BSPLINE, input_hash, pipe->type))
+    {
+      err = 1;
+      goto error;
+    }
+
+    const int wavelet_err = wavelets_process(temp_in, temp_out, mask, roi_out->width, roi_out->height, data, zoom,
+                                             scales, has_mask, use_pyramid ? &pyramid : NULL, HF, LF_odd, LF_even);
+    if(use_pyramid) dt_wavelet_pyramid_release(&pyramid);
+    if(wavelet_err)
     {
       err = 1;
       goto error;
     }
+
+    // early exit: once an iteration barely moves the image, the remaining ones will not either.
+    // The last iteration already wrote into `out`, so only the earlier ones are worth testing.
+    if(d->convergence > 0.f && temp_out != out
+       && relative_update_norm(temp_in, temp_out, roi_out->width, roi_out->height) < d->convergence)
+    {
+      dt_print(DT_DEBUG_PERF, "[diffuse] converged after %i of %i iterations\n", it + 1, iterations);
+      dt_iop_image_copy_by_size(out, temp_out, roi_out->width, roi_out->height, 4);
+      break;
+    }
   }
 
 error:
@@ -1260,7 +1366,7 @@ error:
 #if HAVE_OPENCL
 static inline cl_int wavelets_process_cl(const int devid, cl_mem in, cl_mem reconstructed, cl_mem mask,
                                          const size_t sizes[3], const int width, const int height,
-                                         const dt_iop_diffuse_data_t *const data,
+                                         const dt_iop_diffuse_params_t *const data,
                                          dt_iop_diffuse_global_data_t *const gd,
                                          const float zoom, const int scales,
                                          const int has_mask,
@@ -1487,7 +1593,10 @@ int process_cl(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, con
 {
   const dt_iop_roi_t *const roi_in = &piece->roi_in;
   const dt_iop_roi_t *const roi_out = &piece->roi_out;
-  const dt_iop_diffuse_data_t *const data = (dt_iop_diffuse_data_t *)piece->data;
+  // the OpenCL path runs every requested iteration: the convergence test needs a full-frame
+  // reduction read back to the host per iteration, which costs more than it would save here.
+  // With a tolerance above 0, CPU and GPU stop after different counts: see doc/diffuse-convergence.md
+  const dt_iop_diffuse_params_t *const data = &((dt_iop_diffuse_data_t *)piece->data)->params;
   dt_iop_diffuse_global_data_t *const gd = (dt_iop_diffuse_global_data_t *)self->global_data;
 
   int out_of_memory = FALSE;
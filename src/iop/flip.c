@@ -383,6 +383,28 @@ void modify_roi_in(struct dt_iop_module_t *self, const struct dt_dev_pixelpipe_t
   roi_in->height = CLAMP(roi_in->height, 1, (int)ceilf(h) - roi_in->y);
 }
 
+/* roi_out buffer position -> the roi_in buffer position dt_imageio_flip_buffers() copies it from */
+gboolean distort_process_points(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe,
+                                const dt_dev_pixelpipe_iop_t *piece, float *points, size_t points_count)
+{
+  (void)pipe;
+  const dt_iop_flip_data_t *d = (dt_iop_flip_data_t *)piece->data;
+  const dt_image_orientation_t orientation = d->orientation;
+  const float wd = piece->roi_in.width;
+  const float ht = piece->roi_in.height;
+
+  __OMP_PARALLEL_FOR__()
+  for(size_t k = 0; k < points_count; k++)
+  {
+    float *const p = points + 2 * k;
+    const float x = (orientation & ORIENTATION_SWAP_XY) ? p[1] : p[0];
+    const float y = (orientation & ORIENTATION_SWAP_XY) ? p[0] : p[1];
+    p[0] = (orientation & ORIENTATION_FLIP_X) ? wd - 1.f - x : x;
+    p[1] = (orientation & ORIENTATION_FLIP_Y) ? ht - 1.f - y : y;
+  }
+  return TRUE;
+}
+
 // 3rd (final) pass: you get this input region (may be different from what was requested above),
 // do your best to fill the output region!
 int process(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_pixelpipe_iop_t *piece, const void *const ivoid,
@@ -78,9 +78,9 @@ typedef void dt_iop_params_t;
 
 /** this initializes static, hardcoded presets for this module and is called only once per run of dt. */
 OPTIONAL(void, init_presets, struct dt_iop_module_so_t *self);
-/** called once per module, at startup. */
+/** called once per module, on first use from any thread (see dt_iop_module_global_data()). */
 OPTIONAL(void, init_global, struct dt_iop_module_so_t *self);
-/** called once per module, at shutdown. */
+/** called once per module, at shutdown, only if init_global() ran. */
 OPTIONAL(void, cleanup_global, struct dt_iop_module_so_t *self);
 
 /** get name of the module, to be translated. */
@@ -311,6 +311,18 @@ OPTIONAL(void, distort_mask, struct dt_iop_module_t *self, const struct dt_dev_p
                              struct dt_dev_pixelpipe_iop_t *piece, const float *const in, float *const out,
                              const struct dt_iop_roi_t *const roi_in, const struct dt_iop_roi_t *const roi_out);
 
+/** process()'s own sampling positions, for develop/pixelpipe_fuse.c.
+ * points is an array of float {x1,y1,x2,y2,...}: pixel positions in the piece->roi_out buffer,
+ * replaced in place by the positions of the piece->roi_in buffer that process() interpolates
+ * them from. Entries may be NaN (already known to sample nothing): leave them NaN.
+ * Called with points_count == 0 to ask whether process() is a pure resample right now, i.e.
+ * whether the pipe may fold this piece with its geometric neighbours into one interpolation.
+ * Return FALSE whenever process() does anything else to the pixels (colour, per-channel
+ * shifts, GUI side effects). */
+OPTIONAL(gboolean, distort_process_points, struct dt_iop_module_t *self, const struct dt_dev_pixelpipe_t *pipe,
+                                           const struct dt_dev_pixelpipe_iop_t *piece, float *points,
+                                           size_t points_count);
+
 // introspection related callbacks, will be auto-implemented if DT_MODULE_INTROSPECTION() is used,
 OPTIONAL(int, introspection_init, struct dt_iop_module_so_t *self, int api_version);
 DEFAULT(dt_introspection_t *, get_introspection, void);
@@ -73,8 +73,11 @@
 #include "system/mem_alloc.h"
 #include "system/openmp.h"
 #include "system/target_clones.h"
+#include "caches/pixelpipe_cache.h"
 #include "caches/pixelpipe_cache_alloc.h"
+#include "common/hash.h"
 #include "glib.h"
+#include <glib/gstdio.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -88,6 +91,7 @@
 #include "develop/imageop.h"
 #include "develop/imageop_gui.h"
 #include "develop/tiling.h"
+#include "gui/application.h"
 
 #include "iop/iop_api.h"
 #include <assert.h>
@@ -198,26 +202,384 @@ typedef struct dt_iop_lensfun_global_data_t
  * It is not left to chance either: init_global() starts _lensfun_db_warm() to build it on a
  * background thread, so the work overlaps the rest of startup and is normally finished before
  * any image asks. Whoever gets there first builds it and the other waits -- there is one lock
- * and one construction either way.
+ * and one construction either way. Headless runs with a valid memo file skip the pre-warm: the
+ * questions earlier runs asked are answered without it, see _lensfun_memo_file_open().
  *
  * _lensfun_db_lock covers the construction only, and is never held while the plugin mutex
  * is taken, so the two cannot deadlock against each other. db_tried makes a failed load
  * final: retrying it per lookup would turn a broken installation into a slow one. */
 static GMutex _lensfun_db_lock;
 
-/* Resolved (maker, model) -> lfCamera and (camera, lens name) -> lfLens.
+/* Resolved (maker, model) -> lfCamera and (camera, lens name) -> lfLens list.
  *
  * FindCamerasExt() is a fuzzy scan over every camera in the database and costs 0.35-0.42 ms;
  * FindLenses() costs 0.06 ms when it hits and 0.84 ms when it misses, because a miss scans
  * the lot. commit_params() resolves both on every pipe resync, for every pipe, and it asks
  * the same question every time -- the camera and lens of an image do not change while it is
- * open. The answers are pointers INTO the database, which is built once and never reloaded,
- * so they stay valid for the process's life.
+ * open. The answers are pointers INTO the database, or into one of the memo file's small ones (see
+ * below), which are built once and never reloaded, so they stay valid for the process's life.
  *
- * Guarded by the plugin mutex, which the lookups already took. */
+ * Guarded by the plugin mutex, which the lookups take themselves. */
 static GHashTable *_lensfun_camera_memo = NULL;
 static GHashTable *_lensfun_lens_memo = NULL;
 
+/* The memos die with the process, so every ansel-cli run still parsed the whole database to
+ * answer the one or two questions its images ask -- usually the very questions the previous run
+ * asked. The memo file keeps those answers in the user cache directory, keyed like the memos.
+ * It is not an index of the database: a camera or lens no earlier run asked about still builds
+ * the full database, and a remembered answer is still XML that lensfun parses.
+ *
+ * An answer is what lfDatabase::Save() writes for just the objects that answered, plus the
+ * camera's mount so lens compatibility still resolves: lensfun's own XML, a few KB. A lookup
+ * loads it into a small lfDatabase of its own and replays the question against it, which ranks
+ * the same objects the same way the full database did. Keeping lensfun's format rather than
+ * a layout of ours means calibration data survives whatever lensfun version is installed; the
+ * small databases live as long as the memos pointing into them. A miss is stored as an empty
+ * answer.
+ *
+ * The file is mapped and only trusted if its header matches: format, lensfun version, and a
+ * stamp of every lensfun XML file _lensfun_db_create() may load (path, size, mtime), so any
+ * database update starts it over -- including lensfun-update-data run as root, which writes to
+ * lensfun's system updates directory. What the full database had to answer is added at exit, by
+ * cleanup_global(), replacing the file atomically. The answers asked most recently go first,
+ * and only the first LENSFUN_MEMO_MAX_RECORDS are kept, so the file cannot keep growing.
+ *
+ * On disk, in native byte order -- it never leaves the machine:
+ *   "DTLFMEM\0", uint32 format, uint32 LF_VERSION, uint64 stamp, uint32 record count,
+ *   then per record: uint32 key size, key and its NUL, uint32 XML size, XML.
+ *
+ * Guarded by the plugin mutex, like the memos. */
+#define LENSFUN_MEMO_FORMAT 1
+#define LENSFUN_MEMO_HEADER (8 + 4 + 4 + 8 + 4)
+#define LENSFUN_MEMO_MAX_RECORDS 1024
+static const char _lensfun_memo_file_magic[8] = { 'D', 'T', 'L', 'F', 'M', 'E', 'M', '\0' };
+
+typedef struct dt_iop_lensfun_memo_file_t
+{
+  gboolean opened;     // tried once, whatever came of it
+  uint64_t stamp;      // of the XML files now on disk
+  GMappedFile *file;   // NULL if missing or stale
+  GHashTable *records; // key, in the file -> its answer, in the file
+  GPtrArray *keys;     // the file's keys, in file order
+  GHashTable *asked;   // the file's keys this process looked up
+  GHashTable *fresh;   // key -> XML answered by the full database, to add at exit
+  GPtrArray *dbs;      // the lfDatabase each answer read from the file was loaded into
+} dt_iop_lensfun_memo_file_t;
+
+static dt_iop_lensfun_memo_file_t _lensfun_memo_file = { 0 };
+
+static uint32_t _lensfun_memo_file_u32(const char *p)
+{
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static void _lensfun_memo_file_put_u32(GByteArray *out, const uint32_t value)
+{
+  g_byte_array_append(out, (const guint8 *)&value, sizeof(value));
+}
+
+static gchar *_lensfun_memo_file_path(void)
+{
+  char cachedir[PATH_MAX] = { 0 };
+  dt_loc_get_user_cache_dir(cachedir, sizeof(cachedir));
+  return g_build_filename(cachedir, "lensfun.memo", (char *)NULL);
+}
+
+// every *.xml and timestamp.txt under dir, as "path size mtime", down to depth levels of subdirectories
+static void _lensfun_memo_file_scan(GPtrArray *files, const char *dir, const int depth)
+{
+  GDir *handle = g_dir_open(dir, 0, NULL);
+  if(IS_NULL_PTR(handle)) return;
+
+  const gchar *name;
+  while((name = g_dir_read_name(handle)))
+  {
+    gchar *path = g_build_filename(dir, name, (char *)NULL);
+    GStatBuf st;
+    if(g_stat(path, &st) == 0)
+    {
+      if(S_ISDIR(st.st_mode))
+      {
+        if(depth > 0) _lensfun_memo_file_scan(files, path, depth - 1);
+      }
+      else if(g_str_has_suffix(name, ".xml") || !strcmp(name, "timestamp.txt"))
+        g_ptr_array_add(files, g_strdup_printf("%s %" G_GINT64_FORMAT " %" G_GINT64_FORMAT, path,
+                                               (gint64)st.st_size, (gint64)st.st_mtime));
+    }
+    dt_free(path);
+  }
+  g_dir_close(handle);
+}
+
+static gint _lensfun_memo_file_path_cmp(gconstpointer a, gconstpointer b)
+{
+  return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+static void _lensfun_memo_file_scan_location(GPtrArray *files, const char *dir)
+{
+  if(!IS_NULL_PTR(dir) && *dir) _lensfun_memo_file_scan(files, dir, 3);
+}
+
+/** @brief Hash of the lensfun XML files: wherever lensfun looks, and where _lensfun_db_create() does. */
+static uint64_t _lensfun_memo_file_stamp(void)
+{
+  GPtrArray *files = g_ptr_array_new_with_free_func(dt_free_gpointer);
+
+  // lensfun's own locations, as Load() reads them. An lfDatabase that loaded nothing knows them.
+  lfDatabase *db = new lfDatabase;
+#if LF_VERSION >= ((0 << 24) | (3 << 16) | (0 << 8) | 0)
+  _lensfun_memo_file_scan_location(files, db->UserLocation);
+  _lensfun_memo_file_scan_location(files, db->UserUpdatesLocation);
+  _lensfun_memo_file_scan_location(files, db->SystemLocation);
+  _lensfun_memo_file_scan_location(files, db->SystemUpdatesLocation);
+#else
+  _lensfun_memo_file_scan_location(files, db->HomeDataDir);
+#endif
+  delete db;
+
+  // and the XDG data dirs, where a distribution may put it
+  gchar *dir = g_build_filename(g_get_user_data_dir(), "lensfun", (char *)NULL);
+  _lensfun_memo_file_scan(files, dir, 3);
+  dt_free(dir);
+
+  for(const gchar *const *system = g_get_system_data_dirs(); *system; system++)
+  {
+    dir = g_build_filename(*system, "lensfun", (char *)NULL);
+    _lensfun_memo_file_scan(files, dir, 3);
+    dt_free(dir);
+  }
+
+  // the copy bundled next to our own data
+  char datadir[PATH_MAX] = { 0 };
+  dt_loc_get_datadir(datadir, sizeof(datadir));
+  GFile *file = g_file_parse_name(datadir);
+  GFile *parent = g_file_get_parent(file);
+  gchar *path = parent ? g_file_get_path(parent) : NULL;
+  if(parent) g_object_unref(parent);
+  g_object_unref(file);
+  if(path)
+  {
+    dir = g_build_filename(path, "lensfun", (char *)NULL);
+    _lensfun_memo_file_scan(files, dir, 3);
+    dt_free(dir);
+    dt_free(path);
+  }
+
+  // directory order is the filesystem's business, and the locations may overlap
+  g_ptr_array_sort(files, _lensfun_memo_file_path_cmp);
+  uint64_t stamp = 5381;
+  for(guint k = 0; k < files->len; k++)
+  {
+    const char *entry = (const char *)g_ptr_array_index(files, k);
+    if(k > 0 && !strcmp(entry, (const char *)g_ptr_array_index(files, k - 1))) continue;
+    stamp = dt_hash(stamp, entry, strlen(entry) + 1);
+  }
+  g_ptr_array_free(files, TRUE);
+  return stamp;
+}
+
+static void _lensfun_memo_file_drop_file(void)
+{
+  if(!IS_NULL_PTR(_lensfun_memo_file.records)) g_hash_table_destroy(_lensfun_memo_file.records);
+  _lensfun_memo_file.records = NULL;
+  if(!IS_NULL_PTR(_lensfun_memo_file.keys)) g_ptr_array_free(_lensfun_memo_file.keys, TRUE);
+  _lensfun_memo_file.keys = NULL;
+  if(!IS_NULL_PTR(_lensfun_memo_file.asked)) g_hash_table_destroy(_lensfun_memo_file.asked);
+  _lensfun_memo_file.asked = NULL;
+  if(!IS_NULL_PTR(_lensfun_memo_file.file)) g_mapped_file_unref(_lensfun_memo_file.file);
+  _lensfun_memo_file.file = NULL;
+}
+
+/**
+ * @brief Map the memo file, on first call.
+ * @details Under the plugin mutex. A missing, stale or damaged file is simply not used: it is
+ * rewritten at exit from what this process had to look up.
+ * @return TRUE if there is a memo file to ask.
+ */
+static gboolean _lensfun_memo_file_open(void)
+{
+  dt_iop_lensfun_memo_file_t *memo = &_lensfun_memo_file;
+  if(memo->opened) return !IS_NULL_PTR(memo->records);
+  memo->opened = TRUE;
+
+  memo->stamp = _lensfun_memo_file_stamp();
+  memo->fresh = g_hash_table_new_full(g_str_hash, g_str_equal, dt_free_gpointer, dt_free_gpointer);
+  memo->dbs = g_ptr_array_new();
+
+  gchar *path = _lensfun_memo_file_path();
+  memo->file = g_mapped_file_new(path, FALSE, NULL);
+  dt_free(path);
+  if(IS_NULL_PTR(memo->file)) return FALSE;
+
+  const size_t length = g_mapped_file_get_length(memo->file);
+  const char *data = g_mapped_file_get_contents(memo->file);
+  uint64_t stamp = 0;
+  if(length >= LENSFUN_MEMO_HEADER) memcpy(&stamp, data + 16, sizeof(stamp));
+  if(length < LENSFUN_MEMO_HEADER || memcmp(data, _lensfun_memo_file_magic, sizeof(_lensfun_memo_file_magic))
+     || _lensfun_memo_file_u32(data + 8) != LENSFUN_MEMO_FORMAT
+     || _lensfun_memo_file_u32(data + 12) != (uint32_t)LF_VERSION || stamp != memo->stamp)
+  {
+    _lensfun_memo_file_drop_file();
+    return FALSE;
+  }
+
+  const char *end = data + length;
+  const char *p = data + LENSFUN_MEMO_HEADER;
+  const uint32_t count = _lensfun_memo_file_u32(data + 24);
+  memo->records = g_hash_table_new(g_str_hash, g_str_equal);
+  memo->keys = g_ptr_array_new();
+  memo->asked = g_hash_table_new(g_direct_hash, g_direct_equal);
+  for(uint32_t r = 0; r < count; r++)
+  {
+    // every size is checked against the end before it is trusted: a truncated file is no memo
+    if(end - p < 4) break;
+    const uint32_t key_size = _lensfun_memo_file_u32(p);
+    p += 4;
+    if(key_size == 0 || (size_t)(end - p) < key_size || p[key_size - 1] != '\0') break;
+    const char *key = p;
+    p += key_size;
+    if(end - p < 4) break;
+    const uint32_t xml_size = _lensfun_memo_file_u32(p);
+    if((size_t)(end - p - 4) < xml_size) break;
+    g_hash_table_insert(memo->records, (gpointer)key, (gpointer)p);
+    g_ptr_array_add(memo->keys, (gpointer)key);
+    p += 4 + xml_size;
+  }
+  if(g_hash_table_size(memo->records) != count) _lensfun_memo_file_drop_file();
+
+  return !IS_NULL_PTR(memo->records);
+}
+
+/**
+ * @brief The database the memo file holds to answer key.
+ * @details Under the plugin mutex.
+ * @return FALSE if the memo file has no usable answer. Otherwise *db is the small database to ask
+ * the question again, or NULL if the answer was that nothing matches.
+ */
+static gboolean _lensfun_memo_file_db(const char *key, lfDatabase **db)
+{
+  *db = NULL;
+  if(!_lensfun_memo_file_open()) return FALSE;
+
+  gpointer file_key = NULL, value = NULL;
+  if(!g_hash_table_lookup_extended(_lensfun_memo_file.records, key, &file_key, &value)) return FALSE;
+  g_hash_table_add(_lensfun_memo_file.asked, file_key);
+  const char *record = (const char *)value;
+
+  const uint32_t size = _lensfun_memo_file_u32(record);
+  if(size == 0) return TRUE;
+
+  lfDatabase *answer = new lfDatabase;
+  if(answer->Load("lensfun memo", record + 4, size) != LF_NO_ERROR)
+  {
+    delete answer;
+    return FALSE;
+  }
+  g_ptr_array_add(_lensfun_memo_file.dbs, answer);
+  *db = answer;
+  return TRUE;
+}
+
+/**
+ * @brief Keep what the full database answered to key, for the memo file written at exit.
+ * @details Under the plugin mutex. @p camera also brings its mount along, which FindLenses()
+ * needs to match lenses on compatible mounts.
+ */
+static void _lensfun_memo_file_remember(const char *key, lfDatabase *db, const lfCamera *camera,
+                                    const lfLens *const *lenses)
+{
+  if(IS_NULL_PTR(_lensfun_memo_file.fresh)) return;
+
+  gchar *xml = NULL;
+  if(!IS_NULL_PTR(camera) || !IS_NULL_PTR(lenses))
+  {
+    const lfMount *mounts[] = { (camera && camera->Mount) ? db->FindMount(camera->Mount) : NULL, NULL };
+    const lfCamera *cameras[] = { camera, NULL };
+    char *saved = lfDatabase::Save(mounts[0] ? mounts : NULL, camera ? cameras : NULL, lenses);
+    // nothing to write: the next run asks the database again, as this one did
+    if(IS_NULL_PTR(saved)) return;
+    xml = g_strdup(saved);
+    lf_free(saved);
+  }
+  g_hash_table_replace(_lensfun_memo_file.fresh, g_strdup(key), xml ? xml : g_strdup(""));
+}
+
+/** @brief Rewrite the memo file if this process had to ask the database anything. */
+static void _lensfun_memo_file_write(void)
+{
+  dt_iop_lensfun_memo_file_t *memo = &_lensfun_memo_file;
+  if(IS_NULL_PTR(memo->fresh) || g_hash_table_size(memo->fresh) == 0) return;
+
+  GByteArray *out = g_byte_array_new();
+  g_byte_array_append(out, (const guint8 *)_lensfun_memo_file_magic, sizeof(_lensfun_memo_file_magic));
+  _lensfun_memo_file_put_u32(out, LENSFUN_MEMO_FORMAT);
+  _lensfun_memo_file_put_u32(out, (uint32_t)LF_VERSION);
+  g_byte_array_append(out, (const guint8 *)&memo->stamp, sizeof(memo->stamp));
+  _lensfun_memo_file_put_u32(out, 0); // record count, patched below
+
+  uint32_t count = 0;
+  GHashTableIter iter;
+  gpointer key, value;
+
+  // what this process had to ask the database first, then what it asked the file, then the rest of
+  // the file, so the oldest answers are the ones past the cap
+  g_hash_table_iter_init(&iter, memo->fresh);
+  while(g_hash_table_iter_next(&iter, &key, &value) && count < LENSFUN_MEMO_MAX_RECORDS)
+  {
+    const uint32_t key_size = strlen((const char *)key) + 1;
+    const uint32_t xml_size = strlen((const char *)value);
+    _lensfun_memo_file_put_u32(out, key_size);
+    g_byte_array_append(out, (const guint8 *)key, key_size);
+    _lensfun_memo_file_put_u32(out, xml_size);
+    g_byte_array_append(out, (const guint8 *)value, xml_size);
+    count++;
+  }
+
+  for(int asked = 1; asked >= 0 && !IS_NULL_PTR(memo->keys); asked--)
+    for(guint k = 0; k < memo->keys->len && count < LENSFUN_MEMO_MAX_RECORDS; k++)
+    {
+      const char *file_key = (const char *)g_ptr_array_index(memo->keys, k);
+      if(g_hash_table_contains(memo->asked, file_key) != asked || g_hash_table_contains(memo->fresh, file_key))
+        continue;
+      const char *record = (const char *)g_hash_table_lookup(memo->records, file_key);
+      const uint32_t key_size = strlen(file_key) + 1;
+      _lensfun_memo_file_put_u32(out, key_size);
+      g_byte_array_append(out, (const guint8 *)file_key, key_size);
+      g_byte_array_append(out, (const guint8 *)record, 4 + _lensfun_memo_file_u32(record));
+      count++;
+    }
+  memcpy(out->data + LENSFUN_MEMO_HEADER - 4, &count, sizeof(count));
+
+  // atomic: another process mapping the old file keeps reading the old file
+  gchar *path = _lensfun_memo_file_path();
+  GError *error = NULL;
+  if(!g_file_set_contents(path, (const gchar *)out->data, out->len, &error))
+  {
+    dt_print(DT_DEBUG_ALWAYS, "[iop_lens] could not write the lensfun memo `%s': %s\n", path,
+             error->message);
+    g_error_free(error);
+  }
+  dt_free(path);
+  g_byte_array_free(out, TRUE);
+}
+
+/** @brief Write the memo file back and free it. After the memos, which point into its databases. */
+static void _lensfun_memo_file_close(void)
+{
+  _lensfun_memo_file_write();
+  _lensfun_memo_file_drop_file();
+  if(!IS_NULL_PTR(_lensfun_memo_file.fresh)) g_hash_table_destroy(_lensfun_memo_file.fresh);
+  if(!IS_NULL_PTR(_lensfun_memo_file.dbs))
+  {
+    for(guint k = 0; k < _lensfun_memo_file.dbs->len; k++) delete (lfDatabase *)g_ptr_array_index(_lensfun_memo_file.dbs, k);
+    g_ptr_array_free(_lensfun_memo_file.dbs, TRUE);
+  }
+  memset(&_lensfun_memo_file, 0, sizeof(_lensfun_memo_file));
+}
+
 /** @brief Build the database. Call once, under _lensfun_db_lock. */
 static lfDatabase *_lensfun_db_create(void);
 static lfDatabase *_lensfun_db(dt_iop_lensfun_global_data_t *gd);
@@ -257,64 +619,125 @@ static lfDatabase *_lensfun_db(dt_iop_lensfun_global_data_t *gd)
   return db;
 }
 
+/** @brief _lensfun_db() for a caller holding the plugin mutex, which the construction must not see held. */
+static lfDatabase *_lensfun_db_locked(dt_iop_lensfun_global_data_t *gd)
+{
+  dt_pthread_mutex_unlock(dt_plugin_threadsafe_mutex());
+  lfDatabase *db = _lensfun_db(gd);
+  dt_pthread_mutex_lock(dt_plugin_threadsafe_mutex());
+  return db;
+}
+
 /**
- * @brief Memoised lfDatabase::FindCamerasExt().
- * @details Caller must hold the plugin mutex. The returned camera belongs to the database.
+ * @brief Memoised lfDatabase::FindCamerasExt(): the best match, or NULL.
+ * @details Takes the plugin mutex, so the caller must not hold it. The memo answers first, then
+ * the memo file, and only then the full database, built for it if need be. The camera stays valid
+ * until cleanup_global().
  */
-static const lfCamera *_lensfun_find_camera(lfDatabase *db, const char *maker, const char *model)
+static const lfCamera *_lensfun_find_camera(dt_iop_lensfun_global_data_t *gd, const char *maker,
+                                            const char *model)
 {
-  if(IS_NULL_PTR(db) || IS_NULL_PTR(model) || !model[0]) return NULL;
+  if(IS_NULL_PTR(gd) || IS_NULL_PTR(model) || !model[0]) return NULL;
 
-  gchar *key = g_strdup_printf("%s\x1f%s", maker ? maker : "", model);
+  gchar *key = g_strdup_printf("camera\x1f%s\x1f%s", maker ? maker : "", model);
+  const lfCamera *camera = NULL;
 
+  dt_pthread_mutex_lock(dt_plugin_threadsafe_mutex());
   if(IS_NULL_PTR(_lensfun_camera_memo))
     _lensfun_camera_memo = g_hash_table_new_full(g_str_hash, g_str_equal, dt_free_gpointer, NULL);
 
   gpointer found = NULL;
   if(g_hash_table_lookup_extended(_lensfun_camera_memo, key, NULL, &found))
   {
+    camera = (const lfCamera *)found;
     dt_free(key);
-    return (const lfCamera *)found;
   }
+  else
+  {
+    lfDatabase *db = NULL;
+    const gboolean remembered = _lensfun_memo_file_db(key, &db);
+    if(!remembered) db = _lensfun_db_locked(gd);
 
-  const lfCamera **cameras = db->FindCamerasExt(maker, model, 0);
-  const lfCamera *camera = (!IS_NULL_PTR(cameras)) ? cameras[0] : NULL;
-  if(!IS_NULL_PTR(cameras)) lf_free(cameras);
-
-  // A miss is cached too: it costs a full scan to establish, and it will not change.
-  g_hash_table_insert(_lensfun_camera_memo, key, (gpointer)camera);
+    if(!remembered && IS_NULL_PTR(db))
+      dt_free(key); // no database at all: nothing worth remembering
+    else
+    {
+      const lfCamera **cameras = (!IS_NULL_PTR(db)) ? db->FindCamerasExt(maker, model, 0) : NULL;
+      camera = (!IS_NULL_PTR(cameras)) ? cameras[0] : NULL;
+      if(!remembered) _lensfun_memo_file_remember(key, db, camera, NULL);
+      if(!IS_NULL_PTR(cameras)) lf_free(cameras);
+
+      // A miss is cached too: it costs a full scan to establish, and it will not change.
+      // Another thread may have got there while the database was built; either answer is good.
+      g_hash_table_insert(_lensfun_camera_memo, key, (gpointer)camera);
+    }
+  }
+  dt_pthread_mutex_unlock(dt_plugin_threadsafe_mutex());
 
   return camera;
 }
 
 /**
- * @brief Memoised lfDatabase::FindLenses().
- * @details Caller must hold the plugin mutex. The returned lens belongs to the database.
+ * @brief Memoised lfDatabase::FindLenses(camera, NULL, lens_name): the matches, best first,
+ * NULL-terminated, or NULL.
+ * @details Same rules as _lensfun_find_camera(). An empty name is a question too: it lists the
+ * lenses the camera takes, which is how reload_defaults() finds a fixed lens. The list belongs
+ * to the memo.
  */
-static const lfLens *_lensfun_find_lens(lfDatabase *db, const lfCamera *camera, const char *lens_name)
+static const lfLens *const *_lensfun_find_lenses(dt_iop_lensfun_global_data_t *gd,
+                                                 const lfCamera *camera, const char *lens_name)
 {
-  if(IS_NULL_PTR(db) || IS_NULL_PTR(lens_name) || !lens_name[0]) return NULL;
+  if(IS_NULL_PTR(gd) || IS_NULL_PTR(lens_name)) return NULL;
 
-  gchar *key = g_strdup_printf("%s\x1f%s", (!IS_NULL_PTR(camera) && camera->Model) ? camera->Model : "",
-                               lens_name);
+  gchar *key = g_strdup_printf("lens\x1f%s\x1f%s\x1f%s",
+                               (!IS_NULL_PTR(camera) && camera->Maker) ? camera->Maker : "",
+                               (!IS_NULL_PTR(camera) && camera->Model) ? camera->Model : "", lens_name);
+  const lfLens **lenses = NULL;
 
+  dt_pthread_mutex_lock(dt_plugin_threadsafe_mutex());
   if(IS_NULL_PTR(_lensfun_lens_memo))
-    _lensfun_lens_memo = g_hash_table_new_full(g_str_hash, g_str_equal, dt_free_gpointer, NULL);
+    _lensfun_lens_memo = g_hash_table_new_full(g_str_hash, g_str_equal, dt_free_gpointer, lf_free);
 
   gpointer found = NULL;
   if(g_hash_table_lookup_extended(_lensfun_lens_memo, key, NULL, &found))
   {
+    lenses = (const lfLens **)found;
     dt_free(key);
-    return (const lfLens *)found;
   }
+  else
+  {
+    lfDatabase *db = NULL;
+    const gboolean remembered = _lensfun_memo_file_db(key, &db);
+    if(!remembered) db = _lensfun_db_locked(gd);
 
-  const lfLens **lenses = db->FindLenses(camera, NULL, lens_name, 0);
-  const lfLens *lens = (!IS_NULL_PTR(lenses)) ? lenses[0] : NULL;
-  if(!IS_NULL_PTR(lenses)) lf_free(lenses);
+    if(!remembered && IS_NULL_PTR(db))
+      dt_free(key);
+    else if(g_hash_table_lookup_extended(_lensfun_lens_memo, key, NULL, &found))
+    {
+      // answered by another thread while the database was built: a list may already be out there
+      lenses = (const lfLens **)found;
+      dt_free(key);
+    }
+    else
+    {
+      lenses = (!IS_NULL_PTR(db)) ? db->FindLenses(camera, NULL, lens_name, 0) : NULL;
+      if(!remembered) _lensfun_memo_file_remember(key, db, camera, lenses);
+      g_hash_table_insert(_lensfun_lens_memo, key, (gpointer)lenses);
+    }
+  }
+  dt_pthread_mutex_unlock(dt_plugin_threadsafe_mutex());
+
+  return lenses;
+}
 
-  g_hash_table_insert(_lensfun_lens_memo, key, (gpointer)lens);
+/** @brief The best of _lensfun_find_lenses(), for a lens that has a name. */
+static const lfLens *_lensfun_find_lens(dt_iop_lensfun_global_data_t *gd, const lfCamera *camera,
+                                        const char *lens_name)
+{
+  if(IS_NULL_PTR(lens_name) || !lens_name[0]) return NULL;
 
-  return lens;
+  const lfLens *const *lenses = _lensfun_find_lenses(gd, camera, lens_name);
+  return (!IS_NULL_PTR(lenses)) ? lenses[0] : NULL;
 }
 
 typedef struct dt_iop_lensfun_data_t
@@ -331,6 +754,8 @@ typedef struct dt_iop_lensfun_data_t
   gboolean do_nan_checks;
   gboolean tca_override;
   lfLensCalibTCA custom_tca;
+  uint64_t geometry_hash; // everything the coordinate map depends on but the ROI, see _lens_map_acquire()
+  int modflags;           // what lensfun actually applies of modify_flags, for distort_process_points()
 } dt_iop_lensfun_data_t;
 
 
@@ -572,6 +997,300 @@ static inline void _lens_fill_vignette_row(float *const buf, const int width, co
   }
 }
 
+/* --- cached coordinate maps ------------------------------------------------------------
+ *
+ * ApplySubpixelGeometryDistortion() costs 278 ms of lensfun maths per full frame (see
+ * doc/lensfun-cost.md), and what it returns depends on the lens, its settings and the ROI --
+ * never on the pixels. So it is evaluated on a coarse grid, one node every LENS_MAP_STEP
+ * output pixels, published in the pixelpipe cache under a key made of exactly those inputs,
+ * and interpolated bilinearly per pixel. The next run with the same lens and ROI -- the next
+ * slider move in darkroom, or the next frame of the same shoot in a batch export -- only
+ * resamples. At full resolution the map weighs 1/48 of an RGBA output.
+ *
+ * Lens distortion is smooth, so the interpolation error is far below anything the resampling
+ * kernel can resolve. That is checked, not assumed: lensfun is also asked for every cell
+ * centre, where the bilinear error peaks, and if any deviates by more than LENS_MAP_TOLERANCE
+ * pixel the map is flagged `exact` and the rows are computed by lensfun as before. Maps are not
+ * built at all when lensfun can return NaN (do_nan_checks): a blend of one NaN node would
+ * blank a whole cell.
+ */
+#define LENS_MAP_STEP 8
+#define LENS_MAP_TOLERANCE 0.05f
+#define LENS_MAP_HEADER 64 // bytes, keeps the nodes aligned
+
+typedef struct dt_iop_lens_map_t
+{
+  int step;
+  int grid_w;      // nodes per row, the last one at or past the right edge of the ROI
+  int grid_h;      // rows of nodes, the last one at or past the bottom edge of the ROI
+  gboolean exact;  // the grid is too coarse for this lens: ask lensfun for every pixel
+  // followed, at LENS_MAP_HEADER, by grid_w x grid_h nodes of { xR, yR, xG, yG, xB, yB, 0, 0 }
+} dt_iop_lens_map_t;
+
+static inline float *_lens_map_nodes(const dt_iop_lens_map_t *const map)
+{
+  return (float *)((char *)map + LENS_MAP_HEADER);
+}
+
+__DT_CLONE_TARGETS__
+static void _lens_map_build(dt_iop_lens_map_t *map, const lfModifier *modifier, const dt_iop_roi_t *const roi_out)
+{
+  const int step = map->step;
+  const int grid_w = map->grid_w;
+  const int grid_h = map->grid_h;
+  float *const nodes = _lens_map_nodes(map);
+
+  __OMP_PARALLEL_FOR_CPP__(firstprivate(nodes, modifier, roi_out, step, grid_w, grid_h))
+  for(int j = 0; j < grid_h; j++)
+    for(int i = 0; i < grid_w; i++)
+    {
+      float *const node = nodes + (size_t)8 * ((size_t)j * grid_w + i);
+      modifier->ApplySubpixelGeometryDistortion(roi_out->x + i * step, roi_out->y + j * step, 1, 1, node);
+      node[6] = node[7] = 0.f;
+    }
+
+  float error = 0.f;
+  __OMP_PARALLEL_FOR_CPP__(firstprivate(nodes, modifier, roi_out, step, grid_w, grid_h) reduction(max : error))
+  for(int j = 0; j < grid_h - 1; j++)
+    for(int i = 0; i < grid_w - 1; i++)
+    {
+      const float *const n00 = nodes + (size_t)8 * ((size_t)j * grid_w + i);
+      const float *const n10 = n00 + 8;
+      const float *const n01 = n00 + (size_t)8 * grid_w;
+      const float *const n11 = n01 + 8;
+      float exact[6];
+      modifier->ApplySubpixelGeometryDistortion(roi_out->x + i * step + step / 2,
+                                                roi_out->y + j * step + step / 2, 1, 1, exact);
+      for(int c = 0; c < 6; c++)
+      {
+        const float deviation = fabsf(0.25f * (n00[c] + n10[c] + n01[c] + n11[c]) - exact[c]);
+        error = fmaxf(error, isfinite(deviation) ? deviation : INFINITY);
+      }
+    }
+
+  map->exact = !(error <= LENS_MAP_TOLERANCE);
+}
+
+/**
+ * @brief Get the coordinate map of @p roi_out, building it only if no identical one is cached.
+ *
+ * @return the map, read-locked until _lens_map_release(@p entry), or NULL if none can be used:
+ * the caller then asks lensfun row by row.
+ */
+static const dt_iop_lens_map_t *_lens_map_acquire(const dt_iop_lensfun_data_t *const d, const lfModifier *modifier,
+                                                  const int modflags, const float orig_w, const float orig_h,
+                                                  const dt_iop_roi_t *const roi_out, const int id,
+                                                  dt_pixel_cache_entry_t **entry)
+{
+  *entry = NULL;
+  if(d->do_nan_checks) return NULL;
+
+  const int step = LENS_MAP_STEP;
+  const int grid_w = (roi_out->width - 1) / step + 2;
+  const int grid_h = (roi_out->height - 1) / step + 2;
+  const int geometry_flags = modflags & (LF_MODIFY_TCA | LF_MODIFY_DISTORTION | LF_MODIFY_GEOMETRY | LF_MODIFY_SCALE);
+  const int roi[4] = { roi_out->x, roi_out->y, roi_out->width, roi_out->height };
+
+  uint64_t hash = d->geometry_hash;
+  hash = dt_hash(hash, (const char *)&geometry_flags, sizeof(geometry_flags));
+  hash = dt_hash(hash, (const char *)&orig_w, sizeof(orig_w));
+  hash = dt_hash(hash, (const char *)&orig_h, sizeof(orig_h));
+  hash = dt_hash(hash, (const char *)roi, sizeof(roi));
+  hash = dt_hash(hash, (const char *)&step, sizeof(step));
+
+  const size_t size = LENS_MAP_HEADER + (size_t)grid_w * grid_h * 8 * sizeof(float);
+  void *data = NULL;
+  const int created = dt_dev_pixelpipe_cache_get(hash, size, "lens distortion map", id, TRUE, &data, entry);
+  if(IS_NULL_PTR(data) || IS_NULL_PTR(*entry))
+  {
+    if(*entry)
+    {
+      if(created) dt_dev_pixelpipe_cache_wrlock_entry(FALSE, *entry);
+      dt_dev_pixelpipe_cache_ref_count_entry(FALSE, *entry);
+    }
+    *entry = NULL;
+    return NULL;
+  }
+
+  dt_iop_lens_map_t *map = (dt_iop_lens_map_t *)data;
+  if(created)
+  {
+    map->step = step;
+    map->grid_w = grid_w;
+    map->grid_h = grid_h;
+    _lens_map_build(map, modifier, roi_out);
+    dt_dev_pixelpipe_cache_wrlock_entry(FALSE, *entry);
+  }
+
+  // hold a read lock while the caller reads the nodes: no one may rekey or overwrite them
+  dt_dev_pixelpipe_cache_rdlock_entry(TRUE, *entry);
+  return map;
+}
+
+static void _lens_map_release(dt_pixel_cache_entry_t *entry)
+{
+  if(IS_NULL_PTR(entry)) return;
+  dt_dev_pixelpipe_cache_rdlock_entry(FALSE, entry);
+  dt_dev_pixelpipe_cache_ref_count_entry(FALSE, entry);
+}
+
+/**
+ * @brief Distorted input coordinates of output row @p y, laid out as lensfun does: 6 floats
+ * per pixel, x and y for red, green and blue.
+ */
+__DT_CLONE_TARGETS__
+static inline void _lens_map_row(const dt_iop_lens_map_t *const map, const lfModifier *modifier,
+                                 const dt_iop_roi_t *const roi_out, const int y, float *const coords)
+{
+  if(IS_NULL_PTR(map) || map->exact)
+  {
+    modifier->ApplySubpixelGeometryDistortion(roi_out->x, roi_out->y + y, roi_out->width, 1, coords);
+    return;
+  }
+
+  const int step = map->step;
+  const int j = y / step;
+  const dt_aligned_pixel_simd_t fy = dt_simd_set1((float)(y - j * step) / (float)step);
+  const float *const row0 = _lens_map_nodes(map) + (size_t)8 * j * map->grid_w;
+  const float *const row1 = row0 + (size_t)8 * map->grid_w;
+
+  for(int x = 0; x < roi_out->width; x++)
+  {
+    const int i = x / step;
+    const dt_aligned_pixel_simd_t fx = dt_simd_set1((float)(x - i * step) / (float)step);
+    const float *const n00 = row0 + (size_t)8 * i;
+    const float *const n01 = row1 + (size_t)8 * i;
+
+    // red and green in the first vector, blue and padding in the second
+    dt_aligned_pixel_simd_t v[2];
+    for(int k = 0; k < 2; k++)
+    {
+      const dt_aligned_pixel_simd_t a = dt_load_simd_aligned(n00 + 4 * k);
+      const dt_aligned_pixel_simd_t b = dt_load_simd_aligned(n00 + 8 + 4 * k);
+      const dt_aligned_pixel_simd_t c = dt_load_simd_aligned(n01 + 4 * k);
+      const dt_aligned_pixel_simd_t e = dt_load_simd_aligned(n01 + 8 + 4 * k);
+      const dt_aligned_pixel_simd_t top = a + fx * (b - a);
+      const dt_aligned_pixel_simd_t bottom = c + fx * (e - c);
+      v[k] = top + fy * (bottom - top);
+    }
+
+    float *const out = coords + (size_t)6 * x;
+    dt_store_simd(out, v[0]);
+    out[4] = v[1][0];
+    out[5] = v[1][1];
+  }
+}
+
+/**
+ * @brief Distorted input coordinates of one output position (@p x, @p y), anywhere in the ROI,
+ * interpolated from the same nodes as _lens_map_row().
+ */
+static inline void _lens_map_point(const dt_iop_lens_map_t *const map, const lfModifier *modifier,
+                                   const dt_iop_roi_t *const roi_out, float x, float y, float coords[6])
+{
+  x = CLAMP(x, 0.f, roi_out->width - 1.f);
+  y = CLAMP(y, 0.f, roi_out->height - 1.f);
+
+  if(IS_NULL_PTR(map) || map->exact)
+  {
+    modifier->ApplySubpixelGeometryDistortion(roi_out->x + x, roi_out->y + y, 1, 1, coords);
+    return;
+  }
+
+  const int step = map->step;
+  const int i = (int)x / step;
+  const int j = (int)y / step;
+  const float fx = (x - i * step) / (float)step;
+  const float fy = (y - j * step) / (float)step;
+  const float *const n00 = _lens_map_nodes(map) + (size_t)8 * ((size_t)j * map->grid_w + i);
+  const float *const n01 = n00 + (size_t)8 * map->grid_w;
+  for(int c = 0; c < 6; c++)
+  {
+    const float top = n00[c] + fx * (n00[8 + c] - n00[c]);
+    const float bottom = n01[c] + fx * (n01[8 + c] - n01[c]);
+    coords[c] = top + fy * (bottom - top);
+  }
+}
+
+/**
+ * @brief Resample output row @p out from @p in at the @p coords of _lens_map_row().
+ *
+ * When every channel shares the green coordinates (no TCA correction) the 4 channels are
+ * interpolated in one go, sharing the kernel weights, instead of one sample per channel.
+ */
+__DT_CLONE_TARGETS__
+static inline void _lens_remap_row(const float *const in, float *out, const float *coords,
+                                   const dt_iop_roi_t *const roi_in, const int width, const int ch,
+                                   const struct dt_interpolation *const interpolation,
+                                   const gboolean do_nan_checks, const gboolean shared_coords,
+                                   const gboolean raw_monochrome, const int mask_display)
+{
+  const int ch_width = ch * roi_in->width;
+
+  if(shared_coords && ch == DT_PIXEL_SIMD_CHANNELS)
+  {
+    for(int x = 0; x < width; x++, coords += 6, out += ch)
+    {
+      dt_aligned_pixel_simd_t pixel = { 0.f };
+      if(!do_nan_checks || (isfinite(coords[2]) && isfinite(coords[3])))
+      {
+        const float pi0 = fmaxf(fminf(coords[2] - roi_in->x, roi_in->width - 1.0f), 0.0f);
+        const float pi1 = fmaxf(fminf(coords[3] - roi_in->y, roi_in->height - 1.0f), 0.0f);
+        dt_interpolation_compute_pixel4c(interpolation, in, (float *)&pixel, pi0, pi1, roi_in->width,
+                                         roi_in->height, ch_width);
+        if(raw_monochrome) pixel[0] = pixel[2] = pixel[1];
+      }
+      dt_store_simd_aligned(out, pixel);
+    }
+    return;
+  }
+
+  for(int x = 0; x < width; x++, coords += 6, out += ch)
+  {
+    dt_aligned_pixel_simd_t pixel = { 0.f };
+    for(int c = 0; c < 3; c++)
+    {
+      if(do_nan_checks && (!isfinite(coords[c * 2]) || !isfinite(coords[c * 2 + 1])))
+      {
+        pixel[c] = 0.0f;
+        continue;
+      }
+
+      const float *const inptr = in + (size_t)c;
+      const float pi0 = fmaxf(fminf(coords[c * 2] - roi_in->x, roi_in->width - 1.0f), 0.0f);
+      const float pi1 = fmaxf(fminf(coords[c * 2 + 1] - roi_in->y, roi_in->height - 1.0f), 0.0f);
+      pixel[c] = dt_interpolation_compute_sample(interpolation, inptr, pi0, pi1, roi_in->width,
+                                                 roi_in->height, ch, ch_width);
+    }
+
+    if(raw_monochrome) pixel[0] = pixel[2] = pixel[1];
+
+    if(mask_display & DT_DEV_PIXELPIPE_DISPLAY_MASK)
+    {
+      if(do_nan_checks && (!isfinite(coords[2]) || !isfinite(coords[3])))
+      {
+        pixel[3] = 0.0f;
+      }
+      else
+      {
+        // take green channel distortion also for alpha channel
+        const float *const inptr = in + (size_t)3;
+        const float pi0 = fmaxf(fminf(coords[2] - roi_in->x, roi_in->width - 1.0f), 0.0f);
+        const float pi1 = fmaxf(fminf(coords[3] - roi_in->y, roi_in->height - 1.0f), 0.0f);
+        pixel[3] = dt_interpolation_compute_sample(interpolation, inptr, pi0, pi1, roi_in->width,
+                                                   roi_in->height, ch, ch_width);
+      }
+
+      if(ch == DT_PIXEL_SIMD_CHANNELS) dt_store_simd_aligned(out, pixel);
+      else for(int c = 0; c < ch; c++) out[c] = pixel[c];
+    }
+    else
+    {
+      for(int c = 0; c < 3; c++) out[c] = pixel[c];
+    }
+  }
+}
+
 /* Why do we care about being a monochrome image or not?
  The lensfun library does not have an algorithm for distortion or tca correction specialized for monochrome images,
    the builtin correction works with subtle differences for the color channels leading to some colorizing of the images.
@@ -583,6 +1302,7 @@ static inline void _lens_fill_vignette_row(float *const buf, const int width, co
    As green / Y channel is the most centric i took that as the canonical value instead of taking the mean.
 */
 
+
 __DT_CLONE_TARGETS__
 int process(dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_pixelpipe_iop_t *piece,
             const void *const ivoid, void *const ovoid)
@@ -593,7 +1313,6 @@ int process(dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_
   dt_iop_lensfun_gui_data_t *g = (dt_iop_lensfun_gui_data_t *)dt_iop_gui_data(self);
 
   const int ch = piece->dsc_in.channels;
-  const int ch_width = ch * roi_in->width;
   const int mask_display = pipe->mask_display;
 
   const unsigned int pixelformat = ch == 3 ? LF_CR_3(RED, GREEN, BLUE) : LF_CR_4(RED, GREEN, BLUE, UNKNOWN);
@@ -616,75 +1335,43 @@ int process(dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_
 
   dt_pthread_mutex_unlock(dt_plugin_threadsafe_mutex());
 
+  const gboolean distort = (modflags & (LF_MODIFY_TCA | LF_MODIFY_DISTORTION | LF_MODIFY_GEOMETRY | LF_MODIFY_SCALE)) != 0;
+  const gboolean shared_coords = !(modflags & LF_MODIFY_TCA);
+  const gboolean do_nan_checks = d->do_nan_checks;
+  dt_pixel_cache_entry_t *map_entry = NULL;
+  const dt_iop_lens_map_t *const map
+      = distort ? _lens_map_acquire(d, modifier, modflags, orig_w, orig_h, roi_out, pipe->type, &map_entry) : NULL;
+
   const struct dt_interpolation *const interpolation = dt_interpolation_new(DT_INTERPOLATION_USERPREF_WARP);
 
   if(d->inverse)
   {
     // reverse direction (useful for renderings)
-    if(modflags & (LF_MODIFY_TCA | LF_MODIFY_DISTORTION | LF_MODIFY_GEOMETRY | LF_MODIFY_SCALE))
+    if(distort)
     {
       // acquire temp memory for distorted pixel coords
       const size_t bufsize = (size_t)roi_out->width * 2 * 3;
 
       size_t padded_bufsize;
       float *const buf = dt_pixelpipe_cache_alloc_perthread_float(bufsize, &padded_bufsize);
-      if(IS_NULL_PTR(buf)) return 1;
+      if(IS_NULL_PTR(buf))
+      {
+        _lens_map_release(map_entry);
+        delete modifier;
+        return 1;
+      }
 
-#ifdef _OPENMP
-#pragma omp parallel for default(none)  \
-  firstprivate(roi_out, roi_in, padded_bufsize, modifier, ch, d, buf, ovoid, ivoid, ch_width, interpolation, raw_monochrome, mask_display)
-#endif
+      __OMP_PARALLEL_FOR_CPP__(firstprivate(roi_out, roi_in, padded_bufsize, modifier, map, ch, buf, ovoid, ivoid, \
+                                            interpolation, do_nan_checks, shared_coords, raw_monochrome, mask_display))
       for(int y = 0; y < roi_out->height; y++)
       {
         float *bufptr = (float*)dt_get_perthread(buf, padded_bufsize);
-        modifier->ApplySubpixelGeometryDistortion(roi_out->x, roi_out->y + y, roi_out->width, 1, bufptr);
+        _lens_map_row(map, modifier, roi_out, y, bufptr);
 
         // reverse transform the global coords from lf to our buffer
         float *out = ((float *)ovoid) + (size_t)y * roi_out->width * ch;
-        for(int x = 0; x < roi_out->width; x++, bufptr += 6, out += ch)
-        {
-          dt_aligned_pixel_simd_t pixel = { 0.f };
-          for(int c = 0; c < 3; c++)
-          {
-            if(d->do_nan_checks && (!isfinite(bufptr[c * 2]) || !isfinite(bufptr[c * 2 + 1])))
-            {
-              pixel[c] = 0.0f;
-              continue;
-            }
-
-            const float *const inptr = (const float *const)ivoid + (size_t)c;
-            const float pi0 = fmaxf(fminf(bufptr[c * 2] - roi_in->x, roi_in->width - 1.0f), 0.0f);
-            const float pi1 = fmaxf(fminf(bufptr[c * 2 + 1] - roi_in->y, roi_in->height - 1.0f), 0.0f);
-            pixel[c] = dt_interpolation_compute_sample(interpolation, inptr, pi0, pi1, roi_in->width,
-                                                       roi_in->height, ch, ch_width);
-          }
-
-          if(raw_monochrome) pixel[0] = pixel[2] = pixel[1];
-
-          if(mask_display & DT_DEV_PIXELPIPE_DISPLAY_MASK)
-          {
-            if(d->do_nan_checks && (!isfinite(bufptr[2]) || !isfinite(bufptr[3])))
-            {
-              pixel[3] = 0.0f;
-            }
-            else
-            {
-              // take green channel distortion also for alpha channel
-              const float *const inptr = (const float *const)ivoid + (size_t)3;
-              const float pi0 = fmaxf(fminf(bufptr[2] - roi_in->x, roi_in->width - 1.0f), 0.0f);
-              const float pi1 = fmaxf(fminf(bufptr[3] - roi_in->y, roi_in->height - 1.0f), 0.0f);
-              pixel[3] = dt_interpolation_compute_sample(interpolation, inptr, pi0, pi1, roi_in->width,
-                                                         roi_in->height, ch, ch_width);
-            }
-
-            if(ch == DT_PIXEL_SIMD_CHANNELS) dt_store_simd_aligned(out, pixel);
-            else for(int c = 0; c < ch; c++) out[c] = pixel[c];
-          }
-          else
-          {
-            for(int c = 0; c < 3; c++) out[c] = pixel[c];
-          }
-        }
+        _lens_remap_row((const float *)ivoid, out, bufptr, roi_in, roi_out->width, ch, interpolation,
+                        do_nan_checks, shared_coords, raw_monochrome, mask_display);
       }
       dt_pixelpipe_cache_free_align(buf);
     }
@@ -714,7 +1401,12 @@ int process(dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_
     void *buf = dt_pixelpipe_cache_alloc_align_cache(
         bufsize,
         pipe->type);
-    if(IS_NULL_PTR(buf)) return 1;
+    if(IS_NULL_PTR(buf))
+    {
+      _lens_map_release(map_entry);
+      delete modifier;
+      return 1;
+    }
     memcpy(buf, ivoid, bufsize);
 
     if(modflags & LF_MODIFY_VIGNETTING)
@@ -731,7 +1423,7 @@ int process(dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_
       
     }
 
-    if(modflags & (LF_MODIFY_TCA | LF_MODIFY_DISTORTION | LF_MODIFY_GEOMETRY | LF_MODIFY_SCALE))
+    if(distort)
     {
       // acquire temp memory for distorted pixel coords
       const size_t buf2size = (size_t)roi_out->width * 2 * 3;
@@ -740,62 +1432,22 @@ int process(dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_
       if(IS_NULL_PTR(buf2))
       {
         dt_pixelpipe_cache_free_align(buf);
+        _lens_map_release(map_entry);
+        delete modifier;
         return 1;
       }
 
-#ifdef _OPENMP
-#pragma omp parallel for default(none)  \
-  firstprivate(roi_out, roi_in, ovoid, ch, padded_buf2size, modifier, mask_display, raw_monochrome, interpolation, ch_width, buf, d, buf2)
-#endif
+      __OMP_PARALLEL_FOR_CPP__(firstprivate(roi_out, roi_in, ovoid, ch, padded_buf2size, modifier, map, mask_display, \
+                                            raw_monochrome, interpolation, buf, do_nan_checks, shared_coords, buf2))
       for(int y = 0; y < roi_out->height; y++)
       {
         float *buf2ptr = (float*)dt_get_perthread(buf2, padded_buf2size);
-        modifier->ApplySubpixelGeometryDistortion(roi_out->x, roi_out->y + y, roi_out->width,
-                                                  1, buf2ptr);
+        _lens_map_row(map, modifier, roi_out, y, buf2ptr);
+
         // reverse transform the global coords from lf to our buffer
         float *out = ((float *)ovoid) + (size_t)y * roi_out->width * ch;
-        for(int x = 0; x < roi_out->width; x++, buf2ptr += 6, out += ch)
-        {
-          dt_aligned_pixel_simd_t pixel = { 0.f };
-          for(int c = 0; c < 3; c++)
-          {
-            if(d->do_nan_checks && (!isfinite(buf2ptr[c * 2]) || !isfinite(buf2ptr[c * 2 + 1])))
-            {
-              pixel[c] = 0.0f;
-              continue;
-            }
-
-            float *bufptr = ((float *)buf) + c;
-            const float pi0 = fmaxf(fminf(buf2ptr[c * 2] - roi_in->x, roi_in->width - 1.0f), 0.0f);
-            const float pi1 = fmaxf(fminf(buf2ptr[c * 2 + 1] - roi_in->y, roi_in->height - 1.0f), 0.0f);
-            pixel[c] = dt_interpolation_compute_sample(interpolation, bufptr, pi0, pi1, roi_in->width,
-                                                       roi_in->height, ch, ch_width);
-          }
-          if(raw_monochrome) pixel[0] = pixel[2] = pixel[1];
-          if(mask_display & DT_DEV_PIXELPIPE_DISPLAY_MASK)
-          {
-            if(d->do_nan_checks && (!isfinite(buf2ptr[2]) || !isfinite(buf2ptr[3])))
-            {
-              pixel[3] = 0.0f;
-            }
-            else
-            {
-              // take green channel distortion also for alpha channel
-              float *bufptr = ((float *)buf) + 3;
-              const float pi0 = fmaxf(fminf(buf2ptr[2] - roi_in->x, roi_in->width - 1.0f), 0.0f);
-              const float pi1 = fmaxf(fminf(buf2ptr[3] - roi_in->y, roi_in->height - 1.0f), 0.0f);
-              pixel[3] = dt_interpolation_compute_sample(interpolation, bufptr, pi0, pi1, roi_in->width,
-                                                         roi_in->height, ch, ch_width);
-            }
-
-            if(ch == DT_PIXEL_SIMD_CHANNELS) dt_store_simd_aligned(out, pixel);
-            else for(int c = 0; c < ch; c++) out[c] = pixel[c];
-          }
-          else
-          {
-            for(int c = 0; c < 3; c++) out[c] = pixel[c];
-          }
-        }
+        _lens_remap_row((const float *)buf, out, buf2ptr, roi_in, roi_out->width, ch, interpolation,
+                        do_nan_checks, shared_coords, raw_monochrome, mask_display);
       }
       dt_pixelpipe_cache_free_align(buf2);
     }
@@ -805,6 +1457,7 @@ int process(dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_
     }
     dt_pixelpipe_cache_free_align(buf);
   }
+  _lens_map_release(map_entry);
   delete modifier;
 
   // The "corrections done" label only reports which corrections apply for the current camera/lens/
@@ -821,6 +1474,51 @@ int process(dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_
   return 0;
 }
 
+/* Only plain distortion is a pure resample: vignetting changes the colours, TCA gives every
+ * channel its own position and a monochrome raw gets its green copied over red and blue. */
+gboolean distort_process_points(dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe,
+                                const dt_dev_pixelpipe_iop_t *piece, float *points, size_t points_count)
+{
+  const dt_iop_roi_t *const roi_in = &piece->roi_in;
+  const dt_iop_roi_t *const roi_out = &piece->roi_out;
+  const dt_iop_lensfun_data_t *const d = (dt_iop_lensfun_data_t *)piece->data;
+
+  if(!d->lens || !d->lens->Maker || d->crop <= 0.0f) return TRUE;
+  if(d->do_nan_checks || dt_image_is_monochrome(&self->dev->image_storage)) return FALSE;
+
+  const gboolean pure = !(d->modflags & (LF_MODIFY_VIGNETTING | LF_MODIFY_TCA));
+  const gboolean distort = (d->modflags & (LF_MODIFY_DISTORTION | LF_MODIFY_GEOMETRY | LF_MODIFY_SCALE)) != 0;
+  if(!pure || !distort || points_count == 0) return pure;
+
+  const float orig_w = roi_in->scale * piece->buf_in.width, orig_h = roi_in->scale * piece->buf_in.height;
+
+  dt_pthread_mutex_lock(dt_plugin_threadsafe_mutex());
+  int modflags;
+  const lfModifier *modifier = get_modifier(&modflags, orig_w, orig_h, d, LF_MODIFY_ALL, FALSE);
+  dt_pthread_mutex_unlock(dt_plugin_threadsafe_mutex());
+
+  dt_pixel_cache_entry_t *map_entry = NULL;
+  const dt_iop_lens_map_t *const map
+      = _lens_map_acquire(d, modifier, modflags, orig_w, orig_h, roi_out, pipe->type, &map_entry);
+
+  __OMP_PARALLEL_FOR_CPP__(firstprivate(points, points_count, map, modifier, roi_in, roi_out))
+  for(size_t k = 0; k < points_count; k++)
+  {
+    float *const p = points + 2 * k;
+    if(isnan(p[0])) continue;
+
+    // same green coordinates and clamping as _lens_remap_row()
+    float coords[6];
+    _lens_map_point(map, modifier, roi_out, p[0], p[1], coords);
+    p[0] = fmaxf(fminf(coords[2] - roi_in->x, roi_in->width - 1.0f), 0.0f);
+    p[1] = fmaxf(fminf(coords[3] - roi_in->y, roi_in->height - 1.0f), 0.0f);
+  }
+
+  _lens_map_release(map_entry);
+  delete modifier;
+  return TRUE;
+}
+
 #ifdef HAVE_OPENCL
 int process_cl(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_pixelpipe_iop_t *piece, cl_mem dev_in, cl_mem dev_out)
 {
@@ -1347,8 +2045,7 @@ static const dt_iop_lensfun_params_t *_lens_effective_params(dt_iop_module_t *se
 static void _lens_build_data(dt_iop_module_t *self, const dt_iop_lensfun_params_t *const p,
                              dt_iop_lensfun_data_t *d)
 {
-  dt_iop_lensfun_global_data_t *gd = (dt_iop_lensfun_global_data_t *)self->global_data;
-  lfDatabase *dt_iop_lensfun_db = _lensfun_db(gd);
+  dt_iop_lensfun_global_data_t *gd = (dt_iop_lensfun_global_data_t *)dt_iop_module_global_data(self);
   const lfCamera *camera = NULL;
   if(d->lens)
   {
@@ -1357,18 +2054,14 @@ static void _lens_build_data(dt_iop_module_t *self, const dt_iop_lensfun_params_
   }
   d->lens = new lfLens;
 
-  if(p->camera[0] && !IS_NULL_PTR(dt_iop_lensfun_db))
+  if(p->camera[0])
   {
-    dt_pthread_mutex_lock(dt_plugin_threadsafe_mutex());
-    camera = _lensfun_find_camera(dt_iop_lensfun_db, NULL, p->camera);
-    dt_pthread_mutex_unlock(dt_plugin_threadsafe_mutex());
+    camera = _lensfun_find_camera(gd, NULL, p->camera);
     if(!IS_NULL_PTR(camera)) d->crop = camera->CropFactor;
   }
-  if(p->lens[0] && !IS_NULL_PTR(dt_iop_lensfun_db))
+  if(p->lens[0])
   {
-    dt_pthread_mutex_lock(dt_plugin_threadsafe_mutex());
-    const lfLens *lens = _lensfun_find_lens(dt_iop_lensfun_db, camera, p->lens);
-    dt_pthread_mutex_unlock(dt_plugin_threadsafe_mutex());
+    const lfLens *lens = _lensfun_find_lens(gd, camera, p->lens);
     if(!IS_NULL_PTR(lens))
     {
       *d->lens = *lens;
@@ -1426,6 +2119,40 @@ static void _lens_build_data(dt_iop_module_t *self, const dt_iop_lensfun_params_
   {
     d->do_nan_checks = FALSE;
   }
+
+  // Aperture and distance only drive vignetting: leaving them out lets every frame shot with
+  // this lens at this focal length share one coordinate map, whatever the exposure.
+  const int geometry_flags = d->modify_flags & (LF_MODIFY_TCA | LF_MODIFY_DISTORTION | LF_MODIFY_GEOMETRY | LF_MODIFY_SCALE);
+  uint64_t hash = 5381;
+  hash = dt_hash(hash, p->camera, strnlen(p->camera, sizeof(p->camera)));
+  hash = dt_hash(hash, p->lens, strnlen(p->lens, sizeof(p->lens)));
+  hash = dt_hash(hash, (const char *)&geometry_flags, sizeof(geometry_flags));
+  hash = dt_hash(hash, (const char *)&d->inverse, sizeof(d->inverse));
+  hash = dt_hash(hash, (const char *)&d->scale, sizeof(d->scale));
+  hash = dt_hash(hash, (const char *)&d->crop, sizeof(d->crop));
+  hash = dt_hash(hash, (const char *)&d->focal, sizeof(d->focal));
+  hash = dt_hash(hash, (const char *)&d->target_geom, sizeof(d->target_geom));
+  hash = dt_hash(hash, (const char *)&d->tca_override, sizeof(d->tca_override));
+  if(d->tca_override)
+  {
+    hash = dt_hash(hash, (const char *)&p->tca_r, sizeof(p->tca_r));
+    hash = dt_hash(hash, (const char *)&p->tca_b, sizeof(p->tca_b));
+#ifdef LF_0395
+    hash = dt_hash(hash, (const char *)&d->custom_tca.CalibAttr.AspectRatio,
+                   sizeof(d->custom_tca.CalibAttr.AspectRatio));
+#endif
+  }
+  d->geometry_hash = hash;
+
+  // the corrections this lens has data for: asked once here, not on every fusion query
+  d->modflags = 0;
+  if(d->lens->Maker && d->crop > 0.0f)
+  {
+    const dt_image_t *img = &(self->dev->image_storage);
+    dt_pthread_mutex_lock(dt_plugin_threadsafe_mutex());
+    delete get_modifier(&d->modflags, img->width, img->height, d, LF_MODIFY_ALL, FALSE);
+    dt_pthread_mutex_unlock(dt_plugin_threadsafe_mutex());
+  }
 }
 
 /** @brief The lensfun modify mask this image allows: monochrome sensors get no TCA correction. */
@@ -1575,7 +2302,14 @@ void init_global(dt_iop_module_so_t *module)
   gd->kernel_lens_vignette = dt_opencl_create_kernel(program, "lens_vignette");
 
   // The database is NOT built on this thread -- see _lensfun_db() and _lensfun_db_warm().
-  gd->db_warm = g_thread_new("lensfun-db", _lensfun_db_warm, gd);
+  // Without a GUI, nothing browses the database, and a valid memo file answers what earlier runs
+  // asked: a batch shot with the same gear never needs the parse, which would only be joined,
+  // unused, at exit. Anything new still builds the database on demand. The stamp is a few dozen stat().
+  dt_pthread_mutex_lock(dt_plugin_threadsafe_mutex());
+  const gboolean remembered = _lensfun_memo_file_open();
+  dt_pthread_mutex_unlock(dt_plugin_threadsafe_mutex());
+  if(!IS_NULL_PTR(dt_gui_get_global()) || !remembered)
+    gd->db_warm = g_thread_new("lensfun-db", _lensfun_db_warm, gd);
 }
 
 static lfDatabase *_lensfun_db_create(void)
@@ -1671,22 +2405,15 @@ void reload_defaults(dt_iop_module_t *module)
       if(++cnt == 2) *c = '\0';
   if(img->exif_maker[0] || model[0])
   {
-    dt_iop_lensfun_global_data_t *gd = (dt_iop_lensfun_global_data_t *)module->global_data;
-
-    // just to be sure
-    lfDatabase *db = _lensfun_db(gd);
-    if(IS_NULL_PTR(db)) return;
+    dt_iop_lensfun_global_data_t *gd = (dt_iop_lensfun_global_data_t *)dt_iop_module_global_data(module);
 
-    dt_pthread_mutex_lock(dt_plugin_threadsafe_mutex());
-    const lfCamera **cam = db->FindCamerasExt(img->exif_maker, img->exif_model, 0);
-    dt_pthread_mutex_unlock(dt_plugin_threadsafe_mutex());
+    // memoised, so that a batch of images from one camera asks the database (or the memo file) once
+    const lfCamera *cam = _lensfun_find_camera(gd, img->exif_maker, img->exif_model);
     if(cam)
     {
-      dt_pthread_mutex_lock(dt_plugin_threadsafe_mutex());
-      const lfLens **lens = db->FindLenses(cam[0], NULL, d->lens, 0);
-      dt_pthread_mutex_unlock(dt_plugin_threadsafe_mutex());
+      const lfLens *const *lens = _lensfun_find_lenses(gd, cam, d->lens);
 
-      if(!lens && islower(cam[0]->Mount[0]))
+      if(!lens && islower(cam->Mount[0]))
       {
         /*
          * This is a fixed-lens camera, and LF returned no lens.
@@ -1696,10 +2423,7 @@ void reload_defaults(dt_iop_module_t *module)
          * Let's unset lens name and re-run lens query
          */
         g_strlcpy(d->lens, "", sizeof(d->lens));
-
-        dt_pthread_mutex_lock(dt_plugin_threadsafe_mutex());
-        lens = db->FindLenses(cam[0], NULL, d->lens, 0);
-        dt_pthread_mutex_unlock(dt_plugin_threadsafe_mutex());
+        lens = _lensfun_find_lenses(gd, cam, d->lens);
       }
 
       if(lens)
@@ -1711,7 +2435,7 @@ void reload_defaults(dt_iop_module_t *module)
          * at the zeroth character in the mount's name:
          * If it is a lower case letter, it is a fixed-lens camera.
          */
-        if(!d->lens[0] && islower(cam[0]->Mount[0]))
+        if(!d->lens[0] && islower(cam->Mount[0]))
         {
           /*
            * no lens info in EXIF, and this is fixed-lens camera,
@@ -1732,13 +2456,11 @@ void reload_defaults(dt_iop_module_t *module)
         }
 
         d->target_geom = lens[lens_i]->Type;
-        lf_free(lens);
       }
 
-      d->crop = cam[0]->CropFactor;
-      d->scale = get_autoscale(module, d, cam[0]);
+      d->crop = cam->CropFactor;
+      d->scale = get_autoscale(module, d, cam);
       module->workflow_enabled = dt_image_needs_rawprepare(img);
-      lf_free(cam);
     }
   }
 
@@ -1757,7 +2479,7 @@ void cleanup_global(dt_iop_module_so_t *module)
     gd->db_warm = NULL;
   }
 
-  /* The memos hold pointers INTO the database, so they go first. Both may be NULL: a session
+  /* The memos hold pointers INTO the databases, so they go first. Both may be NULL: a session
    * that never opened an image never built any of this. */
   if(!IS_NULL_PTR(_lensfun_camera_memo))
   {
@@ -1770,6 +2492,9 @@ void cleanup_global(dt_iop_module_so_t *module)
     _lensfun_lens_memo = NULL;
   }
 
+  // saves what this session had to look up, then frees the memo file's small databases
+  _lensfun_memo_file_close();
+
   lfDatabase *dt_iop_lensfun_db = (lfDatabase *)gd->db;
   if(!IS_NULL_PTR(dt_iop_lensfun_db)) delete dt_iop_lensfun_db;
   gd->db = NULL;
@@ -2016,7 +2741,7 @@ static void parse_model(const char *txt, char *model, size_t sz_model)
 static void camera_menusearch_clicked(GtkWidget *button, gpointer user_data)
 {
   dt_iop_module_t *self = (dt_iop_module_t *)user_data;
-  dt_iop_lensfun_global_data_t *gd = (dt_iop_lensfun_global_data_t *)self->global_data;
+  dt_iop_lensfun_global_data_t *gd = (dt_iop_lensfun_global_data_t *)dt_iop_module_global_data(self);
   lfDatabase *dt_iop_lensfun_db = _lensfun_db(gd);
   dt_iop_lensfun_gui_data_t *g = (dt_iop_lensfun_gui_data_t *)dt_iop_gui_data(self);
 
@@ -2035,7 +2760,7 @@ static void camera_menusearch_clicked(GtkWidget *button, gpointer user_data)
 static void camera_autosearch_clicked(GtkWidget *button, gpointer user_data)
 {
   dt_iop_module_t *self = (dt_iop_module_t *)user_data;
-  dt_iop_lensfun_global_data_t *gd = (dt_iop_lensfun_global_data_t *)self->global_data;
+  dt_iop_lensfun_global_data_t *gd = (dt_iop_lensfun_global_data_t *)dt_iop_module_global_data(self);
   lfDatabase *dt_iop_lensfun_db = _lensfun_db(gd);
   dt_iop_lensfun_gui_data_t *g = (dt_iop_lensfun_gui_data_t *)dt_iop_gui_data(self);
   char make[200], model[200];
@@ -2362,7 +3087,7 @@ static void lens_menu_fill(dt_iop_module_t *self, const lfLens *const *lenslist)
 static void lens_menusearch_clicked(GtkWidget *button, gpointer user_data)
 {
   dt_iop_module_t *self = (dt_iop_module_t *)user_data;
-  dt_iop_lensfun_global_data_t *gd = (dt_iop_lensfun_global_data_t *)self->global_data;
+  dt_iop_lensfun_global_data_t *gd = (dt_iop_lensfun_global_data_t *)dt_iop_module_global_data(self);
   lfDatabase *dt_iop_lensfun_db = _lensfun_db(gd);
   dt_iop_lensfun_gui_data_t *g = (dt_iop_lensfun_gui_data_t *)dt_iop_gui_data(self);
   const lfLens **lenslist;
@@ -2382,7 +3107,7 @@ static void lens_menusearch_clicked(GtkWidget *button, gpointer user_data)
 static void lens_autosearch_clicked(GtkWidget *button, gpointer user_data)
 {
   dt_iop_module_t *self = (dt_iop_module_t *)user_data;
-  dt_iop_lensfun_global_data_t *gd = (dt_iop_lensfun_global_data_t *)self->global_data;
+  dt_iop_lensfun_global_data_t *gd = (dt_iop_lensfun_global_data_t *)dt_iop_module_global_data(self);
   lfDatabase *dt_iop_lensfun_db = _lensfun_db(gd);
   dt_iop_lensfun_gui_data_t *g = (dt_iop_lensfun_gui_data_t *)dt_iop_gui_data(self);
   const lfLens **lenslist;
@@ -2460,61 +3185,55 @@ void gui_changed(dt_iop_module_t *self, GtkWidget *w, void *previous)
 
 static float get_autoscale(dt_iop_module_t *self, dt_iop_lensfun_params_t *p, const lfCamera *camera)
 {
-  dt_iop_lensfun_global_data_t *gd = (dt_iop_lensfun_global_data_t *)self->global_data;
-  lfDatabase *dt_iop_lensfun_db = _lensfun_db(gd);
+  dt_iop_lensfun_global_data_t *gd = (dt_iop_lensfun_global_data_t *)dt_iop_module_global_data(self);
   float scale = 1.0;
-  if(p->lens[0] != '\0')
+  const lfLens *lens = _lensfun_find_lens(gd, camera, p->lens);
+  if(lens)
   {
     dt_pthread_mutex_lock(dt_plugin_threadsafe_mutex());
-    const lfLens **lenslist
-        = dt_iop_lensfun_db->FindLenses(camera, NULL, p->lens, 0);
-    if(lenslist)
-    {
-      const dt_image_t *img = &(self->dev->image_storage);
+    const dt_image_t *img = &(self->dev->image_storage);
 
-      // FIXME: get those from rawprepare IOP somehow !!!
-      const int iwd = img->width - img->crop_x - img->crop_width,
-                iht = img->height - img->crop_y - img->crop_height;
+    // FIXME: get those from rawprepare IOP somehow !!!
+    const int iwd = img->width - img->crop_x - img->crop_width,
+              iht = img->height - img->crop_y - img->crop_height;
 
-      // create dummy modifier
+    // create dummy modifier
 #if defined(__GNUC__) && (__GNUC__ > 7)
-      const dt_iop_lensfun_data_t d =
-        {
-         .lens         = (lfLens *)lenslist[0],
-         .modify_flags = p->modify_flags,
-         .inverse      = p->inverse,
-         .scale        = 1.0f,
-         .crop         = p->crop,
-         .focal        = p->focal,
-         .aperture     = p->aperture,
-         .distance     = p->distance,
-         .target_geom  = p->target_geom,
-         .custom_tca   = { .Model = LF_TCA_MODEL_NONE }
-        };
+    const dt_iop_lensfun_data_t d =
+      {
+       .lens         = (lfLens *)lens,
+       .modify_flags = p->modify_flags,
+       .inverse      = p->inverse,
+       .scale        = 1.0f,
+       .crop         = p->crop,
+       .focal        = p->focal,
+       .aperture     = p->aperture,
+       .distance     = p->distance,
+       .target_geom  = p->target_geom,
+       .custom_tca   = { .Model = LF_TCA_MODEL_NONE }
+      };
 #else
-      // prior to GCC 8.x the / .custom_tca   = { .Model = ??? } / was not supported:
-      //    sorry, unimplemented: non-trivial designated initializers not supported
-      // ?? This code can be removed when GCC-7 is not used anymore.
-
-      dt_iop_lensfun_data_t d;
-      d.lens             = (lfLens *)lenslist[0];
-      d.modify_flags     = p->modify_flags;
-      d.inverse          = p->inverse;
-      d.scale            = 1.0f;
-      d.crop             = p->crop;
-      d.focal            = p->focal;
-      d.aperture         = p->aperture;
-      d.distance         = p->distance;
-      d.target_geom      = p->target_geom;
-      d.custom_tca.Model = LF_TCA_MODEL_NONE;
+    // prior to GCC 8.x the / .custom_tca   = { .Model = ??? } / was not supported:
+    //    sorry, unimplemented: non-trivial designated initializers not supported
+    // ?? This code can be removed when GCC-7 is not used anymore.
+
+    dt_iop_lensfun_data_t d;
+    d.lens             = (lfLens *)lens;
+    d.modify_flags     = p->modify_flags;
+    d.inverse          = p->inverse;
+    d.scale            = 1.0f;
+    d.crop             = p->crop;
+    d.focal            = p->focal;
+    d.aperture         = p->aperture;
+    d.distance         = p->distance;
+    d.target_geom      = p->target_geom;
+    d.custom_tca.Model = LF_TCA_MODEL_NONE;
 #endif
 
-      lfModifier *modifier = get_modifier(NULL, iwd, iht, &d, LF_MODIFY_ALL, FALSE);
+    lfModifier *modifier = get_modifier(NULL, iwd, iht, &d, LF_MODIFY_ALL, FALSE);
 
-      scale = modifier->GetAutoScale(p->inverse);
-      delete modifier;
-    }
-    lf_free(lenslist);
+    scale = modifier->GetAutoScale(p->inverse);
+    delete modifier;
     dt_pthread_mutex_unlock(dt_plugin_threadsafe_mutex());
   }
   return scale;
@@ -2760,7 +3479,7 @@ void gui_update(struct dt_iop_module_t *self)
     memcpy(self->params, self->default_params, sizeof(dt_iop_lensfun_params_t));
   }
 
-  dt_iop_lensfun_global_data_t *gd = (dt_iop_lensfun_global_data_t *)self->global_data;
+  dt_iop_lensfun_global_data_t *gd = (dt_iop_lensfun_global_data_t *)dt_iop_module_global_data(self);
   lfDatabase *dt_iop_lensfun_db = _lensfun_db(gd);
   // these are the wrong (untranslated) strings in general but that's ok, they will be overwritten further
   // down
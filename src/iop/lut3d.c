@@ -133,10 +133,20 @@ typedef enum dt_lut3d_cols_t
 
 const char invalid_filepath_prefix[] = "INVALID >> ";
 
+/** A parsed LUT file, shared by every pipe using it. See _lut_cache_acquire(). */
+typedef struct dt_iop_lut3d_shared_t
+{
+  gchar *key;     // mtime, size and full path of the source file
+  float *clut;
+  uint16_t level;
+  int refs;       // pipes holding it, under dt_iop_lut3d_global_data_t::lut_lock
+} dt_iop_lut3d_shared_t;
+
 typedef struct dt_iop_lut3d_data_t
 {
   dt_iop_lut3d_params_t params;
-  float *clut;  // cube lut pointer
+  dt_iop_lut3d_shared_t *lut; // reference owned by this pipe, NULL if no LUT
+  const float *clut;  // cube lut pointer, borrowed from lut
   uint16_t level; // cube_size
 } dt_iop_lut3d_data_t;
 
@@ -146,8 +156,13 @@ typedef struct dt_iop_lut3d_global_data_t
   int kernel_lut3d_trilinear;
   int kernel_lut3d_pyramid;
   int kernel_lut3d_none;
+  GMutex lut_lock;
+  GHashTable *luts;  // key -> dt_iop_lut3d_shared_t, every LUT alive
+  GQueue *idle;      // LUTs no pipe holds, least recently released first
 } dt_iop_lut3d_global_data_t;
 
+static void _lut_shared_free(dt_iop_lut3d_shared_t *lut);
+
 
 const char *name()
 {
@@ -838,8 +853,11 @@ void init_global(dt_iop_module_so_t *module)
 {
   const int program = 28; // rgbcurve.cl, from programs.conf
   dt_iop_lut3d_global_data_t *gd
-      = (dt_iop_lut3d_global_data_t *)malloc(sizeof(dt_iop_lut3d_global_data_t));
+      = (dt_iop_lut3d_global_data_t *)calloc(1, sizeof(dt_iop_lut3d_global_data_t));
   module->data = gd;
+  g_mutex_init(&gd->lut_lock);
+  gd->luts = g_hash_table_new(g_str_hash, g_str_equal);
+  gd->idle = g_queue_new();
   gd->kernel_lut3d_tetrahedral = dt_opencl_create_kernel(program, "lut3d_tetrahedral");
   gd->kernel_lut3d_trilinear = dt_opencl_create_kernel(program, "lut3d_trilinear");
   gd->kernel_lut3d_pyramid = dt_opencl_create_kernel(program, "lut3d_pyramid");
@@ -854,6 +872,15 @@ void cleanup_global(dt_iop_module_so_t *module)
   dt_opencl_free_kernel(gd->kernel_lut3d_trilinear);
   dt_opencl_free_kernel(gd->kernel_lut3d_pyramid);
   dt_opencl_free_kernel(gd->kernel_lut3d_none);
+
+  // every pipe is gone by now, so every LUT left is idle
+  GHashTableIter iter;
+  gpointer value;
+  g_hash_table_iter_init(&iter, gd->luts);
+  while(g_hash_table_iter_next(&iter, NULL, &value)) _lut_shared_free((dt_iop_lut3d_shared_t *)value);
+  g_hash_table_destroy(gd->luts);
+  g_queue_free(gd->idle);
+  g_mutex_clear(&gd->lut_lock);
   dt_free(module->data);
 }
 
@@ -883,49 +910,217 @@ static gboolean _params_need_gmz(const dt_iop_lut3d_params_t *const p)
   return p->filepath[0] && (g_str_has_suffix(p->filepath, ".gmz") || g_str_has_suffix(p->filepath, ".GMZ"));
 }
 
-static int calculate_clut(dt_iop_lut3d_params_t *const p, float **clut)
+static uint16_t calculate_clut(dt_iop_lut3d_params_t *const p, const char *const fullpath, float **clut)
 {
   uint16_t level = 0;
-  const char *filepath = p->filepath;
-    gchar *lutfolder = dt_conf_get_string("plugins/darkroom/lut3d/def_path");
-    if (filepath[0] && lutfolder[0])
+  if (g_str_has_suffix (fullpath, ".png") || g_str_has_suffix (fullpath, ".PNG"))
+  {
+    level = calculate_clut_haldclut(p, fullpath, clut);
+  }
+  else if (g_str_has_suffix (fullpath, ".cube") || g_str_has_suffix (fullpath, ".CUBE"))
+  {
+    level = calculate_clut_cube(fullpath, clut);
+  }
+  else if (g_str_has_suffix (fullpath, ".3dl") || g_str_has_suffix (fullpath, ".3DL"))
+  {
+    level = calculate_clut_3dl(fullpath, clut);
+  }
+  return level;
+}
+
+/* --- Shared LUTs -------------------------------------------------------------------------------
+ *
+ * Every pipe -- preview, full, each export -- used to parse its own copy of the LUT in
+ * commit_params(). A 65³ .cube is 275k lines of text, so a batch export spent longer parsing the
+ * same file again and again than applying it. Parsed LUTs now belong to the module and are
+ * shared: a pipe holds a reference for as long as it uses one. They are keyed by the mtime, size
+ * and path of the file, so a LUT edited on disk is parsed again on the next commit, while pipes
+ * still holding the old one keep it alive. The last DT_IOP_LUT3D_IDLE_LUTS released LUTs are
+ * kept: an export pipe lives for one image, and the next one is about to ask for the same LUT.
+ *
+ * Parsing is skipped across sessions too. A successfully parsed LUT is written to the user cache
+ * directory as raw floats (_lut_compiled_path()), and read back from there as long as the source
+ * has the same mtime and size. The format is native-endian and versioned: a file that does not
+ * match is ignored and rewritten.
+ */
+#define DT_IOP_LUT3D_IDLE_LUTS 4
+#define DT_IOP_LUT3D_COMPILED_MAGIC "ANSLUT3D"
+#define DT_IOP_LUT3D_COMPILED_VERSION 1
+
+typedef struct dt_iop_lut3d_compiled_header_t
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t level;
+} dt_iop_lut3d_compiled_header_t;
+
+static gchar *_lut_fullpath(const dt_iop_lut3d_params_t *const p)
+{
+  if(!p->filepath[0]) return NULL;
+  gchar *lutfolder = dt_conf_get_string("plugins/darkroom/lut3d/def_path");
+  gchar *fullpath = lutfolder[0] ? g_build_filename(lutfolder, p->filepath, NULL) : NULL;
+  dt_free(lutfolder);
+  return fullpath;
+}
+
+static gchar *_lut_key(const char *const fullpath)
+{
+  GStatBuf st;
+  if(IS_NULL_PTR(fullpath) || g_stat(fullpath, &st)) return NULL;
+  return g_strdup_printf("%" G_GINT64_FORMAT ":%" G_GINT64_FORMAT ":%s", (gint64)st.st_mtime,
+                         (gint64)st.st_size, fullpath);
+}
+
+static gchar *_lut_compiled_path(const char *const key)
+{
+  char cachedir[PATH_MAX] = { 0 };
+  dt_loc_get_user_cache_dir(cachedir, sizeof(cachedir));
+  gchar *checksum = g_compute_checksum_for_string(G_CHECKSUM_MD5, key, -1);
+  gchar *filename = g_strdup_printf("%s.lut", checksum);
+  gchar *path = g_build_filename(cachedir, "lut3d", filename, NULL);
+  dt_free(filename);
+  dt_free(checksum);
+  return path;
+}
+
+static uint16_t _lut_compiled_read(const char *const key, float **clut)
+{
+  gchar *path = _lut_compiled_path(key);
+  FILE *f = g_fopen(path, "rb");
+  dt_free(path);
+  if(IS_NULL_PTR(f)) return 0;
+
+  dt_iop_lut3d_compiled_header_t header;
+  uint16_t level = 0;
+  if(fread(&header, sizeof(header), 1, f) == 1
+     && !memcmp(header.magic, DT_IOP_LUT3D_COMPILED_MAGIC, sizeof(header.magic))
+     && header.version == DT_IOP_LUT3D_COMPILED_VERSION && header.level >= 2 && header.level <= 256)
+  {
+    const size_t values = (size_t)header.level * header.level * header.level * 3;
+    float *lclut = dt_pixelpipe_cache_alloc_align_cache(sizeof(float) * values, 0);
+    if(lclut && fread(lclut, sizeof(float), values, f) == values)
     {
-      char *fullpath = g_build_filename(lutfolder, filepath, NULL);
-      if (g_str_has_suffix (filepath, ".png") || g_str_has_suffix (filepath, ".PNG"))
-      {
-        level = calculate_clut_haldclut(p, fullpath, clut);
-      }
-      else if (g_str_has_suffix (filepath, ".cube") || g_str_has_suffix (filepath, ".CUBE"))
-      {
-        level = calculate_clut_cube(fullpath, clut);
-      }
-      else if (g_str_has_suffix (filepath, ".3dl") || g_str_has_suffix (filepath, ".3DL"))
-      {
-        level = calculate_clut_3dl(fullpath, clut);
-      }
-      dt_free(fullpath);
+      *clut = lclut;
+      level = header.level;
     }
-    dt_free(lutfolder);
+    else
+      dt_pixelpipe_cache_free_align(lclut);
+  }
+  fclose(f);
   return level;
 }
 
+static void _lut_compiled_write(const char *const key, const float *const clut, const uint16_t level)
+{
+  gchar *path = _lut_compiled_path(key);
+  gchar *dir = g_path_get_dirname(path);
+  gchar *tmp = g_strdup_printf("%s.tmp", path);
+  FILE *f = NULL;
+  if(!g_mkdir_with_parents(dir, 0700) && (f = g_fopen(tmp, "wb")))
+  {
+    dt_iop_lut3d_compiled_header_t header = { { 0 }, DT_IOP_LUT3D_COMPILED_VERSION, level };
+    memcpy(header.magic, DT_IOP_LUT3D_COMPILED_MAGIC, sizeof(header.magic));
+    const size_t values = (size_t)level * level * level * 3;
+    const gboolean ok = fwrite(&header, sizeof(header), 1, f) == 1 && fwrite(clut, sizeof(float), values, f) == values;
+    // write-then-rename: a session reading it concurrently sees the old file or the whole new one
+    if(!fclose(f) && ok && !g_rename(tmp, path))
+      dt_print(DT_DEBUG_DEV, "[lut3d] compiled %s\n", path);
+    else
+      g_unlink(tmp);
+  }
+  dt_free(tmp);
+  dt_free(dir);
+  dt_free(path);
+}
+
+static void _lut_shared_free(dt_iop_lut3d_shared_t *lut)
+{
+  dt_pixelpipe_cache_free_align(lut->clut);
+  dt_free(lut->key);
+  dt_free(lut);
+}
+
+/**
+ * @brief Get a reference on the LUT stored at @p fullpath, as it is on disk now (@p key).
+ *
+ * Parses the file only if no pipe, no idle slot and no compiled copy has it already.
+ * @return the LUT, to be released with _lut_cache_release(), or NULL if it cannot be read.
+ */
+static dt_iop_lut3d_shared_t *_lut_cache_acquire(dt_iop_lut3d_global_data_t *gd, dt_iop_lut3d_params_t *const p,
+                                                 const char *const fullpath, const char *const key)
+{
+  if(IS_NULL_PTR(fullpath) || IS_NULL_PTR(key)) return NULL;
+
+  g_mutex_lock(&gd->lut_lock);
+  dt_iop_lut3d_shared_t *lut = (dt_iop_lut3d_shared_t *)g_hash_table_lookup(gd->luts, key);
+  if(lut)
+  {
+    if(lut->refs++ == 0) g_queue_remove(gd->idle, lut);
+    g_mutex_unlock(&gd->lut_lock);
+    return lut;
+  }
+  g_mutex_unlock(&gd->lut_lock);
+
+  // Read outside of the lock: other LUTs stay available meanwhile. Two pipes racing for the same
+  // new LUT both read it, and the loser drops its copy below.
+  float *clut = NULL;
+  uint16_t level = _lut_compiled_read(key, &clut);
+  if(level == 0)
+  {
+    level = calculate_clut(p, fullpath, &clut);
+    if(level == 0) return NULL;
+    _lut_compiled_write(key, clut, level);
+  }
+
+  g_mutex_lock(&gd->lut_lock);
+  lut = (dt_iop_lut3d_shared_t *)g_hash_table_lookup(gd->luts, key);
+  if(lut)
+  {
+    if(lut->refs++ == 0) g_queue_remove(gd->idle, lut);
+    dt_pixelpipe_cache_free_align(clut);
+  }
+  else
+  {
+    lut = (dt_iop_lut3d_shared_t *)calloc(1, sizeof(dt_iop_lut3d_shared_t));
+    lut->key = g_strdup(key);
+    lut->clut = clut;
+    lut->level = level;
+    lut->refs = 1;
+    g_hash_table_insert(gd->luts, lut->key, lut);
+  }
+  g_mutex_unlock(&gd->lut_lock);
+  return lut;
+}
+
+static void _lut_cache_release(dt_iop_lut3d_global_data_t *gd, dt_iop_lut3d_shared_t *lut)
+{
+  if(IS_NULL_PTR(lut)) return;
+  g_mutex_lock(&gd->lut_lock);
+  if(--lut->refs == 0)
+  {
+    g_queue_push_tail(gd->idle, lut);
+    while(g_queue_get_length(gd->idle) > DT_IOP_LUT3D_IDLE_LUTS)
+    {
+      dt_iop_lut3d_shared_t *oldest = (dt_iop_lut3d_shared_t *)g_queue_pop_head(gd->idle);
+      g_hash_table_remove(gd->luts, oldest->key);
+      _lut_shared_free(oldest);
+    }
+  }
+  g_mutex_unlock(&gd->lut_lock);
+}
 
 void commit_params(struct dt_iop_module_t *self, dt_iop_params_t *p1, dt_dev_pixelpipe_t *pipe,
                    dt_dev_pixelpipe_iop_t *piece)
 {
   dt_iop_lut3d_params_t *p = (dt_iop_lut3d_params_t *)p1;
   dt_iop_lut3d_data_t *d = (dt_iop_lut3d_data_t *)piece->data;
+  dt_iop_lut3d_global_data_t *gd = (dt_iop_lut3d_global_data_t *)self->global_data;
 
-  if (strcmp(p->filepath, d->params.filepath) != 0 || strcmp(p->lutname, d->params.lutname) != 0 )
-  { // new clut file
-    if (d->clut)
-    { // reset current clut if any
-      dt_pixelpipe_cache_free_align(d->clut);
-      d->clut = NULL;
-      d->level = 0;
-    }
+  const gboolean new_file = strcmp(p->filepath, d->params.filepath) != 0 || strcmp(p->lutname, d->params.lutname) != 0;
 
-    if(_params_need_gmz(p))
+  if(_params_need_gmz(p))
+  {
+    if(new_file)
     {
       // Reached from every pipe -- darkroom, thumbnails, export -- and it is deliberately the
       // only notice outside the darkroom: one modal per thumbnail over a lighttable grid would
@@ -936,11 +1131,28 @@ void commit_params(struct dt_iop_module_t *self, dt_iop_params_t *p1, dt_dev_pix
               "applied to this image. Convert it to .cube -- see %s\n",
               (pipe && pipe->dev) ? pipe->dev->image_storage.filename : "(unknown image)",
               DT_LUT3D_GMZ_DOC_URL);
-      d->level = 0;
     }
-    else
-      d->level = calculate_clut(p, &d->clut);
+    _lut_cache_release(gd, d->lut);
+    d->lut = NULL;
+  }
+  else
+  {
+    // A stat per commit is what notices a LUT rewritten on disk. A file that failed to load is
+    // not retried until the selection changes, so a broken LUT logs its error once.
+    gchar *fullpath = _lut_fullpath(p);
+    gchar *key = _lut_key(fullpath);
+    if(new_file || (d->lut && g_strcmp0(key, d->lut->key) != 0))
+    {
+      dt_iop_lut3d_shared_t *lut = _lut_cache_acquire(gd, p, fullpath, key);
+      _lut_cache_release(gd, d->lut);
+      d->lut = lut;
+    }
+    dt_free(key);
+    dt_free(fullpath);
   }
+
+  d->clut = d->lut ? d->lut->clut : NULL;
+  d->level = d->lut ? d->lut->level : 0;
   memcpy(&d->params, p, sizeof(dt_iop_lut3d_params_t));
 }
 
@@ -950,6 +1162,7 @@ void init_pipe(struct dt_iop_module_t *self, dt_dev_pixelpipe_t *pipe, dt_dev_pi
   piece->data_size = sizeof(dt_iop_lut3d_data_t);
   dt_iop_lut3d_data_t *d = (dt_iop_lut3d_data_t *)piece->data;
   memcpy(&d->params, self->default_params, sizeof(dt_iop_lut3d_params_t));
+  d->lut = NULL;
   d->clut = NULL;
   d->level = 0;
   d->params.filepath[0] = '\0';
@@ -959,8 +1172,9 @@ void cleanup_pipe(struct dt_iop_module_t *self, dt_dev_pixelpipe_t *pipe, dt_dev
 {
   /* init_pipe() may have failed to allocate, and cleanup runs regardless. */
   if(IS_NULL_PTR(piece->data)) return;
-  dt_iop_lut3d_data_t *d = (dt_iop_lut3d_data_t *)piece->data;;
-    dt_pixelpipe_cache_free_align(d->clut);
+  dt_iop_lut3d_data_t *d = (dt_iop_lut3d_data_t *)piece->data;
+  _lut_cache_release((dt_iop_lut3d_global_data_t *)self->global_data, d->lut);
+  d->lut = NULL;
   d->clut = NULL;
   d->level = 0;
   dt_free_align(piece->data);
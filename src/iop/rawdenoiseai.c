@@ -567,7 +567,7 @@ static dt_iop_rawdenoiseai_size_t _default_size(void)
  * copy-through. */
 static gboolean _rawdenoiseai_supported(dt_iop_module_t *module)
 {
-  dt_iop_rawdenoiseai_global_data_t *gd = (dt_iop_rawdenoiseai_global_data_t *)module->global_data;
+  dt_iop_rawdenoiseai_global_data_t *gd = (dt_iop_rawdenoiseai_global_data_t *)dt_iop_module_global_data(module);
   return dt_image_needs_demosaic(&module->dev->image_storage) && gd
          && _get_model(gd, DT_RAWDENOISEAI_V1, _default_size(), DT_RAWDENOISEAI_MULTI);
 }
@@ -1755,7 +1755,7 @@ void gui_update(dt_iop_module_t *self)
 {
   dt_iop_rawdenoiseai_gui_data_t *g = (dt_iop_rawdenoiseai_gui_data_t *)dt_iop_gui_data(self);
   const dt_iop_rawdenoiseai_params_t *p = (dt_iop_rawdenoiseai_params_t *)self->params;
-  dt_iop_rawdenoiseai_global_data_t *gd = (dt_iop_rawdenoiseai_global_data_t *)self->global_data;
+  dt_iop_rawdenoiseai_global_data_t *gd = (dt_iop_rawdenoiseai_global_data_t *)dt_iop_module_global_data(self);
   gtk_stack_set_visible_child_name(GTK_STACK(self->gui->widget), self->hide_enable_button ? "unsupported" : "raw");
 
   // rescan on every panel update: the user may have dropped a file in since
@@ -278,6 +278,29 @@ void modify_roi_in(dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, dt_dev
   roi_in->height = CLAMP(roi_in->height, 1, (int)ceilf(orig_h) - roi_in->y);
 }
 
+/* roi_out buffer position -> the roi_in buffer position process() samples it from */
+static inline void _rotatepixels_process_point(const dt_iop_rotatepixels_data_t *const d,
+                                               const dt_iop_roi_t *const roi_in,
+                                               const dt_iop_roi_t *const roi_out, float *p)
+{
+  const float pi[2] = { roi_out->x + p[0], roi_out->y + p[1] };
+  backtransform(d, roi_in->scale, pi, p);
+  p[0] -= roi_in->x;
+  p[1] -= roi_in->y;
+}
+
+gboolean distort_process_points(dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe,
+                                const dt_dev_pixelpipe_iop_t *piece, float *points, size_t points_count)
+{
+  (void)pipe;
+  const dt_iop_rotatepixels_data_t *const d = (const dt_iop_rotatepixels_data_t *)piece->data;
+  const dt_iop_roi_t *const roi_in = &piece->roi_in;
+  const dt_iop_roi_t *const roi_out = &piece->roi_out;
+  __OMP_PARALLEL_FOR__()
+  for(size_t k = 0; k < points_count; k++) _rotatepixels_process_point(d, roi_in, roi_out, points + 2 * k);
+  return TRUE;
+}
+
 // 3rd (final) pass: you get this input region (may be different from what was requested above),
 // do your best to fill the output region!
 __DT_CLONE_TARGETS__
@@ -290,7 +313,7 @@ int process(dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_
   const int ch = piece->dsc_in.channels;
   const int ch_width = ch * roi_in->width;
 
-  const float scale = roi_in->scale;
+  const dt_iop_rotatepixels_data_t *const d = (const dt_iop_rotatepixels_data_t *)piece->data;
 
   const struct dt_interpolation *interpolation = dt_interpolation_new(DT_INTERPOLATION_USERPREF);
   __OMP_PARALLEL_FOR__()
@@ -301,15 +324,8 @@ int process(dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_
     float *out = ((float *)ovoid) + (size_t)ch * j * roi_out->width;
     for(int i = 0; i < roi_out->width; i++, out += ch)
     {
-      float pi[2], po[2];
-
-      pi[0] = roi_out->x + i;
-      pi[1] = roi_out->y + j;
-
-      backtransform((const dt_iop_rotatepixels_data_t *)piece->data, scale, pi, po);
-
-      po[0] -= roi_in->x;
-      po[1] -= roi_in->y;
+      float po[2] = { i, j };
+      _rotatepixels_process_point(d, roi_in, roi_out, po);
 
       dt_interpolation_compute_pixel4c(interpolation, (float *)ivoid, out, po[0], po[1], roi_in->width,
                                        roi_in->height, ch_width);
@@ -248,6 +248,23 @@ void modify_roi_in(dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, dt_dev
   roi_in->y = roi_out->y * d->y_scale;
 }
 
+/* roi_out buffer position -> the roi_in buffer position process() samples it from */
+static inline void _scalepixels_process_point(const dt_iop_scalepixels_data_t *const d, float *p)
+{
+  p[0] *= d->x_scale;
+  p[1] *= d->y_scale;
+}
+
+gboolean distort_process_points(dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe,
+                                const dt_dev_pixelpipe_iop_t *piece, float *points, size_t points_count)
+{
+  (void)pipe;
+  const dt_iop_scalepixels_data_t *const d = piece->data;
+  __OMP_PARALLEL_FOR__()
+  for(size_t k = 0; k < points_count; k++) _scalepixels_process_point(d, points + 2 * k);
+  return TRUE;
+}
+
 __DT_CLONE_TARGETS__
 int process(dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_pixelpipe_iop_t *piece,
             const void *const ivoid, void *const ovoid)
@@ -267,10 +284,10 @@ int process(dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_
     float *out = ((float *)ovoid) + (size_t)4 * j * roi_out->width;
     for(int i = 0; i < roi_out->width; i++, out += 4)
     {
-      float x = i*d->x_scale;
-      float y = j*d->y_scale;
+      float p[2] = { i, j };
+      _scalepixels_process_point(d, p);
 
-      dt_interpolation_compute_pixel4c(interpolation, (float *)ivoid, out, x, y, roi_in->width,
+      dt_interpolation_compute_pixel4c(interpolation, (float *)ivoid, out, p[0], p[1], roi_in->width,
                                        roi_in->height, ch_width);
     }
   }
@@ -81,6 +81,7 @@
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
+#include <glib/gstdio.h>
 
 #include <librsvg/rsvg.h>
 // ugh, ugly hack. why do people break stuff all the time?
@@ -89,6 +90,7 @@
 #endif
 
 #include "common/file_location.h"
+#include "common/hash.h"
 #include "common/utility.h"
 #include "widgets/accelerators.h"
 #include "widgets/container.h"
@@ -165,6 +167,32 @@ typedef struct dt_iop_watermark_gui_data_t
   GtkWidget *color_picker_button;
 } dt_iop_watermark_gui_data_t;
 
+/* Rendered watermarks, shared by every pipe. A batch export stamps the same watermark on images of
+ * the same size over and over, and rendering it takes librsvg, under the global plugin lock: each
+ * overlay is kept, cropped to the pixels it covers, under everything the rendering read. */
+#define DT_WATERMARK_CACHE_BYTES ((size_t)256 << 20)
+
+typedef struct dt_iop_watermark_overlay_t
+{
+  uint64_t key;
+  int refs;          // one for the cache, one per pipe compositing it
+  int x, y;          // top-left corner of the box, in roi_out
+  int width, height; // 0 when the watermark paints nothing in roi_out
+  float *pixels;     // premultiplied RGBA over the box, opacity not applied
+} dt_iop_watermark_overlay_t;
+
+typedef struct dt_iop_watermark_global_data_t
+{
+  GList *overlays; // dt_iop_watermark_overlay_t *, most recently used first
+  size_t bytes;    // pixels held by the list
+  dt_pthread_mutex_t lock;
+} dt_iop_watermark_global_data_t;
+
+static inline size_t _overlay_bytes(const dt_iop_watermark_overlay_t *overlay)
+{
+  return (size_t)4 * sizeof(float) * overlay->width * overlay->height;
+}
+
 int legacy_params(dt_iop_module_t *self, const void *const old_params, const int old_version,
                   void *new_params, const int new_version)
 {
@@ -497,87 +525,188 @@ static gchar *_watermark_get_svgdoc(dt_iop_module_t *self, dt_iop_watermark_data
   return svgdata;
 }
 
-__DT_CLONE_TARGETS__
-int process(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_pixelpipe_iop_t *piece, const void *const ivoid,
-             void *const ovoid)
+static void _overlay_release(dt_iop_watermark_global_data_t *gd, dt_iop_watermark_overlay_t *overlay)
 {
-  const dt_iop_roi_t *const roi_in = &piece->roi_in;
-  const dt_iop_roi_t *const roi_out = &piece->roi_out;
-  dt_iop_watermark_data_t *data = (dt_iop_watermark_data_t *)piece->data;
-  float *in = (float *)ivoid;
-  float *out = (float *)ovoid;
-  const int ch = 4;
-  const float angle = (M_PI / 180) * (-data->rotate);
+  if(IS_NULL_PTR(overlay)) return;
 
-  gchar configdir[PATH_MAX] = { 0 };
-  gchar datadir[PATH_MAX] = { 0 };
-  gchar *filename;
-  dt_loc_get_datadir(datadir, sizeof(datadir));
-  dt_loc_get_user_config_dir(configdir, sizeof(configdir));
-  g_strlcat(datadir, "/watermarks/", sizeof(datadir));
-  g_strlcat(configdir, "/watermarks/", sizeof(configdir));
-  g_strlcat(datadir, data->filename, sizeof(datadir));
-  g_strlcat(configdir, data->filename, sizeof(configdir));
+  dt_pthread_mutex_lock(&gd->lock);
+  const gboolean last = (--overlay->refs == 0);
+  dt_pthread_mutex_unlock(&gd->lock);
 
-  if(g_file_test(configdir, G_FILE_TEST_EXISTS))
-    filename = configdir;
-  else if(g_file_test(datadir, G_FILE_TEST_EXISTS))
-    filename = datadir;
-  else
+  if(last)
   {
-    dt_iop_image_copy_by_size(ovoid, ivoid, roi_out->width, roi_out->height, ch);
-    return 0;
+    dt_free_align(overlay->pixels);
+    dt_free(overlay);
   }
+}
 
-  // find out the watermark type
-  dt_iop_watermark_type_t type;
-  const gchar *extension = strrchr(data->filename, '.');
-  if(!IS_NULL_PTR(extension))
+static dt_iop_watermark_overlay_t *_overlay_lookup(dt_iop_watermark_global_data_t *gd, const uint64_t key)
+{
+  dt_iop_watermark_overlay_t *found = NULL;
+  dt_pthread_mutex_lock(&gd->lock);
+  for(GList *iter = gd->overlays; iter; iter = g_list_next(iter))
   {
-    if(!g_ascii_strcasecmp(extension, ".svg"))
-      type = DT_WTM_SVG;
-    else if(!g_ascii_strcasecmp(extension, ".png"))
-      type = DT_WTM_PNG;
-    else // this should not happen
+    dt_iop_watermark_overlay_t *overlay = (dt_iop_watermark_overlay_t *)iter->data;
+    if(overlay->key != key) continue;
+    gd->overlays = g_list_remove_link(gd->overlays, iter);
+    gd->overlays = g_list_concat(iter, gd->overlays);
+    overlay->refs++;
+    found = overlay;
+    break;
+  }
+  dt_pthread_mutex_unlock(&gd->lock);
+  return found;
+}
+
+/* Store a freshly rendered overlay, which the caller keeps a reference to, and return the one to
+ * composite: another pipe may have rendered the same one meanwhile. */
+static dt_iop_watermark_overlay_t *_overlay_insert(dt_iop_watermark_global_data_t *gd,
+                                                   dt_iop_watermark_overlay_t *overlay)
+{
+  overlay->refs = 1;
+  const size_t bytes = _overlay_bytes(overlay);
+  // larger than the whole cache: use it for this pipe and forget it, as before there was one
+  if(bytes > DT_WATERMARK_CACHE_BYTES) return overlay;
+
+  GList *evicted = NULL;
+  dt_pthread_mutex_lock(&gd->lock);
+  for(GList *iter = gd->overlays; iter; iter = g_list_next(iter))
+  {
+    dt_iop_watermark_overlay_t *other = (dt_iop_watermark_overlay_t *)iter->data;
+    if(other->key != overlay->key) continue;
+    other->refs++;
+    dt_pthread_mutex_unlock(&gd->lock);
+    _overlay_release(gd, overlay);
+    return other;
+  }
+
+  overlay->refs++;
+  gd->overlays = g_list_prepend(gd->overlays, overlay);
+  gd->bytes += bytes;
+  while(gd->bytes > DT_WATERMARK_CACHE_BYTES)
+  {
+    GList *oldest = g_list_last(gd->overlays);
+    dt_iop_watermark_overlay_t *victim = (dt_iop_watermark_overlay_t *)oldest->data;
+    gd->overlays = g_list_delete_link(gd->overlays, oldest);
+    gd->bytes -= _overlay_bytes(victim);
+    evicted = g_list_prepend(evicted, victim);
+  }
+  dt_pthread_mutex_unlock(&gd->lock);
+
+  for(GList *iter = evicted; iter; iter = g_list_next(iter))
+    _overlay_release(gd, (dt_iop_watermark_overlay_t *)iter->data);
+  g_list_free(evicted);
+  return overlay;
+}
+
+/* Everything the rendering below reads, except the opacity, which is applied when compositing. */
+static uint64_t _overlay_key(const dt_dev_pixelpipe_iop_t *piece, const dt_iop_watermark_data_t *data,
+                             const gchar *filename, const gchar *svgdoc)
+{
+  uint64_t key = 5381;
+  key = dt_hash(key, filename, strlen(filename));
+
+  // a PNG has no text to compare, and an SVG can be edited in place: the file's state goes in too
+  GStatBuf st = { 0 };
+  if(g_stat(filename, &st) == 0)
+  {
+    const int64_t mtime = (int64_t)st.st_mtime;
+    const int64_t size = (int64_t)st.st_size;
+    key = dt_hash(key, (const char *)&mtime, sizeof(mtime));
+    key = dt_hash(key, (const char *)&size, sizeof(size));
+  }
+
+  // expanded: text, font, colour and the image's own variables are all in there
+  if(!IS_NULL_PTR(svgdoc)) key = dt_hash(key, svgdoc, strlen(svgdoc));
+
+  key = dt_hash(key, (const char *)&piece->roi_in, sizeof(dt_iop_roi_t));
+  key = dt_hash(key, (const char *)&piece->roi_out, sizeof(dt_iop_roi_t));
+  key = dt_hash(key, (const char *)&piece->buf_in.width, sizeof(piece->buf_in.width));
+  key = dt_hash(key, (const char *)&piece->buf_in.height, sizeof(piece->buf_in.height));
+  key = dt_hash(key, (const char *)&data->scale, sizeof(data->scale));
+  key = dt_hash(key, (const char *)&data->rotate, sizeof(data->rotate));
+  key = dt_hash(key, (const char *)&data->xoffset, sizeof(data->xoffset));
+  key = dt_hash(key, (const char *)&data->yoffset, sizeof(data->yoffset));
+  key = dt_hash(key, (const char *)&data->alignment, sizeof(data->alignment));
+  key = dt_hash(key, (const char *)&data->sizeto, sizeof(data->sizeto));
+  return key;
+}
+
+/* Keep only the box of pixels the watermark paints, converted to float. Cairo premultiplies, so
+ * outside the box there is nothing to composite at all. */
+__DT_CLONE_TARGETS__
+static dt_iop_watermark_overlay_t *_overlay_crop(const guint8 *const image, const int stride, const int width,
+                                                 const int height)
+{
+  int x0 = width, x1 = -1, y0 = height, y1 = -1;
+  for(int y = 0; y < height; y++)
+  {
+    const guint8 *const row = image + (size_t)y * stride;
+    for(int x = 0; x < width; x++)
     {
-      dt_iop_image_copy_by_size(ovoid, ivoid, roi_out->width, roi_out->height, ch);
-      return 0;
+      if(!row[4 * x + 3]) continue;
+      x0 = MIN(x0, x);
+      x1 = MAX(x1, x);
+      y0 = MIN(y0, y);
+      y1 = y;
     }
   }
-  else
+
+  dt_iop_watermark_overlay_t *overlay = g_new0(dt_iop_watermark_overlay_t, 1);
+  if(x1 < 0) return overlay; // nothing painted: an empty overlay composites to a copy
+
+  overlay->x = x0;
+  overlay->y = y0;
+  overlay->width = x1 - x0 + 1;
+  overlay->height = y1 - y0 + 1;
+  overlay->pixels = dt_alloc_align_float((size_t)4 * overlay->width * overlay->height);
+  if(IS_NULL_PTR(overlay->pixels))
   {
-    dt_iop_image_copy_by_size(ovoid, ivoid, roi_out->width, roi_out->height, ch);
-    return 0;
+    dt_free(overlay);
+    return NULL;
   }
 
-  /* Load svg if not loaded */
-  gchar *svgdoc = NULL;
-  if(type == DT_WTM_SVG)
+  float *const pixels = overlay->pixels;
+  const int box_width = overlay->width;
+  __OMP_PARALLEL_FOR__()
+  for(int y = 0; y < overlay->height; y++)
   {
-    svgdoc = _watermark_get_svgdoc(self, data, &pipe->dev->image_storage, filename);
-    if(IS_NULL_PTR(svgdoc))
+    const guint8 *const s = image + (size_t)(y0 + y) * stride + 4 * x0;
+    float *const p = pixels + (size_t)4 * y * box_width;
+    for(int x = 0; x < box_width; x++)
     {
-      dt_iop_image_copy_by_size(ovoid, ivoid, roi_out->width, roi_out->height, ch);
-      return 0;
+      // cairo's ARGB32 is BGRA in memory on little-endian machines
+      p[4 * x + 0] = s[4 * x + 2] / 255.0f;
+      p[4 * x + 1] = s[4 * x + 1] / 255.0f;
+      p[4 * x + 2] = s[4 * x + 0] / 255.0f;
+      p[4 * x + 3] = s[4 * x + 3] / 255.0f;
     }
   }
+  return overlay;
+}
+
+/* Render the watermark over the whole of roi_out, through rsvg or cairo, and crop it. Returns
+ * what process() returns, with *overlay left NULL when there is nothing to composite. */
+static int _watermark_render(const dt_dev_pixelpipe_iop_t *piece, const dt_iop_watermark_data_t *data,
+                             const dt_iop_watermark_type_t type, const gchar *filename, const gchar *svgdoc,
+                             dt_iop_watermark_overlay_t **overlay)
+{
+  const dt_iop_roi_t *const roi_in = &piece->roi_in;
+  const dt_iop_roi_t *const roi_out = &piece->roi_out;
+  const float angle = (M_PI / 180) * (-data->rotate);
+  *overlay = NULL;
 
   /* setup stride for performance */
   const int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, roi_out->width);
   if(stride == -1)
   {
     fprintf(stderr, "[watermark] cairo stride error\n");
-    dt_iop_image_copy_by_size(ovoid, ivoid, roi_out->width, roi_out->height, ch);
     return 0;
   }
 
   /* create a cairo memory surface that is later used for reading watermark overlay data */
   guint8 *image = (guint8 *)g_try_malloc0_n(roi_out->height, stride);
-  if(IS_NULL_PTR(image))
-  {
-    dt_iop_image_copy_by_size(ovoid, ivoid, roi_out->width, roi_out->height, ch);
-    return 1;
-  }
+  if(IS_NULL_PTR(image)) return 1;
   cairo_surface_t *surface = cairo_image_surface_create_for_data(image, CAIRO_FORMAT_ARGB32, roi_out->width,
                                                                  roi_out->height, stride);
   if(cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS)
@@ -585,7 +714,6 @@ int process(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const
     fprintf(stderr, "[watermark] cairo surface error: %s\n",
             cairo_status_to_string(cairo_surface_status(surface)));
     dt_free(image);
-    dt_iop_image_copy_by_size(ovoid, ivoid, roi_out->width, roi_out->height, ch);
     return 0;
   }
 
@@ -598,12 +726,10 @@ int process(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const
     /* create the rsvghandle from parsed svg data */
     GError *error = NULL;
     svg = rsvg_handle_new_from_data((const guint8 *)svgdoc, strlen(svgdoc), &error);
-    dt_free(svgdoc);
     if(IS_NULL_PTR(svg) || error)
     {
       cairo_surface_destroy(surface);
       dt_free(image);
-      dt_iop_image_copy_by_size(ovoid, ivoid, roi_out->width, roi_out->height, ch);
       dt_pthread_mutex_unlock(dt_plugin_threadsafe_mutex());
       fprintf(stderr, "[watermark] error processing svg file: %s\n", error->message);
       g_error_free(error);
@@ -631,7 +757,6 @@ int process(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const
                 cairo_status_to_string(cairo_surface_status(surface_two)));
         cairo_surface_destroy(surface);
         dt_free(image);
-        dt_iop_image_copy_by_size(ovoid, ivoid, roi_out->width, roi_out->height, ch);
         dt_pthread_mutex_unlock(dt_plugin_threadsafe_mutex());
         return 0;
       }
@@ -742,7 +867,6 @@ int process(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const
       cairo_surface_destroy(surface);
       g_object_unref(svg);
       dt_free(image);
-      dt_iop_image_copy_by_size(ovoid, ivoid, roi_out->width, roi_out->height, ch);
       dt_pthread_mutex_unlock(dt_plugin_threadsafe_mutex());
       return 1;
     }
@@ -756,7 +880,6 @@ int process(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const
       g_object_unref(svg);
       dt_free(image);
       dt_free(image_two);
-      dt_iop_image_copy_by_size(ovoid, ivoid, roi_out->width, roi_out->height, ch);
       dt_pthread_mutex_unlock(dt_plugin_threadsafe_mutex());
       return 0;
     }
@@ -836,22 +959,7 @@ int process(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const
   /* ensure that all operations on surface finishing up */
   cairo_surface_flush(surface);
 
-  /* render surface on output */
-  guint8 *sd = image;
-  const float opacity = data->opacity / 100.0f;
-  __OMP_PARALLEL_FOR__()
-  for(int j = 0; j < roi_out->height * roi_out->width; j++)
-  {
-    float *const i = in + ch*j;
-    float *const o = out + ch*j;
-    guint8 *const s = sd + 4*j;
-    const float alpha = (s[3] / 255.0f) * opacity;
-    /* svg uses a premultiplied alpha, so only use opacity for the blending */
-    o[0] = ((1.0f - alpha) * i[0]) + (opacity * (s[2] / 255.0f));
-    o[1] = ((1.0f - alpha) * i[1]) + (opacity * (s[1] / 255.0f));
-    o[2] = ((1.0f - alpha) * i[2]) + (opacity * (s[0] / 255.0f));
-    o[3] = in[3];
-    }
+  *overlay = _overlay_crop(image, stride, roi_out->width, roi_out->height);
 
   /* clean up */
   cairo_surface_destroy(surface);
@@ -863,6 +971,114 @@ int process(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const
     g_object_unref(svg);
   }
 
+  return IS_NULL_PTR(*overlay) ? 1 : 0;
+}
+
+__DT_CLONE_TARGETS__
+int process(struct dt_iop_module_t *self, const dt_dev_pixelpipe_t *pipe, const dt_dev_pixelpipe_iop_t *piece, const void *const ivoid,
+             void *const ovoid)
+{
+  const dt_iop_roi_t *const roi_out = &piece->roi_out;
+  dt_iop_watermark_data_t *data = (dt_iop_watermark_data_t *)piece->data;
+  dt_iop_watermark_global_data_t *gd = (dt_iop_watermark_global_data_t *)self->global_data;
+  const float *const in = (const float *)ivoid;
+  float *const out = (float *)ovoid;
+  const int ch = 4;
+
+  gchar configdir[PATH_MAX] = { 0 };
+  gchar datadir[PATH_MAX] = { 0 };
+  gchar *filename;
+  dt_loc_get_datadir(datadir, sizeof(datadir));
+  dt_loc_get_user_config_dir(configdir, sizeof(configdir));
+  g_strlcat(datadir, "/watermarks/", sizeof(datadir));
+  g_strlcat(configdir, "/watermarks/", sizeof(configdir));
+  g_strlcat(datadir, data->filename, sizeof(datadir));
+  g_strlcat(configdir, data->filename, sizeof(configdir));
+
+  if(g_file_test(configdir, G_FILE_TEST_EXISTS))
+    filename = configdir;
+  else if(g_file_test(datadir, G_FILE_TEST_EXISTS))
+    filename = datadir;
+  else
+  {
+    dt_iop_image_copy_by_size(ovoid, ivoid, roi_out->width, roi_out->height, ch);
+    return 0;
+  }
+
+  // find out the watermark type
+  dt_iop_watermark_type_t type;
+  const gchar *extension = strrchr(data->filename, '.');
+  if(!IS_NULL_PTR(extension))
+  {
+    if(!g_ascii_strcasecmp(extension, ".svg"))
+      type = DT_WTM_SVG;
+    else if(!g_ascii_strcasecmp(extension, ".png"))
+      type = DT_WTM_PNG;
+    else // this should not happen
+    {
+      dt_iop_image_copy_by_size(ovoid, ivoid, roi_out->width, roi_out->height, ch);
+      return 0;
+    }
+  }
+  else
+  {
+    dt_iop_image_copy_by_size(ovoid, ivoid, roi_out->width, roi_out->height, ch);
+    return 0;
+  }
+
+  /* Load svg if not loaded */
+  gchar *svgdoc = NULL;
+  if(type == DT_WTM_SVG)
+  {
+    svgdoc = _watermark_get_svgdoc(self, data, &pipe->dev->image_storage, filename);
+    if(IS_NULL_PTR(svgdoc))
+    {
+      dt_iop_image_copy_by_size(ovoid, ivoid, roi_out->width, roi_out->height, ch);
+      return 0;
+    }
+  }
+
+  // rendered already, for this image or another one of the same size: no rsvg, no lock
+  const uint64_t key = _overlay_key(piece, data, filename, svgdoc);
+  dt_iop_watermark_overlay_t *overlay = _overlay_lookup(gd, key);
+  if(IS_NULL_PTR(overlay))
+  {
+    const int err = _watermark_render(piece, data, type, filename, svgdoc, &overlay);
+    if(IS_NULL_PTR(overlay))
+    {
+      dt_free(svgdoc);
+      dt_iop_image_copy_by_size(ovoid, ivoid, roi_out->width, roi_out->height, ch);
+      return err;
+    }
+    overlay->key = key;
+    overlay = _overlay_insert(gd, overlay);
+  }
+  dt_free(svgdoc);
+
+  /* render overlay on output */
+  dt_iop_image_copy_by_size(out, in, roi_out->width, roi_out->height, ch);
+
+  const float opacity = data->opacity / 100.0f;
+  const float *const sd = overlay->pixels;
+  const int box_width = overlay->width;
+  const size_t origin = (size_t)overlay->y * roi_out->width + overlay->x;
+  __OMP_PARALLEL_FOR__()
+  for(int j = 0; j < overlay->height; j++)
+  {
+    const size_t offset = ch * (origin + (size_t)j * roi_out->width);
+    const float *const i = in + offset;
+    float *const o = out + offset;
+    const float *const s = sd + (size_t)ch * j * box_width;
+    for(int k = 0; k < box_width; k++)
+    {
+      const float alpha = s[ch * k + 3] * opacity;
+      /* svg uses a premultiplied alpha, so only use opacity for the blending */
+      for(int c = 0; c < 3; c++)
+        o[ch * k + c] = ((1.0f - alpha) * i[ch * k + c]) + (opacity * s[ch * k + c]);
+    }
+  }
+
+  _overlay_release(gd, overlay);
   return 0;
 }
 
@@ -1108,6 +1324,29 @@ void init(dt_iop_module_t *module)
   dt_iop_default_init(module);
 }
 
+void init_global(dt_iop_module_so_t *module)
+{
+  dt_iop_watermark_global_data_t *gd = calloc(1, sizeof(dt_iop_watermark_global_data_t));
+  dt_pthread_mutex_init(&gd->lock, NULL);
+  module->data = gd;
+}
+
+void cleanup_global(dt_iop_module_so_t *module)
+{
+  dt_iop_watermark_global_data_t *gd = (dt_iop_watermark_global_data_t *)module->data;
+  if(IS_NULL_PTR(gd)) return;
+  // pipes are gone by now: the cache holds the last reference of each
+  for(GList *iter = gd->overlays; iter; iter = g_list_next(iter))
+  {
+    dt_iop_watermark_overlay_t *overlay = (dt_iop_watermark_overlay_t *)iter->data;
+    dt_free_align(overlay->pixels);
+    dt_free(overlay);
+  }
+  g_list_free(gd->overlays);
+  dt_pthread_mutex_destroy(&gd->lock);
+  dt_free(module->data);
+}
+
 void reload_defaults(dt_iop_module_t *module)
 {
   dt_iop_watermark_params_t *d = module->default_params;
@@ -478,6 +478,8 @@ static gchar *_create_tooltip_text(const dt_dev_history_item_t *hitem)
     add_blend_history_change_enum(mask_combine & (DEVELOP_COMBINE_INV | DEVELOP_COMBINE_INCL), _("combine masks"), dt_develop_combine_masks_names);
     add_blend_history_change(feathering_radius, "%.4f", _("feathering radius"));
     add_blend_history_change_enum(feathering_guide, _("feathering guide"), dt_develop_feathering_guide_names);
+    add_blend_history_change_enum(feathering_resolution, _("feathering resolution"),
+                                  dt_develop_feathering_resolution_names);
     add_blend_history_change(blur_radius, "%.4f", _("mask blur"));
     add_blend_history_change(contrast, "%.4f", _("mask contrast"));
     add_blend_history_change(brightness, "%.4f", _("brightness"));
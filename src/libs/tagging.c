@@ -93,6 +93,10 @@ typedef struct dt_lib_tagging_t
   GtkTreeStore *attached_treestore, *dictionary_treestore;
   GtkTreeModelFilter *dictionary_listfilter, *dictionary_treefilter;
   GHashTable *collection_tags;
+  GHashTable *keyword_tags; // ids of the tags d->keyword matches, while the dictionary is filtered
+  gchar *completion_key;     // the token the completion popup last matched
+  GHashTable *completion_tags; // ids of the tags it matches, as of completion_generation
+  guint64 completion_generation;
   GtkWidget *floating_tag_window;
   GList *floating_tag_imgs;
   gboolean tree_flag, suggestion_flag, sort_count_flag, hide_path_flag, dttags_flag;
@@ -216,30 +220,36 @@ static void _propagate_sel_to_parents(GtkTreeModel *model, GtkTreeIter *iter)
 static gboolean _set_matching_tag_visibility(GtkTreeModel *model, GtkTreePath *path, GtkTreeIter *iter, dt_lib_module_t *self)
 {
   dt_lib_tagging_t *d = (dt_lib_tagging_t *)self->data;
-  gboolean visible;
-  gchar *tagname = NULL;
-  gchar *synonyms = NULL;
-  gtk_tree_model_get(model, iter, DT_LIB_TAGGING_COL_PATH, &tagname, DT_LIB_TAGGING_COL_SYNONYM, &synonyms, -1);
-  if(!d->keyword[0])
-    visible = TRUE;
-  else
-  {
-    if(synonyms && synonyms[0]) tagname = dt_util_dstrcat(tagname, ", %s", synonyms);
-    gchar *haystack = g_utf8_strdown(tagname, -1);
-    gchar *needle = g_utf8_strdown(d->keyword, -1);
-    visible = (g_strrstr(haystack, needle) != NULL);
-    dt_free(haystack);
-    dt_free(needle);
-  }
+  guint tagid = 0;
+  gboolean was_visible = FALSE;
+  gtk_tree_model_get(model, iter, DT_LIB_TAGGING_COL_ID, &tagid, DT_LIB_TAGGING_COL_VISIBLE, &was_visible, -1);
+
+  // the nodes of the tree that are no tag (id 0) are shown by _tree_reveal_func()
+  // for the tags below them, whose paths contain theirs
+  const gboolean visible = IS_NULL_PTR(d->keyword_tags)
+                           || g_hash_table_contains(d->keyword_tags, GUINT_TO_POINTER(tagid));
+
+  // every set wakes the filter model and the view up, for nothing when the row stays
+  if(visible == was_visible) return FALSE;
+
   if(d->tree_flag)
     gtk_tree_store_set(GTK_TREE_STORE(model), iter, DT_LIB_TAGGING_COL_VISIBLE, visible, -1);
   else
     gtk_list_store_set(GTK_LIST_STORE(model), iter, DT_LIB_TAGGING_COL_VISIBLE, visible, -1);
-  dt_free(tagname);
-  dt_free(synonyms);
   return FALSE;
 }
 
+/* Show the dictionary rows whose path or synonyms contain d->keyword. The tags are matched
+ * once, in the tag name index, and then only looked up per row. */
+static void _filter_dictionary(GtkTreeModel *store, dt_lib_module_t *self)
+{
+  dt_lib_tagging_t *d = (dt_lib_tagging_t *)self->data;
+  d->keyword_tags = d->keyword[0] ? dt_tag_match(d->keyword, TRUE) : NULL;
+  gtk_tree_model_foreach(store, (GtkTreeModelForeachFunc)_set_matching_tag_visibility, self);
+  if(d->keyword_tags) g_hash_table_destroy(d->keyword_tags);
+  d->keyword_tags = NULL;
+}
+
 static gboolean _tree_reveal_func(GtkTreeModel *model, GtkTreePath *path, GtkTreeIter *iter, gpointer data)
 {
   gboolean state;
@@ -528,7 +538,7 @@ static void _init_treeview(dt_lib_module_t *self, const int which)
     }
     if(which && d->keyword[0])  // keyword filtering only applies to the dictionary
     {
-      gtk_tree_model_foreach(store, (GtkTreeModelForeachFunc)_set_matching_tag_visibility, self);
+      _filter_dictionary(store, self);
       gtk_tree_model_foreach(store, (GtkTreeModelForeachFunc)_tree_reveal_func, NULL);
       gtk_tree_view_set_model(GTK_TREE_VIEW(view), model);
     }
@@ -559,7 +569,7 @@ static void _init_treeview(dt_lib_module_t *self, const int which)
     }
     if(which && d->keyword[0])
     {
-      gtk_tree_model_foreach(store, (GtkTreeModelForeachFunc)_set_matching_tag_visibility, self);
+      _filter_dictionary(store, self);
     }
     gtk_tree_view_set_model(GTK_TREE_VIEW(view), model);
     g_object_unref(model);
@@ -1431,7 +1441,7 @@ static void _tag_name_changed(GtkEntry *entry, dt_lib_module_t *self)
   _set_keyword(self);
   GtkTreeModel *model = gtk_tree_view_get_model(d->dictionary_view);
   GtkTreeModel *store = gtk_tree_model_filter_get_model(GTK_TREE_MODEL_FILTER(model));
-  gtk_tree_model_foreach(store, (GtkTreeModelForeachFunc)_set_matching_tag_visibility, self);
+  _filter_dictionary(store, self);
   if(d->tree_flag && d->keyword[0])
   {
     gtk_tree_model_foreach(store, (GtkTreeModelForeachFunc)_tree_reveal_func, NULL);
@@ -2688,8 +2698,8 @@ int position()
   return 3;
 }
 
-// Single-column model feeding the tag entry autocompletion (full tag path).
-enum { DT_COMPL_COL_PATH = 0, DT_COMPL_NUM_COLS };
+// Model feeding the tag entry autocompletion (full tag path, tag id).
+enum { DT_COMPL_COL_PATH = 0, DT_COMPL_COL_ID, DT_COMPL_NUM_COLS };
 
 // (Re)populate the entry autocompletion store with every known tag.
 static void _refresh_completion_store(dt_lib_module_t *self)
@@ -2705,7 +2715,7 @@ static void _refresh_completion_store(dt_lib_module_t *self)
     if(IS_NULL_PTR(tag->tag)) continue;
     GtkTreeIter iter;
     gtk_list_store_append(d->completion_store, &iter);
-    gtk_list_store_set(d->completion_store, &iter, DT_COMPL_COL_PATH, tag->tag, -1);
+    gtk_list_store_set(d->completion_store, &iter, DT_COMPL_COL_PATH, tag->tag, DT_COMPL_COL_ID, tag->id, -1);
   }
   dt_tag_free_result(&tags);
 }
@@ -2804,34 +2814,35 @@ static gboolean _completion_match_func(GtkEntryCompletion *completion, const gch
     lastTag = key;
   }
 
-  char *tag = NULL;
-  gtk_tree_model_get(model, iter, column, &tag, -1);
-
   // nothing typed yet on the active tag token: default the suggestions to the
   // tags used by the current collection opened in lighttable
   if(lastTag[0] == '\0')
   {
+    char *tag = NULL;
+    gtk_tree_model_get(model, iter, column, &tag, -1);
     res = (d && d->collection_tags && tag) ? g_hash_table_contains(d->collection_tags, tag) : FALSE;
     dt_free(tag);
     return res;
   }
 
-  if(tag)
+  if(IS_NULL_PTR(d)) return FALSE;
+
+  // GTK asks once per row and key: match the tag names once per key, in the tag index
+  // (the key comes normalized and casefolded, as the index folds names)
+  if(IS_NULL_PTR(d->completion_tags) || g_strcmp0(d->completion_key, lastTag)
+     || d->completion_generation != dt_tag_names_generation())
   {
-    char *normalized = g_utf8_normalize(tag, -1, G_NORMALIZE_ALL);
-    if(normalized)
-    {
-      char *casefold = g_utf8_casefold(normalized, -1);
-      if(casefold)
-      {
-        res = g_strstr_len(casefold, -1, lastTag) != NULL;
-      }
-      dt_free(casefold);
-    }
-    dt_free(normalized);
-    dt_free(tag);
+    if(d->completion_tags) g_hash_table_destroy(d->completion_tags);
+    dt_free(d->completion_key);
+    d->completion_key = g_strdup(lastTag);
+    d->completion_tags = dt_tag_match(lastTag, FALSE);
+    d->completion_generation = dt_tag_names_generation();
   }
 
+  guint tagid = 0;
+  gtk_tree_model_get(model, iter, DT_COMPL_COL_ID, &tagid, -1);
+  res = g_hash_table_contains(d->completion_tags, GUINT_TO_POINTER(tagid));
+
   return res;
 }
 
@@ -3248,7 +3259,7 @@ void gui_init(dt_lib_module_t *self)
   // current collection's tags when the entry holds a single token (see _completion_match_func).
   // minimum key length 1: an empty entry shows no popup, so the list does not hover over the
   // attached-tags view (e.g. right after a tag was attached and the entry cleared).
-  d->completion_store = gtk_list_store_new(DT_COMPL_NUM_COLS, G_TYPE_STRING);
+  d->completion_store = gtk_list_store_new(DT_COMPL_NUM_COLS, G_TYPE_STRING, G_TYPE_UINT);
   {
     GtkEntryCompletion *completion = gtk_entry_completion_new();
     gtk_entry_completion_set_model(completion, GTK_TREE_MODEL(d->completion_store));
@@ -3491,6 +3502,8 @@ void gui_cleanup(dt_lib_module_t *self)
   DT_DEBUG_CONTROL_SIGNAL_DISCONNECT(dt_control_signal_get_global(), G_CALLBACK(_collection_updated_callback), self);
   if(d->manage_window) gtk_widget_destroy(d->manage_window);
   if(d->collection_tags) g_hash_table_destroy(d->collection_tags);
+  if(d->completion_tags) g_hash_table_destroy(d->completion_tags);
+  dt_free(d->completion_key);
   // d kept its own ref on both attached stores so the view could switch between them
   if(d->attached_liststore) g_object_unref(d->attached_liststore);
   if(d->attached_treestore) g_object_unref(d->attached_treestore);
@@ -0,0 +1,333 @@
+/*
+    This file is part of Ansel,
+    Copyright (C) 2026 Aurélien PIERRE.
+
+    Ansel is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ansel is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ansel.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "math/clustering.h"
+#include "system/macros.h"
+#include "system/mem_alloc.h"
+#include "system/openmp.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+/* ------------------------- the KD-tree ------------------------- */
+
+// points a leaf holds: below this, scanning beats descending
+#define KD_LEAF_SIZE 8
+
+typedef struct _kd_point_t
+{
+  double x, y;
+  int index; // in the caller's array
+} _kd_point_t;
+
+typedef struct _kd_node_t
+{
+  double x0, y0, x1, y1; // bounding box of the node's points
+  int alive;             // of those, how many are still in the tree
+} _kd_node_t;
+
+/* A balanced tree over a permutation of the points: every node covers a contiguous range of
+ * `points`, split in halves at the median, so the ranges are implied by the node index and never
+ * stored. The children of node k are 2k + 1 and 2k + 2. */
+typedef struct _kd_tree_t
+{
+  _kd_point_t *points;
+  _kd_node_t *nodes;
+  int count;
+} _kd_tree_t;
+
+static inline double _kd_coord(const _kd_point_t *p, const int axis)
+{
+  return axis ? p->y : p->x;
+}
+
+// put the k-th smallest of points[lo .. hi] along axis at k, the smaller ones before it
+static void _kd_select(_kd_point_t *points, int lo, int hi, const int k, const int axis)
+{
+  while(lo < hi)
+  {
+    const double pivot = _kd_coord(&points[lo + (hi - lo) / 2], axis);
+    int i = lo, j = hi;
+    while(i <= j)
+    {
+      while(_kd_coord(&points[i], axis) < pivot) i++;
+      while(_kd_coord(&points[j], axis) > pivot) j--;
+      if(i <= j)
+      {
+        const _kd_point_t swap = points[i];
+        points[i] = points[j];
+        points[j] = swap;
+        i++;
+        j--;
+      }
+    }
+    if(k <= j)
+      hi = j;
+    else if(k >= i)
+      lo = i;
+    else
+      return; // k landed among the values equal to the pivot
+  }
+}
+
+static void _kd_build_node(_kd_tree_t *tree, const int node, const int start, const int end)
+{
+  _kd_node_t *n = &tree->nodes[node];
+  n->x0 = n->x1 = tree->points[start].x;
+  n->y0 = n->y1 = tree->points[start].y;
+  for(int k = start + 1; k < end; k++)
+  {
+    n->x0 = MIN(n->x0, tree->points[k].x);
+    n->x1 = MAX(n->x1, tree->points[k].x);
+    n->y0 = MIN(n->y0, tree->points[k].y);
+    n->y1 = MAX(n->y1, tree->points[k].y);
+  }
+  n->alive = end - start;
+  if(end - start <= KD_LEAF_SIZE) return;
+
+  // split across the longer side, to keep the boxes square-ish
+  const int axis = (n->y1 - n->y0 > n->x1 - n->x0);
+  const int mid = start + (end - start) / 2;
+  _kd_select(tree->points, start, end - 1, mid, axis);
+  _kd_build_node(tree, 2 * node + 1, start, mid);
+  _kd_build_node(tree, 2 * node + 2, mid, end);
+}
+
+static gboolean _kd_build(_kd_tree_t *tree, const double *xy, const int count)
+{
+  // a child holds at most half its parent, rounded up
+  int size = count, levels = 0;
+  while(size > KD_LEAF_SIZE)
+  {
+    size = (size + 1) / 2;
+    levels++;
+  }
+
+  tree->count = count;
+  tree->points = malloc(sizeof(_kd_point_t) * count);
+  tree->nodes = malloc(sizeof(_kd_node_t) * ((2 << levels) - 1));
+  if(IS_NULL_PTR(tree->points) || IS_NULL_PTR(tree->nodes)) return FALSE;
+
+  for(int i = 0; i < count; i++)
+    tree->points[i] = (_kd_point_t){ .x = xy[2 * i], .y = xy[2 * i + 1], .index = i };
+  _kd_build_node(tree, 0, 0, count);
+  return TRUE;
+}
+
+static void _kd_cleanup(_kd_tree_t *tree)
+{
+  dt_free(tree->points);
+  dt_free(tree->nodes);
+}
+
+/* The neighbourhood test is |dx| <= epsilon on both axes, written the same way everywhere so that
+ * it stays symmetric under rounding: b is a neighbour of a exactly when a is one of b. The node
+ * tests below bound it from the box corners, which rounding preserves. */
+static inline gboolean _kd_near(const _kd_point_t *p, const double x, const double y, const double epsilon)
+{
+  return fabs(p->x - x) <= epsilon && fabs(p->y - y) <= epsilon;
+}
+
+static inline gboolean _kd_outside(const _kd_node_t *n, const double x, const double y, const double epsilon)
+{
+  return n->x0 - x > epsilon || x - n->x1 > epsilon || n->y0 - y > epsilon || y - n->y1 > epsilon;
+}
+
+static inline gboolean _kd_inside(const _kd_node_t *n, const double x, const double y, const double epsilon)
+{
+  return n->x1 - x <= epsilon && x - n->x0 <= epsilon && n->y1 - y <= epsilon && y - n->y0 <= epsilon;
+}
+
+// neighbours of (x, y) in the whole tree, counting stops once it reaches limit
+static int _kd_count(const _kd_tree_t *tree, const int node, const int start, const int end, const double x,
+                     const double y, const double epsilon, const int limit)
+{
+  const _kd_node_t *n = &tree->nodes[node];
+  if(_kd_outside(n, x, y, epsilon)) return 0;
+  if(_kd_inside(n, x, y, epsilon)) return end - start;
+
+  if(end - start <= KD_LEAF_SIZE)
+  {
+    int found = 0;
+    for(int k = start; k < end; k++) found += _kd_near(&tree->points[k], x, y, epsilon);
+    return found;
+  }
+
+  const int mid = start + (end - start) / 2;
+  const int left = _kd_count(tree, 2 * node + 1, start, mid, x, y, epsilon, limit);
+  if(left >= limit) return left;
+  return left + _kd_count(tree, 2 * node + 2, mid, end, x, y, epsilon, limit - left);
+}
+
+// take the neighbours of (x, y) still in the tree out of it, appending their positions to out
+static int _kd_take(_kd_tree_t *tree, guint8 *alive, const int node, const int start, const int end,
+                    const double x, const double y, const double epsilon, int *out, int *taken)
+{
+  _kd_node_t *n = &tree->nodes[node];
+  if(n->alive == 0 || _kd_outside(n, x, y, epsilon)) return 0;
+
+  int removed = 0;
+  if(end - start <= KD_LEAF_SIZE)
+  {
+    for(int k = start; k < end; k++)
+    {
+      if(!alive[k] || !_kd_near(&tree->points[k], x, y, epsilon)) continue;
+      alive[k] = FALSE;
+      out[(*taken)++] = k;
+      removed++;
+    }
+  }
+  else
+  {
+    const int mid = start + (end - start) / 2;
+    removed = _kd_take(tree, alive, 2 * node + 1, start, mid, x, y, epsilon, out, taken)
+              + _kd_take(tree, alive, 2 * node + 2, mid, end, x, y, epsilon, out, taken);
+  }
+  n->alive -= removed;
+  return removed;
+}
+
+/* ------------------------- DBSCAN ------------------------- */
+
+// starting point taken from https://github.com/gyaikhom/dbscan
+// Copyright 2015 Gagarine Yaikhom (MIT License)
+
+// chain: every point reached searches further, not only the core ones
+static int _cluster_grow(const double *xy, const int count, const double epsilon, const int minpts,
+                         int *labels, const gboolean chain)
+{
+  if(count <= 0) return 0;
+
+  _kd_tree_t tree = { 0 };
+  guint8 *core = malloc(count);
+  guint8 *alive = malloc(count);
+  int *position = malloc(sizeof(int) * count);
+  int *queue = malloc(sizeof(int) * count);
+  if(IS_NULL_PTR(core) || IS_NULL_PTR(alive) || IS_NULL_PTR(position) || IS_NULL_PTR(queue)
+     || !_kd_build(&tree, xy, count))
+  {
+    _kd_cleanup(&tree);
+    dt_free(core);
+    dt_free(alive);
+    dt_free(position);
+    dt_free(queue);
+    return -1;
+  }
+
+  // which points are core: independent read-only queries, in tree order so that neighbouring
+  // threads walk neighbouring branches
+  const int needed = MAX(minpts, 1);
+  __OMP_PARALLEL_FOR__()
+  for(int k = 0; k < count; k++)
+  {
+    const _kd_point_t *p = &tree.points[k];
+    core[k] = _kd_count(&tree, 0, 0, count, p->x, p->y, epsilon, needed) >= needed;
+  }
+
+  for(int k = 0; k < count; k++)
+  {
+    position[tree.points[k].index] = k;
+    alive[k] = TRUE;
+    labels[k] = DT_CLUSTER_NOISE;
+  }
+
+  /* Grow the clusters from the core points, in the caller's order. A point leaves the tree as soon
+   * as a cluster reaches it, which is final: a core point it neighbours either expands into this
+   * same cluster or has already claimed it for its own. So each point is found once, and only core
+   * points search further, unless chaining. */
+  int clusters = 0;
+  for(int i = 0; i < count; i++)
+  {
+    const int seed = position[i];
+    if(!core[seed] || !alive[seed]) continue;
+
+    int head = 0, tail = 0;
+    _kd_take(&tree, alive, 0, 0, count, tree.points[seed].x, tree.points[seed].y, epsilon, queue, &tail);
+    while(head < tail)
+    {
+      const int k = queue[head++];
+      const _kd_point_t *p = &tree.points[k];
+      labels[p->index] = clusters;
+      if(chain || core[k]) _kd_take(&tree, alive, 0, 0, count, p->x, p->y, epsilon, queue, &tail);
+    }
+    clusters++;
+  }
+
+  _kd_cleanup(&tree);
+  dt_free(core);
+  dt_free(alive);
+  dt_free(position);
+  dt_free(queue);
+  return clusters;
+}
+
+int dt_cluster_dbscan(const double *xy, const int count, const double epsilon, const int minpts,
+                      int *labels)
+{
+  return _cluster_grow(xy, count, epsilon, minpts, labels, FALSE);
+}
+
+int dt_cluster_linkage(const double *xy, const int count, const double epsilon, const int minpts,
+                       int *labels)
+{
+  return _cluster_grow(xy, count, epsilon, minpts, labels, TRUE);
+}
+
+/* ------------------------- gaps on a line ------------------------- */
+
+typedef struct _gap_value_t
+{
+  double value;
+  int index;
+} _gap_value_t;
+
+static int _gap_value_cmp(const void *a, const void *b)
+{
+  const _gap_value_t *x = (const _gap_value_t *)a;
+  const _gap_value_t *y = (const _gap_value_t *)b;
+  if(x->value != y->value) return x->value < y->value ? -1 : 1;
+  return (x->index > y->index) - (x->index < y->index);
+}
+
+int dt_cluster_gaps(const double *values, const int count, const double max_gap, int *labels)
+{
+  if(count <= 0) return 0;
+
+  _gap_value_t *sorted = malloc(sizeof(_gap_value_t) * count);
+  if(IS_NULL_PTR(sorted)) return -1;
+
+  for(int i = 0; i < count; i++) sorted[i] = (_gap_value_t){ .value = values[i], .index = i };
+  qsort(sorted, count, sizeof(_gap_value_t), _gap_value_cmp);
+
+  int segment = 0;
+  labels[sorted[0].index] = 0;
+  for(int k = 1; k < count; k++)
+  {
+    if(sorted[k].value - sorted[k - 1].value > max_gap) segment++;
+    labels[sorted[k].index] = segment;
+  }
+
+  dt_free(sorted);
+  return segment + 1;
+}
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
@@ -0,0 +1,93 @@
+/*
+    This file is part of Ansel,
+    Copyright (C) 2026 Aurélien PIERRE.
+
+    Ansel is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ansel is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ansel.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DT_MATH_CLUSTERING_H
+#define DT_MATH_CLUSTERING_H
+
+/**
+ * @file clustering.h
+ * @brief Grouping points that lie close together: DBSCAN in the plane, gap segmentation on a line.
+ *
+ * Both take plain coordinate arrays and write one label per point, in the caller's order, so they
+ * serve the map's thumbnail clusters as well as grouping a shoot by capture time or place. They
+ * keep no state between calls and may run concurrently on different inputs.
+ */
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/** Label of a point that belongs to no cluster. */
+#define DT_CLUSTER_NOISE -1
+
+/**
+ * @brief DBSCAN over 2D points, with a square neighbourhood.
+ *
+ * @details The neighbours of a point are the points within @p epsilon of it along both axes,
+ * itself included. A point with at least @p minpts neighbours is a core point; core points that
+ * are neighbours of each other share a cluster, and the other points join the first cluster that
+ * reaches them through a core neighbour, or stay noise. Clusters are numbered from 0 in the order of
+ * their lowest-indexed core point, so the result only depends on the input.
+ *
+ * The points go in a KD-tree. The neighbour counts, which dominate, run in parallel; the cluster
+ * growth takes each point out of the tree as it is labelled, so a large cluster is not searched
+ * again and again.
+ *
+ * @param xy @p count points as interleaved x, y.
+ * @param minpts neighbours, the point itself included, that make a core point. With 1, every
+ *        point is a cluster of its own at least; with 2, isolated points are noise.
+ * @param labels @p count cluster ids out, @ref DT_CLUSTER_NOISE for noise.
+ * @return the number of clusters, or -1 when out of memory.
+ */
+int dt_cluster_dbscan(const double *xy, const int count, const double epsilon, const int minpts,
+                      int *labels);
+
+/**
+ * @brief Single-linkage groups over 2D points: DBSCAN where every member reaches further.
+ *
+ * @details Same neighbourhood, core points and numbering as dt_cluster_dbscan(), but a cluster
+ * takes in every point connected to one of its core points through any chain of neighbours, core
+ * or not. So a cluster is a whole connected group, kept when it holds at least one core point; the
+ * other groups are noise. This is how the map has always grouped its thumbnails.
+ *
+ * @return the number of clusters, or -1 when out of memory.
+ */
+int dt_cluster_linkage(const double *xy, const int count, const double epsilon, const int minpts,
+                       int *labels);
+
+/**
+ * @brief Split points on a line wherever two consecutive ones are more than @p max_gap apart.
+ *
+ * @details Meant for capture times: a shoot is a run of shots with no pause longer than
+ * @p max_gap between them. Every point gets a segment, numbered from 0 along the line, whatever
+ * the order of @p values.
+ *
+ * @param labels @p count segment ids out.
+ * @return the number of segments, or -1 when out of memory.
+ */
+int dt_cluster_gaps(const double *values, const int count, const double max_gap, int *labels);
+
+G_END_DECLS
+
+#endif // DT_MATH_CLUSTERING_H
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
@@ -1285,6 +1285,16 @@ uint32_t dt_tag_get_tag_id_by_name(const char * const name)
   return dt_tag_repository_find_by_name_nocase(name);
 }
 
+GHashTable *dt_tag_match(const char *needle, const gboolean synonyms)
+{
+  return dt_tag_repository_match(needle, synonyms);
+}
+
+guint64 dt_tag_names_generation(void)
+{
+  return dt_tag_repository_index_generation();
+}
+
 void dt_tag_set_tag_order_by_id(const uint32_t tagid, const uint32_t sort,
                                 const gboolean descending)
 {
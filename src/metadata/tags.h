@@ -234,6 +234,13 @@ void dt_tag_set_tag_order_by_id(const uint32_t tagid, const uint32_t sort,
 /** return the tagid of that tag - follow tag sensitivity - return 0 if not found*/
 uint32_t dt_tag_get_tag_id_by_name(const char * const name);
 
+/** the ids of the tags whose name, or with synonyms also whose synonyms, contain needle,
+ *  ignoring case - a set of GUINT_TO_POINTER keys, free with g_hash_table_destroy() */
+GHashTable *dt_tag_match(const char *needle, const gboolean synonyms);
+
+/** moves whenever a tag name or synonym changes: tag sets from dt_tag_match() are stale */
+guint64 dt_tag_names_generation(void);
+
 /** init the darktable tags table */
 void dt_set_darktable_tags();
 
@@ -1113,37 +1113,6 @@ int dt_box_mean_vertical(float *const buf, const size_t height, const size_t wid
   return 1;
 }
 
-static inline float window_max(const float *x, int n)
-{
-  float m = -(FLT_MAX);
-  __OMP_SIMD__(reduction(max : m))
-  for(int j = 0; j < n; j++)
-    m = MAX(m, x[j]);
-  return m;
-}
-
-// calculate the one-dimensional moving maximum over a window of size 2*w+1
-// input array x has stride 1, output array y has stride stride_y
-static inline void box_max_1d(int N, const float *const restrict x, float *const restrict y, size_t stride_y, int w)
-{
-  float m = window_max(x, MIN(w + 1, N));
-  for(int i = 0; i < N; i++)
-  {
-    // store maximum of current window at center position
-    y[i * stride_y] = m;
-    // if the earliest member of the current window is the max, we need to
-    // rescan the window to determine the new maximum
-    if(i - w >= 0 && x[i - w] == m)
-    {
-      const int start = i - w + 1;
-      m = window_max(x + start, MIN(i + w + 2, N) - start);
-    }
-    // if the window has not yet exceeded the end of the row/column, update the maximum value
-    if(i + w + 1 < N)
-      m = MAX(x[i + w + 1], m);
-  }
-}
-
 __DT_CLONE_TARGETS__
 static void set_16wide(float *const restrict out, const float value)
 {
@@ -1152,72 +1121,130 @@ static void set_16wide(float *const restrict out, const float value)
     out[c] = value;
 }
 
-static inline void update_max_16wide(float m[16], const float *const restrict base)
+/* Running minimum and maximum: van Herk / Gil-Werman.
+ *
+ * The window of 2w+1 samples centred on each output is clipped to the image, which is the same
+ * as padding the sequence with w identity samples (-FLT_MAX for max, FLT_MAX for min) on each
+ * side. The padded sequence of length N+2w is cut into blocks of k = 2w+1 samples; a window of
+ * k consecutive samples then covers the tail of one block and the head of the next, so its
+ * extremum is the extremum of a per-block suffix scan and a per-block prefix scan:
+ *
+ *   y[i] = op(suffix[i], prefix[i + 2w])       (padded coordinates)
+ *
+ * That is three comparisons per sample whatever the radius, where the previous scan rescanned
+ * the whole window each time its extremum slid out -- O(w) per sample on monotonic ramps, which
+ * is exactly what transmission maps and masks are made of.
+ *
+ * Scratch layout, per 1-D run of N samples: `prefix' then `suffix', each N+2w floats (times 16
+ * for the 16-wide column variant). The input is read once into `prefix', so in-place operation
+ * is safe. */
+
+// scratch floats needed by one thread for one run of n samples with radius w, 'lanes' wide
+static inline size_t _box_minmax_scratch_size(const size_t n, const size_t w, const size_t lanes)
 {
-  __OMP_SIMD__(aligned(m, base : 64))
-  for (size_t c = 0; c < 16; c++)
-  {
-    m[c] = fmaxf(m[c], base[c]);
-  }
+  return 2 * lanes * (n + 2 * w);
 }
 
-static inline void load_update_max_16wide(float *const restrict out, float m[16], const float *const restrict base)
+// one-dimensional moving maximum over a window of size 2*w+1
+// input array x has stride stride_x, output array y has stride stride_y, they may alias
+static inline void box_max_1d(const int N, const float *const x, const size_t stride_x, float *const y,
+                              const size_t stride_y, const int w, float *const restrict scratch)
 {
-  __OMP_SIMD__(aligned(out, m : 64))
-  for (size_t c = 0; c < 16; c++)
+  const int k = 2 * w + 1;
+  const int M = N + 2 * w;
+  float *const restrict prefix = scratch;
+  float *const restrict suffix = scratch + M;
+
+  for(int j = 0; j < w; j++) prefix[j] = -(FLT_MAX);
+  for(int j = 0; j < N; j++) prefix[w + j] = x[j * stride_x];
+  for(int j = N + w; j < M; j++) prefix[j] = -(FLT_MAX);
+
+  for(int start = 0; start < M; start += k)
   {
-    const float v = base[c];
-    out[c] = v;
-    m[c] = fmaxf(m[c], v);
+    const int end = MIN(start + k, M);
+    // suffix scan first: the prefix scan below overwrites the padded copy in place
+    float m = -(FLT_MAX);
+    for(int j = end - 1; j >= start; j--)
+    {
+      m = fmaxf(m, prefix[j]);
+      suffix[j] = m;
+    }
+    m = -(FLT_MAX);
+    for(int j = start; j < end; j++)
+    {
+      m = fmaxf(m, prefix[j]);
+      prefix[j] = m;
+    }
   }
+
+  for(int i = 0; i < N; i++)
+    y[i * stride_y] = fmaxf(suffix[i], prefix[i + 2 * w]);
 }
 
-// calculate the one-dimensional moving maximum on four adjacent columns over a window of size 2*w+1
-// input/output array 'buf' has stride 'stride' and we will write 16 consecutive elements every stride elements
-// (thus processing a cache line at a time)
-static inline void box_max_vert_16wide(const int N, float *const restrict scratch, float *const restrict buf,
-                                       const int stride, const int w, const size_t mask)
+// one-dimensional moving maximum on 16 adjacent columns over a window of size 2*w+1
+// input/output array 'buf' has stride 'stride' and we read/write 16 consecutive elements every
+// stride elements (thus processing a cache line at a time)
+__DT_CLONE_TARGETS__
+static void box_max_vert_16wide(const int N, float *const restrict scratch, float *const restrict buf,
+                                const size_t stride, const int w)
 {
-  float DT_ALIGNED_ARRAY m[16] = { -(FLT_MAX), -(FLT_MAX), -(FLT_MAX), -(FLT_MAX),
-                                   -(FLT_MAX), -(FLT_MAX), -(FLT_MAX), -(FLT_MAX),
-                                   -(FLT_MAX), -(FLT_MAX), -(FLT_MAX), -(FLT_MAX),
-                                   -(FLT_MAX), -(FLT_MAX), -(FLT_MAX), -(FLT_MAX) };
-  for(size_t i = 0; i < MIN(w + 1, N); i++)
-  {
-    PREFETCH_NTA(buf + stride*(i+24));
-    load_update_max_16wide(scratch + 16 * (i&mask),m, buf + stride*i);
-  }
-  for(size_t i = 0; i < N; i++)
-  {
-    PREFETCH_NTA(buf + stride*(i+24));
-    // store maximum of current window at center position
-    store_16wide(buf + stride * i, m);
-    // If the earliest member of the current window is the max, we need to
-    // rescan the window to determine the new maximum
-    if (i >= w)
+  const int k = 2 * w + 1;
+  const int M = N + 2 * w;
+  float *const restrict prefix = DT_IS_ALIGNED(scratch);
+  float *const restrict suffix = DT_IS_ALIGNED(scratch + 16 * (size_t)M);
+
+  for(int j = 0; j < w; j++)
+    set_16wide(prefix + 16 * j, -(FLT_MAX));
+  for(int j = 0; j < N; j++)
+  {
+    PREFETCH_NTA(buf + stride * (j + 24));
+    __OMP_SIMD__(aligned(prefix : 64))
+    for(size_t c = 0; c < 16; c++)
+      prefix[16 * (size_t)(w + j) + c] = buf[stride * j + c];
+  }
+  for(int j = N + w; j < M; j++)
+    set_16wide(prefix + 16 * j, -(FLT_MAX));
+
+  for(int start = 0; start < M; start += k)
+  {
+    const int end = MIN(start + k, M);
+    float DT_ALIGNED_ARRAY m[16];
+    set_16wide(m, -(FLT_MAX));
+    for(int j = end - 1; j >= start; j--)
     {
-      set_16wide(m, -(FLT_MAX));  // reset max values to lowest possible
-      for(int j = i - w + 1; j < MIN(i + w + 1, N); j++)
+      __OMP_SIMD__(aligned(m, prefix, suffix : 64))
+      for(size_t c = 0; c < 16; c++)
       {
-        update_max_16wide(m,scratch + 16*(j&mask));
+        m[c] = fmaxf(m[c], prefix[16 * (size_t)j + c]);
+        suffix[16 * (size_t)j + c] = m[c];
       }
     }
-    // if the window has not yet exceeded the end of the row/column, update the maximum value
-    const size_t n = i + w + 1;
-    if(n < N)
+    set_16wide(m, -(FLT_MAX));
+    for(int j = start; j < end; j++)
     {
-      load_update_max_16wide(scratch + 16 * (n&mask), m, buf + stride * n);
+      __OMP_SIMD__(aligned(m, prefix : 64))
+      for(size_t c = 0; c < 16; c++)
+      {
+        m[c] = fmaxf(m[c], prefix[16 * (size_t)j + c]);
+        prefix[16 * (size_t)j + c] = m[c];
+      }
     }
   }
+
+  for(int i = 0; i < N; i++)
+  {
+    __OMP_SIMD__(aligned(prefix, suffix : 64))
+    for(size_t c = 0; c < 16; c++)
+      buf[stride * i + c] = fmaxf(suffix[16 * (size_t)i + c], prefix[16 * (size_t)(i + 2 * w) + c]);
+  }
 }
 
 // calculate the two-dimensional moving maximum over a box of size (2*w+1) x (2*w+1)
-// does the calculation in-place if input and output images are identical
+// does the calculation in-place
 __DT_CLONE_TARGETS__
 static int box_max_1ch(float *const buf, const size_t height, const size_t width, const unsigned w)
 {
-  const size_t eff_height = _compute_effective_height(height, w);
-  const size_t scratch_size = MAX(width,MAX(height,16*eff_height));
+  const size_t scratch_size = MAX(_box_minmax_scratch_size(width, w, 1), _box_minmax_scratch_size(height, w, 16));
   size_t allocsize;
   float *const restrict scratch_buffers = dt_pixelpipe_cache_alloc_perthread_float(scratch_size,&allocsize);
   if(IS_NULL_PTR(scratch_buffers)) return 1;
@@ -1225,22 +1252,20 @@ static int box_max_1ch(float *const buf, const size_t height, const size_t width
   for(size_t row = 0; row < height; row++)
   {
     float *const restrict scratch = dt_get_perthread(scratch_buffers,allocsize);
-    memcpy(scratch, buf + row * width, sizeof(float) * width);
-    box_max_1d(width, scratch, buf + row * width, 1, w);
+    box_max_1d(width, buf + row * width, 1, buf + row * width, 1, w, scratch);
   }
   __OMP_PARALLEL_FOR__()
-  for(int col = 0; col < (width & ~15); col += 16)
+  for(size_t col = 0; col < (width & ~15); col += 16)
   {
     float *const restrict scratch = dt_get_perthread(scratch_buffers,allocsize);
-    box_max_vert_16wide(height, scratch, buf + col, width, w, eff_height-1);
+    box_max_vert_16wide(height, scratch, buf + col, width, w);
   }
   // handle the leftover 0..15 columns
-  for (size_t col = width & ~15 ; col < width; col++)
+  __OMP_PARALLEL_FOR__()
+  for(size_t col = width & ~15 ; col < width; col++)
   {
-    float *const restrict scratch = scratch_buffers;
-    for(size_t row = 0; row < height; row++)
-      scratch[row] = buf[row * width + col];
-    box_max_1d(height, scratch, buf + col, width, w);
+    float *const restrict scratch = dt_get_perthread(scratch_buffers,allocsize);
+    box_max_1d(height, buf + col, width, buf + col, width, w, scratch);
   }
   dt_pixelpipe_cache_free_align(scratch_buffers);
   return 0;
@@ -1258,101 +1283,103 @@ int dt_box_max(float *const buf, const size_t height, const size_t width, const
   return 1;
 }
 
-static inline float window_min(const float *x, int n)
+// one-dimensional moving minimum over a window of size 2*w+1, see box_max_1d()
+static inline void box_min_1d(const int N, const float *const x, const size_t stride_x, float *const y,
+                              const size_t stride_y, const int w, float *const restrict scratch)
 {
-  float m = FLT_MAX;
-  __OMP_SIMD__(reduction(min : m))
-  for(int j = 0; j < n; j++)
-    m = MIN(m, x[j]);
-  return m;
-}
+  const int k = 2 * w + 1;
+  const int M = N + 2 * w;
+  float *const restrict prefix = scratch;
+  float *const restrict suffix = scratch + M;
 
-// calculate the one-dimensional moving minimum over a window of size 2*w+1
-// input array x has stride 1, output array y has stride stride_y
-static inline void box_min_1d(int N, const float *x, float *y, size_t stride_y, int w)
-{
-  float m = window_min(x, MIN(w + 1, N));
-  for(int i = 0; i < N; i++)
+  for(int j = 0; j < w; j++) prefix[j] = FLT_MAX;
+  for(int j = 0; j < N; j++) prefix[w + j] = x[j * stride_x];
+  for(int j = N + w; j < M; j++) prefix[j] = FLT_MAX;
+
+  for(int start = 0; start < M; start += k)
   {
-    y[i * stride_y] = m;
-    if(i - w >= 0 && x[i - w] == m)
+    const int end = MIN(start + k, M);
+    float m = FLT_MAX;
+    for(int j = end - 1; j >= start; j--)
+    {
+      m = fminf(m, prefix[j]);
+      suffix[j] = m;
+    }
+    m = FLT_MAX;
+    for(int j = start; j < end; j++)
     {
-      const int start = (i - w + 1);
-      m = window_min(x + start, MIN((i + w + 2), N) - start);
+      m = fminf(m, prefix[j]);
+      prefix[j] = m;
     }
-    // if the window has not yet exceeded the end of the row/column, update the minimum value
-    if(i + w + 1 < N)
-      m = MIN(x[i + w + 1], m);
   }
-}
 
-static inline void update_min_16wide(float m[16], const float *const restrict base)
-{
-  __OMP_SIMD__(aligned(m, base : 64))
-  for (size_t c = 0; c < 16; c++)
-  {
-    m[c] = fminf(m[c], base[c]);
-  }
+  for(int i = 0; i < N; i++)
+    y[i * stride_y] = fminf(suffix[i], prefix[i + 2 * w]);
 }
 
-static inline void load_update_min_16wide(float *const restrict out, float m[16], const float *const restrict base)
+// one-dimensional moving minimum on 16 adjacent columns, see box_max_vert_16wide()
+__DT_CLONE_TARGETS__
+static void box_min_vert_16wide(const int N, float *const restrict scratch, float *const restrict buf,
+                                const size_t stride, const int w)
 {
-  __OMP_SIMD__(aligned(out, m : 64))
-  for (size_t c = 0; c < 16; c++)
+  const int k = 2 * w + 1;
+  const int M = N + 2 * w;
+  float *const restrict prefix = DT_IS_ALIGNED(scratch);
+  float *const restrict suffix = DT_IS_ALIGNED(scratch + 16 * (size_t)M);
+
+  for(int j = 0; j < w; j++)
+    set_16wide(prefix + 16 * j, FLT_MAX);
+  for(int j = 0; j < N; j++)
   {
-    const float v = base[c];
-    out[c] = v;
-    m[c] = fminf(m[c], v);
+    PREFETCH_NTA(buf + stride * (j + 24));
+    __OMP_SIMD__(aligned(prefix : 64))
+    for(size_t c = 0; c < 16; c++)
+      prefix[16 * (size_t)(w + j) + c] = buf[stride * j + c];
   }
-}
+  for(int j = N + w; j < M; j++)
+    set_16wide(prefix + 16 * j, FLT_MAX);
 
-// calculate the one-dimensional moving minimum on four adjacent columns over a window of size 2*w+1
-// input/output array 'buf' has stride 'stride' and we will write 16 consecutive elements every stride elements
-// (thus processing a cache line at a time)
-static inline void box_min_vert_16wide(const int N, float *const restrict scratch, float *const restrict buf,
-                                       const int stride, const int w, const size_t mask)
-{
-  float DT_ALIGNED_ARRAY m[16] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX,
-                                   FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX,
-                                   FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX,
-                                   FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
-  for(size_t i = 0; i < MIN(w + 1, N); i++)
-  {
-    PREFETCH_NTA(buf + stride*(i+24));
-    load_update_min_16wide(scratch + 16*(i&mask), m, buf + stride*i);
-  }
-  for(size_t i = 0; i < N; i++)
-  {
-    PREFETCH_NTA(buf + stride*(i+24));
-    // store minimum of current window at center position
-    store_16wide(buf + i * stride, m);
-    // If the earliest member of the current window is the min, we need to
-    // rescan the window to determine the new minimum
-    if (i >= w)
+  for(int start = 0; start < M; start += k)
+  {
+    const int end = MIN(start + k, M);
+    float DT_ALIGNED_ARRAY m[16];
+    set_16wide(m, FLT_MAX);
+    for(int j = end - 1; j >= start; j--)
     {
-      set_16wide(m, FLT_MAX);  // reset min values to the highest possible
-      for(int j = i - w + 1; j < MIN(i + w + 1, N); j++)
+      __OMP_SIMD__(aligned(m, prefix, suffix : 64))
+      for(size_t c = 0; c < 16; c++)
       {
-        update_min_16wide(m,scratch + 16*(j&mask));
+        m[c] = fminf(m[c], prefix[16 * (size_t)j + c]);
+        suffix[16 * (size_t)j + c] = m[c];
       }
     }
-    // if the window has not yet exceeded the end of the row/column, update the minimum value
-    const size_t n = i + w + 1;
-    if(n < N)
+    set_16wide(m, FLT_MAX);
+    for(int j = start; j < end; j++)
     {
-      load_update_min_16wide(scratch + 16 * (n&mask), m, buf + stride * n);
+      __OMP_SIMD__(aligned(m, prefix : 64))
+      for(size_t c = 0; c < 16; c++)
+      {
+        m[c] = fminf(m[c], prefix[16 * (size_t)j + c]);
+        prefix[16 * (size_t)j + c] = m[c];
+      }
     }
   }
+
+  for(int i = 0; i < N; i++)
+  {
+    __OMP_SIMD__(aligned(prefix, suffix : 64))
+    for(size_t c = 0; c < 16; c++)
+      buf[stride * i + c] = fminf(suffix[16 * (size_t)i + c], prefix[16 * (size_t)(i + 2 * w) + c]);
+  }
 }
 
 
 // calculate the two-dimensional moving minimum over a box of size (2*w+1) x (2*w+1)
-// does the calculation in-place if input and output images are identical
+// does the calculation in-place
 __DT_CLONE_TARGETS__
 static int box_min_1ch(float *const buf, const size_t height, const size_t width, const int w)
 {
-  const size_t eff_height = _compute_effective_height(height, w);
-  const size_t scratch_size = MAX(width,MAX(height,16*eff_height));
+  const size_t scratch_size = MAX(_box_minmax_scratch_size(width, w, 1), _box_minmax_scratch_size(height, w, 16));
   size_t allocsize;
   float *const restrict scratch_buffers = dt_pixelpipe_cache_alloc_perthread_float(scratch_size,&allocsize);
   if(IS_NULL_PTR(scratch_buffers)) return 1;
@@ -1360,22 +1387,20 @@ static int box_min_1ch(float *const buf, const size_t height, const size_t width
   for(size_t row = 0; row < height; row++)
   {
     float *const restrict scratch = dt_get_perthread(scratch_buffers,allocsize);
-    memcpy(scratch, buf + row * width, sizeof(float) * width);
-    box_min_1d(width, scratch, buf + row * width, 1, w);
+    box_min_1d(width, buf + row * width, 1, buf + row * width, 1, w, scratch);
   }
   __OMP_PARALLEL_FOR__()
   for(size_t col = 0; col < (width & ~15); col += 16)
   {
     float *const restrict scratch = dt_get_perthread(scratch_buffers,allocsize);
-    box_min_vert_16wide(height, scratch, buf + col, width, w, eff_height-1);
+    box_min_vert_16wide(height, scratch, buf + col, width, w);
   }
   // handle the leftover 0..15 columns
-  for (size_t col = width & ~15 ; col < width; col++)
+  __OMP_PARALLEL_FOR__()
+  for(size_t col = width & ~15 ; col < width; col++)
   {
-    float *const restrict scratch = scratch_buffers;
-    for(size_t row = 0; row < height; row++)
-      scratch[row] = buf[row * width + col];
-    box_min_1d(height, scratch, buf + col, width, w);
+    float *const restrict scratch = dt_get_perthread(scratch_buffers,allocsize);
+    box_min_1d(height, buf + col, width, buf + col, width, w, scratch);
   }
 
   dt_pixelpipe_cache_free_align(scratch_buffers);
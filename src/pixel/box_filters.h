@@ -46,6 +46,8 @@ int dt_box_mean_horizontal(float *const restrict buf, const size_t width, const
 // run a single iteration vertically over the entire image.  Supported values for ch: 4|Kahan
 int dt_box_mean_vertical(float *const buf, const size_t height, const size_t width, const int ch, const int radius);
 
+// in-place moving minimum/maximum over a (2*radius+1) x (2*radius+1) box clipped to the image.
+// van Herk/Gil-Werman: constant cost per pixel whatever the radius.  Supported values for ch: 1
 int dt_box_min(float *const buf, const size_t height, const size_t width, const int ch, const int radius);
 int dt_box_max(float *const buf, const size_t height, const size_t width, const int ch, const int radius);
 
@@ -111,7 +111,44 @@ static inline float *get_color_pixel(color_image img, size_t i)
 }
 
 
-// apply guided filter to single-component image img using the 3-components image imgg as a guide
+// the per-call scratch of the guided filter: the packed 4- and 9-channel planes that
+// guided_filter_coefficients() box-filters, plus the per-thread row buffer of the horizontal
+// pass. It is sized once for the largest tile and reused by every tile of the call, instead of
+// being allocated and released by each tile.
+typedef struct guided_filter_scratch
+{
+  float *mean;
+  float *variance;
+  float *img_bak;
+  size_t img_bak_sz;
+} guided_filter_scratch;
+
+static int new_guided_filter_scratch(guided_filter_scratch *scratch, const int width, const int height)
+{
+  const size_t size = (size_t)width * height;
+  scratch->mean = dt_pixelpipe_cache_alloc_align_float_cache(4 * size, 0);
+  scratch->variance = dt_pixelpipe_cache_alloc_align_float_cache(9 * size, 0);
+  scratch->img_bak = dt_pixelpipe_cache_alloc_perthread_float(9 * (size_t)width, &scratch->img_bak_sz);
+  if(IS_NULL_PTR(scratch->mean) || IS_NULL_PTR(scratch->variance) || IS_NULL_PTR(scratch->img_bak))
+  {
+    dt_pixelpipe_cache_free_align(scratch->mean);
+    dt_pixelpipe_cache_free_align(scratch->variance);
+    dt_pixelpipe_cache_free_align(scratch->img_bak);
+    return 1;
+  }
+  return 0;
+}
+
+static void free_guided_filter_scratch(guided_filter_scratch *scratch)
+{
+  dt_pixelpipe_cache_free_align(scratch->mean);
+  dt_pixelpipe_cache_free_align(scratch->variance);
+  dt_pixelpipe_cache_free_align(scratch->img_bak);
+}
+
+// compute the box-averaged linear coefficients of the guided filter over the 'source' region
+// of the single-component image img using the 3-components image imgg as a guide.
+// On success, a_b holds 4 channels per source pixel: a_red, a_green, a_blue, b.
 // the filtering applies a monochrome box filter to a total of 13 image channels:
 //    1 monochrome input image
 //    3 color guide image
@@ -120,11 +157,10 @@ static inline float *get_color_pixel(color_image img, size_t i)
 // for computational efficiency, we'll pack them into a four-channel image and a 9-channel image
 // image instead of running 13 separate box filters: guide+input, R/G/B/R-R/R-G/R-B/G-G/G-B/B-B.
 __DT_CLONE_TARGETS__
-static int guided_filter_tiling(color_image imgg, gray_image img, gray_image img_out, tile target, const int w,
-                                const float eps, const float guide_weight, const float min, const float max)
+static int guided_filter_coefficients(color_image imgg, gray_image img, tile source, const int w,
+                                      const float eps, const float guide_weight,
+                                      const guided_filter_scratch *const buffers, color_image *a_b_out)
 {
-  const tile source = { max_i(target.left - 2 * w, 0), min_i(target.right + 2 * w, imgg.width),
-                        max_i(target.lower - 2 * w, 0), min_i(target.upper + 2 * w, imgg.height) };
   const int width = source.right - source.left;
   const int height = source.upper - source.lower;
   size_t size = (size_t)width * (size_t)height;
@@ -143,25 +179,10 @@ static int guided_filter_tiling(color_image imgg, gray_image img, gray_image img
 #define VAR_GG 6
 #define VAR_BB 8
 #define VAR_GB 7
-  color_image mean = { 0 };
-  color_image variance = { 0 };
-  if(new_color_image(&mean, width, height, 4) != 0) 
-    return 1;
-
-  if(new_color_image(&variance, width, height, 9) != 0)
-  {
-    free_color_image(&mean);
-    return 1;
-  }
-  const size_t img_dimen = mean.width;
-  size_t img_bak_sz;
-  float *img_bak = dt_pixelpipe_cache_alloc_perthread_float(9*img_dimen, &img_bak_sz);
-  if(IS_NULL_PTR(img_bak))
-  {
-    free_color_image(&variance);
-    free_color_image(&mean);
-    return 1;
-  }
+  color_image mean = { buffers->mean, width, height, 4 };
+  color_image variance = { buffers->variance, width, height, 9 };
+  float *const img_bak = buffers->img_bak;
+  const size_t img_bak_sz = buffers->img_bak_sz;
   int err = 0;
   __OMP_PARALLEL_FOR__()
   for(int j_imgg = source.lower; j_imgg < source.upper; j_imgg++)
@@ -202,18 +223,13 @@ static int guided_filter_tiling(color_image imgg, gray_image img, gray_image img
       err = 1;
     }
   }
-  dt_pixelpipe_cache_free_align(img_bak);
   if(!err && dt_box_mean_vertical(mean.data, mean.height, mean.width, 4|BOXFILTER_KAHAN_SUM, w) != 0)
     err = 1;
   if(!err && dt_box_mean_vertical(variance.data, variance.height, variance.width, 9|BOXFILTER_KAHAN_SUM, w) != 0)
     err = 1;
   
-  if(err)
-  {
-    free_color_image(&variance);
-    free_color_image(&mean);
-    return 1;
-  }
+  if(err) return 1;
+
   // we will recycle memory of 'mean' for the new coefficient arrays a_? and b to reduce memory foot print
   color_image a_b = mean;
   #define A_RED 0
@@ -274,13 +290,27 @@ static int guided_filter_tiling(color_image imgg, gray_image img, gray_image img
     a_b.data[4*i+A_BLUE] = a_b_;
     a_b.data[4*i+B] = b_;
   }
-  free_color_image(&variance);
-
   if(dt_box_mean(a_b.data, a_b.height, a_b.width, a_b.stride|BOXFILTER_KAHAN_SUM, w, 1))
-  {
-    free_color_image(&mean);
     return 1;
-  }
+
+  *a_b_out = a_b;
+  return 0;
+}
+
+// apply guided filter to single-component image img using the 3-components image imgg as a guide,
+// writing the 'target' region of img_out
+__DT_CLONE_TARGETS__
+static int guided_filter_tiling(color_image imgg, gray_image img, gray_image img_out, tile target, const int w,
+                                const float eps, const float guide_weight, const float min, const float max,
+                                const guided_filter_scratch *const buffers)
+{
+  const tile source = { max_i(target.left - 2 * w, 0), min_i(target.right + 2 * w, imgg.width),
+                        max_i(target.lower - 2 * w, 0), min_i(target.upper + 2 * w, imgg.height) };
+  const int width = source.right - source.left;
+  color_image a_b = { 0 };
+  if(guided_filter_coefficients(imgg, img, source, w, eps, guide_weight, buffers, &a_b) != 0)
+    return 1;
+
   __OMP_PARALLEL_FOR__()
   for(int j_imgg = target.lower; j_imgg < target.upper; j_imgg++)
   {
@@ -299,7 +329,6 @@ static int guided_filter_tiling(color_image imgg, gray_image img, gray_image img
       img_out.data[i_imgg + (size_t)j_imgg * imgg.width] = CLAMP(res, min, max);
     }
   }
-  free_color_image(&mean);
   return 0;
 }
 
@@ -371,16 +400,152 @@ int guided_filter(const float *const guide, const float *const in, float *const
   const int tile_height = compute_tile_height(height,w);
   const float eps = sqrt_eps * sqrt_eps; // this is the regularization parameter of the original papers
 
-  for(int j = 0; j < height; j += tile_height)
+  // every tile reads its target plus a 2*w apron on each side: size the scratch for the largest one
+  guided_filter_scratch buffers = { 0 };
+  if(new_guided_filter_scratch(&buffers, min_i(tile_width + 4 * w, width), min_i(tile_height + 4 * w, height)))
+    return 1;
+
+  int err = 0;
+  for(int j = 0; j < height && !err; j += tile_height)
   {
-    for(int i = 0; i < width; i += tile_width)
+    for(int i = 0; i < width && !err; i += tile_width)
     {
       tile target = { i, min_i(i + tile_width, width), j, min_i(j + tile_height, height) };
-      if(guided_filter_tiling(img_guide, img_in, img_out, target, w, eps, guide_weight, min, max) != 0)
-        return 1;
+      err = guided_filter_tiling(img_guide, img_in, img_out, target, w, eps, guide_weight, min, max, &buffers);
     }
   }
-  return 0;
+  free_guided_filter_scratch(&buffers);
+  return err;
+}
+
+// box-average s x s blocks of a ch-channel image into a (ceil(width/s), ceil(height/s)) image
+// of 'ch_out' <= 4 channels, zero-filling the channels the input does not have.
+// Blocks on the right and bottom edges may be partial.
+__DT_CLONE_TARGETS__
+static void downsample_box(const float *const restrict in, const int width, const int height, const int ch,
+                           float *const restrict out, const int ds_width, const int ds_height, const int ch_out,
+                           const int s)
+{
+  __OMP_PARALLEL_FOR__(collapse(2))
+  for(int j = 0; j < ds_height; j++)
+  {
+    for(int i = 0; i < ds_width; i++)
+    {
+      dt_aligned_pixel_t acc = { 0.f, 0.f, 0.f, 0.f };
+      int count = 0;
+      for(int jj = j * s; jj < min_i((j + 1) * s, height); jj++)
+        for(int ii = i * s; ii < min_i((i + 1) * s, width); ii++, count++)
+          for(int c = 0; c < min_i(ch, ch_out); c++)
+            acc[c] += in[((size_t)jj * width + ii) * ch + c];
+      for(int c = 0; c < ch_out; c++)
+        out[((size_t)j * ds_width + i) * ch_out + c] = acc[c] / (float)count;
+    }
+  }
+}
+
+__DT_CLONE_TARGETS__
+int guided_filter_subsampled(const float *const guide, const float *const in, float *const out, const int width,
+                             const int height, const int ch, const int w, const float sqrt_eps,
+                             const float guide_weight, const float min, const float max, const int subsample)
+{
+  assert(ch >= 3);
+  assert(w >= 1);
+
+  const int s = subsample;
+  const int ds_w = w / max_i(s, 1);
+  // nothing to gain, or a window the coarse grid cannot represent: take the exact path
+  if(s <= 1 || ds_w < 1)
+    return guided_filter(guide, in, out, width, height, ch, w, sqrt_eps, guide_weight, min, max);
+
+  const int ds_width = (width + s - 1) / s;
+  const int ds_height = (height + s - 1) / s;
+  const size_t ds_size = (size_t)ds_width * ds_height;
+  const float eps = sqrt_eps * sqrt_eps;
+  const int tile_width = compute_tile_width(ds_width, ds_w);
+  const int tile_height = compute_tile_height(ds_height, ds_w);
+
+  // the coarse guide, input and coefficients are s^2 times smaller than the image; the 13 planes
+  // of the solve are tiled like guided_filter() so they stay bounded by the tile, not the image
+  float *const ds_guide = dt_pixelpipe_cache_alloc_align_float_cache(4 * ds_size, 0);
+  float *const ds_in = dt_pixelpipe_cache_alloc_align_float_cache(ds_size, 0);
+  float *const ds_ab = dt_pixelpipe_cache_alloc_align_float_cache(4 * ds_size, 0);
+  guided_filter_scratch buffers = { 0 };
+  if(IS_NULL_PTR(ds_guide) || IS_NULL_PTR(ds_in) || IS_NULL_PTR(ds_ab)
+     || new_guided_filter_scratch(&buffers, min_i(tile_width + 4 * ds_w, ds_width),
+                                  min_i(tile_height + 4 * ds_w, ds_height)))
+  {
+    dt_pixelpipe_cache_free_align(ds_guide);
+    dt_pixelpipe_cache_free_align(ds_in);
+    dt_pixelpipe_cache_free_align(ds_ab);
+    return 1;
+  }
+
+  downsample_box(guide, width, height, ch, ds_guide, ds_width, ds_height, 4, s);
+  downsample_box(in, width, height, 1, ds_in, ds_width, ds_height, 1, s);
+
+  const color_image img_guide = { ds_guide, ds_width, ds_height, 4 };
+  const gray_image img_in = { ds_in, ds_width, ds_height };
+  const color_image a_b = { ds_ab, ds_width, ds_height, 4 };
+  int err = 0;
+  for(int j = 0; j < ds_height && !err; j += tile_height)
+  {
+    for(int i = 0; i < ds_width && !err; i += tile_width)
+    {
+      // same apron as guided_filter_tiling(): the coefficients of the target are exact
+      const tile target = { i, min_i(i + tile_width, ds_width), j, min_i(j + tile_height, ds_height) };
+      const tile source = { max_i(target.left - 2 * ds_w, 0), min_i(target.right + 2 * ds_w, ds_width),
+                            max_i(target.lower - 2 * ds_w, 0), min_i(target.upper + 2 * ds_w, ds_height) };
+      color_image tile_ab = { 0 };
+      err = guided_filter_coefficients(img_guide, img_in, source, ds_w, eps, guide_weight, &buffers, &tile_ab);
+      if(err) break;
+      const int source_width = source.right - source.left;
+      const size_t row_size = sizeof(float) * 4 * (target.right - target.left);
+      __OMP_PARALLEL_FOR__()
+      for(int jj = target.lower; jj < target.upper; jj++)
+        memcpy(get_color_pixel(a_b, (size_t)jj * ds_width + target.left),
+               get_color_pixel(tile_ab, (size_t)(jj - source.lower) * source_width + (target.left - source.left)),
+               row_size);
+    }
+  }
+
+  if(!err)
+  {
+    // the coefficients are smooth by construction (they are box-averaged): upsample them
+    // bilinearly and apply them to the full-resolution guide
+    const float inv_s = 1.f / (float)s;
+    __OMP_PARALLEL_FOR__()
+    for(int j = 0; j < height; j++)
+    {
+      const float y = fmaxf(((float)j + 0.5f) * inv_s - 0.5f, 0.f);
+      const int y0 = min_i((int)y, ds_height - 1);
+      const int y1 = min_i(y0 + 1, ds_height - 1);
+      const float fy = y - (float)y0;
+      for(int i = 0; i < width; i++)
+      {
+        const float x = fmaxf(((float)i + 0.5f) * inv_s - 0.5f, 0.f);
+        const int x0 = min_i((int)x, ds_width - 1);
+        const int x1 = min_i(x0 + 1, ds_width - 1);
+        const float fx = x - (float)x0;
+        const float *const p00 = get_color_pixel(a_b, (size_t)y0 * ds_width + x0);
+        const float *const p01 = get_color_pixel(a_b, (size_t)y0 * ds_width + x1);
+        const float *const p10 = get_color_pixel(a_b, (size_t)y1 * ds_width + x0);
+        const float *const p11 = get_color_pixel(a_b, (size_t)y1 * ds_width + x1);
+        dt_aligned_pixel_t ab;
+        for_four_channels(c)
+          ab[c] = (1.f - fy) * ((1.f - fx) * p00[c] + fx * p01[c]) + fy * ((1.f - fx) * p10[c] + fx * p11[c]);
+        const float *const pixel = guide + ((size_t)j * width + i) * ch;
+        const float res = guide_weight * (ab[A_RED] * pixel[0] + ab[A_GREEN] * pixel[1] + ab[A_BLUE] * pixel[2])
+                          + ab[B];
+        out[(size_t)j * width + i] = CLAMP(res, min, max);
+      }
+    }
+  }
+
+  free_guided_filter_scratch(&buffers);
+  dt_pixelpipe_cache_free_align(ds_guide);
+  dt_pixelpipe_cache_free_align(ds_in);
+  dt_pixelpipe_cache_free_align(ds_ab);
+  return err;
 }
 
 #ifdef HAVE_OPENCL
@@ -90,6 +90,13 @@ static inline int max_i(int a, int b)
 int guided_filter(const float *guide, const float *in, float *out, int width, int height, int ch, int w,
                   float sqrt_eps, float guide_weight, float min, float max);
 
+// Fast guided filter (He & Sun, 2015): the linear coefficients are solved on a grid subsampled by
+// 'subsample' in each direction with a window of w / subsample, then upsampled bilinearly and
+// applied to the full-resolution guide. Cost drops by roughly subsample^2; falls back to
+// guided_filter() when subsample <= 1 or the coarse window would vanish.
+int guided_filter_subsampled(const float *guide, const float *in, float *out, int width, int height, int ch,
+                             int w, float sqrt_eps, float guide_weight, float min, float max, int subsample);
+
 #ifdef HAVE_OPENCL
 
 typedef struct dt_guided_filter_cl_global_t
@@ -16,6 +16,7 @@
     along with darktable.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include "system/mem_alloc.h"
 #include "system/openmp.h"
 #include "system/target_clones.h"
 #include "pixel/lut3d.h"
@@ -59,97 +60,97 @@ static inline __attribute__((always_inline)) void _finish_lut_output(const float
   output[3] = input[3];
 }
 
+/**
+ * Pixels interpolated per batch by dt_lut3d_tetrahedral_interp(). Picking the tetrahedron is
+ * a 6-way branch on the order of the fractional parts, which the branch predictor cannot
+ * learn on natural images. So each batch is done in 2 passes. The first computes cell,
+ * tetrahedron and barycentric weights for every pixel without branches, so it vectorizes
+ * across pixels. The second gathers the 4 vertices and blends them.
+ */
+#define DT_LUT3D_BATCH 16
+
 __DT_CLONE_TARGETS__
 void dt_lut3d_tetrahedral_interp(const float *const in, float *const out, const size_t pixel_nb,
                                  const float *const restrict clut, const uint16_t level,
                                  const float normalization)
 {
   const int level2 = level * level;
+  const int step[3] = { 3, 3 * level, 3 * level2 };
+  const int diagonal = step[0] + step[1] + step[2];
   const float safe_normalization = fmaxf(normalization, 1e-6f);
+  const size_t batches = (pixel_nb + DT_LUT3D_BATCH - 1) / DT_LUT3D_BATCH;
+
   __OMP_PARALLEL_FOR__()
-  for(size_t k = 0; k < (size_t)(pixel_nb * 4); k += 4)
+  for(size_t b = 0; b < batches; b++)
   {
-    const float *const input = in + k;
-    float *const output = out + k;
-    float normalized[3];
-    float residual[3];
-    float rgbd[3];
-    int rgbi[3];
-
-    _prepare_lut_input(input, normalized, residual, rgbd, rgbi, level, safe_normalization);
-
-    const int color = rgbi[0] + rgbi[1] * level + rgbi[2] * level2;
-    const int i000 = color * 3;
-    const int i100 = i000 + 3;
-    const int i010 = (color + level) * 3;
-    const int i110 = i010 + 3;
-    const int i001 = (color + level2) * 3;
-    const int i101 = i001 + 3;
-    const int i011 = (color + level + level2) * 3;
-    const int i111 = i011 + 3;
-
-    if(rgbd[0] > rgbd[1])
+    const size_t first = b * DT_LUT3D_BATCH;
+    const size_t count = (pixel_nb - first < DT_LUT3D_BATCH) ? pixel_nb - first : DT_LUT3D_BATCH;
+    int DT_ALIGNED_ARRAY vertex[3][DT_LUT3D_BATCH];
+    float DT_ALIGNED_ARRAY weight[4][DT_LUT3D_BATCH];
+    float DT_ALIGNED_ARRAY residual[3][DT_LUT3D_BATCH];
+
+    __OMP_SIMD__()
+    for(size_t p = 0; p < count; p++)
     {
-      if(rgbd[1] > rgbd[2])
+      const float *const input = in + 4 * (first + p);
+      float rgbd[3];
+      int rgbi[3];
+      for(int c = 0; c < 3; c++)
       {
-        output[0] = (1 - rgbd[0]) * clut[i000] + (rgbd[0] - rgbd[1]) * clut[i100]
-                    + (rgbd[1] - rgbd[2]) * clut[i110] + rgbd[2] * clut[i111];
-        output[1] = (1 - rgbd[0]) * clut[i000 + 1] + (rgbd[0] - rgbd[1]) * clut[i100 + 1]
-                    + (rgbd[1] - rgbd[2]) * clut[i110 + 1] + rgbd[2] * clut[i111 + 1];
-        output[2] = (1 - rgbd[0]) * clut[i000 + 2] + (rgbd[0] - rgbd[1]) * clut[i100 + 2]
-                    + (rgbd[1] - rgbd[2]) * clut[i110 + 2] + rgbd[2] * clut[i111 + 2];
-      }
-      else if(rgbd[0] > rgbd[2])
-      {
-        output[0] = (1 - rgbd[0]) * clut[i000] + (rgbd[0] - rgbd[2]) * clut[i100]
-                    + (rgbd[2] - rgbd[1]) * clut[i101] + rgbd[1] * clut[i111];
-        output[1] = (1 - rgbd[0]) * clut[i000 + 1] + (rgbd[0] - rgbd[2]) * clut[i100 + 1]
-                    + (rgbd[2] - rgbd[1]) * clut[i101 + 1] + rgbd[1] * clut[i111 + 1];
-        output[2] = (1 - rgbd[0]) * clut[i000 + 2] + (rgbd[0] - rgbd[2]) * clut[i100 + 2]
-                    + (rgbd[2] - rgbd[1]) * clut[i101 + 2] + rgbd[1] * clut[i111 + 2];
-      }
-      else
-      {
-        output[0] = (1 - rgbd[2]) * clut[i000] + (rgbd[2] - rgbd[0]) * clut[i001]
-                    + (rgbd[0] - rgbd[1]) * clut[i101] + rgbd[1] * clut[i111];
-        output[1] = (1 - rgbd[2]) * clut[i000 + 1] + (rgbd[2] - rgbd[0]) * clut[i001 + 1]
-                    + (rgbd[0] - rgbd[1]) * clut[i101 + 1] + rgbd[1] * clut[i111 + 1];
-        output[2] = (1 - rgbd[2]) * clut[i000 + 2] + (rgbd[2] - rgbd[0]) * clut[i001 + 2]
-                    + (rgbd[0] - rgbd[1]) * clut[i101 + 2] + rgbd[1] * clut[i111 + 2];
+        const float unclamped = input[c] / safe_normalization;
+        const float normalized = fminf(fmaxf(unclamped, 0.f), 1.f);
+        residual[c][p] = unclamped - normalized;
+        const float scaled = normalized * (float)(level - 1);
+        rgbi[c] = ((int)scaled < 0) ? 0 : (((int)scaled > level - 2) ? level - 2 : (int)scaled);
+        rgbd[c] = scaled - rgbi[c];
       }
+
+      // Axes of the largest, middle and smallest fractional parts. The comparisons are the
+      // ones the original 6-way branch made, so ties pick the same tetrahedron.
+      const int r_g = rgbd[0] > rgbd[1];
+      const int g_b = rgbd[1] > rgbd[2];
+      const int r_b = rgbd[0] > rgbd[2];
+      const int b_g = rgbd[2] > rgbd[1];
+      const int b_r = rgbd[2] > rgbd[0];
+      const int hi = r_g ? ((g_b || r_b) ? 0 : 2) : (b_g ? 2 : 1);
+      const int lo = r_g ? (g_b ? 2 : 1) : ((b_g || b_r) ? 0 : 2);
+      const int mid = 3 - hi - lo;
+
+      const float x = (hi == 0) ? rgbd[0] : (hi == 1) ? rgbd[1] : rgbd[2];
+      const float y = (mid == 0) ? rgbd[0] : (mid == 1) ? rgbd[1] : rgbd[2];
+      const float z = (lo == 0) ? rgbd[0] : (lo == 1) ? rgbd[1] : rgbd[2];
+      const int step_hi = (hi == 0) ? step[0] : (hi == 1) ? step[1] : step[2];
+      const int step_mid = (mid == 0) ? step[0] : (mid == 1) ? step[1] : step[2];
+
+      const int origin = 3 * (rgbi[0] + rgbi[1] * level + rgbi[2] * level2);
+      vertex[0][p] = origin;
+      vertex[1][p] = origin + step_hi;
+      vertex[2][p] = origin + step_hi + step_mid;
+      weight[0][p] = 1.f - x;
+      weight[1][p] = x - y;
+      weight[2][p] = y - z;
+      weight[3][p] = z;
     }
-    else
+
+    __OMP_SIMD__()
+    for(size_t p = 0; p < count; p++)
     {
-      if(rgbd[2] > rgbd[1])
-      {
-        output[0] = (1 - rgbd[2]) * clut[i000] + (rgbd[2] - rgbd[1]) * clut[i001]
-                    + (rgbd[1] - rgbd[0]) * clut[i011] + rgbd[0] * clut[i111];
-        output[1] = (1 - rgbd[2]) * clut[i000 + 1] + (rgbd[2] - rgbd[1]) * clut[i001 + 1]
-                    + (rgbd[1] - rgbd[0]) * clut[i011 + 1] + rgbd[0] * clut[i111 + 1];
-        output[2] = (1 - rgbd[2]) * clut[i000 + 2] + (rgbd[2] - rgbd[1]) * clut[i001 + 2]
-                    + (rgbd[1] - rgbd[0]) * clut[i011 + 2] + rgbd[0] * clut[i111 + 2];
-      }
-      else if(rgbd[2] > rgbd[0])
+      const float *const input = in + 4 * (first + p);
+      float *const output = out + 4 * (first + p);
+      const int i0 = vertex[0][p];
+      const int i1 = vertex[1][p];
+      const int i2 = vertex[2][p];
+      const int i3 = i0 + diagonal;
+      const float alpha = input[3];
+      for(int c = 0; c < 3; c++)
       {
-        output[0] = (1 - rgbd[1]) * clut[i000] + (rgbd[1] - rgbd[2]) * clut[i010]
-                    + (rgbd[2] - rgbd[0]) * clut[i011] + rgbd[0] * clut[i111];
-        output[1] = (1 - rgbd[1]) * clut[i000 + 1] + (rgbd[1] - rgbd[2]) * clut[i010 + 1]
-                    + (rgbd[2] - rgbd[0]) * clut[i011 + 1] + rgbd[0] * clut[i111 + 1];
-        output[2] = (1 - rgbd[1]) * clut[i000 + 2] + (rgbd[1] - rgbd[2]) * clut[i010 + 2]
-                    + (rgbd[2] - rgbd[0]) * clut[i011 + 2] + rgbd[0] * clut[i111 + 2];
-      }
-      else
-      {
-        output[0] = (1 - rgbd[1]) * clut[i000] + (rgbd[1] - rgbd[0]) * clut[i010]
-                    + (rgbd[0] - rgbd[2]) * clut[i110] + rgbd[2] * clut[i111];
-        output[1] = (1 - rgbd[1]) * clut[i000 + 1] + (rgbd[1] - rgbd[0]) * clut[i010 + 1]
-                    + (rgbd[0] - rgbd[2]) * clut[i110 + 1] + rgbd[2] * clut[i111 + 1];
-        output[2] = (1 - rgbd[1]) * clut[i000 + 2] + (rgbd[1] - rgbd[0]) * clut[i010 + 2]
-                    + (rgbd[0] - rgbd[2]) * clut[i110 + 2] + rgbd[2] * clut[i111 + 2];
+        const float value = weight[0][p] * clut[i0 + c] + weight[1][p] * clut[i1 + c]
+                            + weight[2][p] * clut[i2 + c] + weight[3][p] * clut[i3 + c];
+        // see _finish_lut_output()
+        output[c] = (value + residual[c][p]) * safe_normalization;
       }
+      output[3] = alpha;
     }
-
-    _finish_lut_output(input, output, residual, safe_normalization);
   }
 }
 
@@ -0,0 +1,172 @@
+/*
+    This file is part of Ansel,
+    Copyright (C) 2026 Aurélien PIERRE.
+
+    Ansel is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ansel is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ansel.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pixel/wavelet_pyramid.h"
+
+#include "caches/pixelpipe_cache.h"
+#include "caches/pixelpipe_cache_alloc.h"
+#include "common/hash.h"
+#include "pixel/bspline.h"
+#include "system/macros.h"
+
+#include <string.h>
+
+uint64_t dt_wavelet_pyramid_hash(const uint64_t input_hash, const dt_wavelet_filter_t filter, const size_t width,
+                                 const size_t height, const int scales)
+{
+  static const char tag[] = "wavelet pyramid";
+  uint64_t hash = dt_hash(input_hash, tag, sizeof(tag));
+  const uint64_t shape[4] = { (uint64_t)filter, (uint64_t)width, (uint64_t)height, (uint64_t)scales };
+  return dt_hash(hash, (const char *)shape, sizeof(shape));
+}
+
+static void _map_planes(dt_wavelet_pyramid_t *pyramid)
+{
+  const size_t plane = pyramid->width * pyramid->height * 4;
+  for(int s = 0; s < pyramid->scales; s++)
+    pyramid->HF[s] = pyramid->data + s * plane;
+  pyramid->residual = pyramid->data + pyramid->scales * plane;
+}
+
+// decompose 'in' into the planes of 'pyramid'. Scale s writes its low-pass output either to the
+// residual slot or to 'temp', alternating so that the LAST scale lands in the residual slot: the
+// only extra memory is one plane.
+static int _build_bspline(dt_wavelet_pyramid_t *pyramid, const float *const in)
+{
+  const size_t width = pyramid->width;
+  const size_t height = pyramid->height;
+  const size_t plane = width * height * 4;
+  float *const residual = pyramid->data + pyramid->scales * plane;
+
+  float *const temp = dt_pixelpipe_cache_alloc_align_float_cache(plane, 0);
+  size_t padded_size;
+  float *const tempbuf = dt_pixelpipe_cache_alloc_perthread_float(4 * width, &padded_size);
+  if(IS_NULL_PTR(temp) || IS_NULL_PTR(tempbuf))
+  {
+    dt_pixelpipe_cache_free_align(temp);
+    dt_pixelpipe_cache_free_align(tempbuf);
+    return 1;
+  }
+
+  const float *buffer_in = in;
+  for(int s = 0; s < pyramid->scales; s++)
+  {
+    float *const buffer_out = ((pyramid->scales - 1 - s) % 2 == 0) ? residual : temp;
+    decompose_2D_Bspline(buffer_in, pyramid->data + s * plane, buffer_out, width, height, 1 << s, tempbuf,
+                         padded_size);
+    buffer_in = buffer_out;
+  }
+
+  dt_pixelpipe_cache_free_align(tempbuf);
+  dt_pixelpipe_cache_free_align(temp);
+  return 0;
+}
+
+static int _build(dt_wavelet_pyramid_t *pyramid, const float *const in)
+{
+  switch(pyramid->filter)
+  {
+    case DT_WAVELET_FILTER_BSPLINE:
+      return _build_bspline(pyramid, in);
+  }
+  return 1;
+}
+
+int dt_wavelet_pyramid_acquire(dt_wavelet_pyramid_t *pyramid, const float *const in, const size_t width,
+                               const size_t height, const int scales, const dt_wavelet_filter_t filter,
+                               const uint64_t input_hash, const int id)
+{
+  memset(pyramid, 0, sizeof(*pyramid));
+  if(scales < 1 || scales > DT_WAVELET_PYRAMID_MAX_SCALES) return 1;
+
+  pyramid->width = width;
+  pyramid->height = height;
+  pyramid->scales = scales;
+  pyramid->filter = filter;
+  const size_t size = (size_t)(scales + 1) * width * height * 4 * sizeof(float);
+
+  if(input_hash == DT_PIXELPIPE_CACHE_HASH_INVALID)
+  {
+    pyramid->data = dt_pixelpipe_cache_alloc_align_cache(size, id);
+    if(IS_NULL_PTR(pyramid->data)) return 1;
+    _map_planes(pyramid);
+    if(_build(pyramid, in))
+    {
+      dt_wavelet_pyramid_release(pyramid);
+      return 1;
+    }
+    return 0;
+  }
+
+  const uint64_t hash = dt_wavelet_pyramid_hash(input_hash, filter, width, height, scales);
+  void *data = NULL;
+  dt_pixel_cache_entry_t *entry = NULL;
+  const int created = dt_dev_pixelpipe_cache_get(hash, size, "wavelet pyramid", id, TRUE, &data, &entry);
+  if(IS_NULL_PTR(data) || IS_NULL_PTR(entry))
+  {
+    if(entry)
+    {
+      if(created) dt_dev_pixelpipe_cache_wrlock_entry(FALSE, entry);
+      dt_dev_pixelpipe_cache_ref_count_entry(FALSE, entry);
+    }
+    return 1;
+  }
+
+  pyramid->data = (float *)data;
+  pyramid->entry = entry;
+  _map_planes(pyramid);
+
+  if(created)
+  {
+    const int err = _build(pyramid, in);
+    dt_dev_pixelpipe_cache_wrlock_entry(FALSE, entry);
+    if(err)
+    {
+      // never leave a half-built pyramid published under a valid key
+      dt_dev_pixelpipe_cache_ref_count_entry(FALSE, entry);
+      dt_dev_pixelpipe_cache_remove(TRUE, entry);
+      memset(pyramid, 0, sizeof(*pyramid));
+      return 1;
+    }
+  }
+  else
+    pyramid->reused = TRUE;
+
+  // hold a read lock while the caller reads the planes: no one may rekey or overwrite them
+  dt_dev_pixelpipe_cache_rdlock_entry(TRUE, entry);
+  return 0;
+}
+
+void dt_wavelet_pyramid_release(dt_wavelet_pyramid_t *pyramid)
+{
+  if(IS_NULL_PTR(pyramid)) return;
+  if(pyramid->entry)
+  {
+    dt_dev_pixelpipe_cache_rdlock_entry(FALSE, pyramid->entry);
+    dt_dev_pixelpipe_cache_ref_count_entry(FALSE, pyramid->entry);
+  }
+  else if(pyramid->data)
+    dt_pixelpipe_cache_free_align(pyramid->data);
+  memset(pyramid, 0, sizeof(*pyramid));
+}
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
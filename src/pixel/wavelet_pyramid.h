@@ -0,0 +1,105 @@
+/*
+    This file is part of Ansel,
+    Copyright (C) 2026 Aurélien PIERRE.
+
+    Ansel is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ansel is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ansel.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef DT_PIXEL_WAVELET_PYRAMID_H
+#define DT_PIXEL_WAVELET_PYRAMID_H
+
+/** @file pixel/wavelet_pyramid.h
+ *
+ * @brief A multi-scale decomposition of one RGBA float image, shareable through the
+ * pixelpipe cache.
+ *
+ * The à-trous decomposition of a module's input depends on that input and on the filter, and
+ * on nothing the module's parameters say. When the user drags a slider of a wavelet module,
+ * its input has not changed, and neither has the pyramid built from it: rebuilding it on every
+ * run is pure waste. A pyramid acquired with a valid input hash is stored as ONE cacheline
+ * keyed by (input hash, filter, size, number of scales), so the next run -- of this module or
+ * of any other module handed the same input and asking for the same filter -- finds it there.
+ *
+ * Layout of the cacheline: `scales` high-frequency planes followed by the low-frequency
+ * residual, each width x height x 4 floats. The planes are READ-ONLY for consumers: a published
+ * pyramid is shared, and a module that wants to modify a band copies it first.
+ *
+ * The scales cannot be built in parallel with one another: each à-trous level filters the
+ * previous level's low-pass output. Each level is parallel over rows instead.
+ *
+ * This is pixel code: it takes a buffer and a key, and does not know which module asks. The
+ * caller decides whether the pyramid is worth publishing (see dt_wavelet_pyramid_acquire()).
+ */
+
+#include <glib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct dt_pixel_cache_entry_t;
+
+#define DT_WAVELET_PYRAMID_MAX_SCALES 12
+
+typedef enum dt_wavelet_filter_t
+{
+  DT_WAVELET_FILTER_BSPLINE = 0, // 5-tap B-spline à-trous, as decompose_2D_Bspline() in pixel/bspline.h
+} dt_wavelet_filter_t;
+
+typedef struct dt_wavelet_pyramid_t
+{
+  size_t width;
+  size_t height;
+  int scales;
+  dt_wavelet_filter_t filter;
+  gboolean reused;                                  // TRUE if found already built in the cache
+  const float *HF[DT_WAVELET_PYRAMID_MAX_SCALES];   // high frequencies, finest first
+  const float *residual;                            // low frequency left after the last scale
+
+  // private
+  float *data;
+  struct dt_pixel_cache_entry_t *entry;
+} dt_wavelet_pyramid_t;
+
+/**
+ * @brief Cache key of the pyramid of an input identified by @p input_hash.
+ */
+uint64_t dt_wavelet_pyramid_hash(const uint64_t input_hash, const dt_wavelet_filter_t filter, const size_t width,
+                                 const size_t height, const int scales);
+
+/**
+ * @brief Get the decomposition of @p in, building it only if no identical one is cached.
+ *
+ * @param pyramid Filled on success. Release it with dt_wavelet_pyramid_release().
+ * @param in RGBA float input, width x height x 4.
+ * @param input_hash Content hash of @p in -- typically the global hash of the pipeline node
+ *        that produced it, hashed further with whatever the caller did to it since. Pass
+ *        DT_PIXELPIPE_CACHE_HASH_INVALID to build into private memory and publish nothing, which
+ *        is what one-shot pipes (export) want: nobody will ask twice.
+ * @param id Pipeline type owning the cacheline, as for dt_dev_pixelpipe_cache_get().
+ * @return 0 on success, 1 on allocation failure.
+ */
+int dt_wavelet_pyramid_acquire(dt_wavelet_pyramid_t *pyramid, const float *const in, const size_t width,
+                               const size_t height, const int scales, const dt_wavelet_filter_t filter,
+                               const uint64_t input_hash, const int id);
+
+/**
+ * @brief Drop the caller's hold on the pyramid. A published pyramid stays in the cache, evictable.
+ */
+void dt_wavelet_pyramid_release(dt_wavelet_pyramid_t *pyramid);
+
+#endif // DT_PIXEL_WAVELET_PYRAMID_H
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
@@ -0,0 +1,187 @@
+/*
+    This file is part of Ansel,
+    Copyright (C) 2026 Aurélien PIERRE.
+
+    Ansel is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ansel is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ansel.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "system/scratch_pool.h"
+#include "system/dtpthread.h"
+#include "system/macros.h"
+#include "system/mem_alloc.h"
+
+typedef struct _scratch_buffer_t
+{
+  void *data;
+  size_t size;
+} _scratch_buffer_t;
+
+struct dt_scratch_pool_t
+{
+  dt_pthread_mutex_t lock;
+  GQueue idle;      // _scratch_buffer_t *, the most recently returned first
+  GHashTable *lent; // data -> _scratch_buffer_t *
+  size_t idle_bytes;
+  size_t max_idle_bytes;
+  gboolean closing; // freed by its owner, waiting for the buffers still lent
+};
+
+static void _buffer_free(_scratch_buffer_t *buffer)
+{
+  dt_free_align(buffer->data);
+  dt_free(buffer);
+}
+
+// keep the idle buffers within max_bytes, dropping the ones unused the longest. Under the lock.
+static void _trim(dt_scratch_pool_t *pool, const size_t max_bytes)
+{
+  while(pool->idle_bytes > max_bytes)
+  {
+    _scratch_buffer_t *buffer = g_queue_pop_tail(&pool->idle);
+    pool->idle_bytes -= buffer->size;
+    _buffer_free(buffer);
+  }
+}
+
+static void _destroy(dt_scratch_pool_t *pool)
+{
+  g_hash_table_destroy(pool->lent);
+  dt_pthread_mutex_destroy(&pool->lock);
+  dt_free(pool);
+}
+
+dt_scratch_pool_t *dt_scratch_pool_new(const size_t max_idle_bytes)
+{
+  dt_scratch_pool_t *pool = g_new0(dt_scratch_pool_t, 1);
+  dt_pthread_mutex_init(&pool->lock, NULL);
+  g_queue_init(&pool->idle);
+  pool->lent = g_hash_table_new(g_direct_hash, g_direct_equal);
+  pool->max_idle_bytes = max_idle_bytes;
+  return pool;
+}
+
+void dt_scratch_pool_free(dt_scratch_pool_t *pool)
+{
+  if(IS_NULL_PTR(pool)) return;
+
+  dt_pthread_mutex_lock(&pool->lock);
+  _trim(pool, 0);
+  pool->closing = TRUE;
+  const gboolean last = g_hash_table_size(pool->lent) == 0;
+  dt_pthread_mutex_unlock(&pool->lock);
+
+  if(last) _destroy(pool);
+}
+
+void dt_scratch_pool_flush(dt_scratch_pool_t *pool)
+{
+  if(IS_NULL_PTR(pool)) return;
+
+  dt_pthread_mutex_lock(&pool->lock);
+  _trim(pool, 0);
+  dt_pthread_mutex_unlock(&pool->lock);
+}
+
+void dt_scratch_pool_set_max_idle_bytes(dt_scratch_pool_t *pool, const size_t max_idle_bytes)
+{
+  if(IS_NULL_PTR(pool)) return;
+
+  dt_pthread_mutex_lock(&pool->lock);
+  pool->max_idle_bytes = max_idle_bytes;
+  _trim(pool, max_idle_bytes);
+  dt_pthread_mutex_unlock(&pool->lock);
+}
+
+void *dt_scratch_pool_get(dt_scratch_pool_t *pool, const size_t size)
+{
+  if(IS_NULL_PTR(pool)) return dt_alloc_align(size);
+
+  _scratch_buffer_t *buffer = NULL;
+
+  dt_pthread_mutex_lock(&pool->lock);
+  // the smallest idle buffer that holds size bytes without wasting more than as much again:
+  // thumbnails of one size but different aspect ratios then share their buffers
+  GList *best = NULL;
+  for(GList *link = pool->idle.head; link; link = g_list_next(link))
+  {
+    _scratch_buffer_t *candidate = (_scratch_buffer_t *)link->data;
+    if(candidate->size < size || candidate->size / 2 > size) continue;
+    if(best && ((_scratch_buffer_t *)best->data)->size <= candidate->size) continue;
+    best = link;
+  }
+  if(best)
+  {
+    buffer = (_scratch_buffer_t *)best->data;
+    g_queue_delete_link(&pool->idle, best);
+    pool->idle_bytes -= buffer->size;
+    g_hash_table_insert(pool->lent, buffer->data, buffer);
+  }
+  dt_pthread_mutex_unlock(&pool->lock);
+  if(buffer) return buffer->data;
+
+  // none fits: a new one, allocated outside the lock
+  buffer = g_new0(_scratch_buffer_t, 1);
+  buffer->size = size;
+  buffer->data = dt_alloc_align(size);
+  if(IS_NULL_PTR(buffer->data))
+  {
+    dt_free(buffer);
+    return NULL;
+  }
+
+  dt_pthread_mutex_lock(&pool->lock);
+  g_hash_table_insert(pool->lent, buffer->data, buffer);
+  dt_pthread_mutex_unlock(&pool->lock);
+  return buffer->data;
+}
+
+void dt_scratch_pool_put(dt_scratch_pool_t *pool, void *data)
+{
+  if(IS_NULL_PTR(data)) return;
+  if(IS_NULL_PTR(pool))
+  {
+    dt_free_align(data);
+    return;
+  }
+
+  dt_pthread_mutex_lock(&pool->lock);
+  _scratch_buffer_t *buffer = g_hash_table_lookup(pool->lent, data);
+  if(IS_NULL_PTR(buffer))
+  {
+    // not ours: whoever allocated it still owns it
+    dt_pthread_mutex_unlock(&pool->lock);
+    return;
+  }
+  g_hash_table_remove(pool->lent, data);
+
+  if(pool->closing)
+  {
+    _buffer_free(buffer);
+    const gboolean last = g_hash_table_size(pool->lent) == 0;
+    dt_pthread_mutex_unlock(&pool->lock);
+    if(last) _destroy(pool);
+    return;
+  }
+
+  g_queue_push_head(&pool->idle, buffer);
+  pool->idle_bytes += buffer->size;
+  _trim(pool, pool->max_idle_bytes);
+  dt_pthread_mutex_unlock(&pool->lock);
+}
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
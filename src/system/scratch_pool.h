@@ -0,0 +1,70 @@
+/*
+    This file is part of Ansel,
+    Copyright (C) 2026 Aurélien PIERRE.
+
+    Ansel is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ansel is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ansel.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DT_SYSTEM_SCRATCH_POOL_H
+#define DT_SYSTEM_SCRATCH_POOL_H
+
+#include <glib.h>
+#include <stddef.h>
+
+/*
+ * Scratch buffers kept between frames.
+ *
+ * An overlay drawn on every redraw wants the same few frame-sized buffers each time. Allocating
+ * them anew means fresh pages, and the kernel faulting every one of them in before the first
+ * pixel is written. A pool keeps the buffers it gets back and hands out the smallest one that is
+ * large enough, up to twice the size asked for, so a steady stream of frames of about the same
+ * size stops allocating.
+ *
+ * Thread-safe: buffers may be taken and returned from any thread. What the pool holds idle is
+ * capped; past the cap, the least recently returned buffers are freed.
+ */
+typedef struct dt_scratch_pool_t dt_scratch_pool_t;
+
+/** A pool that keeps at most max_idle_bytes of buffers nobody is using. */
+dt_scratch_pool_t *dt_scratch_pool_new(const size_t max_idle_bytes);
+
+/**
+ * Free the idle buffers, and the pool itself once every buffer it lent is back.
+ * Buffers still out may be returned afterwards: they are freed then.
+ */
+void dt_scratch_pool_free(dt_scratch_pool_t *pool);
+
+/** Change the cap on idle buffers, freeing what is over it now. */
+void dt_scratch_pool_set_max_idle_bytes(dt_scratch_pool_t *pool, const size_t max_idle_bytes);
+
+/** Free the idle buffers now, e.g. when the overlay that used them is turned off. */
+void dt_scratch_pool_flush(dt_scratch_pool_t *pool);
+
+/**
+ * A cacheline-aligned buffer of at least size bytes, uninitialised, or NULL when out of memory.
+ * A NULL pool falls back to dt_alloc_align().
+ */
+void *dt_scratch_pool_get(dt_scratch_pool_t *pool, const size_t size);
+
+/** Give back a buffer from dt_scratch_pool_get() on the same pool. NULL, or a buffer the pool
+ * did not lend, is ignored. */
+void dt_scratch_pool_put(dt_scratch_pool_t *pool, void *buffer);
+
+#endif // DT_SYSTEM_SCRATCH_POOL_H
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on
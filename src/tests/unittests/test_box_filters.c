@@ -0,0 +1,152 @@
+/*
+    This file is part of Ansel,
+    Copyright (C) 2026 Aurélien PIERRE.
+
+    Ansel is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ansel is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ansel.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** dt_box_min() / dt_box_max() against the definition.
+ *
+ * The running extremum is exact arithmetic -- no rounding, no summation order -- so the only
+ * acceptable difference from a brute-force scan of the clipped window is none. The image
+ * sizes are chosen so both the 16-column strips and the 0..15 leftover columns run, and the
+ * radii span 1 to 256, past the image size, where the window clips on both sides at once.
+ *
+ * Each radius also prints its wall time. The filter is O(1) per pixel, so the column should
+ * stay flat as the radius grows; a time that scales with the radius is the old rescanning
+ * behaviour coming back, even if every pixel is still right.
+ */
+
+#include "darktable.h"
+#include "caches/pixelpipe_cache.h"
+#include "pixel/box_filters.h"
+#include "system/openmp.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+// cmocka.h declares `extern jmp_buf global_expect_assert_env' at file scope without including
+// <setjmp.h> itself. Same suppression as test_metadata_notify.c, and for the same reason.
+#include <setjmp.h>  // NOLINT(misc-include-cleaner)
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <glib.h>
+
+#define TEST_WIDTH 203
+#define TEST_HEIGHT 117
+
+static const int radii[] = { 1, 2, 3, 5, 8, 16, 31, 64, 100, 128, 255, 256 };
+
+/** Deterministic, with plateaus and monotonic ramps: the inputs the rescanning filter was slow on. */
+static void _fill(float *const buf, const size_t width, const size_t height)
+{
+  for(size_t j = 0; j < height; j++)
+    for(size_t i = 0; i < width; i++)
+      buf[j * width + i] = (float)((i * 7 + j * 13) % 29) + ((i / 11) % 2 ? (float)i : -(float)j);
+}
+
+/** The definition, one axis at a time: an extremum over a box is the extremum of the per-row
+ * extrema, exactly, so this is the brute force at a cost the larger radii can afford. */
+static void _brute_force(const float *const in, float *const out, const int width, const int height,
+                         const int w, const gboolean maximum)
+{
+  float *const rows = g_new(float, (size_t)width * height);
+  for(int j = 0; j < height; j++)
+    for(int i = 0; i < width; i++)
+    {
+      float m = maximum ? -FLT_MAX : FLT_MAX;
+      for(int x = MAX(i - w, 0); x <= MIN(i + w, width - 1); x++)
+        m = maximum ? fmaxf(m, in[j * width + x]) : fminf(m, in[j * width + x]);
+      rows[j * width + i] = m;
+    }
+  for(int j = 0; j < height; j++)
+    for(int i = 0; i < width; i++)
+    {
+      float m = maximum ? -FLT_MAX : FLT_MAX;
+      for(int y = MAX(j - w, 0); y <= MIN(j + w, height - 1); y++)
+        m = maximum ? fmaxf(m, rows[y * width + i]) : fminf(m, rows[y * width + i]);
+      out[j * width + i] = m;
+    }
+  g_free(rows);
+}
+
+static void _check(const gboolean maximum)
+{
+  const size_t size = (size_t)TEST_WIDTH * TEST_HEIGHT;
+  float *const in = g_new(float, size);
+  float *const expected = g_new(float, size);
+  float *const buf = g_new(float, size);
+  _fill(in, TEST_WIDTH, TEST_HEIGHT);
+
+  for(size_t r = 0; r < G_N_ELEMENTS(radii); r++)
+  {
+    const int w = radii[r];
+    _brute_force(in, expected, TEST_WIDTH, TEST_HEIGHT, w, maximum);
+    memcpy(buf, in, sizeof(float) * size);
+
+    const gint64 start = g_get_monotonic_time();
+    const int err = maximum ? dt_box_max(buf, TEST_HEIGHT, TEST_WIDTH, 1, w)
+                            : dt_box_min(buf, TEST_HEIGHT, TEST_WIDTH, 1, w);
+    const gint64 end = g_get_monotonic_time();
+    assert_int_equal(err, 0);
+    print_message("box %s radius %3d: %6" G_GINT64_FORMAT " us\n", maximum ? "max" : "min", w, end - start);
+
+    for(size_t k = 0; k < size; k++)
+      assert_float_equal(buf[k], expected[k], 0.f);
+  }
+
+  g_free(in);
+  g_free(expected);
+  g_free(buf);
+}
+
+static void test_box_max_matches_definition(void **state)
+{
+  (void)state;
+  _check(TRUE);
+}
+
+static void test_box_min_matches_definition(void **state)
+{
+  (void)state;
+  _check(FALSE);
+}
+
+static int _setup(void **state)
+{
+  (void)state;
+  // the per-thread scratch is sized from the application's thread count, which dt_init() would set
+  darktable.num_openmp_threads = omp_get_max_threads();
+  return dt_dev_pixelpipe_cache_init((size_t)64 << 20, FALSE, FALSE) ? 0 : -1;
+}
+
+static int _teardown(void **state)
+{
+  (void)state;
+  dt_dev_pixelpipe_cache_cleanup();
+  return 0;
+}
+
+int main(void)
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_box_max_matches_definition),
+    cmocka_unit_test(test_box_min_matches_definition),
+  };
+  return cmocka_run_group_tests(tests, _setup, _teardown);
+}
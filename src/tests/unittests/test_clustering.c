@@ -0,0 +1,352 @@
+/*
+    This file is part of Ansel,
+    Copyright (C) 2026 Aurélien PIERRE.
+
+    Ansel is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ansel is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ansel.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** dt_cluster_dbscan() against DBSCAN by definition, dt_cluster_linkage() against the map's old
+ * clustering, and dt_cluster_gaps().
+ *
+ * DBSCAN leaves one thing open: a border point next to two clusters may join either. So the
+ * brute-force side only pins what is unique -- which points are core, how the core points split
+ * into clusters, which points are noise -- and checks that every border point sits in the cluster
+ * of one of its core neighbours.
+ *
+ * The timing of a million points is tests/benchmark/ansel-bench-clustering, not a unit test.
+ */
+
+#include "math/clustering.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+// cmocka.h declares `extern jmp_buf global_expect_assert_env' at file scope without including
+// <setjmp.h> itself. Same suppression as test_metadata_notify.c, and for the same reason.
+#include <setjmp.h>  // NOLINT(misc-include-cleaner)
+#include <stdint.h>
+#include <cmocka.h>
+
+#include <glib.h>
+
+/** Gaussian-ish blobs over a sparse uniform background, interleaved so the input is in no order. */
+static double *_points(GRand *rand, const int count, const int blobs, const double spread, const double size)
+{
+  double *xy = g_new(double, 2 * count);
+  double *centres = g_new(double, 2 * blobs);
+  for(int b = 0; b < 2 * blobs; b++) centres[b] = g_rand_double_range(rand, 0., size);
+  for(int i = 0; i < count; i++)
+  {
+    if(i % 5 == 0)
+    {
+      xy[2 * i] = g_rand_double_range(rand, 0., size);
+      xy[2 * i + 1] = g_rand_double_range(rand, 0., size);
+      continue;
+    }
+    const int b = g_rand_int_range(rand, 0, blobs);
+    // the sum of three uniforms is close enough to a normal for this
+    for(int c = 0; c < 2; c++)
+    {
+      double offset = 0.;
+      for(int k = 0; k < 3; k++) offset += g_rand_double_range(rand, -spread, spread);
+      xy[2 * i + c] = centres[2 * b + c] + offset;
+    }
+  }
+  g_free(centres);
+  return xy;
+}
+
+static gboolean _near(const double *xy, const int a, const int b, const double epsilon)
+{
+  return fabs(xy[2 * a] - xy[2 * b]) <= epsilon && fabs(xy[2 * a + 1] - xy[2 * b + 1]) <= epsilon;
+}
+
+static int _find(int *parent, int i)
+{
+  while(parent[i] != i) i = parent[i] = parent[parent[i]];
+  return i;
+}
+
+static void _check_against_definition(const double *xy, const int count, const double epsilon, const int minpts)
+{
+  int *labels = g_new(int, count);
+  const int clusters = dt_cluster_dbscan(xy, count, epsilon, minpts, labels);
+
+  gboolean *core = g_new0(gboolean, count);
+  int *parent = g_new(int, count);
+  for(int i = 0; i < count; i++)
+  {
+    int neighbours = 0;
+    for(int j = 0; j < count; j++) neighbours += _near(xy, i, j, epsilon);
+    core[i] = neighbours >= minpts;
+    parent[i] = i;
+  }
+  for(int i = 0; i < count; i++)
+    for(int j = i + 1; j < count; j++)
+      if(core[i] && core[j] && _near(xy, i, j, epsilon)) parent[_find(parent, i)] = _find(parent, j);
+
+  // the core points: one cluster per component, numbered in the order the components first appear
+  int *cluster_of_root = g_new(int, count);
+  for(int i = 0; i < count; i++) cluster_of_root[i] = -1;
+  int components = 0;
+  for(int i = 0; i < count; i++)
+  {
+    if(!core[i]) continue;
+    const int root = _find(parent, i);
+    if(cluster_of_root[root] < 0) cluster_of_root[root] = components++;
+    assert_int_equal(labels[i], cluster_of_root[root]);
+  }
+  assert_int_equal(clusters, components);
+
+  // the others: noise exactly when no core point is near, else in the cluster of one that is
+  for(int i = 0; i < count; i++)
+  {
+    if(core[i]) continue;
+    gboolean reachable = FALSE, joined = FALSE;
+    for(int j = 0; j < count; j++)
+    {
+      if(!core[j] || !_near(xy, i, j, epsilon)) continue;
+      reachable = TRUE;
+      joined |= labels[i] == labels[j];
+    }
+    if(reachable)
+      assert_true(joined);
+    else
+      assert_int_equal(labels[i], DT_CLUSTER_NOISE);
+  }
+
+  g_free(labels);
+  g_free(core);
+  g_free(parent);
+  g_free(cluster_of_root);
+}
+
+static void test_dbscan_matches_definition(void **state)
+{
+  (void)state;
+  GRand *rand = g_rand_new_with_seed(47);
+  const int count = 3000;
+  double *xy = _points(rand, count, 12, 0.02, 1.);
+
+  _check_against_definition(xy, count, 0.005, 1);
+  _check_against_definition(xy, count, 0.005, 2);
+  _check_against_definition(xy, count, 0.01, 4);
+  _check_against_definition(xy, count, 0.02, 10);
+  _check_against_definition(xy, count, 0.2, 50);
+
+  g_free(xy);
+  g_rand_free(rand);
+}
+
+/** Duplicates, a zero epsilon, and the minpts bounds the map relies on. */
+static void test_dbscan_degenerate(void **state)
+{
+  (void)state;
+  const double xy[] = { 0., 0., 0., 0., 5., 5., 10., 10., 10., 10., 10., 10. };
+  int labels[6];
+
+  // with one point enough, every point is a cluster, and duplicates share theirs
+  assert_int_equal(dt_cluster_dbscan(xy, 6, 0., 1, labels), 3);
+  assert_int_equal(labels[0], 0);
+  assert_int_equal(labels[1], 0);
+  assert_int_equal(labels[2], 1);
+  assert_int_equal(labels[5], 2);
+
+  // with two, the lone point is noise
+  assert_int_equal(dt_cluster_dbscan(xy, 6, 0., 2, labels), 2);
+  assert_int_equal(labels[2], DT_CLUSTER_NOISE);
+  assert_int_equal(labels[3], 1);
+
+  // with three, only the triplicate is left
+  assert_int_equal(dt_cluster_dbscan(xy, 6, 0., 3, labels), 1);
+  assert_int_equal(labels[0], DT_CLUSTER_NOISE);
+  assert_int_equal(labels[4], 0);
+
+  // and a wide epsilon takes everything in
+  assert_int_equal(dt_cluster_dbscan(xy, 6, 10., 2, labels), 1);
+  for(int i = 0; i < 6; i++) assert_int_equal(labels[i], 0);
+
+  assert_int_equal(dt_cluster_dbscan(xy, 0, 1., 2, labels), 0);
+}
+
+/* The clustering src/views/map.c ran before it moved here, brute-forced: in index order, a point
+ * with at least minpts *other* unclustered points near it starts a cluster, which then takes in
+ * everything it can reach through neighbours. minpts is the map's setting, with the point itself
+ * taken off above 1, as the map did. */
+static int _map_baseline(const double *xy, const int count, const double epsilon, const int min_images,
+                         int *labels)
+{
+  const int minpts = min_images > 1 ? min_images - 1 : min_images;
+  const int unclassified = -2;
+  int *queue = g_new(int, count);
+  for(int i = 0; i < count; i++) labels[i] = unclassified;
+
+  int clusters = 0;
+  for(int i = 0; i < count; i++)
+  {
+    if(labels[i] != unclassified) continue;
+    int neighbours = 0;
+    for(int j = 0; j < count; j++) neighbours += j != i && labels[j] < 0 && _near(xy, i, j, epsilon);
+    if(neighbours < minpts)
+    {
+      labels[i] = DT_CLUSTER_NOISE;
+      continue;
+    }
+    int head = 0, tail = 0;
+    labels[i] = clusters;
+    queue[tail++] = i;
+    while(head < tail)
+    {
+      const int k = queue[head++];
+      for(int j = 0; j < count; j++)
+        if(labels[j] < 0 && _near(xy, k, j, epsilon))
+        {
+          labels[j] = clusters;
+          queue[tail++] = j;
+        }
+    }
+    clusters++;
+  }
+  g_free(queue);
+  return clusters;
+}
+
+// what src/views/map.c passes for its "min images per group" setting
+static int _map_minpts(const int min_images)
+{
+  return min_images > 1 ? min_images : min_images + 1;
+}
+
+static void _check_against_map(const double *xy, const int count, const double epsilon, const int min_images)
+{
+  int *labels = g_new(int, count);
+  int *expected = g_new(int, count);
+  assert_int_equal(dt_cluster_linkage(xy, count, epsilon, _map_minpts(min_images), labels),
+                   _map_baseline(xy, count, epsilon, min_images, expected));
+  for(int i = 0; i < count; i++) assert_int_equal(labels[i], expected[i]);
+  g_free(labels);
+  g_free(expected);
+}
+
+/** A chain through points that are not core, a pair, and a loner, at every small setting. */
+static void test_linkage_matches_map(void **state)
+{
+  (void)state;
+  // 0-1-2-3-4 one step apart along x, with 5, 6, 7 crowding 4; 8 and 9 a pair; 10 alone
+  const double xy[] = { 0., 0., 1., 0., 2., 0., 3., 0., 4., 0., 4.5, 0.5, 4.5, -0.5, 5., 0.,
+                        10., 10., 10.5, 10., 20., 20. };
+  const int count = 11;
+  int labels[11];
+
+  // 0: every image is a group of its own at least
+  assert_int_equal(dt_cluster_linkage(xy, count, 1., _map_minpts(0), labels), 3);
+  assert_int_equal(labels[8], 1);
+  assert_int_equal(labels[10], 2);
+  // 1 and 2: one neighbour is enough, as it always was
+  for(int min_images = 1; min_images <= 2; min_images++)
+  {
+    assert_int_equal(dt_cluster_linkage(xy, count, 1., _map_minpts(min_images), labels), 2);
+    for(int i = 0; i < 8; i++) assert_int_equal(labels[i], 0);
+    assert_int_equal(labels[8], 1);
+    assert_int_equal(labels[9], 1);
+    assert_int_equal(labels[10], DT_CLUSTER_NOISE);
+  }
+  // 5: only 4 has five images around it, itself included, and the cluster still runs down the
+  // chain to 0, where DBSCAN would stop at 3
+  assert_int_equal(dt_cluster_linkage(xy, count, 1., _map_minpts(5), labels), 1);
+  for(int i = 0; i < 8; i++) assert_int_equal(labels[i], 0);
+  assert_int_equal(labels[8], DT_CLUSTER_NOISE);
+  assert_int_equal(dt_cluster_dbscan(xy, count, 1., 5, labels), 1);
+  assert_int_equal(labels[2], DT_CLUSTER_NOISE);
+  assert_int_equal(labels[3], 0);
+  // 6: nothing is left
+  assert_int_equal(dt_cluster_linkage(xy, count, 1., _map_minpts(6), labels), 0);
+
+  for(int min_images = 0; min_images <= 7; min_images++) _check_against_map(xy, count, 1., min_images);
+
+  GRand *rand = g_rand_new_with_seed(1437);
+  const int random_count = 2000;
+  double *random_xy = _points(rand, random_count, 10, 0.02, 1.);
+  for(int min_images = 0; min_images <= 5; min_images++)
+  {
+    _check_against_map(random_xy, random_count, 0.004, min_images);
+    _check_against_map(random_xy, random_count, 0.02, min_images);
+  }
+  g_free(random_xy);
+  g_rand_free(rand);
+}
+
+static void test_gaps(void **state)
+{
+  (void)state;
+  // capture times in seconds, out of order: two shoots an hour apart, and a late straggler
+  const double times[] = { 3700., 10., 0., 3600., 30., 9000., 3650., 60. };
+  int labels[8];
+
+  assert_int_equal(dt_cluster_gaps(times, 8, 600., labels), 3);
+  const int expected[] = { 1, 0, 0, 1, 0, 2, 1, 0 };
+  for(int i = 0; i < 8; i++) assert_int_equal(labels[i], expected[i]);
+
+  // a gap exactly max_gap long does not split
+  assert_int_equal(dt_cluster_gaps(times, 8, 3540., labels), 2);
+  assert_int_equal(dt_cluster_gaps(times, 8, 5300., labels), 1);
+  assert_int_equal(dt_cluster_gaps(times, 8, 0., labels), 8);
+  assert_int_equal(dt_cluster_gaps(times, 0, 1., labels), 0);
+}
+
+/** Square blobs of 100 points on a grid, over a sparse background: every blob is a cluster of
+ * its own, numbered in input order. The layout of ansel-bench-clustering, a hundred times smaller. */
+static void test_dbscan_blob_grid(void **state)
+{
+  (void)state;
+  const int blobs_x = 8, blobs_y = 5, per_blob = 100, background = 1000;
+  const int count = blobs_x * blobs_y * per_blob + background;
+  GRand *rand = g_rand_new_with_seed(1000000);
+  double *xy = g_new(double, 2 * count);
+  int *labels = g_new(int, count);
+
+  int i = 0;
+  for(int b = 0; b < blobs_x * blobs_y; b++)
+    for(int k = 0; k < per_blob; k++, i++)
+    {
+      xy[2 * i] = 10. * (b % blobs_x) + g_rand_double_range(rand, 4.5, 5.5);
+      xy[2 * i + 1] = 10. * (b / blobs_x) + g_rand_double_range(rand, 4.5, 5.5);
+    }
+  for(; i < count; i++)
+  {
+    xy[2 * i] = g_rand_double_range(rand, 0., 10. * blobs_x);
+    xy[2 * i + 1] = g_rand_double_range(rand, 0., 10. * blobs_y);
+  }
+
+  // about 28 neighbours inside a blob, 7 in its corners, 0.07 in the background
+  assert_int_equal(dt_cluster_dbscan(xy, count, 0.3, 5, labels), blobs_x * blobs_y);
+  for(int b = 0; b < blobs_x * blobs_y; b++)
+    for(int k = 0; k < per_blob; k++) assert_int_equal(labels[b * per_blob + k], b);
+
+  g_free(xy);
+  g_free(labels);
+  g_rand_free(rand);
+}
+
+int main(void)
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_dbscan_matches_definition),
+    cmocka_unit_test(test_dbscan_degenerate),
+    cmocka_unit_test(test_linkage_matches_map),
+    cmocka_unit_test(test_gaps),
+    cmocka_unit_test(test_dbscan_blob_grid),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,275 @@
+/*
+    This file is part of Ansel,
+    Copyright (C) 2026 Aurélien PIERRE.
+
+    Ansel is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ansel is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ansel.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** DT_CONVERSION_BAKE_LUT against the lcms2 transforms it is sampled from.
+ *
+ * The built-in profiles are all matrix-shaper, so the lcms2 branch is forced: what is measured
+ * is the grid and its interpolation, which do not care where the transform came from. Every
+ * case converts to sRGB, so the error is measured as a delta E 1976 between the two sRGB
+ * renderings, clamped to the display range as a screen or a file would.
+ *
+ * Each case prints its mean, 99th percentile and maximum. The bounds asserted are loose on
+ * purpose: the maximum sits in dark saturated colours on the gamut boundary, where the output
+ * clamp puts a kink inside a grid cell, and it is the mean that says whether the LUT is right.
+ * Pixels outside [0,1] must come out of lcms2 itself, so for them the only acceptable
+ * difference is none.
+ */
+
+#include "darktable.h"
+#include "colorprofiles/colorspaces.h"
+#include "colorprofiles/conversion.h"
+#include "common/colorspaces_inline_conversions.h"
+#include "common/conf.h"
+#include "common/file_location.h"
+#include "system/mem_alloc.h"
+#include "system/openmp.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+// cmocka.h declares `extern jmp_buf global_expect_assert_env' at file scope without including
+// <setjmp.h> itself. Same suppression as test_metadata_notify.c, and for the same reason.
+#include <setjmp.h>  // NOLINT(misc-include-cleaner)
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <cmocka.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#define TEST_WIDTH 512
+#define TEST_HEIGHT 256
+
+#define MAX_MEAN_DELTA_E 0.3f
+#define MAX_DELTA_E 4.0f
+
+static gchar *_configdir = NULL;
+
+/** Deterministic, and biased towards the shadows the way photographs are: each channel is a
+ * uniform draw raised to the power 1, 2 or 3. */
+static void _fill(float *const buf, const size_t npixels)
+{
+  uint32_t state = 0x9E3779B9u;
+  for(size_t k = 0; k < npixels; k++)
+    for(int c = 0; c < 4; c++)
+    {
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      const float u = (float)(state >> 8) / (float)(1u << 24);
+      buf[4 * k + c] = (c == 3) ? 0.0f : powf(u, (float)(1 + (state & 3) % 3));
+    }
+}
+
+static void _srgb_to_Lab(const float *const pixel, dt_aligned_pixel_t Lab)
+{
+  dt_aligned_pixel_t sRGB = { 0.0f }, XYZ = { 0.0f };
+  for(int c = 0; c < 3; c++) sRGB[c] = CLAMP(pixel[c], 0.0f, 1.0f);
+  dt_sRGB_to_XYZ(sRGB, XYZ);
+  dt_XYZ_to_Lab(XYZ, Lab);
+}
+
+static int _compare_float(const void *a, const void *b)
+{
+  const float x = *(const float *)a;
+  const float y = *(const float *)b;
+  return (x > y) - (x < y);
+}
+
+static void _check(const dt_colorspaces_color_profile_type_t from_type,
+                   const dt_colorspaces_color_profile_type_t clip_type,
+                   const dt_colorspaces_color_profile_type_t proof_type, const char *name)
+{
+  const dt_colorspaces_endpoint_t from = { .type = from_type, .filename = "", .role = DT_PROFILE_ROLE_WORKING };
+  const dt_colorspaces_endpoint_t to = { .type = DT_COLORSPACE_SRGB, .filename = "", .role = DT_PROFILE_ROLE_OUTPUT };
+  const dt_colorspaces_endpoint_t clip = { .type = clip_type, .filename = "", .role = DT_PROFILE_ROLE_WORKING };
+  const dt_colorspaces_endpoint_t proof = { .type = proof_type, .filename = "", .role = DT_PROFILE_ROLE_OUTPUT };
+  const dt_colorspaces_endpoint_t *const clip_ptr = (clip_type == DT_COLORSPACE_NONE) ? NULL : &clip;
+  const dt_colorspaces_endpoint_t *const proof_ptr = (proof_type == DT_COLORSPACE_NONE) ? NULL : &proof;
+
+  dt_colorspaces_conversion_t *reference = dt_colorspaces_prepare_conversion(
+      &from, &to, clip_ptr, proof_ptr, DT_INTENT_PERCEPTUAL, DT_CONVERSION_FORCE_LCMS2);
+  dt_colorspaces_conversion_t *baked
+      = dt_colorspaces_prepare_conversion(&from, &to, clip_ptr, proof_ptr, DT_INTENT_PERCEPTUAL,
+                                          DT_CONVERSION_FORCE_LCMS2 | DT_CONVERSION_BAKE_LUT);
+  assert_non_null(reference);
+  assert_non_null(baked);
+  assert_false(dt_colorspaces_conversion_is_matrix(baked));
+
+  // it did bake, and a pipeline cache can tell the two apart
+  assert_true(dt_colorspaces_conversion_identity(baked) != dt_colorspaces_conversion_identity(reference));
+
+  const size_t npixels = (size_t)TEST_WIDTH * TEST_HEIGHT;
+  float *const in = dt_alloc_align_float(4 * npixels);
+  float *const expected = dt_alloc_align_float(4 * npixels);
+  float *const result = dt_alloc_align_float(4 * npixels);
+  float *const delta = g_new(float, npixels);
+  assert_non_null(in);
+  assert_non_null(expected);
+  assert_non_null(result);
+
+  _fill(in, npixels);
+
+  // one row out of the grid: below black, above white, NaN-free
+  for(size_t i = 0; i < TEST_WIDTH; i++)
+  {
+    float *const pixel = in + 4 * i;
+    pixel[i % 3] = (i & 1) ? 1.0f + 0.01f * (float)i : -0.001f * (float)(i + 1);
+  }
+
+  dt_colorspaces_apply_conversion(reference, in, expected, TEST_WIDTH, TEST_HEIGHT);
+  dt_colorspaces_apply_conversion(baked, in, result, TEST_WIDTH, TEST_HEIGHT);
+
+  for(size_t i = 0; i < 4 * TEST_WIDTH; i += 4)
+    for(int c = 0; c < 3; c++) assert_true(result[i + c] == expected[i + c]);
+
+  double sum = 0.0;
+  for(size_t k = 0; k < npixels; k++)
+  {
+    dt_aligned_pixel_t a, b;
+    _srgb_to_Lab(expected + 4 * k, a);
+    _srgb_to_Lab(result + 4 * k, b);
+    delta[k] = sqrtf(sqf(a[0] - b[0]) + sqf(a[1] - b[1]) + sqf(a[2] - b[2]));
+    sum += delta[k];
+  }
+  qsort(delta, npixels, sizeof(float), _compare_float);
+  const float mean = (float)(sum / npixels);
+  const float p99 = delta[(size_t)(0.99 * (npixels - 1))];
+  const float max = delta[npixels - 1];
+
+  fprintf(stderr, "[%s] delta E 1976 against lcms2: mean %.3f, p99 %.3f, max %.3f\n", name, mean, p99, max);
+  assert_true(mean < MAX_MEAN_DELTA_E);
+  assert_true(max < MAX_DELTA_E);
+
+  g_free(delta);
+  dt_free_align(result);
+  dt_free_align(expected);
+  dt_free_align(in);
+  dt_colorspaces_free_conversion(&baked);
+  dt_colorspaces_free_conversion(&reference);
+}
+
+/** Scene-linear working space to a display: the shaped grid. */
+static void test_linear_to_srgb(void **state)
+{
+  (void)state;
+  _check(DT_COLORSPACE_LIN_REC2020, DT_COLORSPACE_NONE, DT_COLORSPACE_NONE, "linear Rec2020 -> sRGB");
+}
+
+/** An encoded source: the grid is spaced evenly in the values themselves. */
+static void test_encoded_to_srgb(void **state)
+{
+  (void)state;
+  _check(DT_COLORSPACE_ADOBERGB, DT_COLORSPACE_NONE, DT_COLORSPACE_NONE, "Adobe RGB -> sRGB");
+}
+
+/** Two lcms2 transforms and the clamp between them, folded into one grid. */
+static void test_clipped_to_srgb(void **state)
+{
+  (void)state;
+  _check(DT_COLORSPACE_LIN_REC2020, DT_COLORSPACE_LIN_REC709, DT_COLORSPACE_NONE,
+         "linear Rec2020 -> sRGB, clipped to Rec709");
+}
+
+/** Soft proofing: the 65^3 grid. */
+static void test_proofed_to_srgb(void **state)
+{
+  (void)state;
+  _check(DT_COLORSPACE_LIN_REC2020, DT_COLORSPACE_NONE, DT_COLORSPACE_ADOBERGB,
+         "linear Rec2020 -> sRGB, proofed in Adobe RGB");
+}
+
+/** A second conversion with the same identity takes the memoised grid: same pixels, to the bit. */
+static void test_memoised_grid(void **state)
+{
+  (void)state;
+  const dt_colorspaces_endpoint_t from
+      = { .type = DT_COLORSPACE_LIN_REC2020, .filename = "", .role = DT_PROFILE_ROLE_WORKING };
+  const dt_colorspaces_endpoint_t to = { .type = DT_COLORSPACE_SRGB, .filename = "", .role = DT_PROFILE_ROLE_OUTPUT };
+  const dt_colorspaces_conversion_flags_t flags = DT_CONVERSION_FORCE_LCMS2 | DT_CONVERSION_BAKE_LUT;
+
+  dt_colorspaces_conversion_t *first
+      = dt_colorspaces_prepare_conversion(&from, &to, NULL, NULL, DT_INTENT_PERCEPTUAL, flags);
+  dt_colorspaces_conversion_t *second
+      = dt_colorspaces_prepare_conversion(&from, &to, NULL, NULL, DT_INTENT_PERCEPTUAL, flags);
+  assert_non_null(first);
+  assert_non_null(second);
+  assert_true(dt_colorspaces_conversion_identity(first) == dt_colorspaces_conversion_identity(second));
+
+  const size_t npixels = TEST_WIDTH;
+  float *const in = dt_alloc_align_float(4 * npixels);
+  float *const a = dt_alloc_align_float(4 * npixels);
+  float *const b = dt_alloc_align_float(4 * npixels);
+  _fill(in, npixels);
+
+  // the first one goes, the grid stays with the second
+  dt_colorspaces_apply_conversion(first, in, a, TEST_WIDTH, 1);
+  dt_colorspaces_free_conversion(&first);
+  dt_colorspaces_flush_baked_luts();
+  dt_colorspaces_apply_conversion(second, in, b, TEST_WIDTH, 1);
+
+  for(size_t k = 0; k < npixels; k++)
+    for(int c = 0; c < 3; c++) assert_true(a[4 * k + c] == b[4 * k + c]);
+
+  dt_free_align(b);
+  dt_free_align(a);
+  dt_free_align(in);
+  dt_colorspaces_free_conversion(&second);
+}
+
+static int _setup(void **state)
+{
+  (void)state;
+  // the per-thread miss rows are sized from the application's thread count, which dt_init() would set
+  darktable.num_openmp_threads = omp_get_max_threads();
+
+  // a throwaway config directory: the profile list reads conf keys, and nothing here is saved
+  _configdir = g_dir_make_tmp("ansel-test-XXXXXX", NULL);
+  if(IS_NULL_PTR(_configdir)) return -1;
+  dt_loc_init(NULL, NULL, NULL, _configdir, _configdir, _configdir, NULL);
+
+  gchar *anselrc = g_build_filename(_configdir, "anselrc", NULL);
+  darktable.conf = (dt_conf_t *)calloc(1, sizeof(dt_conf_t));
+  dt_conf_init(darktable.conf, anselrc, NULL);
+  g_free(anselrc);
+
+  dt_colorprofiles_init();
+  return 0;
+}
+
+static int _teardown(void **state)
+{
+  (void)state;
+  dt_colorprofiles_cleanup();
+  g_rmdir(_configdir);
+  g_free(_configdir);
+  return 0;
+}
+
+int main(void)
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_linear_to_srgb),
+    cmocka_unit_test(test_encoded_to_srgb),
+    cmocka_unit_test(test_clipped_to_srgb),
+    cmocka_unit_test(test_proofed_to_srgb),
+    cmocka_unit_test(test_memoised_grid),
+  };
+  return cmocka_run_group_tests(tests, _setup, _teardown);
+}
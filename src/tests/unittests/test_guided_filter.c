@@ -0,0 +1,175 @@
+/*
+    This file is part of Ansel,
+    Copyright (C) 2026 Aurélien PIERRE.
+
+    Ansel is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ansel is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ansel.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** guided_filter_subsampled() against guided_filter().
+ *
+ * The subsampled filter solves the coefficients on a coarse grid and upsamples them, so it is an
+ * approximation: it may differ from the full-resolution filter, by a bounded amount. The bounds
+ * below hold with a 2x margin over what this image gives, at the subsampling blend.c picks for
+ * the window (CLAMP(w / 16, 1, 4)) and at both guide weights it uses. At subsample 2, the coarse
+ * grid is wider than one tile of the solve, so the tile seams are covered too.
+ *
+ * Below subsample 2, or when the coarse window would vanish, the subsampled filter is the exact
+ * filter and must match it bit for bit.
+ *
+ * Each window prints both wall times.
+ */
+
+#include "darktable.h"
+#include "caches/pixelpipe_cache.h"
+#include "pixel/guided_filter.h"
+#include "system/openmp.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+// cmocka.h declares `extern jmp_buf global_expect_assert_env' at file scope without including
+// <setjmp.h> itself. Same suppression as test_metadata_notify.c, and for the same reason.
+#include <setjmp.h>  // NOLINT(misc-include-cleaner)
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <glib.h>
+
+#define TEST_WIDTH 1100
+#define TEST_HEIGHT 300
+
+// mean and max absolute difference to the full-resolution filter, over a mask in [0, 1]
+#define MAX_MEAN_ERROR 0.003f
+#define MAX_ERROR 0.04f
+
+static const int windows[] = { 32, 48, 64, 96, 128, 250 };
+static const float guide_weights[] = { 1.f, 100.f };
+
+/** A guide with a diagonal colour edge and soft gradients, and a mask that is a disc the edge cuts
+ * through, plus a little texture: the case feathering exists for. */
+static void _fill(float *const guide, float *const mask, const int width, const int height)
+{
+  for(int j = 0; j < height; j++)
+    for(int i = 0; i < width; i++)
+    {
+      const size_t k = (size_t)j * width + i;
+      const float edge = (i + 0.3f * j > 0.55f * width) ? 1.f : 0.f;
+      guide[4 * k + 0] = 0.1f + 0.6f * edge + 0.05f * sinf(i * 0.05f);
+      guide[4 * k + 1] = 0.2f + 0.3f * edge + 0.05f * cosf(j * 0.07f);
+      guide[4 * k + 2] = 0.3f - 0.2f * edge;
+      guide[4 * k + 3] = 0.f;
+      const float disc = hypotf(i - 0.4f * width, j - 0.5f * height) < 0.3f * height ? 1.f : 0.f;
+      mask[k] = 0.8f * disc + 0.1f * (float)((i * 7 + j * 13) % 17) / 17.f;
+    }
+}
+
+static void test_subsampled_within_tolerance(void **state)
+{
+  (void)state;
+  const size_t size = (size_t)TEST_WIDTH * TEST_HEIGHT;
+  float *const guide = g_new(float, 4 * size);
+  float *const mask = g_new(float, size);
+  float *const exact = g_new(float, size);
+  float *const fast = g_new(float, size);
+  _fill(guide, mask, TEST_WIDTH, TEST_HEIGHT);
+
+  for(size_t n = 0; n < G_N_ELEMENTS(windows); n++)
+    for(size_t g = 0; g < G_N_ELEMENTS(guide_weights); g++)
+    {
+      const int w = windows[n];
+      const int subsample = CLAMP(w / 16, 1, 4);
+      const float guide_weight = guide_weights[g];
+
+      const gint64 start = g_get_monotonic_time();
+      assert_int_equal(guided_filter(guide, mask, exact, TEST_WIDTH, TEST_HEIGHT, 4, w, 1.f, guide_weight,
+                                     0.f, 1.f), 0);
+      const gint64 middle = g_get_monotonic_time();
+      assert_int_equal(guided_filter_subsampled(guide, mask, fast, TEST_WIDTH, TEST_HEIGHT, 4, w, 1.f,
+                                                guide_weight, 0.f, 1.f, subsample), 0);
+      const gint64 end = g_get_monotonic_time();
+
+      double sum = 0.;
+      float worst = 0.f;
+      for(size_t k = 0; k < size; k++)
+      {
+        const float d = fabsf(fast[k] - exact[k]);
+        sum += d;
+        worst = fmaxf(worst, d);
+      }
+      const float mean = (float)(sum / size);
+      print_message("window %3d, subsample %d, guide weight %3g: mean %.5f, max %.5f, exact %6" G_GINT64_FORMAT
+                    " us, subsampled %6" G_GINT64_FORMAT " us\n",
+                    w, subsample, guide_weight, mean, worst, middle - start, end - middle);
+      assert_true(mean <= MAX_MEAN_ERROR);
+      assert_true(worst <= MAX_ERROR);
+    }
+
+  g_free(guide);
+  g_free(mask);
+  g_free(exact);
+  g_free(fast);
+}
+
+static void test_subsampled_falls_back_to_exact(void **state)
+{
+  (void)state;
+  const size_t size = (size_t)TEST_WIDTH * TEST_HEIGHT;
+  float *const guide = g_new(float, 4 * size);
+  float *const mask = g_new(float, size);
+  float *const exact = g_new(float, size);
+  float *const fast = g_new(float, size);
+  _fill(guide, mask, TEST_WIDTH, TEST_HEIGHT);
+
+  // subsample 1, then a window narrower than the subsampling
+  const int cases[][2] = { { 24, 1 }, { 3, 4 } };
+  for(size_t n = 0; n < G_N_ELEMENTS(cases); n++)
+  {
+    const int w = cases[n][0];
+    assert_int_equal(guided_filter(guide, mask, exact, TEST_WIDTH, TEST_HEIGHT, 4, w, 1.f, 100.f, 0.f, 1.f), 0);
+    assert_int_equal(guided_filter_subsampled(guide, mask, fast, TEST_WIDTH, TEST_HEIGHT, 4, w, 1.f, 100.f,
+                                              0.f, 1.f, cases[n][1]), 0);
+    assert_memory_equal(fast, exact, sizeof(float) * size);
+  }
+
+  g_free(guide);
+  g_free(mask);
+  g_free(exact);
+  g_free(fast);
+}
+
+static int _setup(void **state)
+{
+  (void)state;
+  // the per-thread scratch is sized from the application's thread count, which dt_init() would set
+  darktable.num_openmp_threads = omp_get_max_threads();
+  return dt_dev_pixelpipe_cache_init((size_t)64 << 20, FALSE, FALSE) ? 0 : -1;
+}
+
+static int _teardown(void **state)
+{
+  (void)state;
+  dt_dev_pixelpipe_cache_cleanup();
+  return 0;
+}
+
+int main(void)
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_subsampled_within_tolerance),
+    cmocka_unit_test(test_subsampled_falls_back_to_exact),
+  };
+  return cmocka_run_group_tests(tests, _setup, _teardown);
+}
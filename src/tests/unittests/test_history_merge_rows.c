@@ -0,0 +1,185 @@
+/*
+    This file is part of Ansel,
+    Copyright (C) 2026 Aurélien PIERRE.
+
+    Ansel is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ansel is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ansel.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** develop/history_merge_rows.h against the history dt_history_merge() writes.
+ *
+ * Image A stands for the first image of a batch: its history is what the full merge left, the
+ * destination's items followed by one item per merged module. The rows are read back from it and
+ * appended to image B, which had the same history before the merge. Both must end up row for row
+ * identical. The full merge itself needs loaded modules and stays out of reach here; what it
+ * writes is spelled out through the repository, as dt_dev_write_history_item() would. */
+
+#include "testdb.h"
+
+#include "develop/blend.h"
+#include "develop/history_merge_rows.h"
+#include "develop/iop_order.h"
+
+#include <string.h>
+
+static const unsigned char params_exposure[] = { 0x01, 0x02, 0x03, 0x04 };
+static const unsigned char params_color_old[] = { 0x10, 0x11 };
+static const unsigned char params_color_new[] = { 0x20, 0x21 };
+static const unsigned char params_exposure_new[] = { 0x05, 0x06, 0x07, 0x08 };
+
+static gboolean _write(const int32_t img, const int num, const char *operation, const void *params,
+                       const int params_size, const gboolean enabled, const dt_develop_blend_params_t *blend)
+{
+  return dt_history_repository_write_item(img, num, operation, params, params_size, 1, enabled, blend,
+                                          sizeof(dt_develop_blend_params_t), dt_develop_blend_version(), 0, "");
+}
+
+/** The destination before the merge: exposure, then color balance, the last item of the history. */
+static int32_t _make_dest(const int32_t film, const char *filename, const dt_develop_blend_params_t *blend)
+{
+  const int32_t img = testdb_make_image(film, filename);
+  assert_true(img > 0);
+  assert_true(dt_history_repository_set_module_order(img, DT_IOP_ORDER_ANSEL_RAW, NULL));
+  assert_true(_write(img, 0, "exposure", params_exposure, sizeof(params_exposure), TRUE, blend));
+  assert_true(_write(img, 1, "colorbalancergb", params_color_old, sizeof(params_color_old), TRUE, blend));
+  assert_true(dt_history_repository_set_end(img, 2));
+  return img;
+}
+
+typedef struct _rows_t
+{
+  GString *text;
+} _rows_t;
+
+static void _dump_row(void *user_data, const int32_t imgid, const int num, const int module_version,
+                      const char *operation, const void *op_params, const int op_params_len,
+                      const gboolean enabled, const void *blendop_params, const int blendop_params_len,
+                      const int blendop_version, const int multi_priority, const char *multi_name,
+                      const char *preset_name)
+{
+  _rows_t *rows = (_rows_t *)user_data;
+  g_string_append_printf(rows->text, "%d %s v%d %s p%d '%s' b%d:", num, operation, module_version,
+                         enabled ? "on" : "off", multi_priority, multi_name ? multi_name : "", blendop_version);
+  for(int k = 0; k < op_params_len; k++) g_string_append_printf(rows->text, "%02x", ((const guint8 *)op_params)[k]);
+  g_string_append_c(rows->text, '/');
+  for(int k = 0; k < blendop_params_len; k++)
+    g_string_append_printf(rows->text, "%02x", ((const guint8 *)blendop_params)[k]);
+  g_string_append_c(rows->text, '\n');
+}
+
+/** Everything the history of @p img stores, in num order, then history_end. */
+static gchar *_dump(const int32_t img)
+{
+  _rows_t rows = { .text = g_string_new(NULL) };
+  dt_history_repository_foreach_row(img, _dump_row, &rows);
+  g_string_append_printf(rows.text, "end %d\n", dt_history_repository_get_end(img));
+  return g_string_free(rows.text, FALSE);
+}
+
+static dt_hm_rows_t *_merged_modules(void)
+{
+  dt_hm_rows_t *rows = dt_hm_rows_new();
+  dt_hm_rows_add(rows, "colorbalancergb", "", 0, FALSE);
+  dt_hm_rows_add(rows, "exposure", "0", 0, FALSE);
+  return rows;
+}
+
+static void test_rows_write_what_the_merge_wrote(void **state)
+{
+  (void)state;
+  dt_develop_blend_params_t blend;
+  memset(&blend, 0, sizeof(blend));
+  const int32_t film = testdb_make_film("/testdb/rows");
+  const int32_t a = _make_dest(film, "a.raw", &blend);
+  const int32_t b = _make_dest(film, "b.raw", &blend);
+
+  // The full merge on A: color balance first, on the instance the history ended with -- a new item
+  // all the same, the merge never folds into the last one -- then exposure, disabled.
+  assert_true(_write(a, 2, "colorbalancergb", params_color_new, sizeof(params_color_new), TRUE, &blend));
+  assert_true(_write(a, 3, "exposure", params_exposure_new, sizeof(params_exposure_new), FALSE, &blend));
+  assert_true(dt_history_repository_set_end(a, 4));
+
+  dt_hm_batch_state_t batch = { .decision = DT_HM_BATCH_ACCEPT };
+  batch.order_text = dt_hm_rows_order_text(a);
+  assert_non_null(batch.order_text);
+
+  dt_hm_rows_t *rows = _merged_modules();
+  assert_false(dt_hm_rows_usable(rows));
+  assert_true(dt_hm_rows_capture(rows, a));
+  assert_true(dt_hm_rows_usable(rows));
+
+  assert_int_equal(dt_hm_rows_write_history(rows, b, &batch), 0);
+  gchar *dump_a = _dump(a);
+  gchar *dump_b = _dump(b);
+  assert_string_equal(dump_b, dump_a);
+  g_free(dump_a);
+  g_free(dump_b);
+
+  // An image with another module order is the full merge's, and is left alone.
+  const int32_t c = _make_dest(film, "c.jpg", &blend);
+  assert_true(dt_history_repository_set_module_order(c, DT_IOP_ORDER_ANSEL_JPG, NULL));
+  gchar *before = _dump(c);
+  assert_int_equal(dt_hm_rows_write_history(rows, c, &batch), 1);
+  gchar *after = _dump(c);
+  assert_string_equal(after, before);
+  g_free(before);
+  g_free(after);
+
+  // So is one with a redo tail.
+  const int32_t d = _make_dest(film, "d.raw", &blend);
+  assert_true(dt_history_repository_set_end(d, 1));
+  assert_int_equal(dt_hm_rows_write_history(rows, d, &batch), 1);
+  assert_int_equal(dt_history_repository_get_end(d), 1);
+
+  dt_hm_rows_free(rows);
+  g_free(batch.order_text);
+}
+
+static void test_rows_capture_declines(void **state)
+{
+  (void)state;
+  dt_develop_blend_params_t blend;
+  memset(&blend, 0, sizeof(blend));
+  const int32_t film = testdb_make_film("/testdb/rows_declined");
+
+  // the history doesn't end with the merged modules, in their order
+  const int32_t a = _make_dest(film, "a.raw", &blend);
+  assert_true(_write(a, 2, "exposure", params_exposure_new, sizeof(params_exposure_new), TRUE, &blend));
+  assert_true(_write(a, 3, "colorbalancergb", params_color_new, sizeof(params_color_new), TRUE, &blend));
+  assert_true(dt_history_repository_set_end(a, 4));
+  dt_hm_rows_t *rows = _merged_modules();
+  assert_false(dt_hm_rows_capture(rows, a));
+  assert_false(dt_hm_rows_usable(rows));
+  dt_hm_rows_free(rows);
+
+  // a drawn mask: its forms live in masks_history, which the rows don't carry
+  dt_develop_blend_params_t masked = blend;
+  masked.mask_mode = DEVELOP_MASK_ENABLED | DEVELOP_MASK_SHAPE;
+  masked.mask_id = 42;
+  const int32_t b = _make_dest(film, "b.raw", &blend);
+  assert_true(_write(b, 2, "colorbalancergb", params_color_new, sizeof(params_color_new), TRUE, &masked));
+  assert_true(_write(b, 3, "exposure", params_exposure_new, sizeof(params_exposure_new), TRUE, &blend));
+  assert_true(dt_history_repository_set_end(b, 4));
+  rows = _merged_modules();
+  assert_false(dt_hm_rows_capture(rows, b));
+  dt_hm_rows_free(rows);
+}
+
+int main(void)
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_rows_write_what_the_merge_wrote),
+    cmocka_unit_test(test_rows_capture_declines),
+  };
+  return cmocka_run_group_tests(tests, testdb_setup, testdb_teardown);
+}
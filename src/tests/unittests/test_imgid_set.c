@@ -0,0 +1,160 @@
+/*
+    This file is part of Ansel,
+    Copyright (C) 2026 Aurélien PIERRE.
+
+    Ansel is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ansel is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ansel.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** dt_imgid_set_t, the selection's set of image ids, against a GHashTable doing the same.
+ *
+ * The ids straddle the 64-bit words and the 65536-id blocks, where an off-by-one in the bit
+ * arithmetic would show, and the count is checked after every operation since the selection
+ * reports it as its length without ever counting again.
+ */
+
+#include "common/imgid_set.h"
+
+#include <stdarg.h>
+#include <stddef.h>
+// cmocka.h declares `extern jmp_buf global_expect_assert_env' at file scope without including
+// <setjmp.h> itself. Same suppression as test_metadata_notify.c, and for the same reason.
+#include <setjmp.h>  // NOLINT(misc-include-cleaner)
+#include <stdint.h>
+#include <cmocka.h>
+
+#include <glib.h>
+
+static const int32_t edges[] = { 0, 1, 63, 64, 65, 65535, 65536, 65537, 131071, 300000 };
+
+static void _fill(dt_imgid_set_t *set, const int32_t from, const int32_t to, const int32_t step)
+{
+  for(int32_t id = from; id < to; id += step) dt_imgid_set_add(set, id);
+}
+
+/** The walk must yield exactly the ids the reference holds, ascending, and the count must agree. */
+static void _assert_same(const dt_imgid_set_t *set, GHashTable *expected)
+{
+  assert_int_equal(dt_imgid_set_count(set), g_hash_table_size(expected));
+  int32_t previous = -1;
+  uint32_t walked = 0;
+  for(int32_t id = dt_imgid_set_next(set, -1); id != -1; id = dt_imgid_set_next(set, id))
+  {
+    assert_true(id > previous);
+    assert_true(g_hash_table_contains(expected, GINT_TO_POINTER(id)));
+    previous = id;
+    walked++;
+  }
+  assert_int_equal(walked, g_hash_table_size(expected));
+}
+
+static void test_membership(void **state)
+{
+  (void)state;
+  dt_imgid_set_t *set = dt_imgid_set_new();
+  GHashTable *expected = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+  assert_int_equal(dt_imgid_set_next(set, -1), -1);
+  assert_int_equal(dt_imgid_set_last(set), -1);
+
+  for(size_t k = 0; k < G_N_ELEMENTS(edges); k++)
+  {
+    assert_true(dt_imgid_set_add(set, edges[k]));
+    assert_false(dt_imgid_set_add(set, edges[k])); // already in
+    g_hash_table_add(expected, GINT_TO_POINTER(edges[k]));
+  }
+  assert_false(dt_imgid_set_add(set, -1));
+  assert_false(dt_imgid_set_contains(set, 2));
+  assert_false(dt_imgid_set_contains(set, 400000)); // past the last block
+  assert_int_equal(dt_imgid_set_last(set), 300000);
+  _assert_same(set, expected);
+
+  // ascending list, as the selection hands it out
+  GList *list = dt_imgid_set_to_list(set);
+  assert_int_equal(g_list_length(list), G_N_ELEMENTS(edges));
+  size_t k = 0;
+  for(GList *l = list; l; l = g_list_next(l), k++) assert_int_equal(GPOINTER_TO_INT(l->data), edges[k]);
+  g_list_free(list);
+
+  assert_true(dt_imgid_set_remove(set, 65536));
+  assert_false(dt_imgid_set_remove(set, 65536));
+  g_hash_table_remove(expected, GINT_TO_POINTER(65536));
+  assert_true(dt_imgid_set_remove(set, 300000));
+  g_hash_table_remove(expected, GINT_TO_POINTER(300000));
+  assert_int_equal(dt_imgid_set_last(set), 131071);
+  _assert_same(set, expected);
+
+  dt_imgid_set_clear(set);
+  g_hash_table_remove_all(expected);
+  _assert_same(set, expected);
+
+  g_hash_table_destroy(expected);
+  dt_imgid_set_free(set);
+}
+
+static void test_set_operations(void **state)
+{
+  (void)state;
+  // multiples of 3 and of 5 over three blocks
+  dt_imgid_set_t *threes = dt_imgid_set_new();
+  dt_imgid_set_t *fives = dt_imgid_set_new();
+  _fill(threes, 0, 200000, 3);
+  _fill(fives, 1, 150000, 5);
+
+  GHashTable *expected = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+  dt_imgid_set_t *both = dt_imgid_set_copy(threes);
+  dt_imgid_set_union(both, fives);
+  for(int32_t id = 0; id < 200000; id++)
+    if(id % 3 == 0 || (id < 150000 && id % 5 == 1)) g_hash_table_add(expected, GINT_TO_POINTER(id));
+  _assert_same(both, expected);
+
+  dt_imgid_set_t *common = dt_imgid_set_copy(threes);
+  dt_imgid_set_intersect(common, fives);
+  g_hash_table_remove_all(expected);
+  for(int32_t id = 0; id < 150000; id++)
+    if(id % 3 == 0 && id % 5 == 1) g_hash_table_add(expected, GINT_TO_POINTER(id));
+  _assert_same(common, expected);
+
+  dt_imgid_set_t *only = dt_imgid_set_copy(threes);
+  dt_imgid_set_subtract(only, fives);
+  g_hash_table_remove_all(expected);
+  for(int32_t id = 0; id < 200000; id++)
+    if(id % 3 == 0 && !(id < 150000 && id % 5 == 1)) g_hash_table_add(expected, GINT_TO_POINTER(id));
+  _assert_same(only, expected);
+
+  // intersecting with a smaller set empties the blocks past its end
+  dt_imgid_set_t *low = dt_imgid_set_new();
+  _fill(low, 0, 10, 1);
+  dt_imgid_set_intersect(only, low);
+  g_hash_table_remove_all(expected);
+  for(int32_t id = 0; id < 10; id += 3) g_hash_table_add(expected, GINT_TO_POINTER(id));
+  _assert_same(only, expected);
+
+  g_hash_table_destroy(expected);
+  dt_imgid_set_free(low);
+  dt_imgid_set_free(only);
+  dt_imgid_set_free(common);
+  dt_imgid_set_free(both);
+  dt_imgid_set_free(fives);
+  dt_imgid_set_free(threes);
+}
+
+int main(void)
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_membership),
+    cmocka_unit_test(test_set_operations),
+  };
+  return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,130 @@
+/*
+    This file is part of Ansel,
+    Copyright (C) 2026 Aurélien PIERRE.
+
+    Ansel is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ansel is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ansel.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** The in-memory tag name index behind the collection's tag rules and the tagging entry:
+ * it must answer what the LOWER()/SUBSTR() queries it replaced answered, and follow every
+ * write to data.tags without being reloaded. */
+
+#include "testdb.h"
+
+#include "system/mem_alloc.h" // dt_free
+
+static gboolean _has(GArray *tagids, const guint tagid)
+{
+  for(guint k = 0; k < tagids->len; k++)
+    if(g_array_index(tagids, guint, k) == tagid) return TRUE;
+  return FALSE;
+}
+
+static void test_paths_and_prefixes(void **state)
+{
+  (void)state;
+  const guint places = dt_tag_repository_insert("Places");
+  const guint france = dt_tag_repository_insert("places|France");
+  const guint paris = dt_tag_repository_insert("places|France|Paris");
+  const guint franconia = dt_tag_repository_insert("places|Franconia");
+  const guint ete = dt_tag_repository_insert("saisons|Été");
+  assert_true(places && france && paris && franconia && ete);
+
+  // exact, ignoring case
+  GArray *found = dt_tag_repository_find_path("PLACES|france", FALSE);
+  assert_int_equal(found->len, 1);
+  assert_true(_has(found, france));
+  g_array_unref(found);
+
+  // the subtree is the tag and what is below its "|", not its namesakes
+  found = dt_tag_repository_find_path("places|france", TRUE);
+  assert_int_equal(found->len, 2);
+  assert_true(_has(found, france));
+  assert_true(_has(found, paris));
+  assert_false(_has(found, franconia));
+  g_array_unref(found);
+
+  // a prefix takes the namesakes too
+  found = dt_tag_repository_find_prefix("places|fran");
+  assert_int_equal(found->len, 3);
+  assert_true(_has(found, franconia));
+  g_array_unref(found);
+
+  // folding is not ASCII-only, as LOWER() was
+  found = dt_tag_repository_find_path("SAISONS|ÉTÉ", FALSE);
+  assert_int_equal(found->len, 1);
+  assert_true(_has(found, ete));
+  g_array_unref(found);
+
+  found = dt_tag_repository_find_path("nowhere", TRUE);
+  assert_int_equal(found->len, 0);
+  g_array_unref(found);
+}
+
+static void test_follows_writes(void **state)
+{
+  (void)state;
+  const guint cat = dt_tag_repository_insert("animals|cat");
+  const guint dog = dt_tag_repository_insert("animals|dog");
+  assert_true(cat && dog);
+
+  // loaded by now: from here every change has to be patched in
+  GHashTable *found = dt_tag_repository_match("CAT", FALSE);
+  assert_true(g_hash_table_contains(found, GUINT_TO_POINTER(cat)));
+  g_hash_table_destroy(found);
+
+  guint64 generation = dt_tag_repository_index_generation();
+  dt_tag_repository_rename(cat, "animals|feline");
+  assert_true(dt_tag_repository_index_generation() != generation);
+  found = dt_tag_repository_match("cat", FALSE);
+  assert_false(g_hash_table_contains(found, GUINT_TO_POINTER(cat)));
+  g_hash_table_destroy(found);
+  found = dt_tag_repository_match("feline", FALSE);
+  assert_true(g_hash_table_contains(found, GUINT_TO_POINTER(cat)));
+  g_hash_table_destroy(found);
+
+  // synonyms only count when asked for
+  dt_tag_repository_set_synonyms(dog, "hound, canine");
+  found = dt_tag_repository_match("canine", FALSE);
+  assert_false(g_hash_table_contains(found, GUINT_TO_POINTER(dog)));
+  g_hash_table_destroy(found);
+  found = dt_tag_repository_match("canine", TRUE);
+  assert_true(g_hash_table_contains(found, GUINT_TO_POINTER(dog)));
+  g_hash_table_destroy(found);
+
+  // a new tag is found at once
+  const guint bird = dt_tag_repository_insert("animals|bird");
+  GArray *below = dt_tag_repository_find_path("animals", TRUE);
+  assert_int_equal(below->len, 3);
+  assert_true(_has(below, bird));
+  g_array_unref(below);
+
+  // and deleted ones are gone, one at a time or in a batch
+  dt_tag_repository_delete(bird);
+  gchar *ids = g_strdup_printf("%u, %u", cat, dog);
+  dt_tag_repository_delete_batch(ids);
+  dt_free(ids);
+  below = dt_tag_repository_find_path("animals", TRUE);
+  assert_int_equal(below->len, 0);
+  g_array_unref(below);
+}
+
+int main(void)
+{
+  const struct CMUnitTest tests[] = {
+    cmocka_unit_test(test_paths_and_prefixes),
+    cmocka_unit_test(test_follows_writes),
+  };
+  return cmocka_run_group_tests(tests, testdb_setup, testdb_teardown);
+}
@@ -97,9 +97,11 @@
 #include "common/selection.h"
 #include "common/undo.h"
 #include "common/conf.h"
+#include "database/collection_query.h"
 #include "control/input.h"
 #include "control/control.h"
 #include "control/jobs.h"
+#include "control/jobs/image_jobs.h"
 #include "develop/dev_pixelpipe.h"
 #include "develop/develop.h"
 #include "develop/imageop.h"
@@ -1149,6 +1151,39 @@ static void _darkroom_log_image_load_error(const int ret)
   }
 }
 
+/* Position in the collection of the image opened last, and which way the user went to get here:
+ * stepping forward through a shoot is by far the common case, but going back is not rare. */
+static int _darkroom_prefetch_offset = -1;
+static int _darkroom_prefetch_direction = 1;
+
+/* Decode the neighbours of the image just opened while the user edits it, the one in the direction
+ * of travel first, so the next step in the filmstrip doesn't wait on the raw. */
+static void _darkroom_prefetch_neighbours(const int32_t imgid)
+{
+  if(!dt_conf_get_bool("plugins/darkroom/prefetch_neighbours")) return;
+
+  const int offset = dt_collection_query_image_offset(imgid);
+  if(dt_collection_query_get_nth(offset) != imgid)
+  {
+    // not in the current collection: no neighbours, and no direction to learn from
+    _darkroom_prefetch_offset = -1;
+    return;
+  }
+
+  if(_darkroom_prefetch_offset >= 0 && offset != _darkroom_prefetch_offset)
+    _darkroom_prefetch_direction = (offset > _darkroom_prefetch_offset) ? 1 : -1;
+  _darkroom_prefetch_offset = offset;
+
+  int32_t neighbours[2];
+  int count = 0;
+  const int32_t ahead = dt_collection_query_get_nth(offset + _darkroom_prefetch_direction);
+  const int32_t behind = dt_collection_query_get_nth(offset - _darkroom_prefetch_direction);
+  if(ahead > 0) neighbours[count++] = ahead;
+  if(behind > 0) neighbours[count++] = behind;
+
+  dt_image_prefetch_full(neighbours, count);
+}
+
 static void _darkroom_image_loaded_callback(gpointer instance, guint request_id, guint result, gpointer user_data)
 {
   dt_view_t *self = (dt_view_t *)user_data;
@@ -1202,6 +1237,8 @@ static void _darkroom_image_loaded_callback(gpointer instance, guint request_id,
   dt_view_image_info_update(dev->image_storage.id);
 
   dt_dev_start_all_pipelines(dev);
+
+  _darkroom_prefetch_neighbours(dev->image_storage.id);
 }
 
 int try_enter(dt_view_t *self)
@@ -1983,6 +2020,8 @@ void leave(dt_view_t *self)
   _darkroom_center_pan_drag = FALSE;
   _reset_edge_pan();
   dt_gui_throttle_cancel(dev);
+  // the user is going elsewhere: the neighbours of this image may not be wanted any more
+  dt_image_prefetch_cancel();
   // Last moment at which committing is still safe -- everything below tears down
   // dev->pipe / dev->iop / dev->history. Run the pending edit rather than lose it.
   dt_dev_history_flush_pending_commits(dev);
@@ -48,6 +48,7 @@
 #include "common/selection.h"
 #include "common/times.h"
 #include "common/utility.h"
+#include "math/clustering.h"
 #include "common/conf.h"
 #include "control/control.h"
 #include "gui/dtgtk/thumbtable.h"
@@ -88,6 +89,28 @@ typedef struct dt_map_image_t
   dt_view_image_surface_fetcher_t fetcher;
 } dt_map_image_t;
 
+/* The images of one zoom level as the map shows them: a cluster, or a lone image. */
+typedef struct dt_map_cluster_t
+{
+  int32_t imgid;                // first member in longitude order, the one shown
+  int group;                    // cluster id, NOISE for a lone image
+  int group_count;
+  gboolean group_same_loc;
+  double latitude, longitude;   // centroid, degrees
+  double lat_min, lat_max, lon_min, lon_max; // members' extent, degrees
+} dt_map_cluster_t;
+
+/* The whole collection clustered at one zoom, kept until the points or the settings change. */
+typedef struct dt_map_level_t
+{
+  int count;
+  dt_map_cluster_t *clusters;
+  int *cluster_of; // per point row: index into clusters
+} dt_map_level_t;
+
+// osm-gps-map tops out at 20; anything above is clustered but not kept
+#define DT_MAP_ZOOM_LEVELS 21
+
 typedef struct dt_map_t
 {
   gboolean entering;
@@ -95,8 +118,15 @@ typedef struct dt_map_t
   OsmGpsMapSource_t map_source;
   OsmGpsMapLayer *osd;
   GSList *images;
+  // every collected geotagged image, in radians and longitude order, with the clusters of the
+  // zoom level on screen. Loaded once per collection, patched when images get geotagged.
   dt_geo_position_t *points;
   int nb_points;
+  gboolean points_valid;  // FALSE: reload the points on the next map move
+  GHashTable *point_rows; // imgid -> row in points, plus one
+  dt_map_level_t *levels[DT_MAP_ZOOM_LEVELS];
+  float levels_epsilon_factor; // the settings the levels were clustered with
+  int levels_min_images;
   GdkPixbuf *image_pin, *place_pin;
   GList *incoming_selection;
   GList *selected_images;
@@ -124,9 +154,6 @@ typedef struct dt_map_t
 #define UNCLASSIFIED -1
 #define NOISE -2
 
-#define CORE_POINT 1
-#define NOT_CORE_POINT 0
-
 static const int thumb_size = 128, thumb_border = 2, image_pin_size = 13, place_pin_size = 72;
 static const int cross_size = 16, max_size = 1024;
 static const uint32_t thumb_frame_color = 0x000000aa;
@@ -202,10 +229,9 @@ static gboolean _view_map_drag_motion_callback(GtkWidget *widget, GdkDragContext
                                                gint x, gint y, guint time, dt_view_t *self);
 static gboolean _view_map_dnd_failed_callback(GtkWidget *widget, GdkDragContext *drag_context,
                                               GtkDragResult result, dt_view_t *self);
-// find the images clusters on the map
-static void _dbscan(dt_geo_position_t *points, unsigned int num_points, double epsilon,
-                    unsigned int minpts);
 static gboolean _view_map_prefs_changed(dt_map_t *lib);
+/* free the clusterings of every zoom level */
+static void _view_map_levels_free(dt_map_t *lib);
 
 /* center map to on the baricenter of the image list */
 static gboolean _view_map_center_on_image_list(dt_view_t *self);
@@ -578,6 +604,7 @@ void init(dt_view_t *self)
   self->data = calloc(1, sizeof(dt_map_t));
 
   dt_map_t *lib = (dt_map_t *)self->data;
+  lib->point_rows = g_hash_table_new(g_direct_hash, g_direct_equal);
 
   if(dt_gui_get_global())
   {
@@ -681,10 +708,6 @@ void cleanup(dt_view_t *self)
     g_object_unref(G_OBJECT(lib->place_pin));
     g_object_unref(G_OBJECT(lib->osd));
     osm_gps_map_image_remove_all(lib->map);
-    if(lib->points)
-    {
-      dt_free(lib->points);
-    }
     if(lib->images)
     {
       g_slist_free_full(lib->images, _free_map_image);
@@ -712,6 +735,9 @@ void cleanup(dt_view_t *self)
     g_object_unref(G_OBJECT(lib->map));
     lib->map = NULL;
   }
+  _view_map_levels_free(lib);
+  dt_free(lib->points);
+  g_hash_table_destroy(lib->point_rows);
   dt_free(self->data);
 }
 
@@ -1270,6 +1296,232 @@ static void _view_map_get_bounding_box(dt_map_t *lib, dt_map_box_t *bbox)
   memcpy(bbox, &box, sizeof(dt_map_box_t));
 }
 
+static void _view_map_levels_free(dt_map_t *lib)
+{
+  for(int z = 0; z < DT_MAP_ZOOM_LEVELS; z++)
+  {
+    if(IS_NULL_PTR(lib->levels[z])) continue;
+    dt_free(lib->levels[z]->clusters);
+    dt_free(lib->levels[z]->cluster_of);
+    dt_free(lib->levels[z]);
+  }
+}
+
+static int _geo_position_cmp(const void *a, const void *b)
+{
+  const dt_geo_position_t *p = (const dt_geo_position_t *)a;
+  const dt_geo_position_t *q = (const dt_geo_position_t *)b;
+  if(p->x != q->x) return p->x < q->x ? -1 : 1;
+  return (p->imgid > q->imgid) - (p->imgid < q->imgid);
+}
+
+// the points changed: put them back in order, and forget every clustering of them
+static void _view_map_points_reindex(dt_map_t *lib)
+{
+  if(lib->nb_points > 0) qsort(lib->points, lib->nb_points, sizeof(dt_geo_position_t), _geo_position_cmp);
+  g_hash_table_remove_all(lib->point_rows);
+  for(int i = 0; i < lib->nb_points; i++)
+    g_hash_table_insert(lib->point_rows, GINT_TO_POINTER(lib->points[i].imgid), GINT_TO_POINTER(i + 1));
+  _view_map_levels_free(lib);
+}
+
+static void _view_map_points_load(dt_map_t *lib)
+{
+  int count = 0;
+  dt_image_geo_point_t *geo = dt_image_repository_get_collected_geo_points(-180.0, 180.0, 90.0, -90.0, &count);
+
+  dt_free(lib->points);
+  lib->nb_points = 0;
+  if(count > 0) lib->points = (dt_geo_position_t *)calloc(count, sizeof(dt_geo_position_t));
+  if(lib->points)
+  {
+    for(int i = 0; i < count; i++)
+    {
+      lib->points[i].imgid = geo[i].imgid;
+      lib->points[i].x = geo[i].longitude * M_PI / 180;
+      lib->points[i].y = geo[i].latitude * M_PI / 180;
+      lib->points[i].cluster_id = UNCLASSIFIED;
+    }
+    lib->nb_points = count;
+  }
+  dt_free(geo);
+
+  lib->points_valid = TRUE;
+  _view_map_points_reindex(lib);
+}
+
+// some images were geotagged, moved or had their location removed: patch their rows only
+static void _view_map_points_update(dt_map_t *lib, GList *imgs)
+{
+  if(!lib->points_valid) return; // the next map move reads them all anyway
+
+  for(const GList *iter = imgs; iter; iter = g_list_next(iter))
+  {
+    const int row = GPOINTER_TO_INT(g_hash_table_lookup(lib->point_rows, iter->data));
+    if(row > 0) lib->points[row - 1].imgid = UNKNOWN_IMAGE;
+  }
+
+  int kept = 0;
+  for(int i = 0; i < lib->nb_points; i++)
+    if(lib->points[i].imgid != UNKNOWN_IMAGE) lib->points[kept++] = lib->points[i];
+
+  int count = 0;
+  dt_image_geo_point_t *geo = dt_image_repository_get_collected_geo_points_of(imgs, &count);
+  if(count > 0)
+  {
+    dt_geo_position_t *points
+        = (dt_geo_position_t *)realloc(lib->points, sizeof(dt_geo_position_t) * (kept + count));
+    if(IS_NULL_PTR(points))
+    {
+      dt_free(geo);
+      lib->points_valid = FALSE;
+      return;
+    }
+    lib->points = points;
+    for(int i = 0; i < count; i++)
+    {
+      dt_geo_position_t *p = &lib->points[kept + i];
+      p->imgid = geo[i].imgid;
+      p->x = geo[i].longitude * M_PI / 180;
+      p->y = geo[i].latitude * M_PI / 180;
+      p->cluster_id = UNCLASSIFIED;
+    }
+  }
+  dt_free(geo);
+
+  lib->nb_points = kept + count;
+  _view_map_points_reindex(lib);
+}
+
+/* Cluster the whole collection at @p zoom, or take the clustering from the last visit, and
+ * leave each point's cluster id in lib->points, which the pointer handlers read. */
+static const dt_map_level_t *_view_map_get_level(dt_map_t *lib, int zoom)
+{
+  const float epsilon_factor = dt_conf_get_int("plugins/map/epsilon_factor");
+  const int min_images = dt_conf_get_int("plugins/map/min_images_per_group");
+  if(epsilon_factor != lib->levels_epsilon_factor || min_images != lib->levels_min_images)
+  {
+    _view_map_levels_free(lib);
+    lib->levels_epsilon_factor = epsilon_factor;
+    lib->levels_min_images = min_images;
+  }
+  if(lib->nb_points == 0) return NULL;
+
+  zoom = CLAMP(zoom, 0, DT_MAP_ZOOM_LEVELS - 1);
+  dt_map_level_t *level = lib->levels[zoom];
+  dt_geo_position_t *p = lib->points;
+
+  if(IS_NULL_PTR(level))
+  {
+    // zoom varies from 0 (156412 m/pixel) to 20 (0.149 m/pixel)
+    // https://wiki.openstreetmap.org/wiki/Zoom_levels
+    // each time zoom increases by 1 the size is divided by 2
+    // epsilon factor = 100 => epsilon covers more or less a thumbnail surface
+    #define R 6371   // earth radius (km)
+    double epsilon = thumb_size * (((unsigned int)(156412000 >> zoom))
+                                * epsilon_factor * 0.01 * 0.000001 / R);
+
+    double *xy = (double *)malloc(sizeof(double) * 2 * lib->nb_points);
+    int *labels = (int *)malloc(sizeof(int) * lib->nb_points);
+    int groups = -1;
+    if(xy && labels)
+    {
+      for(int i = 0; i < lib->nb_points; i++)
+      {
+        xy[2 * i] = p[i].x;
+        xy[2 * i + 1] = p[i].y;
+      }
+      dt_times_t start;
+      dt_get_times(&start);
+      // min_images has always counted the image itself, except for 0 and 1, which ask for that
+      // many neighbours. Clusters grow through every image they reach.
+      const int minpts = min_images > 1 ? min_images : min_images + 1;
+      groups = dt_cluster_linkage(xy, lib->nb_points, epsilon, minpts, labels);
+      dt_show_times(&start, "[map] dbscan calculation");
+      for(int i = 0; i < lib->nb_points && groups >= 0; i++)
+        p[i].cluster_id = labels[i] == DT_CLUSTER_NOISE ? NOISE : labels[i];
+    }
+    dt_free(xy);
+    dt_free(labels);
+    if(groups < 0) return NULL;
+
+    level = (dt_map_level_t *)calloc(1, sizeof(dt_map_level_t));
+    int *first_of_group = (int *)malloc(sizeof(int) * MAX(groups, 1));
+    if(level)
+    {
+      level->clusters = (dt_map_cluster_t *)malloc(sizeof(dt_map_cluster_t) * lib->nb_points);
+      level->cluster_of = (int *)malloc(sizeof(int) * lib->nb_points);
+    }
+    if(IS_NULL_PTR(level) || IS_NULL_PTR(first_of_group) || IS_NULL_PTR(level->clusters)
+       || IS_NULL_PTR(level->cluster_of))
+    {
+      if(level)
+      {
+        dt_free(level->clusters);
+        dt_free(level->cluster_of);
+      }
+      dt_free(level);
+      dt_free(first_of_group);
+      return NULL;
+    }
+    for(int g = 0; g < groups; g++) first_of_group[g] = -1;
+
+    for(int i = 0; i < lib->nb_points; i++)
+    {
+      const double lon = p[i].x * 180 / M_PI, lat = p[i].y * 180 / M_PI;
+      const int g = p[i].cluster_id;
+      int k = (g >= 0) ? first_of_group[g] : -1;
+      if(k < 0)
+      {
+        // a lone image, or the first member of a cluster: it is the one shown
+        k = level->count++;
+        if(g >= 0) first_of_group[g] = k;
+        level->clusters[k] = (dt_map_cluster_t){ .imgid = p[i].imgid, .group = g, .group_count = 0,
+                                                 .group_same_loc = TRUE,
+                                                 .lat_min = lat, .lat_max = lat, .lon_min = lon, .lon_max = lon };
+      }
+      dt_map_cluster_t *c = &level->clusters[k];
+      c->group_count++;
+      c->longitude += lon;
+      c->latitude += lat;
+      c->lat_min = MIN(c->lat_min, lat);
+      c->lat_max = MAX(c->lat_max, lat);
+      c->lon_min = MIN(c->lon_min, lon);
+      c->lon_max = MAX(c->lon_max, lon);
+      level->cluster_of[i] = k;
+    }
+    for(int k = 0; k < level->count; k++)
+    {
+      dt_map_cluster_t *c = &level->clusters[k];
+      c->longitude /= c->group_count;
+      c->latitude /= c->group_count;
+      c->group_same_loc = (c->lat_min == c->lat_max && c->lon_min == c->lon_max);
+    }
+    dt_free(first_of_group);
+    lib->levels[zoom] = level;
+  }
+  else
+  {
+    for(int i = 0; i < lib->nb_points; i++) p[i].cluster_id = level->clusters[level->cluster_of[i]].group;
+  }
+
+  return level;
+}
+
+typedef struct _cluster_marks_t
+{
+  dt_map_t *lib;
+  const dt_map_level_t *level;
+  gboolean *selected; // per cluster of the level
+} _cluster_marks_t;
+
+static void _mark_cluster(const int32_t imgid, void *user_data)
+{
+  _cluster_marks_t *marks = (_cluster_marks_t *)user_data;
+  const int row = GPOINTER_TO_INT(g_hash_table_lookup(marks->lib->point_rows, GINT_TO_POINTER(imgid)));
+  if(row > 0) marks->selected[marks->level->cluster_of[row - 1]] = TRUE;
+}
+
 static void _view_map_changed_callback_delayed(gpointer user_data)
 {
   dt_view_t *self = (dt_view_t *)user_data;
@@ -1311,106 +1563,37 @@ static void _view_map_changed_callback_delayed(gpointer user_data)
     dt_conf_set_float("plugins/map/latitude", center_lat);
     dt_conf_set_int("plugins/map/zoom", zoom);
 
-    /* the collected images inside the viewport, in the longitude order dbscan needs */
-    int img_count = 0;
-    dt_image_geo_point_t *geo = dt_image_repository_get_collected_geo_points(
-        lib->bbox.lon1, lib->bbox.lon2, lib->bbox.lat1, lib->bbox.lat2, &img_count);
-
-    if(lib->points)
-    {
-      dt_free(lib->points);
-    }
-    lib->nb_points = img_count;
-    if(img_count > 0)
-      lib->points = (dt_geo_position_t *)calloc(img_count, sizeof(dt_geo_position_t));
-    dt_geo_position_t *p = lib->points;
-
-    /* make the image list: same points, in radians, ready to be clustered */
-    int i = 0;
-    for(i = 0; p && i < img_count; i++)
-    {
-      p[i].imgid = geo[i].imgid;
-      p[i].x = geo[i].longitude * M_PI / 180;
-      p[i].y = geo[i].latitude * M_PI / 180;
-      p[i].cluster_id = UNCLASSIFIED;
-    }
-    dt_free(geo);
+    /* the clusters of this zoom level that reach into the viewport */
+    if(!lib->points_valid) _view_map_points_load(lib);
+    const dt_map_level_t *level = _view_map_get_level(lib, zoom);
 
-    if(p)
+    if(level)
     {
-      const float epsilon_factor = dt_conf_get_int("plugins/map/epsilon_factor");
-      const int min_images = dt_conf_get_int("plugins/map/min_images_per_group");
-      // zoom varies from 0 (156412 m/pixel) to 20 (0.149 m/pixel)
-      // https://wiki.openstreetmap.org/wiki/Zoom_levels
-      // each time zoom increases by 1 the size is divided by 2
-      // epsilon factor = 100 => epsilon covers more or less a thumbnail surface
-      #define R 6371   // earth radius (km)
-      double epsilon = thumb_size * (((unsigned int)(156412000 >> zoom))
-                                  * epsilon_factor * 0.01 * 0.000001 / R);
-
-      dt_times_t start;
-      dt_get_times(&start);
-      _dbscan(p, img_count, epsilon, min_images);
-      dt_show_times(&start, "[map] dbscan calculation");
+      // which clusters hold a selected image: one lookup per selected image
+      _cluster_marks_t marks = { .lib = lib, .level = level };
+      marks.selected = (gboolean *)calloc(MAX(level->count, 1), sizeof(gboolean));
+      if(marks.selected) dt_act_on_foreach_image(_mark_cluster, &marks);
+      gboolean *selected = marks.selected;
 
-      // set the clusters
-      GList *sel_imgs = dt_act_on_get_images();
-      int group = -1;
-      for(i = 0; i< img_count; i++)
+      for(int k = 0; k < level->count; k++)
       {
-        if(p[i].cluster_id == NOISE)
-        {
-          dt_map_image_t *entry = (dt_map_image_t *)calloc(1, sizeof(dt_map_image_t));
-          dt_view_image_surface_fetcher_init(&entry->fetcher);
-          entry->imgid = p[i].imgid;
-          entry->group = p[i].cluster_id;
-          entry->group_count = 1;
-          entry->longitude = p[i].x * 180 / M_PI;
-          entry->latitude = p[i].y * 180 / M_PI;
-          entry->group_same_loc = TRUE;
-          if(sel_imgs)
-            entry->selected_in_group = g_list_find((GList *)sel_imgs,
-                                                   GINT_TO_POINTER(entry->imgid))
-                                       ? TRUE : FALSE;
-          lib->images = g_slist_prepend(lib->images, entry);
-        }
-        else if(p[i].cluster_id > group)
-        {
-          group = p[i].cluster_id;
-          dt_map_image_t *entry = (dt_map_image_t *)calloc(1, sizeof(dt_map_image_t));
-          dt_view_image_surface_fetcher_init(&entry->fetcher);
-          entry->imgid = p[i].imgid;
-          entry->group = p[i].cluster_id;
-          entry->group_same_loc = TRUE;
-          entry->selected_in_group = (sel_imgs && g_list_find((GList *)sel_imgs,
-                                                               GINT_TO_POINTER(p[i].imgid)))
-                                     ? TRUE : FALSE;
-          const double lon = p[i].x, lat = p[i].y;
-          for(int j = 0; j < img_count; j++)
-          {
-            if(p[j].cluster_id == group)
-            {
-              entry->group_count++;
-              entry->longitude += p[j].x;
-              entry->latitude += p[j].y;
-              if(entry->group_same_loc && (p[j].x != lon || p[j].y != lat))
-              {
-                entry->group_same_loc = FALSE;
-              }
-              if(sel_imgs && !entry->selected_in_group)
-              {
-                if(g_list_find((GList *)sel_imgs, GINT_TO_POINTER(p[j].imgid)))
-                  entry->selected_in_group = TRUE;
-              }
-            }
-          }
-          entry->latitude = entry->latitude  * 180 / M_PI / entry->group_count;
-          entry->longitude = entry->longitude * 180 / M_PI / entry->group_count;
-          lib->images = g_slist_prepend(lib->images, entry);
-        }
+        const dt_map_cluster_t *c = &level->clusters[k];
+        if(c->lon_max < lib->bbox.lon1 || c->lon_min > lib->bbox.lon2
+           || c->lat_max < lib->bbox.lat2 || c->lat_min > lib->bbox.lat1)
+          continue;
+
+        dt_map_image_t *entry = (dt_map_image_t *)calloc(1, sizeof(dt_map_image_t));
+        dt_view_image_surface_fetcher_init(&entry->fetcher);
+        entry->imgid = c->imgid;
+        entry->group = c->group;
+        entry->group_count = c->group_count;
+        entry->longitude = c->longitude;
+        entry->latitude = c->latitude;
+        entry->group_same_loc = c->group_same_loc;
+        entry->selected_in_group = selected && selected[k];
+        lib->images = g_slist_prepend(lib->images, entry);
       }
-      g_list_free(sel_imgs);
-      sel_imgs = NULL;
+      dt_free(selected);
     }
 
     needs_redraw = _view_map_draw_images(self);
@@ -2545,6 +2728,7 @@ static void _view_map_collection_changed(gpointer instance, dt_collection_change
 {
   dt_view_t *self = (dt_view_t *)user_data;
   dt_map_t *lib = (dt_map_t *)self->data;
+  lib->points_valid = FALSE;
   // avoid to centre the map on collection while a location is active
   if(dt_view_manager_get_global()->proxy.map.view && !lib->loc.main.id)
   {
@@ -2591,6 +2775,11 @@ static void _view_map_geotag_changed(gpointer instance, GList *imgs, const int l
   {
     dt_view_t *self = (dt_view_t *)user_data;
     dt_map_t *lib = (dt_map_t *)self->data;
+    // no list means anything may have moved
+    if(imgs)
+      _view_map_points_update(lib, imgs);
+    else
+      lib->points_valid = FALSE;
     if(dt_view_manager_get_global()->proxy.map.view) g_signal_emit_by_name(lib->map, "changed");
   }
 }
@@ -2805,138 +2994,6 @@ static gboolean _view_map_prefs_changed(dt_map_t *lib)
   return prefs_changed;
 }
 
-// starting point taken from https://github.com/gyaikhom/dbscan
-// Copyright 2015 Gagarine Yaikhom (MIT License)
-
-typedef struct epsilon_neighbours_t
-{
-  unsigned int num_members;
-  unsigned int index[];
-} epsilon_neighbours_t;
-
-typedef struct dt_dbscan_t
-{
-  dt_geo_position_t *points;
-  unsigned int num_points;
-  double epsilon;
-  unsigned int minpts;
-  epsilon_neighbours_t *seeds;
-  epsilon_neighbours_t *spreads;
-  unsigned int index;
-  unsigned int cluster_id;
-} dt_dbscan_t;
-
-static dt_dbscan_t db;
-
-static void _get_epsilon_neighbours(epsilon_neighbours_t *en, unsigned int index)
-{
-  // points are ordered by longitude
-  // limit the exploration to epsilon east and west
-  // west
-  for(int i = index; i < db.num_points; ++i)
-  {
-    if(i == index || db.points[i].cluster_id >= 0)
-      continue;
-    if((db.points[i].x - db.points[index].x) > db.epsilon)
-      break;
-    if(fabs(db.points[i].y - db.points[index].y) > db.epsilon)
-      continue;
-    else
-    {
-      en->index[en->num_members] = i;
-      en->num_members++;
-    }
-  }
-  // east
-  for(int i = index; i >= 0; --i)
-  {
-    if(i == (int)index || db.points[i].cluster_id >= 0)
-      continue;
-    if((db.points[index].x - db.points[i].x) > db.epsilon)
-      break;
-    if(fabs(db.points[index].y - db.points[i].y) > db.epsilon)
-      continue;
-    else
-    {
-      en->index[en->num_members] = i;
-      en->num_members++;
-    }
-  }
-}
-
-static void _dbscan_spread(unsigned int index)
-{
-  db.spreads->num_members = 0;
-  _get_epsilon_neighbours(db.spreads, index);
-
-  for(unsigned int i = 0; i < db.spreads->num_members; i++)
-  {
-    dt_geo_position_t *d = &db.points[db.spreads->index[i]];
-    if(d->cluster_id == NOISE || d->cluster_id == UNCLASSIFIED)
-    {
-      db.seeds->index[db.seeds->num_members] = db.spreads->index[i];
-      db.seeds->num_members++;
-      d->cluster_id = db.cluster_id;
-    }
-  }
-}
-
-static int _dbscan_expand(unsigned int index)
-{
-  int return_value = NOT_CORE_POINT;
-  db.seeds->num_members = 0;
-  _get_epsilon_neighbours(db.seeds, index);
-
-  if (db.seeds->num_members < db.minpts)
-    db.points[index].cluster_id = NOISE;
-  else
-  {
-    db.points[index].cluster_id = db.cluster_id;
-    for(int i = 0; i < db.seeds->num_members; i++)
-    {
-      db.points[db.seeds->index[i]].cluster_id = db.cluster_id;
-    }
-
-    for(int i = 0; i < db.seeds->num_members; i++)
-    {
-      _dbscan_spread(db.seeds->index[i]);
-    }
-    return_value = CORE_POINT;
-  }
-  return return_value;
-}
-
-static void _dbscan(dt_geo_position_t *points, unsigned int num_points,
-                    double epsilon, unsigned int minpts)
-{
-  db.points = points;
-  db.num_points = num_points;
-  db.epsilon = epsilon;
-  // remove the pivot from target
-  db.minpts = minpts > 1 ? minpts - 1 : minpts;
-  db.cluster_id = 0;
-  db.seeds = (epsilon_neighbours_t *)malloc(sizeof(db.seeds->num_members)
-      + num_points * sizeof(db.seeds->index[0]));
-  db.spreads = (epsilon_neighbours_t *)malloc(sizeof(db.spreads->num_members)
-      + num_points * sizeof(db.spreads->index[0]));
-
-  if(db.seeds && db.spreads)
-  {
-    for(unsigned int i = 0; i < db.num_points; ++i)
-    {
-      if(db.points[i].cluster_id == UNCLASSIFIED)
-      {
-        if(_dbscan_expand(i) == CORE_POINT)
-        {
-          ++db.cluster_id;
-        }
-      }
-    }
-  dt_free(db.seeds);
-  dt_free(db.spreads);
-  }
-}
-
 // clang-format off
 // modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
 // vim: shiftwidth=2 expandtab tabstop=2 cindent
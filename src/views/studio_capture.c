@@ -24,9 +24,11 @@
 
 #include "develop/masks_gui.h"
 #include "system/atomic.h"
+#include "widgets/bauhaus.h"
 #include "widgets/widget_settings.h"
 #include "widgets/accelerators.h"
 #include "common/collection.h"
+#include "common/folder_survey.h"
 #include "common/module_versioning.h"
 #include "common/selection.h"
 #include "control/input.h"
@@ -52,6 +54,7 @@
 
 #include <gdk/gdkkeysyms.h>
 #include <math.h>
+#include <pango/pangocairo.h>
 #include "control/signal.h"
 
 DT_MODULE(1)
@@ -97,6 +100,13 @@ typedef struct dt_studio_capture_t
   // import signal fires, so the first fetched surface may predate them.
   guint refresh_timeout;
 
+  // Shot-to-screen latency of the displayed image, when the folder survey
+  // imported it: wall-clock times at which this view first painted it from
+  // its thumbnail, then from the live pipe. 0 until then.
+  gint64 thumbnail_shown;
+  gint64 preview_shown;
+  gboolean latency_logged;
+
   // Own develop instance. While the atelier is active it is published as
   // darktable.develop and runs the pixelpipe on the displayed image so the
   // scopes (which read darktable.develop->preview_pipe) have data to show.
@@ -393,6 +403,8 @@ static void _studio_set_image(dt_studio_capture_t *d, const int32_t imgid)
   d->pan_x = d->pan_y = 0.0;
   d->anchor_pending = FALSE;
   d->panning = FALSE;
+  d->thumbnail_shown = d->preview_shown = 0;
+  d->latency_logged = FALSE;
   dt_view_image_surface_fetcher_invalidate(&d->fetcher, &d->surface);
 
   dt_view_active_images_reset(FALSE);
@@ -813,6 +825,46 @@ static void _studio_draw_pickers(dt_studio_capture_t *d, cairo_t *cr)
   cairo_restore(cr);
 }
 
+/**
+ * @brief Print, in the bottom-right corner, how long a captured shot took to reach the screen.
+ *
+ * Counted from the moment its file was completely written in the surveyed
+ * folder, to the first paint of its thumbnail, then of the processed preview.
+ */
+static void _studio_draw_latency(dt_studio_capture_t *d, cairo_t *cr, const int width, const int height)
+{
+  if(d->thumbnail_shown == 0) return;
+  const gint64 arrival = dt_folder_survey_get_arrival(d->imgid);
+  if(arrival <= 0) return;
+
+  const double thumbnail = MAX(d->thumbnail_shown - arrival, 0) / (double)G_USEC_PER_SEC;
+  const double preview = MAX(d->preview_shown - arrival, 0) / (double)G_USEC_PER_SEC;
+  gchar *label = d->preview_shown
+                     ? g_strdup_printf(_("shot to screen: %.2f s, full preview: %.2f s"), thumbnail, preview)
+                     : g_strdup_printf(_("shot to screen: %.2f s"), thumbnail);
+
+  if(d->preview_shown && !d->latency_logged)
+  {
+    dt_print(DT_DEBUG_PERF, "[studio_capture] image %i: thumbnail shown %.3f s, full preview %.3f s after capture\n",
+             d->imgid, thumbnail, preview);
+    d->latency_logged = TRUE;
+  }
+
+  PangoFontDescription *desc = pango_font_description_copy_static(dt_bauhaus_get_global()->pango_font_desc);
+  pango_font_description_set_absolute_size(desc, DT_PIXEL_APPLY_DPI(12) * PANGO_SCALE);
+  PangoLayout *layout = pango_cairo_create_layout(cr);
+  pango_layout_set_font_description(layout, desc);
+  pango_layout_set_text(layout, label, -1);
+  PangoRectangle ink;
+  pango_layout_get_pixel_extents(layout, &ink, NULL);
+  cairo_move_to(cr, width - ink.width - ink.height * 2, height - ink.height * 3);
+  cairo_set_source_rgba(cr, 0.7, 0.7, 0.7, 0.8);
+  pango_cairo_show_layout(cr, layout);
+  pango_font_description_free(desc);
+  g_object_unref(layout);
+  dt_free(label);
+}
+
 void expose(dt_view_t *self, cairo_t *cr, int32_t width, int32_t height, int32_t pointerx, int32_t pointery)
 {
   dt_studio_capture_t *d = (dt_studio_capture_t *)self->data;
@@ -924,7 +976,12 @@ void expose(dt_view_t *self, cairo_t *cr, int32_t width, int32_t height, int32_t
     cairo_restore(cr);
   }
 
+  const gint64 now = g_get_real_time();
+  if(d->thumbnail_shown == 0) d->thumbnail_shown = now;
+  if(drew_live && d->preview_shown == 0) d->preview_shown = now;
+
   _studio_draw_pickers(d, cr);
+  _studio_draw_latency(d, cr, width, height);
   dt_dev_draw_profile_mode_label(cr, height);
 }
 
@@ -1036,6 +1036,70 @@ void dt_cairo_sharpen_surface_rgb24(cairo_surface_t *surface)
   cairo_surface_mark_dirty(surface);
 }
 
+// Scale a display-ready buffer, as the thumbnail of a width x height widget at @p zoom wants it
+static cairo_surface_t *_view_surface_from_display_buffer(uint8_t *rgbbuf, const int buf_wd, const int buf_ht,
+                                                          const int width, const int height, const int zoom)
+{
+  float scale = 1.f;
+  int img_width = buf_wd;
+  int img_height = buf_ht;
+
+  if(zoom == DT_THUMBTABLE_ZOOM_FIT)
+  {
+    scale = fminf((float)width / (float)buf_wd, (float)height / (float)buf_ht) * dt_gui_get_global()->ppd;
+    img_width = roundf(buf_wd * scale);
+    img_height = roundf(buf_ht * scale);
+
+    // due to the forced rounding above, we need to recompute scaling
+    scale = fmaxf((float)img_width / (float)buf_wd, (float)img_height / (float)buf_ht);
+  }
+  else if(zoom == DT_THUMBTABLE_ZOOM_TWICE)
+  {
+    // NOTE: we upscale the image surface, which means we will oversample
+    // the full-res input buffer
+    scale = 2.f;
+    img_width = roundf(buf_wd * scale);
+    img_height = roundf(buf_ht * scale);
+  }
+
+  cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, img_width, img_height);
+
+  const int32_t stride = cairo_format_stride_for_width(CAIRO_FORMAT_RGB24, buf_wd);
+  cairo_surface_t *tmp_surface = cairo_image_surface_create_for_data(rgbbuf, CAIRO_FORMAT_RGB24, buf_wd, buf_ht, stride);
+  if(IS_NULL_PTR(tmp_surface))
+  {
+    cairo_surface_destroy(surface);
+    return NULL;
+  }
+
+  // draw the image scaled:
+  cairo_t *cr = cairo_create(surface);
+  cairo_scale(cr, scale, scale);
+  cairo_set_source_surface(cr, tmp_surface, 0, 0);
+
+  // set filter no nearest:
+  // in skull mode, we want to see big pixels.
+  // in 1 iir mode for the right mip, we want to see exactly what the pipe gave us, 1:1 pixel for pixel.
+  // in between, filtering just makes stuff go unsharp.
+  if((buf_wd <= 8 && buf_ht <= 8)
+      || fabsf(scale - 1.0f) < 0.01f
+      || zoom == DT_THUMBTABLE_ZOOM_TWICE)
+    cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_NEAREST);
+  else
+    cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_BEST);
+
+  cairo_paint(cr);
+  cairo_surface_destroy(tmp_surface);
+  cairo_destroy(cr);
+
+  /* The async/shared surface path returns pixel-sized Cairo image surfaces.
+   * Publish the widget PPD on the finished surface so GUI callers can place it
+   * in logical coordinates without re-deriving HiDPI scaling on every draw. */
+  cairo_surface_set_device_scale(surface, dt_gui_get_global()->ppd, dt_gui_get_global()->ppd);
+
+  return surface;
+}
+
 static dt_view_surface_value_t _view_image_get_surface_internal(int32_t imgid, int width, int height,
                                                                 cairo_surface_t **surface, int zoom,
                                                                 dt_atomic_int *shutdown)
@@ -1100,31 +1164,6 @@ static dt_view_surface_value_t _view_image_get_surface_internal(int32_t imgid, i
     return DT_VIEW_SURFACE_KO;
   }
 
-  // so we create a new image surface to return
-  float scale = 1.f;
-  int img_width = buf_wd;
-  int img_height = buf_ht;
-
-  if(zoom == DT_THUMBTABLE_ZOOM_FIT)
-  {
-    scale = fminf((float)width / (float)buf_wd, (float)height / (float)buf_ht) * dt_gui_get_global()->ppd;
-    img_width = roundf(buf_wd * scale);
-    img_height = roundf(buf_ht * scale);
-
-    // due to the forced rounding above, we need to recompute scaling
-    scale = fmaxf((float)img_width / (float)buf_wd, (float)img_height / (float)buf_ht);
-  }
-  else if(zoom == DT_THUMBTABLE_ZOOM_TWICE)
-  {
-    // NOTE: we upscale the image surface, which means we will oversample
-    // the full-res input buffer
-    scale = 2.f;
-    img_width = roundf(buf_wd * scale);
-    img_height = roundf(buf_ht * scale);
-  }
-
-  *surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, img_width, img_height);
-
   // we transfer cached image on a cairo_surface (with colorspace transform if needed)
   uint8_t *rgbbuf = (uint8_t *)calloc((size_t)buf_wd * buf_ht * 4, sizeof(uint8_t));
   if(IS_NULL_PTR(rgbbuf))
@@ -1140,38 +1179,14 @@ static dt_view_surface_value_t _view_image_get_surface_internal(int32_t imgid, i
   dt_colorprofiles_rgba8_to_display_bgra8(buf.buf, rgbbuf, buf.width, buf.height, buf.color_space);
   dt_mipmap_cache_release(&buf);
 
-  const int32_t stride = cairo_format_stride_for_width(CAIRO_FORMAT_RGB24, buf_wd);
-  cairo_surface_t *tmp_surface = cairo_image_surface_create_for_data(rgbbuf, CAIRO_FORMAT_RGB24, buf_wd, buf_ht, stride);
-  if(IS_NULL_PTR(tmp_surface))
+  *surface = _view_surface_from_display_buffer(rgbbuf, buf_wd, buf_ht, width, height, zoom);
+  if(IS_NULL_PTR(*surface))
   {
     dt_free(rgbbuf);
     return ret;
   }
-
-  // draw the image scaled:
-  cairo_t *cr = cairo_create(*surface);
-  cairo_scale(cr, scale, scale);
-  cairo_set_source_surface(cr, tmp_surface, 0, 0);
-
-  // set filter no nearest:
-  // in skull mode, we want to see big pixels.
-  // in 1 iir mode for the right mip, we want to see exactly what the pipe gave us, 1:1 pixel for pixel.
-  // in between, filtering just makes stuff go unsharp.
-  if((buf_wd <= 8 && buf_ht <= 8)
-      || fabsf(scale - 1.0f) < 0.01f
-      || zoom == DT_THUMBTABLE_ZOOM_TWICE)
-    cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_NEAREST);
-  else
-    cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_BEST);
-
-  cairo_paint(cr);
-  cairo_surface_destroy(tmp_surface);
-  cairo_destroy(cr);
-
-  /* The async/shared surface path returns pixel-sized Cairo image surfaces.
-   * Publish the widget PPD on the finished surface so GUI callers can place it
-   * in logical coordinates without re-deriving HiDPI scaling on every draw. */
-  cairo_surface_set_device_scale(*surface, dt_gui_get_global()->ppd, dt_gui_get_global()->ppd);
+  const int img_width = cairo_image_surface_get_width(*surface);
+  const int img_height = cairo_image_surface_get_height(*surface);
 
   // we consider skull as ok as the image hasn't to be reloaded
   if(buf_wd <= 8 && buf_ht <= 8)
@@ -1211,6 +1226,31 @@ dt_view_surface_value_t dt_view_image_get_surface(int32_t imgid, int width, int
   return _view_image_get_surface_internal(imgid, width, height, surface, zoom, NULL);
 }
 
+dt_view_surface_value_t dt_view_image_get_preview_surface(int32_t imgid, int width, int height,
+                                                          cairo_surface_t **surface)
+{
+  *surface = NULL;
+  const float ppd = dt_gui_get_global()->ppd;
+  const dt_mipmap_size_t mip = dt_mipmap_cache_get_matching_size(ceilf(width * ppd), ceilf(height * ppd), imgid);
+
+  uint8_t *preview = NULL;
+  uint32_t buf_wd = 0, buf_ht = 0;
+  dt_colorspaces_color_profile_type_t color_space = DT_COLORSPACE_NONE;
+  if(dt_mipmap_cache_get_preview(imgid, mip, &preview, &buf_wd, &buf_ht, &color_space))
+    return DT_VIEW_SURFACE_KO;
+
+  uint8_t *rgbbuf = (uint8_t *)calloc((size_t)buf_wd * buf_ht * 4, sizeof(uint8_t));
+  if(rgbbuf)
+  {
+    dt_colorprofiles_rgba8_to_display_bgra8(preview, rgbbuf, buf_wd, buf_ht, color_space);
+    *surface = _view_surface_from_display_buffer(rgbbuf, buf_wd, buf_ht, width, height, DT_THUMBTABLE_ZOOM_FIT);
+  }
+  dt_free_align(preview);
+  dt_free(rgbbuf);
+
+  return *surface ? DT_VIEW_SURFACE_OK : DT_VIEW_SURFACE_KO;
+}
+
 char* dt_view_extend_modes_str(const char * name, const gboolean is_hdr, const gboolean is_bw, const gboolean is_bw_flow)
 {
   char* upcase = g_ascii_strup(name, -1);  // extension in capital letters to avoid character descenders
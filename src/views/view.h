@@ -174,6 +174,11 @@ char* dt_view_extend_modes_str(const char * name, const gboolean is_hdr, const g
 /** expose an image and return a cair0_surface. */
 dt_view_surface_value_t dt_view_image_get_surface(int32_t imgid, int width, int height, cairo_surface_t **surface,
                                                   int zoom);
+/** quick stand-in for a thumbnail that needs the pipeline, fitting a width x height widget, or
+ * DT_VIEW_SURFACE_KO when there is none or the thumbnail comes cheap anyway. See
+ * dt_mipmap_cache_get_preview(). */
+dt_view_surface_value_t dt_view_image_get_preview_surface(int32_t imgid, int width, int height,
+                                                          cairo_surface_t **surface);
 void dt_view_image_surface_fetcher_init(dt_view_image_surface_fetcher_t *fetcher);
 void dt_view_image_surface_fetcher_cleanup(dt_view_image_surface_fetcher_t *fetcher);
 void dt_view_image_surface_fetcher_invalidate(dt_view_image_surface_fetcher_t *fetcher, cairo_surface_t **target);
@@ -43,11 +43,21 @@ static inline float uint8_to_float(const uint8_t i)
 int dt_focuspeaking(cairo_t *cr,
                     uint8_t *const restrict image,
                     const int buf_width, const int buf_height,
-                    gboolean draw,
+                    gboolean draw, dt_scratch_pool_t *scratch,
                     float *x, float *y)
 {
-  float *const restrict luma = dt_alloc_align(sizeof(float) * (size_t)buf_width * buf_height);
-  float *const restrict luma_ds = dt_alloc_align(sizeof(float) * (size_t)buf_width * buf_height);
+  // The barycenter alone does not need every pixel: without an overlay to draw, the analysis
+  // runs on a half-size luma, which is a quarter of the work for a centering nobody can tell apart.
+  const int scale = (!draw && buf_width >= 256 && buf_height >= 256) ? 2 : 1;
+  const size_t width = buf_width / scale;
+  const size_t height = buf_height / scale;
+
+  // the kernels below reach 8 pixels in from the borders
+  if(width <= 16 || height <= 16) return 0;
+
+  const size_t npixels = width * height;
+  float *const restrict luma = dt_scratch_pool_get(scratch, sizeof(float) * npixels);
+  float *const restrict luma_ds = dt_scratch_pool_get(scratch, sizeof(float) * npixels);
   uint8_t *restrict focus_peaking = NULL;
   int err = 0;
   if(IS_NULL_PTR(luma_ds) || IS_NULL_PTR(luma))
@@ -56,23 +66,27 @@ int dt_focuspeaking(cairo_t *cr,
     goto error_early;
   }
 
-  const size_t npixels = (size_t)buf_height * buf_width;
-  // Create a luma buffer as the euclidian norm of RGB channels
-  __OMP_PARALLEL_FOR_SIMD__(aligned(image, luma:64))
-  for(size_t index = 0; index < npixels; index++)
-    {
-      const size_t index_RGB = index * 4;
-
-      // remove gamma 2.2 and take the square is equivalent to this:
-      const float exponent = 2.0f * 2.2f;
+  // Removing gamma 2.2 and squaring is a power of 4.4, of 256 possible values only
+  float power[256];
+  for(int k = 0; k < 256; k++) power[k] = powf(uint8_to_float(k), 2.0f * 2.2f);
 
-      luma[index] = sqrtf( powf(uint8_to_float(image[index_RGB]), exponent) +
-                           powf(uint8_to_float(image[index_RGB + 1]), exponent) +
-                           powf(uint8_to_float(image[index_RGB + 2]), exponent) );
+  // Create a luma buffer as the euclidian norm of RGB channels, averaged over scale x scale pixels
+  __OMP_PARALLEL_FOR__(collapse(2))
+  for(size_t i = 0; i < height; ++i)
+    for(size_t j = 0; j < width; ++j)
+    {
+      float sum = 0.f;
+      for(int ii = 0; ii < scale; ii++)
+        for(int jj = 0; jj < scale; jj++)
+        {
+          const uint8_t *const pixel = image + ((i * scale + ii) * buf_width + j * scale + jj) * 4;
+          sum += sqrtf(power[pixel[0]] + power[pixel[1]] + power[pixel[2]]);
+        }
+      luma[i * width + j] = sum / (float)(scale * scale);
     }
 
   // Prefilter noise
-  if(fast_eigf_surface_blur(luma, buf_width, buf_height, 12, 0.00005f, 4, DT_GF_BLENDING_LINEAR, 1, 0.0f, exp2f(-8.0f), 1.0f) != 0)
+  if(fast_eigf_surface_blur(luma, width, height, 12, 0.00005f, 4, DT_GF_BLENDING_LINEAR, 1, 0.0f, exp2f(-8.0f), 1.0f) != 0)
   {
     err = 1;
     goto error_early;
@@ -83,11 +97,11 @@ int dt_focuspeaking(cairo_t *cr,
   float x_integral = 0.f;
   float y_integral = 0.f;
   __OMP_PARALLEL_FOR__(collapse(2) reduction(+:mass, x_integral, y_integral))
-  for(size_t i = 0; i < buf_height; ++i)
-    for(size_t j = 0; j < buf_width; ++j)
+  for(size_t i = 0; i < height; ++i)
+    for(size_t j = 0; j < width; ++j)
     {
-      size_t index = i * buf_width + j;
-      if(i < 8 || i >= buf_height - 8 || j < 8 || j > buf_width - 8)
+      size_t index = i * width + j;
+      if(i < 8 || i >= height - 8 || j < 8 || j > width - 8)
       {
         // ensure defined value for borders
         luma_ds[index] = 0.0f;
@@ -113,28 +127,28 @@ int dt_focuspeaking(cairo_t *cr,
         for(int ii = 0; ii < 7; ii++)
           for(int jj = 0; jj < 7; jj++)
           {
-            laplacian_close += luma[(i - 3 + ii) * buf_width + (j - 3 + jj)] * kernel[ii][jj];
-            laplacian_far += luma[(i + (-3 + ii) * 2) * buf_width + (j + (-3 + jj) * 2)] * kernel[ii][jj];
+            laplacian_close += luma[(i - 3 + ii) * width + (j - 3 + jj)] * kernel[ii][jj];
+            laplacian_far += luma[(i + (-3 + ii) * 2) * width + (j + (-3 + jj) * 2)] * kernel[ii][jj];
           }
 
         // gradient on principal directions
-        const float gradient_1_y = (luma[(i - 2) * buf_width + (j)] - luma[(i + 2) * buf_width + (j)]) / 4.f;
-        const float gradient_1_x = (luma[(i) * buf_width + (j - 2)] - luma[(i) * buf_width + (j + 2)]) / 4.f;
+        const float gradient_1_y = (luma[(i - 2) * width + (j)] - luma[(i + 2) * width + (j)]) / 4.f;
+        const float gradient_1_x = (luma[(i) * width + (j - 2)] - luma[(i) * width + (j + 2)]) / 4.f;
         const float TV_1 = dt_fast_hypotf(gradient_1_x, gradient_1_y);
 
         // gradient on diagonals
-        const float gradient_2_y = (luma[(i - 2) * buf_width + (j - 2)] - luma[(i + 2) * buf_width + (j + 2)]) / (2.f * sqrtf(2.f));
-        const float gradient_2_x = (luma[(i - 2) * buf_width + (j + 2)] - luma[(i + 2) * buf_width + (j - 2)]) / (2.f * sqrtf(2.f));
+        const float gradient_2_y = (luma[(i - 2) * width + (j - 2)] - luma[(i + 2) * width + (j + 2)]) / (2.f * sqrtf(2.f));
+        const float gradient_2_x = (luma[(i - 2) * width + (j + 2)] - luma[(i + 2) * width + (j - 2)]) / (2.f * sqrtf(2.f));
         const float TV_2 = dt_fast_hypotf(gradient_2_x, gradient_2_y);
 
         // gradient on principal directions
-        const float gradient_3_y = (luma[(i - 1) * buf_width + (j)] - luma[(i + 1) * buf_width + (j)]) / 2.f;
-        const float gradient_3_x = (luma[(i) * buf_width + (j - 1)] - luma[(i) * buf_width + (j + 1)]) / 2.f;
+        const float gradient_3_y = (luma[(i - 1) * width + (j)] - luma[(i + 1) * width + (j)]) / 2.f;
+        const float gradient_3_x = (luma[(i) * width + (j - 1)] - luma[(i) * width + (j + 1)]) / 2.f;
         const float TV_3 = dt_fast_hypotf(gradient_3_x, gradient_3_y);
 
         // gradient on diagonals
-        const float gradient_4_y = (luma[(i - 1) * buf_width + (j - 1)] - luma[(i + 1) * buf_width + (j + 1)]) / (sqrtf(2.f));
-        const float gradient_4_x = (luma[(i - 1) * buf_width + (j + 1)] - luma[(i + 1) * buf_width + (j - 1)]) / (sqrtf(2.f));
+        const float gradient_4_y = (luma[(i - 1) * width + (j - 1)] - luma[(i + 1) * width + (j + 1)]) / (sqrtf(2.f));
+        const float gradient_4_x = (luma[(i - 1) * width + (j + 1)] - luma[(i + 1) * width + (j - 1)]) / (sqrtf(2.f));
         const float TV_4 = dt_fast_hypotf(gradient_4_x, gradient_4_y);
 
         // Total Variation = norm(grad_x, grad_y). We use it as a metric of global contrast since it doesn't use the current pixel.
@@ -151,78 +165,69 @@ int dt_focuspeaking(cairo_t *cr,
       }
     }
 
-  // Compute the coordinates of the details barycenter
-  if(x) *x = CLAMP(x_integral / mass, 0, buf_height);
-  if(y) *y = CLAMP(y_integral / mass, 0, buf_height);
+  // Compute the coordinates of the details barycenter, in image pixels
+  if(x) *x = CLAMP(scale * x_integral / mass, 0, buf_width);
+  if(y) *y = CLAMP(scale * y_integral / mass, 0, buf_height);
 
   // Stop there if no drawing is requested
   if(!draw)
   {
-    dt_free_align(luma);
-    dt_free_align(luma_ds);
+    dt_scratch_pool_put(scratch, luma);
+    dt_scratch_pool_put(scratch, luma_ds);
     return 0;
   }
 
-  // Plain aligned allocation: this is a transient GUI overlay buffer, not pipeline memory,
-  // so it has no business being charged against the pixelpipe cache budget.
-  focus_peaking = dt_alloc_align(sizeof(uint8_t) * buf_width * buf_height * 4);
+  // Not pipeline memory: a transient GUI overlay, kept in the caller's pool between frames rather
+  // than charged against the pixelpipe cache budget. Same size as the luma buffers, so it reuses them.
+  focus_peaking = dt_scratch_pool_get(scratch, sizeof(uint8_t) * npixels * 4);
   if(IS_NULL_PTR(focus_peaking))
   {
     err = 1;
     goto error;
   }
 
-  // Dilate the mask to improve connectivity
+  // Dilate the mask to improve connectivity. The 3x3 kernel this used to run only ever had its
+  // first tap set, { { 1.f } }, which amounts to moving the mask one pixel down and right.
   __OMP_PARALLEL_FOR__(collapse(2))
-  for(size_t i = 0; i < buf_height; ++i)
-    for(size_t j = 0; j < buf_width; ++j)
+  for(size_t i = 0; i < height; ++i)
+    for(size_t j = 0; j < width; ++j)
     {
-      size_t index = i * buf_width + j;
-      if(i < 8 || i >= buf_height - 8 || j < 8 || j > buf_width - 8)
-      {
-        // ensure defined value for borders
-        luma[index] = 0.0f;
-      }
+      const size_t index = i * width + j;
+      if(i < 8 || i >= height - 8 || j < 8 || j > width - 8)
+        luma[index] = 0.0f; // ensure defined value for borders
       else
-      {
-        // Dilating kernel
-        static const float kernel[3][3] = { { 1.f } };
-        luma[index] = 0.f;
-        for(int ii = 0; ii < 3; ii++)
-          for(int jj = 0; jj < 3; jj++)
-            luma[index] += luma_ds[(i - 1 + ii) * buf_width + (j - 1 + jj)] * kernel[ii][jj];
-      }
+        luma[index] = luma_ds[(i - 1) * width + (j - 1)];
     }
 
   // Anti-aliasing
-  if(dt_box_mean(luma, buf_height, buf_width, 1, 3, 1) != 0)
+  if(dt_box_mean(luma, height, width, 1, 3, 1) != 0)
   {
     err = 1;
     goto error;
   }
 
   // Postfilter to connect isolated dots and draw lines
-  if(fast_eigf_surface_blur(luma, buf_width, buf_height, 12, 0.000005f, 1, DT_GF_BLENDING_LINEAR, 1, 0.0f, exp2f(-8.0f), 1.0f) != 0)
+  if(fast_eigf_surface_blur(luma, width, height, 12, 0.000005f, 1, DT_GF_BLENDING_LINEAR, 1, 0.0f, exp2f(-8.0f), 1.0f) != 0)
   {
     err = 1;
     goto error;
   }
 
-  // Compute the laplacian mean over the picture
-  float TV_sum = 0.0f;
-  __OMP_PARALLEL_FOR_SIMD__(collapse(2) aligned(luma:64) reduction(+:TV_sum))
-  for(size_t i = 8; i < buf_height - 8; ++i)
-    for(size_t j = 8; j < buf_width - 8; ++j)
-      TV_sum += luma[i * buf_width + j] / ((float)(buf_height - 16) * (float)(buf_width - 16));
-
-  // Compute the standard deviation
-  float sigma = 0.0f;
-  __OMP_PARALLEL_FOR_SIMD__(collapse(2) aligned(focus_peaking, luma:64) reduction(+:sigma))
-  for(size_t i = 8; i < buf_height - 8; ++i)
-    for(size_t j = 8; j < buf_width - 8; ++j)
-       sigma += sqf(luma[i * buf_width + j] - TV_sum) / ((float)(buf_height - 16) * (float)(buf_width - 16));
+  // Compute the laplacian mean and standard deviation over the picture, in one pass
+  double sum = 0.;
+  double sum_sq = 0.;
+  __OMP_PARALLEL_FOR__(collapse(2) reduction(+:sum, sum_sq))
+  for(size_t i = 8; i < height - 8; ++i)
+    for(size_t j = 8; j < width - 8; ++j)
+    {
+      const double TV = luma[i * width + j];
+      sum += TV;
+      sum_sq += TV * TV;
+    }
 
-  sigma = sqrtf(sigma);
+  const double samples = (double)(height - 16) * (double)(width - 16);
+  const float TV_sum = sum / samples;
+  const float sigma = sqrt(fmax(sum_sq / samples - (double)TV_sum * TV_sum, 0.));
 
   // Set the sharpness thresholds
   const float six_sigma = TV_sum + 4.f * sigma;
@@ -231,15 +236,15 @@ int dt_focuspeaking(cairo_t *cr,
 
   // Prepare the focus-peaking image overlay
   __OMP_PARALLEL_FOR__(collapse(2))
-  for(size_t i = 0; i < buf_height; ++i)
-    for(size_t j = 0; j < buf_width; ++j)
+  for(size_t i = 0; i < height; ++i)
+    for(size_t j = 0; j < width; ++j)
     {
       static const uint8_t yellow[4] = { 0, 255, 255, 255 };
       static const uint8_t green[4]  = { 0, 255,   0, 255 };
       static const uint8_t blue[4]   = { 255, 0,   0, 255 };
 
-      const size_t index = (i * buf_width + j) * 4;
-      const float TV = luma[(i * buf_width + j)];
+      const size_t index = (i * width + j) * 4;
+      const float TV = luma[(i * width + j)];
 
       if(TV > six_sigma)
       {
@@ -268,21 +273,21 @@ int dt_focuspeaking(cairo_t *cr,
   cairo_rectangle(cr, 0, 0, buf_width, buf_height);
   cairo_surface_t *surface = cairo_image_surface_create_for_data((unsigned char *)focus_peaking,
                                                                  CAIRO_FORMAT_ARGB32,
-                                                                 buf_width, buf_height,
-                                                                 cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, buf_width));
+                                                                 width, height,
+                                                                 cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width));
   cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
   cairo_set_source_surface(cr, surface, 0.0, 0.0);
   cairo_pattern_set_filter(cairo_get_source (cr), dt_widget_image_filter());
   cairo_fill(cr);
   cairo_restore(cr);
 
-  // cleanup
+  // cleanup: the surface must be gone before its pixels go back to the pool
   cairo_surface_destroy(surface);
 
 error:
-  dt_free_align(focus_peaking);
+  dt_scratch_pool_put(scratch, focus_peaking);
 error_early:
-  dt_free_align(luma);
-  dt_free_align(luma_ds);
+  dt_scratch_pool_put(scratch, luma);
+  dt_scratch_pool_put(scratch, luma_ds);
   return err;
 }
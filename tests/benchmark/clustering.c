@@ -0,0 +1,68 @@
+/*
+    This file is part of Ansel,
+    Copyright (C) 2026 Aurélien PIERRE.
+
+    Ansel is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ansel is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ansel.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** ansel-bench-clustering: dt_cluster_dbscan() on a million synthetic points.
+ *
+ * A thousand square blobs of 900 points on a grid, over 100 000 points of background. Prints the
+ * wall time of the clustering, and exits with status 1 if the blobs don't come out as one cluster
+ * each. A time that grows far faster than the point count is the quadratic neighbour search
+ * coming back. The correctness of the clustering itself is src/tests/unittests/test_clustering.c.
+ */
+
+#include "math/clustering.h"
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(void)
+{
+  const int blobs_x = 40, blobs_y = 25, per_blob = 900, background = 100000;
+  const int count = blobs_x * blobs_y * per_blob + background;
+  GRand *rand = g_rand_new_with_seed(1000000);
+  double *xy = g_new(double, 2 * count);
+  int *labels = g_new(int, count);
+
+  int i = 0;
+  for(int b = 0; b < blobs_x * blobs_y; b++)
+    for(int k = 0; k < per_blob; k++, i++)
+    {
+      xy[2 * i] = 10. * (b % blobs_x) + g_rand_double_range(rand, 4.5, 5.5);
+      xy[2 * i + 1] = 10. * (b / blobs_x) + g_rand_double_range(rand, 4.5, 5.5);
+    }
+  for(; i < count; i++)
+  {
+    xy[2 * i] = g_rand_double_range(rand, 0., 10. * blobs_x);
+    xy[2 * i + 1] = g_rand_double_range(rand, 0., 10. * blobs_y);
+  }
+
+  // about 36 neighbours inside a blob, 0.04 in the background
+  const gint64 start = g_get_monotonic_time();
+  const int clusters = dt_cluster_dbscan(xy, count, 0.1, 5, labels);
+  const gint64 end = g_get_monotonic_time();
+  printf("dbscan, %d points: %" G_GINT64_FORMAT " ms\n", count, (end - start) / 1000);
+
+  int failed = clusters != blobs_x * blobs_y;
+  for(int b = 0; b < blobs_x * blobs_y && !failed; b++) failed = labels[b * per_blob] != b;
+  if(failed) fprintf(stderr, "dbscan: %d clusters, expected one per blob (%d)\n", clusters, blobs_x * blobs_y);
+
+  g_free(xy);
+  g_free(labels);
+  g_rand_free(rand);
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,398 @@
+/*
+    This file is part of Ansel,
+    Copyright (C) 2026 Aurélien PIERRE.
+
+    Ansel is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ansel is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ansel.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** ansel-bench-decode: throughput and latency of the image loaders, per file format.
+ *
+ * Decodes files N at a time on a GThreadPool, each decoder with its share of the OpenMP threads,
+ * and reads the next files ahead while the current ones decompress. See README.txt.
+ */
+
+#include <glib.h>    // for GPtrArray, GHashTable, GMutex
+#include <gtk/gtk.h> // for gtk_init_check
+#include <libintl.h> // for bind_textdomain_codeset, etc
+#include <limits.h>  // for PATH_MAX
+#include <stdio.h>   // for fprintf, printf, stderr
+#include <stdlib.h>  // for exit, EXIT_FAILURE
+#include <string.h>  // for strcmp
+
+#include "darktable.h"          // for dt_init, dt_cleanup
+#include "common/file_location.h"
+#include "common/image_extensions.h" // for dt_supported_image
+#include "common/times.h"       // for dt_get_wtime
+#include "config.h"             // for GETTEXT_PACKAGE, etc
+#include "common/image.h"
+#include "imageio/imageio_core.h"
+#include "imageio/imageio_readahead.h"
+#include "metadata/exif.h"
+#include "system/atomic.h"
+#include "system/mem_alloc.h"
+#include "system/openmp.h"
+
+#include <glib/gstdio.h>
+
+#ifdef __APPLE__
+#include "osx/osx.h"
+#endif
+
+#ifdef _WIN32
+#include "win/main_wrapper.h"
+#endif
+
+/* What one decode gave, handed to the callback from the decoding thread as soon as the file is
+ * decoded. Calls for different files run concurrently and in no particular order; the image and
+ * the buffer are released when the callback returns. */
+typedef struct _batch_result_t
+{
+  const char *filename;
+  dt_imageio_retval_t ret;
+  size_t file_size;      // bytes on disk
+  double seconds;        // wall time of dt_imageio_open_standalone(), read included
+  const dt_image_t *img; // as filled by the decoder
+  const dt_mipmap_buffer_t *buf; // the decoded pixels, NULL buf->buf when the decode failed
+} _batch_result_t;
+
+typedef void (*_batch_callback_t)(const _batch_result_t *result, void *user_data);
+
+typedef struct _batch_t
+{
+  const char *const *filenames;
+  int count;
+  int jobs;
+  int threads; // OpenMP threads of each decoder
+  _batch_callback_t done;
+  void *user_data;
+  dt_atomic_int failed;
+} _batch_t;
+
+static void _batch_decode_one(gpointer data, gpointer user_data)
+{
+  _batch_t *batch = (_batch_t *)user_data;
+  const int k = GPOINTER_TO_INT(data) - 1;
+  const char *filename = batch->filenames[k];
+
+  // the file that will take this decoder's slot next starts reading now, while this one decodes
+  if(k + batch->jobs < batch->count) dt_imageio_readahead(batch->filenames[k + batch->jobs]);
+
+#ifdef _OPENMP
+  // pool threads are not control workers: give them their share explicitly, every time
+  omp_set_num_threads(batch->threads);
+#endif
+
+  GStatBuf st;
+  _batch_result_t result = { .filename = filename, .ret = DT_IMAGEIO_CACHE_FULL };
+  if(g_stat(filename, &st) == 0) result.file_size = st.st_size;
+
+  dt_mipmap_buffer_t buf = { 0 };
+  dt_image_t *img = dt_alloc_align(sizeof(dt_image_t)); // dt_image_t is 64-aligned, see #1212
+  if(!IS_NULL_PTR(img))
+  {
+    dt_image_init(img);
+    gchar *basename = g_path_get_basename(filename);
+    g_strlcpy(img->filename, basename, sizeof(img->filename));
+    dt_free(basename);
+    dt_exif_read(img, filename);
+
+    const double start = dt_get_wtime();
+    result.ret = dt_imageio_open_standalone(img, filename, &buf);
+    result.seconds = dt_get_wtime() - start;
+  }
+
+  result.img = img;
+  result.buf = &buf;
+  if(result.ret != DT_IMAGEIO_OK) dt_atomic_add_int(&batch->failed, 1);
+  if(batch->done) batch->done(&result, batch->user_data);
+
+  dt_imageio_close_standalone(&buf);
+  dt_free_align(img);
+}
+
+/* Decode filenames into buffers owned by the batch, jobs files at a time, through
+ * dt_imageio_open_standalone(): no cache involvement, so this measures the loaders alone. The
+ * OpenMP threads are shared between the decoders, so that rawspeed's slice-parallel decompressors
+ * don't oversubscribe the machine. Returns the number of files that failed to decode. */
+static int _decode_batch(const char *const *filenames, const int count, const int jobs,
+                         _batch_callback_t done, void *user_data)
+{
+  if(IS_NULL_PTR(filenames) || count <= 0) return 0;
+
+  _batch_t batch = { .filenames = filenames, .count = count, .done = done, .user_data = user_data };
+  batch.jobs = CLAMP(jobs, 1, count);
+  batch.threads = MAX(1, dt_get_num_openmp_threads() / batch.jobs);
+  dt_atomic_set_int(&batch.failed, 0);
+
+  for(int k = 0; k < batch.jobs; k++) dt_imageio_readahead(filenames[k]);
+
+  // a FIFO: files start decoding in the order given, which is the order they are read ahead in
+  GThreadPool *pool = g_thread_pool_new(_batch_decode_one, &batch, batch.jobs, FALSE, NULL);
+  for(int k = 0; k < count; k++) g_thread_pool_push(pool, GINT_TO_POINTER(k + 1), NULL);
+  g_thread_pool_free(pool, FALSE, TRUE);
+
+  return dt_atomic_get_int(&batch.failed);
+}
+
+/* Latencies and volume of one file format, keyed by lowercase extension. */
+typedef struct _format_stats_t
+{
+  int failed;
+  size_t bytes;
+  double seconds;
+  GArray *latencies; // double, seconds, decoded files only
+} _format_stats_t;
+
+typedef struct _bench_t
+{
+  GMutex lock;
+  GHashTable *formats; // gchar *extension -> _format_stats_t *
+  int count;
+  int counter;
+} _bench_t;
+
+static void _format_stats_free(gpointer data)
+{
+  _format_stats_t *stats = (_format_stats_t *)data;
+  g_array_free(stats->latencies, TRUE);
+  dt_free(stats);
+}
+
+static void _decoded(const _batch_result_t *result, void *user_data)
+{
+  _bench_t *bench = (_bench_t *)user_data;
+  const char *dot = strrchr(result->filename, '.');
+  gchar *ext = g_ascii_strdown(dot ? dot + 1 : "?", -1);
+
+  g_mutex_lock(&bench->lock);
+  _format_stats_t *stats = g_hash_table_lookup(bench->formats, ext);
+  if(IS_NULL_PTR(stats))
+  {
+    stats = g_new0(_format_stats_t, 1);
+    stats->latencies = g_array_new(FALSE, FALSE, sizeof(double));
+    g_hash_table_insert(bench->formats, g_strdup(ext), stats);
+  }
+
+  if(result->ret == DT_IMAGEIO_OK)
+  {
+    stats->bytes += result->file_size;
+    stats->seconds += result->seconds;
+    g_array_append_val(stats->latencies, result->seconds);
+  }
+  else
+    stats->failed++;
+
+  bench->counter++;
+  if(result->ret == DT_IMAGEIO_OK)
+    fprintf(stderr, "[%d/%d] %s: %dx%d, %.1f MB in %.0f ms\n", bench->counter, bench->count, result->filename,
+            result->buf->width, result->buf->height, result->file_size / 1e6, result->seconds * 1e3);
+  else
+    fprintf(stderr, "[%d/%d] %s: failed to decode\n", bench->counter, bench->count, result->filename);
+  g_mutex_unlock(&bench->lock);
+
+  dt_free(ext);
+}
+
+static int _compare_double(gconstpointer a, gconstpointer b)
+{
+  const double x = *(const double *)a;
+  const double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// nearest rank, on a sorted array
+static double _percentile(const GArray *sorted, const double q)
+{
+  if(sorted->len == 0) return 0.;
+  const guint rank = (guint)(q * (sorted->len - 1) + 0.5);
+  return g_array_index(sorted, double, rank);
+}
+
+static void _print_report(_bench_t *bench, const double wall)
+{
+  size_t total_bytes = 0;
+  GList *extensions = g_list_sort(g_hash_table_get_keys(bench->formats), (GCompareFunc)g_strcmp0);
+
+  printf("%-8s %7s %7s %10s %9s %9s %9s %9s\n", "format", "files", "failed", "MB", "MB/s", "mean ms",
+         "p50 ms", "p95 ms");
+  for(GList *iter = extensions; iter; iter = g_list_next(iter))
+  {
+    _format_stats_t *stats = g_hash_table_lookup(bench->formats, iter->data);
+    g_array_sort(stats->latencies, _compare_double);
+    const guint decoded = stats->latencies->len;
+    // per decoder: what one file at a time sustains, whatever --jobs was
+    printf("%-8s %7u %7d %10.1f %9.1f %9.1f %9.1f %9.1f\n", (const char *)iter->data, decoded + stats->failed,
+           stats->failed, stats->bytes / 1e6, stats->seconds > 0. ? stats->bytes / 1e6 / stats->seconds : 0.,
+           decoded ? stats->seconds * 1e3 / decoded : 0., _percentile(stats->latencies, 0.5) * 1e3,
+           _percentile(stats->latencies, 0.95) * 1e3);
+    total_bytes += stats->bytes;
+  }
+  g_list_free(extensions);
+
+  // and what the whole batch sustained, I/O overlap and parallel decoders included
+  printf("\n%d files, %.1f MB decoded in %.2f s: %.1f MB/s\n", bench->count, total_bytes / 1e6, wall,
+         wall > 0. ? total_bytes / 1e6 / wall : 0.);
+}
+
+// g_ptr_array_sort() hands over pointers to the elements
+static int _compare_path(gconstpointer a, gconstpointer b)
+{
+  return g_strcmp0(*(const gchar *const *)a, *(const gchar *const *)b);
+}
+
+// a file as given, or the supported images directly inside a folder, in name order
+static void _add_path(GPtrArray *files, const char *path)
+{
+  if(!g_file_test(path, G_FILE_TEST_IS_DIR))
+  {
+    g_ptr_array_add(files, g_strdup(path));
+    return;
+  }
+
+  GDir *dir = g_dir_open(path, 0, NULL);
+  if(IS_NULL_PTR(dir)) return;
+
+  GPtrArray *entries = g_ptr_array_new();
+  const gchar *name = NULL;
+  while((name = g_dir_read_name(dir)))
+  {
+    gchar *filename = g_build_filename(path, name, NULL);
+    if(g_file_test(filename, G_FILE_TEST_IS_REGULAR) && dt_supported_image(name))
+      g_ptr_array_add(entries, filename);
+    else
+      dt_free(filename);
+  }
+  g_dir_close(dir);
+
+  g_ptr_array_sort(entries, _compare_path);
+  for(guint k = 0; k < entries->len; k++) g_ptr_array_add(files, g_ptr_array_index(entries, k));
+  g_ptr_array_free(entries, TRUE);
+}
+
+static void usage(const char *progname)
+{
+  fprintf(stderr,
+          "usage: %s [-h, --help; --version]\n"
+          "  [-j, --jobs <N> (default = 1)]\n"
+          "  <file or folder> [<file or folder> ...]\n"
+          "  [--core <darktable options>]\n"
+          "\n"
+          "Decodes every file through the image loaders, N files at a time, and reports\n"
+          "the throughput and decode latency of each file format. Folders are not recursed.\n"
+          "Nothing is imported, cached or written.\n"
+          "\n"
+          "Decode latency includes the file read: run twice to measure with a warm page cache.\n",
+          progname);
+}
+
+int main(int argc, char *arg[])
+{
+#ifdef __APPLE__
+  dt_osx_prepare_environment();
+#endif
+
+  // get valid locale dir
+  dt_loc_init(NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+  char localedir[PATH_MAX] = { 0 };
+  dt_loc_get_localedir(localedir, sizeof(localedir));
+  bindtextdomain(GETTEXT_PACKAGE, localedir);
+
+  bind_textdomain_codeset(GETTEXT_PACKAGE, "UTF-8");
+  textdomain(GETTEXT_PACKAGE);
+
+  gtk_init_check(&argc, &arg);
+
+  // parse command line arguments
+  int jobs = 1;
+  GPtrArray *files = g_ptr_array_new_with_free_func(dt_free_gpointer);
+
+  int k;
+  for(k = 1; k < argc; k++)
+  {
+    if(!strcmp(arg[k], "-h") || !strcmp(arg[k], "--help"))
+    {
+      usage(arg[0]);
+      exit(EXIT_FAILURE);
+    }
+    else if(!strcmp(arg[k], "--version"))
+    {
+      printf("this is ansel-bench-decode %s\n", darktable_package_version);
+      exit(EXIT_FAILURE);
+    }
+    else if((!strcmp(arg[k], "-j") || !strcmp(arg[k], "--jobs")) && argc > k + 1)
+    {
+      k++;
+      jobs = MAX(atoi(arg[k]), 1);
+    }
+    else if(!strcmp(arg[k], "--core"))
+    {
+      // everything from here on should be passed to the core
+      k++;
+      break;
+    }
+    else
+      _add_path(files, arg[k]);
+  }
+
+  if(files->len == 0)
+  {
+    usage(arg[0]);
+    g_ptr_array_free(files, TRUE);
+    exit(EXIT_FAILURE);
+  }
+
+  int m_argc = 0;
+  char **m_arg = malloc(sizeof(char *) * (5 + argc - k + 1));
+  m_arg[m_argc++] = "ansel-bench-decode";
+  m_arg[m_argc++] = "--library";
+  m_arg[m_argc++] = ":memory:";
+  m_arg[m_argc++] = "--conf";
+  m_arg[m_argc++] = "write_sidecar_files=never";
+  for(; k < argc; k++) m_arg[m_argc++] = arg[k];
+  m_arg[m_argc] = NULL;
+
+  // init dt without gui:
+  if(dt_init(m_argc, m_arg, FALSE, TRUE))
+  {
+    dt_free(m_arg);
+    g_ptr_array_free(files, TRUE);
+    exit(EXIT_FAILURE);
+  }
+
+  _bench_t bench = { .count = files->len };
+  g_mutex_init(&bench.lock);
+  bench.formats = g_hash_table_new_full(g_str_hash, g_str_equal, dt_free_gpointer, _format_stats_free);
+
+  fprintf(stderr, "decoding %u files, %d at a time\n", files->len, MIN(jobs, (int)files->len));
+
+  const double start = dt_get_wtime();
+  _decode_batch((const char *const *)files->pdata, files->len, jobs, _decoded, &bench);
+  const double wall = dt_get_wtime() - start;
+
+  _print_report(&bench, wall);
+
+  g_hash_table_destroy(bench.formats);
+  g_mutex_clear(&bench.lock);
+  g_ptr_array_free(files, TRUE);
+
+  dt_cleanup();
+
+  dt_free(m_arg);
+}
+
+// clang-format off
+// modelines: These editor modelines have been set for all relevant files by tools/update_modelines.py
+// vim: shiftwidth=2 expandtab tabstop=2 cindent
+// kate: tab-indents: off; indent-width 2; replace-tabs on; indent-mode cstyle; remove-trailing-spaces modified;
+// clang-format on